@@ -14,7 +14,9 @@ const char* audio_get_sink_name(int id);
 int audio_is_sink_available(const char* sink_name);
 const char* audio_get_first_sink_name();
 int audio_init(const char* sink_name);
+int audio_init_export(const char *filename);
 void audio_render();
+void audio_export_render(unsigned int ms);
 void audio_close();
 
 audio_sink* audio_get_sink();
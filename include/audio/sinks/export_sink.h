@@ -0,0 +1,11 @@
+#ifndef _EXPORT_SINK_H
+#define _EXPORT_SINK_H
+
+#include "audio/sink.h"
+
+#define EXPORT_SINK_RATE 48000
+
+int export_sink_init(audio_sink *sink, const char *filename);
+void export_sink_mix(audio_sink *sink, unsigned int samples);
+
+#endif // _EXPORT_SINK_H
@@ -5,5 +5,10 @@ typedef struct controller_t controller;
 
 void ai_controller_free(controller *ctrl);
 void ai_controller_create(controller *ctrl, int difficulty);
+int ai_controller_load_stats(const char *filename);
+int ai_controller_save_stats(const char *filename);
+int ai_controller_merge_stats(const char *filename);
+void ai_controller_reset_stats();
+void ai_controller_set_training(int training);
 
 #endif
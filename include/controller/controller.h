@@ -47,7 +47,7 @@ struct ctrl_event_t {
 typedef struct controller_t controller;
 
 struct controller_t {
-    object *har;
+    object_ref har;
     list hooks;
     ctrl_event *extra_events;
     int (*tick_fun)(controller *ctrl, int ticks, ctrl_event **ev);
@@ -75,6 +75,8 @@ int controller_har_hook(controller *ctrl, har_event event);
 void controller_add_hook(controller *ctrl, controller *source, void(*fp)(controller *ctrl, int act_type));
 void controller_clear_hooks(controller *ctrl);
 void controller_free_chain(ctrl_event *ev);
+void controller_set_har(controller *ctrl, object *har);
+object* controller_get_har(controller *ctrl);
 void controller_set_repeat(controller *ctrl, int repeat);
 int controller_rumble(controller *ctrl, float magnitude, int duration);
 
@@ -2,9 +2,21 @@
 #define _REC_CONTROLLER_H
 
 #include "controller/controller.h"
+#include <stdint.h>
 #include "utils/hashmap.h"
 
+// Match setup stored in the REC header, used to bootstrap replay playback
+typedef struct rec_match_info_t {
+    int arena_id; // 0 to 4, add SCENE_ARENA0 for the scene ID
+    int speed; // 0 to 10, as in game_state_get_speed. -1 if not known.
+    uint32_t seed; // RNG seed at arena creation
+    int has_seed; // 0 if the file was not recorded by us, and seed is not known
+} rec_match_info;
+
 void rec_controller_create(controller *ctrl, int player, sd_rec_file *rec);
 void rec_controller_free(controller *ctrl);
 
+void rec_write_match_info(sd_rec_file *rec, const rec_match_info *info);
+void rec_read_match_info(const sd_rec_file *rec, rec_match_info *info);
+
 #endif // _REC_CONTROLLER_H
@@ -4,10 +4,17 @@
 typedef struct engine_init_flags_t {
     unsigned int net_mode;
     unsigned int record;
+    unsigned int train_ticks; // If > 0, run AI self-play for this many ticks
+    unsigned int ai_match; // Start in a random arena with two AI players, without training
+    unsigned int headless; // Render offscreen only, with no window
     char rec_file[255];
+    char train_file[255];
+    char frame_dir[255]; // If set, every rendered frame is saved here
+    char export_file[255]; // If set, rendered frames are exported as video here
+    char export_audio_file[255];
 } engine_init_flags;
 
-int engine_init(); // Init window, audiodevice, etc.
+int engine_init(engine_init_flags *init_flags); // Init window, audiodevice, etc.
 void engine_run(engine_init_flags *init_flags); // Run game
 void engine_close(); // Kill window, audiodev
 
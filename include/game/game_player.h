@@ -15,7 +15,7 @@
 typedef struct game_player_t {
     int har_id; // HAR_JAGUAR to HAR_NOVA
     int pilot_id; // 0 to 9
-    object *har;
+    object_ref har;
     controller *ctrl;
     surface *portrait;
     sd_pilot pilot;
@@ -2,6 +2,7 @@
 #define _GAME_STATE_TYPE_H
 
 #include "utils/vector.h"
+#include "game/protos/physics.h"
 #include "engine.h"
 
 enum {
@@ -35,6 +36,7 @@ typedef struct game_state_t {
     unsigned int int_tick; // never adjusted, used in ping calculation
     unsigned int role;
     unsigned int speed;
+    float render_alpha; // How far between the previous and the current dynamic tick to render, 0..1
     engine_init_flags *init_flags;
 
     // For screen shaking
@@ -48,11 +50,13 @@ typedef struct game_state_t {
     // Crossfade state
     int next_wait_ticks;
     int this_wait_ticks;
+    int next_hold_ticks; // Ticks spent waiting for the next scene to finish loading
 
     int next_requires_refresh; // If next frame requires a texture refresh, this should be set to 1
     int net_mode; // NET_MODE_NONE, NET_MODE_CLIENT, NET_MODE_SERVER
     scene *sc;
     vector objects;
+    physics_store bodies; // Scratch space for batched object movement
     game_player *players[2];
 } game_state;
 
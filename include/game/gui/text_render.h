@@ -55,6 +55,26 @@ typedef struct {
     bool wrap;
 } text_settings;
 
+// A character placed by the layout, relative to the top left corner of the text box
+typedef struct {
+    int16_t x;
+    int16_t y;
+    char ch;
+} text_glyph;
+
+// Text that has been wrapped and aligned into a box once. It is only laid out
+// again when the text, the box size or the layout settings change; colors,
+// opacity and shadows are taken from the settings at render time.
+typedef struct {
+    char *text;
+    int w;
+    int h;
+    text_settings settings;
+    text_glyph *glyphs;
+    int glyph_count;
+    int glyph_capacity;
+} text_layout;
+
 // New text rendering functions
 void text_defaults(text_settings *settings);
 int text_find_max_strlen(int maxchars, const char *ptr);
@@ -63,6 +83,11 @@ void text_render_char(const text_settings *settings, int x, int y, char ch);
 void text_render(const text_settings *settings, int x, int y, int w, int h, const char *text);
 int text_char_width(const text_settings *settings);
 
+void text_layout_create(text_layout *layout);
+void text_layout_free(text_layout *layout);
+int text_layout_update(text_layout *layout, const text_settings *settings, int w, int h, const char *text);
+void text_layout_render(const text_layout *layout, const text_settings *settings, int x, int y);
+
 // Old functions
 void font_get_wrapped_size(const font *font, const char *text, int max_w, int *out_w, int *out_h);
 void font_get_wrapped_size_shadowed(const font *font, const char *text, int max_w, int shadow_flag, int *out_w, int *out_h);
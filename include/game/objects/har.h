@@ -106,6 +106,18 @@ typedef struct action_buffer_t {
     uint32_t age;
 } action_buffer;
 
+// Shadow trail left by the "ub" tag. A new entry is added every other tick,
+// and each fades out in HAR_TRAIL_TICKS, so this many are visible at most.
+#define HAR_TRAIL_LENGTH 8
+#define HAR_TRAIL_TICKS 16
+
+typedef struct har_trail_t {
+    sprite *spr; // Points to AF sprite data, not owned.
+    vec2i pos;
+    int direction;
+    int age; // -1 if unused
+} har_trail;
+
 typedef struct game_player_t game_player;
 
 typedef struct har_t {
@@ -149,6 +161,9 @@ typedef struct har_t {
 
     action_buffer act_buf[OBJECT_EVENT_BUFFER_SIZE];
 
+    har_trail trail[HAR_TRAIL_LENGTH];
+    uint8_t trail_head;
+
 #ifdef DEBUGMODE
     surface cd_debug;
 #endif
@@ -164,5 +179,7 @@ int har_is_crouching(har *h);
 int har_is_walking(har *h);
 int har_is_blocking(har *h, af_move *move);
 void har_copy_actions(object *new, object *old);
+void har_render_trail(object *obj);
+void har_spawn_scrap(object *obj, vec2i pos, int amount);
 
 #endif // _HAR_H
@@ -5,9 +5,11 @@
 #include "resources/sprite.h"
 #include "video/screen_palette.h"
 #include "game/protos/player.h"
+#include "game/protos/object_ref.h"
 #include "utils/vec.h"
 #include "utils/hashmap.h"
 #include "utils/random.h"
+#include "utils/allocator.h"
 #include "video/surface.h"
 #include "game/utils/serial.h"
 
@@ -15,6 +17,7 @@
 #define OBJECT_NO_GROUP -1
 
 #define OBJECT_EVENT_BUFFER_SIZE 16
+#define OBJECT_INTERPOLATE_MAX 32.0f // Larger jumps in a tick are not smoothed
 
 enum {
     OBJECT_FACE_LEFT = -1,
@@ -38,6 +41,17 @@ enum {
     EFFECT_POSITIONAL_LIGHTING = 0x4,
 };
 
+// Objects with a body type other than BODY_NONE are moved in batches by
+// game_state (see game/protos/physics.h) instead of the move callback.
+enum {
+    BODY_NONE = 0,
+    BODY_SCRAP, // Integer positions, settles down on the floor
+    BODY_PROJECTILE
+};
+
+#define BODY_WALL_BOUNCE 0x1 // Bounce off walls; otherwise finish on wall hit
+#define BODY_GROUND_FREEZE 0x2 // Halt animation when resting on the floor
+
 typedef struct object_t object;
 typedef struct game_state_t game_state;
 
@@ -58,6 +72,10 @@ struct object_t {
     vec2f start;
     vec2f pos;
     vec2f vel;
+
+    // Position at the start of the last dynamic tick, for interpolated rendering
+    vec2f prev_pos;
+    uint32_t prev_pos_tick;
     int8_t direction;
     int8_t group;
 
@@ -76,6 +94,8 @@ struct object_t {
 
     float y_percent;
     float gravity;
+    uint8_t body;
+    uint8_t body_flags;
 
     // Bitmask for several video effects (shadow, etc.)
     int video_effects;
@@ -88,9 +108,8 @@ struct object_t {
     char *sound_translation_table;
     uint8_t sprite_override; //< Tells whether cur_sprite should be kept constant regardless of anim string.
 
-    // NULL if this object is not attached to any other objects
-    // Object pointer if it is. In this case, velocity and direction will be matched.
-    const object *attached_to;
+    // Object this one is attached to, if any. In this case, position and direction will be matched.
+    object_ref attached_to;
 
     uint8_t pal_offset;
     uint8_t cur_remap;
@@ -123,6 +142,12 @@ struct object_t {
     object_palette_transform_cb pal_transform;
 };
 
+// Object memory comes from a fixed size pool; falls back to malloc if the pool is full.
+object* object_alloc();
+void object_dealloc(object *obj);
+void object_get_allocator(allocator *alloc);
+void object_pool_close();
+
 void object_create(object *obj, game_state *gs, vec2i pos, vec2f vel);
 void object_render(object *obj);
 void object_render_shadow(object *obj);
@@ -141,7 +166,7 @@ void object_free(object *obj);
 int object_serialize(object *obj, serial *ser);
 int object_unserialize(object *obj, serial *ser, game_state *gs);
 
-void object_attach_to(object *obj, const object *attach_to);
+void object_attach_to(object *obj, object *attach_to);
 
 void object_set_stride(object *obj, int stride);
 void object_set_delay(object *obj, int delay);
@@ -166,6 +191,8 @@ int object_get_effects(const object *obj);
 void object_set_layers(object *obj, int layers);
 void object_set_group(object *obj, int group);
 void object_set_gravity(object *obj, float gravity);
+void object_set_body(object *obj, int body, int flags);
+int object_get_body(const object *obj);
 
 void object_set_userdata(object *obj, void *ptr);
 void *object_get_userdata(const object *obj);
@@ -210,6 +237,7 @@ vec2f object_get_vel(const object *obj);
 
 void object_set_pos(object *obj, vec2i pos);
 void object_set_vel(object *obj, vec2f vel);
+vec2f object_get_render_pos(object *obj);
 
 int object_w(const object *obj);
 int object_h(const object *obj);
@@ -0,0 +1,19 @@
+#ifndef _OBJECT_REF_H
+#define _OBJECT_REF_H
+
+#include "utils/pool.h"
+
+typedef struct object_t object;
+
+// Reference to an object that may be freed while the reference is kept.
+// Resolves to NULL once the object is gone. Objects that did not fit into the
+// object pool have no handle, and are not checked.
+typedef struct object_ref_t {
+    pool_handle handle;
+    object *ptr;
+} object_ref;
+
+object_ref object_ref_create(object *obj);
+object* object_ref_get(const object_ref *ref);
+
+#endif // _OBJECT_REF_H
@@ -0,0 +1,34 @@
+#ifndef _PHYSICS_H
+#define _PHYSICS_H
+
+#include <stdint.h>
+
+// Structure-of-arrays copy of the hot physics state of scrap and projectiles.
+// game_state gathers these objects here every tick, steps them all in one
+// go, and then writes the results back to the objects.
+
+typedef struct object_t object;
+
+typedef struct physics_store_t {
+    unsigned int size;
+    unsigned int capacity;
+    object **objs;
+    float *px;
+    float *py;
+    float *vx;
+    float *vy;
+    float *gravity;
+    float *dampen;
+    uint8_t *body;
+    uint8_t *flags;
+    uint8_t *result;
+} physics_store;
+
+void physics_store_create(physics_store *ps);
+void physics_store_free(physics_store *ps);
+void physics_store_clear(physics_store *ps);
+int physics_store_add(physics_store *ps, object *obj);
+void physics_store_step(physics_store *ps);
+void physics_store_write(physics_store *ps);
+
+#endif // _PHYSICS_H
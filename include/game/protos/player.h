@@ -2,6 +2,7 @@
 #define _PLAYER_H
 
 #include "utils/vec.h"
+#include "game/protos/object_ref.h"
 #include <shadowdive/script.h>
 
 typedef struct object_t object;
@@ -56,7 +57,7 @@ typedef struct player_animation_state_t {
 
     void *spawn_userdata;
     void *destroy_userdata;
-    object *enemy;
+    object_ref enemy;
     object_state_add_cb spawn;
     object_state_del_cb destroy;
 } player_animation_state;
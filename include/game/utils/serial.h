@@ -3,14 +3,17 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "utils/allocator.h"
 
 typedef struct serial_t {
     size_t len;
     size_t rpos;
     char *data;
+    allocator alloc;
 } serial;
 
 void serial_create(serial *s);
+void serial_create_with_allocator(serial *s, allocator alloc);
 void serial_write(serial *s, const char *buf, int len);
 void serial_write_int8(serial *s, int8_t v);
 void serial_write_int16(serial *s, int16_t v);
@@ -47,6 +47,10 @@ typedef struct settings_video_t {
     int crossfade_on;
     char *scaler;
     int scale_factor;
+    int software_render;
+    int interpolate;
+    int max_catchup;
+    int sim_thread;
 } settings_video;
 
 typedef struct settings_gameplay_t {
@@ -72,6 +76,7 @@ typedef struct settings_advanced_t {
     int vitality;
     int knock_down;
     int block_damage;
+    int ai_search_budget; // Moves the hardest AIs may profile per decision for lookahead search
 } settings_advanced;
 
 typedef struct settings_keyboard_t {
@@ -104,6 +109,8 @@ typedef struct settings_network_t {
     char *net_connect_ip;
     int net_connect_port;
     int net_listen_port;
+    char *metrics_file; // Prometheus text file for host metrics; empty for none
+    int metrics_interval; // Seconds between metrics file writes
 } settings_network;
 
 
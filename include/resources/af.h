@@ -2,6 +2,7 @@
 #define _AF_H
 
 #include "resources/af_move.h"
+#include "resources/baked.h"
 
 typedef struct af_t {
     unsigned int id;
@@ -15,7 +16,7 @@ typedef struct af_t {
     char sound_translation_table[30];
 } af;
 
-void af_create(af *a, void *src);
+void af_create(af *a, void *src, const baked_file *baked);
 af_move* af_get_move(af *a, int id);
 void af_free(af *a);
 
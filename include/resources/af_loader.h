@@ -4,5 +4,6 @@
 #include "resources/af.h"
 
 int load_af_file(af *a, int id);
+int load_af_file_sync(af *a, int id);
 
 #endif // _AF_LOADER_H
@@ -21,7 +21,7 @@ typedef struct af_move_t {
 #endif
 } af_move;
 
-void af_move_create(af_move *move, void *src, int id);
+void af_move_create(af_move *move, void *src, int id, sprite_store *store);
 void af_move_free(af_move *move);
 
 #endif // _AF_MOVE_H
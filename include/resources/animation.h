@@ -44,7 +44,7 @@ typedef struct animation_t {
     vector sprites;
 } animation;
 
-void animation_create(animation *ani, void *src, int id);
+void animation_create(animation *ani, void *src, int id, sprite_store *store);
 sprite* animation_get_sprite(animation *ani, int sprite_id);
 void animation_free(animation *ani);
 
@@ -0,0 +1,50 @@
+#ifndef _BAKED_H
+#define _BAKED_H
+
+#include <stdint.h>
+
+#define BAKED_VERSION 3
+
+/*
+* The baked archive holds the sprites of every BK and AF file, already VGA
+* decoded and span encoded like sprite_pixels, with identical sprites stored
+* once. It is mapped into memory as is, and sprites point straight into it.
+*
+* Layout: baked_header, baked_file[file_count], the baked_sprite tables of each
+* file, then the pixel data. All offsets are from the start of the archive.
+* The archive is written in native byte order, for the machine that baked it.
+*/
+typedef struct baked_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t file_count;
+} baked_header;
+
+typedef struct baked_file_t {
+    uint32_t resource_id;
+    uint32_t source_size;  // Size and modification time of the original file; the
+    uint32_t source_mtime; // entry is not used if either has changed
+    uint32_t sprites_offset;
+    uint32_t sprite_count;
+} baked_file;
+
+// Sorted by animation and sprite id within each file
+typedef struct baked_sprite_t {
+    uint16_t anim_id;
+    uint16_t sprite_id;
+    uint16_t w;
+    uint16_t h;
+    uint32_t data_offset;
+    uint32_t data_size;
+} baked_sprite;
+
+int baked_open(const char *filename);
+void baked_close();
+const baked_file* baked_find(int resource_id);
+const baked_sprite* baked_find_sprite(const baked_file *file, int anim_id, int sprite_id);
+const unsigned char* baked_sprite_data(const baked_sprite *sprite);
+int baked_check_sprite(const baked_sprite *sprite);
+
+int baked_write(const char *filename);
+
+#endif // _BAKED_H
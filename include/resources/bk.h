@@ -2,6 +2,7 @@
 #define _BK_H
 
 #include "resources/bk_info.h"
+#include "resources/baked.h"
 #include "utils/hashmap.h"
 #include "utils/vector.h"
 
@@ -13,7 +14,7 @@ typedef struct bk_t {
     char sound_translation_table[30];
 } bk;
 
-void bk_create(bk *b, void *src);
+void bk_create(bk *b, void *src, const baked_file *baked);
 bk_info* bk_get_info(bk *b, int id);
 palette* bk_get_palette(bk *b, int id);
 char* bk_get_stl(bk *b);
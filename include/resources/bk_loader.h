@@ -4,5 +4,6 @@
 #include "resources/bk.h"
 
 int load_bk_file(bk *b, int id);
+int load_bk_file_sync(bk *b, int id);
 
 #endif // _BK_LOADER_H
@@ -10,6 +10,8 @@ enum {
     CONFIG_PATH,
     SCORE_PATH,
     SAVE_PATH,
+    AI_STATS_PATH,
+    BAKE_PATH,
     NUMBER_OF_LOCAL_PATHS
 };
 
@@ -0,0 +1,25 @@
+#ifndef _PREFETCH_H
+#define _PREFETCH_H
+
+#include "resources/bk.h"
+#include "resources/af.h"
+
+int prefetch_init();
+void prefetch_close();
+
+// Queue a background load. Results are picked up by load_bk_file and load_af_file.
+void prefetch_bk(int resource_id);
+void prefetch_af(int resource_id);
+void prefetch_discard_all();
+
+// Returns 1 while queued files are still being decoded, 0 when all are done.
+// Never waits, so scene code can keep running until the results are ready.
+int prefetch_poll();
+
+// Returns 0 and fills the struct if a prefetched result was available, 1 otherwise.
+// Waits for the loader thread if the resource is still being decoded; callers
+// should use prefetch_poll first, so that this only blocks as a fallback.
+int prefetch_get_bk(bk *b, int resource_id);
+int prefetch_get_af(af *a, int resource_id);
+
+#endif // _PREFETCH_H
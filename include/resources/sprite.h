@@ -2,19 +2,22 @@
 #define _SPRITE_H
 
 #include "resources/palette.h"
+#include "resources/sprite_store.h"
 #include "video/surface.h"
 #include "utils/vec.h"
 
 typedef struct sprite_t {
     int id;
     vec2i pos;
-    surface *data;
+    surface *data; // Own surface, for sprites without packed pixels; use sprite_get_surface
+    sprite_pixels *pixels;
 } sprite;
 
-void sprite_create(sprite *sp, void *src, int id);
+void sprite_create(sprite *sp, void *src, int id, sprite_store *store);
 void sprite_create_custom(sprite *sp, vec2i pos, surface *sur);
 void sprite_free(sprite *sp);
 
+surface* sprite_get_surface(sprite *sp);
 vec2i sprite_get_size(sprite *s);
 sprite* sprite_copy(sprite *src);
 
@@ -0,0 +1,48 @@
+#ifndef _SPRITE_STORE_H
+#define _SPRITE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "video/surface.h"
+#include "utils/hashmap.h"
+#include "resources/baked.h"
+
+// Span encoded sprite pixels. Each row is a 16 bit span count, followed by
+// spans of 16 bit x offset, 16 bit length and the pixels themselves.
+// Pixels outside the spans have a zero stencil. Shared between identical frames.
+// Data is either stored right after the struct, or in the baked archive.
+typedef struct sprite_pixels_t {
+    uint32_t hash;
+    uint16_t w, h;
+    unsigned int refs;
+    unsigned int size;
+    uint8_t mem_tag;
+    surface *decoded; // Decoded on first use, and shared like the pixels
+    const unsigned char *data;
+    unsigned char inline_data[];
+} sprite_pixels;
+
+// Deduplication index that lives for the duration of a single file load
+typedef struct sprite_store_t {
+    hashmap entries;
+    unsigned int sprites;
+    unsigned int unique;
+    size_t raw_bytes;
+    size_t packed_bytes;
+    int mem_tag; // Subsystem the sprites are counted to; see utils/memtrack.h
+    const baked_file *baked; // Prebaked sprites of the file, or NULL
+    int anim_id; // Animation whose sprites are being created
+    unsigned int baked_sprites;
+} sprite_store;
+
+void sprite_store_create(sprite_store *st, int mem_tag);
+sprite_pixels* sprite_store_pack(sprite_store *st, const char *data, const char *stencil, int w, int h);
+sprite_pixels* sprite_store_find_baked(sprite_store *st, int sprite_id, int w, int h);
+void sprite_store_report(const sprite_store *st, const char *file_type, int file_id);
+void sprite_store_free(sprite_store *st);
+
+int sprite_pixels_check(const unsigned char *data, unsigned int size, int w, int h);
+void sprite_pixels_release(sprite_pixels *px);
+surface* sprite_pixels_get_surface(sprite_pixels *px);
+
+#endif // _SPRITE_STORE_H
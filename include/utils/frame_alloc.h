@@ -0,0 +1,25 @@
+#ifndef _FRAME_ALLOC_H
+#define _FRAME_ALLOC_H
+
+#include <stddef.h>
+#include "utils/allocator.h"
+
+#define FRAME_ALLOC_SIZE (4 * 1024 * 1024)
+
+typedef struct frame_alloc_stats_t {
+    size_t bytes;            // Bytes allocated during the frame
+    unsigned int allocs;     // Number of allocations during the frame
+    unsigned int fallbacks;  // Allocations that did not fit and went to the heap
+} frame_alloc_stats;
+
+// Bump allocator for short lived data. Only to be used from the main thread.
+void* frame_alloc_malloc(size_t size);
+void frame_alloc_free(void *ptr);
+void* frame_alloc_realloc(void *ptr, size_t size);
+void frame_alloc_get_allocator(allocator *alloc);
+int frame_alloc_owns(const void *ptr);
+void frame_alloc_reset();
+void frame_alloc_get_stats(frame_alloc_stats *last, size_t *peak_bytes);
+void frame_alloc_close();
+
+#endif // _FRAME_ALLOC_H
@@ -1,9 +1,13 @@
 #ifndef _HASHMAP_H
 #define _HASHMAP_H
 
+#include <stdint.h>
 #include "utils/iterator.h"
 #include "utils/allocator.h"
 
+// Keys and values that fit here together are stored inside the bucket itself
+#define HASHMAP_INLINE_SIZE 24
+
 typedef struct hashmap_pair_t hashmap_pair;
 typedef struct hashmap_node_t hashmap_node;
 typedef struct hashmap_t hashmap;
@@ -15,17 +19,19 @@ struct hashmap_pair_t {
 
 struct hashmap_node_t {
     hashmap_pair pair;
-    hashmap_node *next;
+    uint32_t hash;
+    uint32_t dist; // Distance from the home bucket + 1, or 0 if the bucket is empty
+    uint64_t data[HASHMAP_INLINE_SIZE / 8];
 };
 
 struct hashmap_t {
-    hashmap_node **buckets;
+    hashmap_node *buckets;
     unsigned int buckets_x;
     unsigned int reserved;
     allocator alloc;
 };
 
-void hashmap_create(hashmap *hashmap, int n_size); // actual size will be 2^n_size
+void hashmap_create(hashmap *hashmap, int n_size); // initial size will be 2^n_size
 void hashmap_create_with_allocator(hashmap *hashmap, int n_size, allocator alloc);
 void hashmap_free(hashmap *hashmap);
 unsigned int hashmap_size(const hashmap *hashmap);
@@ -0,0 +1,25 @@
+#ifndef _HISTOGRAM_H
+#define _HISTOGRAM_H
+
+#define HISTOGRAM_MAX_BUCKETS 16
+
+// Counts samples into buckets. Bucket i holds samples below bounds[i] (and at
+// or above the bound before it); the last bucket holds everything above the last bound.
+typedef struct histogram_t {
+    float bounds[HISTOGRAM_MAX_BUCKETS - 1];
+    unsigned int counts[HISTOGRAM_MAX_BUCKETS];
+    int bucket_count;
+    unsigned int samples;
+    double sum;
+    float min;
+    float max;
+} histogram;
+
+void histogram_create(histogram *h, const float *bounds, int bound_count);
+void histogram_add(histogram *h, float value);
+void histogram_reset(histogram *h);
+float histogram_mean(const histogram *h);
+float histogram_percentile(const histogram *h, float p);
+void histogram_log(const histogram *h, const char *name, const char *unit);
+
+#endif // _HISTOGRAM_H
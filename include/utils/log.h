@@ -3,21 +3,36 @@
 
 #include <stdlib.h>
 
+enum {
+    LOG_DEBUG = 0,
+    LOG_INFO,
+    LOG_ERROR,
+    LOG_OFF
+};
+
 #ifdef DEBUGMODE
-#define DEBUG(...) log_print('D', __FUNCTION__, __VA_ARGS__ )
-#define PERROR(...) log_print('E', __FUNCTION__, __VA_ARGS__ )
-#define INFO(...) log_print('I', __FUNCTION__, __VA_ARGS__ )
+#define DEBUG(...) log_print(LOG_DEBUG, __FILE__, __FUNCTION__, __VA_ARGS__ )
+#define PERROR(...) log_print(LOG_ERROR, __FILE__, __FUNCTION__, __VA_ARGS__ )
+#define INFO(...) log_print(LOG_INFO, __FILE__, __FUNCTION__, __VA_ARGS__ )
 #else
 #define DEBUG(...)
-#define PERROR(...) log_print('E', NULL, __VA_ARGS__ )
-#define INFO(...) log_print('I', NULL, __VA_ARGS__ )
+#define PERROR(...) log_print(LOG_ERROR, __FILE__, NULL, __VA_ARGS__ )
+#define INFO(...) log_print(LOG_INFO, __FILE__, NULL, __VA_ARGS__ )
 #endif
 
 #define LOGTICK(x) _log_tick = x;
 extern unsigned int _log_tick;
 
-void log_print(char mode, const char* fn, const char *fmt, ...);
+// The format string must be a literal; it is read again later by the writer thread.
+void log_print(int level, const char *file, const char *fn, const char *fmt, ...);
 int log_init(const char *filename);
 void log_close();
 
+// Messages below the level are dropped. A module level (module is the source
+// file name without the extension, eg. "har") overrides the global one.
+void log_set_level(int level);
+int log_get_level();
+int log_set_module_level(const char *module, int level);
+int log_parse_level(const char *name);
+
 #endif // _LOG_H
@@ -0,0 +1,56 @@
+#ifndef _MEMTRACK_H
+#define _MEMTRACK_H
+
+#include <stdlib.h>
+#include "utils/allocator.h"
+
+// Subsystems that memory is accounted to
+enum MEMTRACK_TAG {
+    MEM_CONTAINERS,
+    MEM_BK_SPRITES,
+    MEM_AF_SPRITES,
+    MEM_SURFACES,
+    MEM_TCACHE,
+    MEM_AUDIO,
+    MEM_OBJECTS,
+    MEM_TAG_COUNT
+};
+
+typedef struct memtrack_stats_t {
+    long long bytes;
+    long long peak;
+    long long live; // Allocations not yet freed
+    unsigned long long total; // Allocations ever made
+} memtrack_stats;
+
+/*
+* Memory accounting is only done in builds with MEMTRACK defined (cmake -DUSE_MEMTRACK=ON).
+* Otherwise all of this compiles down to plain malloc and free, and nothing is counted.
+*
+* memtrack_malloc and friends keep the size and tag in front of the block, so
+* their memory must be freed with memtrack_free. memtrack_add and memtrack_sub are
+* for memory that is allocated elsewhere, or whose size is known when it is freed.
+*/
+#ifdef MEMTRACK
+void* memtrack_malloc(int tag, size_t size);
+void* memtrack_realloc(int tag, void *ptr, size_t size);
+void memtrack_free(void *ptr);
+void memtrack_add(int tag, size_t bytes);
+void memtrack_sub(int tag, size_t bytes);
+void memtrack_move(int from, int to, size_t bytes);
+#else
+static inline void* memtrack_malloc(int tag, size_t size) { return malloc(size); }
+static inline void* memtrack_realloc(int tag, void *ptr, size_t size) { return realloc(ptr, size); }
+static inline void memtrack_free(void *ptr) { free(ptr); }
+static inline void memtrack_add(int tag, size_t bytes) {}
+static inline void memtrack_sub(int tag, size_t bytes) {}
+static inline void memtrack_move(int from, int to, size_t bytes) {}
+#endif
+
+int memtrack_enabled();
+void memtrack_get_allocator(allocator *alloc);
+void memtrack_get_stats(int tag, memtrack_stats *stats);
+const char* memtrack_tag_name(int tag);
+void memtrack_report_leaks();
+
+#endif // _MEMTRACK_H
@@ -0,0 +1,53 @@
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <stddef.h>
+
+enum METRIC_TYPE {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+};
+
+enum METRIC_ID {
+    METRIC_TICKS,
+    METRIC_TICKS_PER_SECOND,
+    METRIC_TICK_TIME,
+    METRIC_FRAME_TIME,
+    METRIC_OBJECTS,
+    METRIC_TCACHE_HITS,
+    METRIC_TCACHE_MISSES,
+    METRIC_PACKETS_SENT,
+    METRIC_PACKETS_RECEIVED,
+    METRIC_BYTES_SENT,
+    METRIC_BYTES_RECEIVED,
+    METRIC_PEER_RTT,
+    METRIC_SYNCS_SENT,
+    METRIC_BYTES_SERIALIZED,
+    METRIC_FRAME_ALLOC_BYTES,
+    METRIC_FRAME_ALLOC_PEAK,
+    METRIC_COUNT
+};
+
+#define METRICS_MAX_SLOTS 2
+
+// Recording is a relaxed atomic add or store, and may be done from any thread.
+void metrics_add(int id, long long amount);
+void metrics_set(int id, long long value);
+void metrics_set_slot(int id, int slot, long long value);
+void metrics_observe(int id, float value);
+
+long long metrics_get(int id, int slot);
+unsigned long long metrics_count(int id);
+float metrics_percentile(int id, float p);
+void metrics_reset();
+
+// Periodic dumping into a Prometheus text file. metrics_tick() is called once per
+// main loop round, from one thread only.
+void metrics_init(const char *path, int interval_s);
+void metrics_tick();
+void metrics_close();
+size_t metrics_format(char *buf, size_t size);
+int metrics_write(const char *path);
+
+#endif // _METRICS_H
@@ -0,0 +1,34 @@
+#ifndef _POOL_H
+#define _POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define POOL_ALIGN 64
+#define POOL_INVALID_HANDLE 0
+
+// Handle is (generation << 16) | slot index. Generation is bumped every time
+// a slot is released, so stale handles resolve to NULL.
+typedef uint32_t pool_handle;
+
+typedef struct pool_t {
+    void *block;
+    char *data;
+    size_t slot_size;
+    unsigned int capacity;
+    unsigned int used;
+    int free_head;
+    int *next_free;
+    uint16_t *generations;
+} pool;
+
+int pool_create(pool *p, size_t item_size, unsigned int capacity);
+void pool_free(pool *p);
+void* pool_alloc(pool *p, pool_handle *handle);
+void pool_release(pool *p, void *ptr);
+int pool_owns(const pool *p, const void *ptr);
+pool_handle pool_get_handle(const pool *p, const void *ptr);
+void* pool_get(const pool *p, pool_handle handle);
+unsigned int pool_size(const pool *p);
+
+#endif // _POOL_H
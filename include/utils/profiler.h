@@ -0,0 +1,47 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <stdint.h>
+
+#define PROFILER_RING_SIZE 8192 // Events kept per thread for the trace
+#define PROFILER_MAX_THREADS 32
+
+// Timed zones. Add new ones here, and their names to profiler.c.
+enum PROFILE_ZONE {
+    PROFILE_TICK_CLEANUP = 0,
+    PROFILE_TICK_MOVE,
+    PROFILE_TICK_COLLIDE,
+    PROFILE_TICK_OBJECTS,
+    PROFILE_RENDER_BACKGROUND,
+    PROFILE_RENDER_BOTTOM,
+    PROFILE_RENDER_MIDDLE,
+    PROFILE_RENDER_TOP,
+    PROFILE_RENDER_OVERLAY,
+    PROFILE_RENDER_FINISH,
+    PROFILE_COMPOSITE_BAND,
+    PROFILE_TCACHE_MISS,
+    PROFILE_AUDIO,
+    PROFILE_SCENE_LOAD,
+    PROFILE_ZONE_COUNT
+};
+
+// Times the code between these two, in the same scope. Costs next to nothing
+// while the profiler is off.
+#define PROFILE_BEGIN(zone) uint64_t profile_start_##zone = profiler_begin()
+#define PROFILE_END(zone) profiler_end(zone, profile_start_##zone)
+
+void profiler_init();
+void profiler_close();
+void profiler_set_enabled(int enabled);
+int profiler_is_enabled();
+uint64_t profiler_begin();
+void profiler_end(int zone, uint64_t start);
+void profiler_thread_exit();
+int profiler_thread_count();
+void profiler_frame();
+const char* profiler_zone_name(int zone);
+float profiler_zone_ms(int zone);
+float profiler_zone_calls(int zone);
+int profiler_write_trace(const char *filename);
+
+#endif // _PROFILER_H
@@ -0,0 +1,28 @@
+#ifndef _TASK_H
+#define _TASK_H
+
+#include <stdatomic.h>
+#include <SDL2/SDL.h>
+
+typedef int (*task_func)(void *userdata);
+
+// A single job that runs on its own thread, and whose result is waited for
+// once it is actually needed. If the thread cannot be started, the job is run
+// right away in task_start instead.
+typedef struct task_t {
+    const char *name;
+    task_func func;
+    void *userdata;
+    SDL_Thread *thread;
+    SDL_mutex *lock;
+    atomic_int done;
+    int result;
+    unsigned int took; // Milliseconds the job ran
+} task;
+
+void task_start(task *t, const char *name, task_func func, void *userdata);
+int task_wait(task *t);
+int task_is_done(task *t);
+void task_free(task *t);
+
+#endif // _TASK_H
@@ -0,0 +1,24 @@
+#ifndef _TRIPLE_BUFFER_H
+#define _TRIPLE_BUFFER_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Hands whole buffers from one producer thread to one consumer thread without
+// locking. The producer always has a buffer to write, the consumer always has the
+// latest finished one to read, and the third one is the hand-off between them.
+typedef struct triple_buffer_t {
+    char *data;
+    size_t size;
+    int write;
+    int read;
+    atomic_int ready; // Index of the hand-off buffer, plus TRIPLE_BUFFER_FRESH
+} triple_buffer;
+
+int triple_buffer_create(triple_buffer *tb, size_t size);
+void triple_buffer_free(triple_buffer *tb);
+void* triple_buffer_write_ptr(triple_buffer *tb);
+void triple_buffer_publish(triple_buffer *tb);
+void* triple_buffer_read_ptr(triple_buffer *tb, int *fresh);
+
+#endif // _TRIPLE_BUFFER_H
@@ -10,6 +10,8 @@ typedef struct vector_t {
     unsigned int blocks;
     unsigned int reserved;
     unsigned int inc_factor;
+    unsigned char *marks; // Entries marked for deletion, allocated on first use
+    unsigned int marked;
     allocator alloc;
 } vector;
 
@@ -25,6 +27,9 @@ int vector_prepend(vector *vector, const void *value);
 void vector_sort(vector *vector, vector_compare_func cf);
 unsigned int vector_size(const vector *vector);
 int vector_delete(vector *vector, iterator *iterator);
+int vector_swapdelete(vector *vector, iterator *iterator);
+int vector_mark_delete(vector *vector, iterator *iterator);
+void vector_compact(vector *vector);
 void vector_iter_begin(const vector *vector, iterator *iter);
 void vector_iter_end(const vector *vector, iterator *iter);
 
@@ -6,6 +6,12 @@
 #include "video/screen_palette.h"
 #include "resources/palette.h"
 
+// Horizontal run of opaque pixels on a single row
+typedef struct surface_span_t {
+    uint16_t x;
+    uint16_t len;
+} surface_span;
+
 typedef struct {
     int w;
     int h;
@@ -13,6 +19,8 @@ typedef struct {
     char *data;
     char *stencil;
     uint8_t force_refresh;
+    int *span_rows; // Opaque spans of paletted surfaces, built on first blit. See surface_get_spans.
+    uint8_t mem_tag; // Subsystem the memory is counted to; see utils/memtrack.h
 } surface;
 
 enum {
@@ -27,12 +35,14 @@ enum {
 
 void surface_create(surface *sur, int type, int w, int h);
 void surface_force_refresh(surface *sur);
+const surface_span* surface_get_spans(surface *sur, int row, int *count);
 void surface_create_from_image(surface *sur, image *img);
 void surface_create_from_data(surface *sur, int type, int w, int h, const char *src);
 int surface_to_image(surface *sur, image *img);
 void surface_copy(surface *dst, surface *src);
 void surface_copy_ex(surface *dst, surface *src);
 void surface_free(surface *sur);
+void surface_set_mem_tag(surface *sur, int tag);
 void surface_clear(surface *sur);
 void surface_fill(surface *sur, color c);
 void surface_sub(surface *dst,
@@ -24,6 +24,7 @@ enum VIDEO_FLIP_MODE {
 enum VIDEO_RENDERER {
     VIDEO_RENDERER_QUIRKS = 0,
     VIDEO_RENDERER_HW,
+    VIDEO_RENDERER_SOFT,
 };
 
 int video_init(int window_w,
@@ -32,6 +33,7 @@ int video_init(int window_w,
                int vsync,
                const char* scaler_name,
                int scale_factor);
+int video_init_headless();
 int video_reinit(int window_w,
                  int window_h,
                  int fullscreen,
@@ -92,13 +94,18 @@ void video_render_sprite_flip_scale_opacity_tint(
     color tint);
 
 void video_select_renderer(int renderer);
+void video_set_software(int enabled);
+int video_set_threaded(int enabled);
+int video_present();
 void video_tick();
 void video_render_background(surface *sur);
 void video_render_prepare();
 void video_render_finish();
 void video_close();
 void video_screenshot(image *img);
-int video_area_capture(surface *sur, int x, int y, int w, int h);
+int video_read_frame(char *dst);
+int video_area_capture(surface *sur, int x, int y, int w, int h, int *ready);
+void video_area_capture_cancel(surface *sur);
 void video_set_fade(float fade);
 
 void video_set_base_palette(const palette *src);
@@ -0,0 +1,8 @@
+#ifndef _VIDEO_COMPOSITE_H
+#define _VIDEO_COMPOSITE_H
+
+#include "video/video_state.h"
+
+void video_composite_init(video_state *state);
+
+#endif // _VIDEO_COMPOSITE_H
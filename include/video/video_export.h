@@ -0,0 +1,8 @@
+#ifndef _VIDEO_EXPORT_H
+#define _VIDEO_EXPORT_H
+
+int video_export_open(const char *filename, int fps);
+int video_export_frame();
+void video_export_close();
+
+#endif // _VIDEO_EXPORT_H
@@ -10,6 +10,7 @@
 typedef struct video_state_t {
     SDL_Window *window;
     SDL_Renderer *renderer;
+    unsigned int renderer_version; // Bumped every time the renderer is recreated
     int w;
     int h;
     int fs;
@@ -20,12 +21,19 @@ typedef struct video_state_t {
     char scaler_name[16];
 
     float fade;
-    int target_move_x;
+    int target_move_x; // Screen shake, in native pixels
     int target_move_y;
 
     int cur_renderer;
+    int software; // Use the software compositor instead of the hardware renderer
+    int headless; // No window or renderer; frames only exist in the framebuffer
+    int threaded; // Frames are drawn on the simulation thread, and presented from snapshots
     SDL_Texture *target;
 
+    // Last finished frame, when the active renderer draws on the CPU
+    uint8_t *framebuffer;
+    int framebuffer_ok;
+
     // Palettes
     palette *base_palette;
     screen_palette *cur_palette;
@@ -3,7 +3,9 @@
 #include "audio/audio.h"
 #include "audio/sink.h"
 #include "audio/sinks/openal_sink.h"
+#include "audio/sinks/export_sink.h"
 #include "utils/log.h"
+#include "utils/profiler.h"
 
 audio_sink *_global_sink = NULL;
 
@@ -55,7 +57,9 @@ int audio_is_sink_available(const char* sink_name) {
 
 void audio_render() {
     if(_global_sink != NULL) {
+        PROFILE_BEGIN(PROFILE_AUDIO);
         sink_render(_global_sink);
+        PROFILE_END(PROFILE_AUDIO);
     }
 }
 
@@ -98,6 +102,27 @@ int audio_init(const char* sink_name) {
     return 0;
 }
 
+// Mixes into a WAV file instead of playing; see audio_export_render
+int audio_init_export(const char *filename) {
+    _global_sink = malloc(sizeof(audio_sink));
+    sink_init(_global_sink);
+    if(export_sink_init(_global_sink, filename) != 0) {
+        free(_global_sink);
+        _global_sink = NULL;
+        return 1;
+    }
+    INFO("Audio system initialized for export.");
+    return 0;
+}
+
+// Advances exported audio by the given amount of game time
+void audio_export_render(unsigned int ms) {
+    if(_global_sink != NULL) {
+        export_sink_mix(_global_sink, EXPORT_SINK_RATE * ms / 1000);
+        sink_render(_global_sink);
+    }
+}
+
 void audio_close() {
     if(_global_sink != NULL) {
         sink_free(_global_sink);
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include "audio/sinks/export_sink.h"
+#include "audio/stream.h"
+#include "audio/source.h"
+#include "utils/log.h"
+
+/*
+* Sink that mixes all streams itself and writes the result into a 16 bit stereo
+* WAV file, instead of playing it. Mixing is driven by export_sink_mix, so the
+* audio advances exactly as much as the exported video does.
+*/
+
+#define EXPORT_BUFFER_SIZE 16384
+#define EXPORT_MIX_SIZE 4096
+#define WAV_HEADER_SIZE 44
+
+// Equal power panning, with unit gain when centered
+#define EXPORT_PAN_ANGLE 0.78539816f
+#define EXPORT_PAN_GAIN 1.41421356f
+
+typedef struct {
+    FILE *handle;
+    uint32_t data_bytes;
+    float mix[EXPORT_MIX_SIZE * 2];
+} export_sink;
+
+typedef struct {
+    char buf[EXPORT_BUFFER_SIZE];
+    int frames;
+    double pos;
+} export_stream;
+
+static void put32(unsigned char *dst, uint32_t v) {
+    dst[0] = v & 0xFF;
+    dst[1] = (v >> 8) & 0xFF;
+    dst[2] = (v >> 16) & 0xFF;
+    dst[3] = (v >> 24) & 0xFF;
+}
+
+static void put16(unsigned char *dst, unsigned int v) {
+    dst[0] = v & 0xFF;
+    dst[1] = (v >> 8) & 0xFF;
+}
+
+static void export_sink_write_header(export_sink *local) {
+    unsigned char h[WAV_HEADER_SIZE];
+    memcpy(h, "RIFF", 4);
+    put32(h + 4, 36 + local->data_bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 16); // Format chunk size
+    put16(h + 20, 1); // PCM
+    put16(h + 22, 2); // Channels
+    put32(h + 24, EXPORT_SINK_RATE);
+    put32(h + 28, EXPORT_SINK_RATE * 4); // Bytes per second
+    put16(h + 32, 4); // Bytes per frame
+    put16(h + 34, 16); // Bits per sample
+    memcpy(h + 36, "data", 4);
+    put32(h + 40, local->data_bytes);
+    fwrite(h, 1, WAV_HEADER_SIZE, local->handle);
+}
+
+// Reads one frame of the source buffer as floats, in range -1 .. 1
+static void export_stream_frame(audio_stream *stream, export_stream *local, int i, float *l, float *r) {
+    int channels = source_get_channels(stream->src);
+    float v[2];
+    if(source_get_bytes(stream->src) == 1) {
+        const unsigned char *p = (const unsigned char*)local->buf + i * channels;
+        v[0] = (p[0] - 128) / 128.0f;
+        v[1] = (p[channels - 1] - 128) / 128.0f;
+    } else {
+        const unsigned char *p = (const unsigned char*)local->buf + i * channels * 2;
+        v[0] = (int16_t)(p[0] | (p[1] << 8)) / 32768.0f;
+        p += (channels - 1) * 2;
+        v[1] = (int16_t)(p[0] | (p[1] << 8)) / 32768.0f;
+    }
+    *l = v[0];
+    *r = v[1];
+}
+
+static int export_stream_fill(audio_stream *stream, export_stream *local) {
+    int frame_size = source_get_channels(stream->src) * source_get_bytes(stream->src);
+    int ret = source_update(stream->src, local->buf, EXPORT_BUFFER_SIZE - (EXPORT_BUFFER_SIZE % frame_size));
+    local->frames = (ret > 0) ? ret / frame_size : 0;
+    return local->frames;
+}
+
+// Resamples the stream with linear interpolation, and adds it to the mix
+static void export_stream_mix(audio_stream *stream, float *mix, unsigned int samples) {
+    export_stream *local = stream_get_userdata(stream);
+    double step = (double)source_get_frequency(stream->src) * stream->pitch / EXPORT_SINK_RATE;
+
+    // Mono sources are panned, stereo ones are played as they are
+    float gain_l = stream->volume;
+    float gain_r = stream->volume;
+    if(source_get_channels(stream->src) == 1) {
+        float angle = (stream->panning + 1.0f) * EXPORT_PAN_ANGLE;
+        gain_l *= cosf(angle) * EXPORT_PAN_GAIN;
+        gain_r *= sinf(angle) * EXPORT_PAN_GAIN;
+    }
+
+    for(unsigned int n = 0; n < samples; n++) {
+        while(local->pos >= local->frames) {
+            local->pos -= local->frames;
+            if(export_stream_fill(stream, local) == 0) {
+                stream_set_finished(stream);
+                return;
+            }
+        }
+        int i = (int)local->pos;
+        float t = local->pos - i;
+        float al, ar, bl, br;
+        export_stream_frame(stream, local, i, &al, &ar);
+        if(i + 1 < local->frames) {
+            export_stream_frame(stream, local, i + 1, &bl, &br);
+        } else {
+            bl = al;
+            br = ar;
+        }
+        mix[n * 2] += (al + (bl - al) * t) * gain_l;
+        mix[n * 2 + 1] += (ar + (br - ar) * t) * gain_r;
+        local->pos += step;
+    }
+}
+
+// Only the status matters here; mixing starts at the next export_sink_mix
+static void export_stream_play(audio_stream *stream) {}
+static void export_stream_stop(audio_stream *stream) {}
+
+static void export_stream_close(audio_stream *stream) {
+    free(stream_get_userdata(stream));
+}
+
+static void export_sink_format_stream(audio_sink *sink, audio_stream *stream) {
+    export_stream *local = malloc(sizeof(export_stream));
+    local->frames = 0;
+    local->pos = 0.0;
+    stream_set_userdata(stream, local);
+    stream_set_play_cb(stream, export_stream_play);
+    stream_set_stop_cb(stream, export_stream_stop);
+    stream_set_close_cb(stream, export_stream_close);
+}
+
+static void export_sink_close(audio_sink *sink) {
+    export_sink *local = sink_get_userdata(sink);
+
+    // Now that the length is known, fix up the header
+    if(fseek(local->handle, 0, SEEK_SET) == 0) {
+        export_sink_write_header(local);
+    }
+    fclose(local->handle);
+    INFO("Export sink closed, wrote %u kB of audio.", local->data_bytes / 1024);
+    free(local);
+}
+
+void export_sink_mix(audio_sink *sink, unsigned int samples) {
+    export_sink *local = sink_get_userdata(sink);
+    int16_t out[EXPORT_MIX_SIZE * 2];
+
+    while(samples > 0) {
+        unsigned int count = (samples > EXPORT_MIX_SIZE) ? EXPORT_MIX_SIZE : samples;
+        memset(local->mix, 0, sizeof(float) * count * 2);
+
+        iterator it;
+        hashmap_iter_begin(&sink->streams, &it);
+        hashmap_pair *pair;
+        while((pair = iter_next(&it)) != NULL) {
+            audio_stream *stream = *((audio_stream**)pair->val);
+            if(stream_get_status(stream) == STREAM_STATUS_PLAYING) {
+                export_stream_mix(stream, local->mix, count);
+            }
+        }
+
+        for(unsigned int i = 0; i < count * 2; i++) {
+            float v = local->mix[i] * 32767.0f;
+            if(v > 32767.0f) v = 32767.0f;
+            if(v < -32768.0f) v = -32768.0f;
+            int16_t s = (int16_t)v;
+            put16((unsigned char*)&out[i], (uint16_t)s);
+        }
+        fwrite(out, 4, count, local->handle);
+        local->data_bytes += count * 4;
+        samples -= count;
+    }
+}
+
+int export_sink_init(audio_sink *sink, const char *filename) {
+    export_sink *local = malloc(sizeof(export_sink));
+    local->data_bytes = 0;
+    local->handle = fopen(filename, "wb");
+    if(local->handle == NULL) {
+        PERROR("Could not open audio export file %s!", filename);
+        free(local);
+        return 1;
+    }
+
+    // Sizes are filled in when the sink is closed
+    export_sink_write_header(local);
+
+    // Set callbacks
+    sink_set_userdata(sink, local);
+    sink_set_close_cb(sink, export_sink_close);
+    sink_set_format_stream_cb(sink, export_sink_format_stream);
+
+    INFO("Export Audio Sink:");
+    INFO(" * File:        %s", filename);
+    INFO(" * Format:      %d Hz, 16 bit stereo", EXPORT_SINK_RATE);
+    return 0;
+}
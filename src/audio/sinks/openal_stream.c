@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include "audio/sinks/openal_stream.h"
 #include "utils/log.h"
+#include "utils/memtrack.h"
 
 #define AUDIO_BUFFER_COUNT 2
 #define AUDIO_BUFFER_SIZE 32768
@@ -116,6 +117,7 @@ void openal_stream_close(audio_stream *stream) {
     alSourceStop(local->source);
     alDeleteSources(1, &local->source);
     alDeleteBuffers(AUDIO_BUFFER_COUNT, local->buffers);
+    memtrack_sub(MEM_AUDIO, AUDIO_BUFFER_COUNT * AUDIO_BUFFER_SIZE);
     free(local);
 }
 
@@ -157,6 +159,8 @@ int openal_stream_init(audio_stream *stream, audio_sink *sink) {
         goto exit_1;
     }
 
+    memtrack_add(MEM_AUDIO, AUDIO_BUFFER_COUNT * AUDIO_BUFFER_SIZE);
+
     // Set callbacks etc.
     stream_set_userdata(stream, local);
     stream_set_update_cb(stream, openal_stream_update);
@@ -4,6 +4,10 @@
 #include "console/console_type.h"
 #include "resources/ids.h"
 #include "video/video.h"
+#include "utils/profiler.h"
+#include "utils/log.h"
+#include "utils/memtrack.h"
+#include "utils/metrics.h"
 
 // utils
 int strtoint(char *input, int *output) {
@@ -101,7 +105,7 @@ int console_cmd_har(game_state *gs, int argc, char **argv) {
             game_player *player = game_state_get_player(gs, 0);
 
             object *har_obj = game_player_get_har(player);
-            object *obj = malloc(sizeof(object));
+            object *obj = object_alloc();
             vec2i pos = object_get_pos(har_obj);
             int hd = object_get_direction(har_obj);
             object_create(obj, gs, pos, vec2f_create(0,0));
@@ -121,9 +125,9 @@ int console_cmd_har(game_state *gs, int argc, char **argv) {
 
             // Set HAR for player
             game_player_set_har(player, obj);
-            game_player_get_ctrl(player)->har = obj;
-            game_player_get_har(player)->animation_state.enemy = game_player_get_har(game_state_get_player(gs, 1));
-            game_player_get_har(game_state_get_player(gs, 1))->animation_state.enemy = game_player_get_har(player);
+            controller_set_har(game_player_get_ctrl(player), obj);
+            game_player_get_har(player)->animation_state.enemy = object_ref_create(game_player_get_har(game_state_get_player(gs, 1)));
+            game_player_get_har(game_state_get_player(gs, 1))->animation_state.enemy = object_ref_create(game_player_get_har(player));
 
 
             maybe_install_har_hooks(game_state_get_scene(gs));
@@ -181,7 +185,7 @@ int console_cmd_renderer(game_state *gs, int argc, char **argv) {
     if(argc == 2) {
         int i;
         if(strtoint(argv[1], &i)) {
-            if(i == 0 || i == 1) {
+            if(i >= VIDEO_RENDERER_QUIRKS && i <= VIDEO_RENDERER_SOFT) {
                 video_select_renderer(i);
                 return 0;
             }
@@ -225,6 +229,96 @@ int console_cmd_ez_destruct(game_state *gs, int argc, char **argv) {
     return 0;
 }
 
+int console_cmd_prof(game_state *gs, int argc, char **argv) {
+    if(argc == 1) {
+        profiler_set_enabled(!profiler_is_enabled());
+        console_output_addline(profiler_is_enabled() ? "Profiler ON" : "Profiler OFF");
+        return 0;
+    }
+    if(strcmp(argv[1], "trace") == 0 && argc <= 3) {
+        char filename[64];
+        if(argc == 3) {
+            snprintf(filename, sizeof(filename), "%s", argv[2]);
+        } else {
+            snprintf(filename, sizeof(filename), "trace_%u.json", SDL_GetTicks());
+        }
+        if(profiler_write_trace(filename)) {
+            return 1;
+        }
+        console_output_addline(filename);
+        return 0;
+    }
+    return 1;
+}
+
+// log <level>, or log <module> <level|default>
+int console_cmd_log(game_state *gs, int argc, char **argv) {
+    if(argc == 2) {
+        int level = log_parse_level(argv[1]);
+        if(level < 0) {
+            return 1;
+        }
+        log_set_level(level);
+        return 0;
+    }
+    if(argc == 3) {
+        int level = log_parse_level(argv[2]);
+        if(level < 0 && strcmp(argv[2], "default") != 0) {
+            return 1;
+        }
+        return log_set_module_level(argv[1], level);
+    }
+    return 1;
+}
+
+int console_cmd_metrics(game_state *gs, int argc, char **argv) {
+    char buf[64];
+    if(argc == 3 && strcmp(argv[1], "write") == 0) {
+        return metrics_write(argv[2]);
+    }
+    if(argc != 1) {
+        return 1;
+    }
+    long long hits = metrics_get(METRIC_TCACHE_HITS, 0);
+    long long misses = metrics_get(METRIC_TCACHE_MISSES, 0);
+    snprintf(buf, sizeof(buf), "ticks/s %lld, objects %lld",
+             metrics_get(METRIC_TICKS_PER_SECOND, 0), metrics_get(METRIC_OBJECTS, 0));
+    console_output_addline(buf);
+    snprintf(buf, sizeof(buf), "tick p50 %gms p99 %gms",
+             metrics_percentile(METRIC_TICK_TIME, 0.5f), metrics_percentile(METRIC_TICK_TIME, 0.99f));
+    console_output_addline(buf);
+    snprintf(buf, sizeof(buf), "tcache hits %.1f%%",
+             (hits + misses > 0) ? 100.0 * hits / (hits + misses) : 0.0);
+    console_output_addline(buf);
+    snprintf(buf, sizeof(buf), "net tx %lld rx %lld rtt %lld/%lld",
+             metrics_get(METRIC_PACKETS_SENT, 0), metrics_get(METRIC_PACKETS_RECEIVED, 0),
+             metrics_get(METRIC_PEER_RTT, 0), metrics_get(METRIC_PEER_RTT, 1));
+    console_output_addline(buf);
+    snprintf(buf, sizeof(buf), "syncs %lld, serialized %lldB",
+             metrics_get(METRIC_SYNCS_SENT, 0), metrics_get(METRIC_BYTES_SERIALIZED, 0));
+    console_output_addline(buf);
+    snprintf(buf, sizeof(buf), "frame alloc %lldB peak %lldB",
+             metrics_get(METRIC_FRAME_ALLOC_BYTES, 0), metrics_get(METRIC_FRAME_ALLOC_PEAK, 0));
+    console_output_addline(buf);
+    return 0;
+}
+
+int console_cmd_mem(game_state *gs, int argc, char **argv) {
+    char buf[64];
+    memtrack_stats stats;
+    if(!memtrack_enabled()) {
+        console_output_addline("Not a memtrack build (-DUSE_MEMTRACK=ON)");
+        return 0;
+    }
+    for(int i = 0; i < MEM_TAG_COUNT; i++) {
+        memtrack_get_stats(i, &stats);
+        snprintf(buf, sizeof(buf), "%s: %lldkB peak %lldkB, %lld live",
+                 memtrack_tag_name(i), stats.bytes / 1024, stats.peak / 1024, stats.live);
+        console_output_addline(buf);
+    }
+    return 0;
+}
+
 void console_init_cmd() {
     // Add console commands
     console_add_cmd("h",     &console_cmd_history,  "show command history");
@@ -239,8 +333,12 @@ void console_init_cmd() {
     console_add_cmd("lose",  &console_cmd_lose,   "Set your health to 0");
     console_add_cmd("stun",  &console_cmd_stun,   "Stun the other player");
     console_add_cmd("rein",  &console_cmd_rein,   "R-E-I-N!");
-    console_add_cmd("rdr",   &console_cmd_renderer, "Renderer (0=sw,1=hw)");
+    console_add_cmd("rdr",   &console_cmd_renderer, "Renderer (0=sw quirks,1=hw,2=sw full)");
     console_add_cmd("god",   &console_cmd_god,  "Enable god mode");
     console_add_cmd("kreissack",   &console_kreissack,  "Fight Kreissack");
     console_add_cmd("ez-destruct",  &console_cmd_ez_destruct,  "Punch = destruction, kick = scrap");
+    console_add_cmd("prof",  &console_cmd_prof, "Toggle profiler; prof trace [file] saves a trace");
+    console_add_cmd("metrics", &console_cmd_metrics, "Show host metrics; metrics write <file> saves them");
+    console_add_cmd("mem",   &console_cmd_mem,  "Show memory use by subsystem");
+    console_add_cmd("log",   &console_cmd_log,  "Log level (debug/info/error/off); log <module> <level|default>");
 }
@@ -1,4 +1,7 @@
+#include <stdio.h>
 #include <math.h>
+#include <SDL2/SDL.h>
+#include <shadowdive/script.h>
 #include "controller/ai_controller.h"
 #include "game/objects/har.h"
 #include "game/objects/scrap.h"
@@ -8,13 +11,22 @@
 #include "game/scenes/arena.h"
 #include "game/game_state.h"
 #include "game/utils/serial.h"
+#include "game/utils/settings.h"
 #include "resources/af_loader.h"
 #include "resources/ids.h"
 #include "resources/animation.h"
+#include "resources/pathmanager.h"
 #include "controller/controller.h"
 #include "utils/log.h"
+#include "utils/miscmath.h"
 #include "utils/vec.h"
 #include "utils/random.h"
+#include "game/common_defines.h"
+
+// Lookahead search parameters
+#define AI_SIM_ARENA_SIZE 8
+#define AI_LOOKAHEAD_TICKS 40
+#define AI_BODY_HALF_WIDTH 25
 
 typedef struct move_stat_t {
     int max_hit_dist;
@@ -25,6 +37,36 @@ typedef struct move_stat_t {
     int last_dist;
 } move_stat;
 
+// Learned move statistics, per HAR. Loaded from disk on first AI creation,
+// and updated from finished matches when training.
+#define AI_STATS_MAGIC "OAIS"
+#define AI_STATS_VERSION 1
+
+typedef struct ai_move_record_t {
+    int8_t value;
+    int16_t min_hit_dist;
+    int16_t max_hit_dist;
+    uint32_t samples;
+} ai_move_record;
+
+static ai_move_record ai_stats[NUMBER_OF_HAR_TYPES][70];
+static int ai_stats_loaded = 0;
+static int ai_training = 0;
+
+// Where and when a move can connect. Computed once per AF file.
+typedef struct move_hit_profile_t {
+    int profiled;
+    int hit_tick; // Ticks from move start to first frame with hit coordinates, -1 if none
+    int reach; // Largest forward reach of the hit coordinates
+} move_hit_profile;
+
+// Lightweight clone of HAR physics state for the lookahead search. No animation, no rendering.
+typedef struct ai_sim_har_t {
+    vec2f pos;
+    vec2f vel;
+    float gravity;
+} ai_sim_har;
+
 typedef struct ai_t {
     int har_event_hooked;
     int difficulty;
@@ -41,6 +83,18 @@ typedef struct ai_t {
 
     // all projectiles currently on screen (vector of projectile object*)
     vector active_projectiles;
+
+    // HAR whose learned stats are in move_stats, -1 if none
+    int stats_har;
+
+    // lookahead search
+    int search_budget; // Moves that may be profiled per decision, 0 disables search
+    af *profiled_af;
+    move_hit_profile hit_profiles[70];
+    ai_sim_har sim_arena[AI_SIM_ARENA_SIZE]; // reset every tick
+    int sim_used;
+    int dist_ground[AI_LOOKAHEAD_TICKS]; // predicted distance if we stop and attack
+    int dist_air[AI_LOOKAHEAD_TICKS]; // predicted distance if we keep our momentum
 } ai;
 
 
@@ -134,8 +188,212 @@ int ai_har_event(controller *ctrl, har_event event) {
 }
 
 
+static void ai_stats_reset() {
+    for(int i = 0; i < NUMBER_OF_HAR_TYPES; i++) {
+        for(int k = 0; k < 70; k++) {
+            ai_stats[i][k].value = 0;
+            ai_stats[i][k].min_hit_dist = -1;
+            ai_stats[i][k].max_hit_dist = -1;
+            ai_stats[i][k].samples = 0;
+        }
+    }
+}
+
+// Folds the stats of a finished match into the learned table
+static void ai_stats_merge(ai *a) {
+    if(a->stats_har < 0 || a->stats_har >= NUMBER_OF_HAR_TYPES) {
+        return;
+    }
+    for(int i = 0; i < 70; i++) {
+        move_stat *ms = &a->move_stats[i];
+        ai_move_record *r = &ai_stats[a->stats_har][i];
+        if(ms->attempts == 0) {
+            continue;
+        }
+        int64_t value = (r->value * (int64_t)r->samples + ms->value * ms->attempts) / (r->samples + ms->attempts);
+        r->value = clamp(value, -100, 10);
+        r->samples += ms->attempts;
+        if(ms->min_hit_dist != -1 && (r->min_hit_dist == -1 || ms->min_hit_dist < r->min_hit_dist)) {
+            r->min_hit_dist = ms->min_hit_dist;
+        }
+        if(ms->max_hit_dist != -1 && (r->max_hit_dist == -1 || ms->max_hit_dist > r->max_hit_dist)) {
+            r->max_hit_dist = ms->max_hit_dist;
+        }
+    }
+}
+
+// Seeds move stats for a HAR from the learned table
+static void ai_stats_apply(ai *a, int har_id) {
+    a->stats_har = har_id;
+    if(har_id < 0 || har_id >= NUMBER_OF_HAR_TYPES) {
+        return;
+    }
+    for(int i = 0; i < 70; i++) {
+        move_stat *ms = &a->move_stats[i];
+        ai_move_record *r = &ai_stats[har_id][i];
+        memset(ms, 0, sizeof(move_stat));
+        ms->last_dist = -1;
+        ms->value = r->value;
+        ms->min_hit_dist = r->min_hit_dist;
+        ms->max_hit_dist = r->max_hit_dist;
+    }
+}
+
+// Folds a record read from a stats file into the learned table,
+// weighting the values by sample count
+static void ai_record_merge(ai_move_record *r, const ai_move_record *o) {
+    if(o->samples == 0) {
+        return;
+    }
+    int64_t value = (r->value * (int64_t)r->samples + o->value * (int64_t)o->samples) / ((int64_t)r->samples + o->samples);
+    r->value = clamp(value, -100, 10);
+    r->samples += o->samples;
+    if(o->min_hit_dist != -1 && (r->min_hit_dist == -1 || o->min_hit_dist < r->min_hit_dist)) {
+        r->min_hit_dist = o->min_hit_dist;
+    }
+    if(o->max_hit_dist != -1 && (r->max_hit_dist == -1 || o->max_hit_dist > r->max_hit_dist)) {
+        r->max_hit_dist = o->max_hit_dist;
+    }
+}
+
+// Reads a stats file into the learned table. When merging, the records are
+// folded into the current table instead of replacing it.
+static int ai_stats_read(const char *filename, int merge) {
+    FILE *f = fopen(filename, "rb");
+    if(f == NULL) {
+        return 1;
+    }
+    serial ser;
+    serial_create(&ser);
+    char buf[1024];
+    size_t len;
+    while((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+        serial_write(&ser, buf, len);
+    }
+    fclose(f);
+
+    char magic[4];
+    serial_read(&ser, magic, 4);
+    int version = serial_read_int8(&ser);
+    int hars = (uint8_t)serial_read_int8(&ser);
+    int moves = (uint8_t)serial_read_int8(&ser);
+    size_t expect = 7 + hars * moves * 9;
+    if(memcmp(magic, AI_STATS_MAGIC, 4) != 0 || version != AI_STATS_VERSION
+        || hars > NUMBER_OF_HAR_TYPES || moves > 70 || serial_len(&ser) != expect) {
+        PERROR("AI stats file '%s' is invalid; ignoring it.", filename);
+        serial_free(&ser);
+        return 1;
+    }
+    for(int i = 0; i < hars; i++) {
+        for(int k = 0; k < moves; k++) {
+            ai_move_record r;
+            r.value = serial_read_int8(&ser);
+            r.min_hit_dist = serial_read_int16(&ser);
+            r.max_hit_dist = serial_read_int16(&ser);
+            r.samples = serial_read_int32(&ser);
+            if(merge) {
+                ai_record_merge(&ai_stats[i][k], &r);
+            } else {
+                ai_stats[i][k] = r;
+            }
+        }
+    }
+    serial_free(&ser);
+    return 0;
+}
+
+/** \brief Loads learned AI move statistics
+  *
+  * \param filename File written by ai_controller_save_stats
+  * \return 0 on success, 1 on error. On error the table is left empty.
+  */
+int ai_controller_load_stats(const char *filename) {
+    ai_stats_reset();
+    ai_stats_loaded = 1;
+    if(ai_stats_read(filename, 0)) {
+        ai_stats_reset();
+        return 1;
+    }
+    DEBUG("Loaded AI stats from '%s'.", filename);
+    return 0;
+}
+
+/** \brief Merges AI move statistics into the learned table
+  *
+  * Used to combine the results of training runs done in parallel. Values are
+  * averaged by sample count, and the hit distance ranges are widened.
+  *
+  * \param filename File written by ai_controller_save_stats
+  * \return 0 on success, 1 on error. On error the table is left as it was.
+  */
+int ai_controller_merge_stats(const char *filename) {
+    ai_stats_loaded = 1;
+    if(ai_stats_read(filename, 1)) {
+        return 1;
+    }
+    DEBUG("Merged AI stats from '%s'.", filename);
+    return 0;
+}
+
+/** \brief Saves learned AI move statistics
+  *
+  * \param filename File to write
+  * \return 0 on success, 1 on error.
+  */
+int ai_controller_save_stats(const char *filename) {
+    serial ser;
+    serial_create(&ser);
+    serial_write(&ser, AI_STATS_MAGIC, 4);
+    serial_write_int8(&ser, AI_STATS_VERSION);
+    serial_write_int8(&ser, NUMBER_OF_HAR_TYPES);
+    serial_write_int8(&ser, 70);
+    for(int i = 0; i < NUMBER_OF_HAR_TYPES; i++) {
+        for(int k = 0; k < 70; k++) {
+            ai_move_record *r = &ai_stats[i][k];
+            serial_write_int8(&ser, r->value);
+            serial_write_int16(&ser, r->min_hit_dist);
+            serial_write_int16(&ser, r->max_hit_dist);
+            serial_write_int32(&ser, r->samples);
+        }
+    }
+
+    int ret = 0;
+    FILE *f = fopen(filename, "wb");
+    if(f == NULL || fwrite(ser.data, 1, ser.len, f) != ser.len) {
+        PERROR("Unable to write AI stats file '%s'.", filename);
+        ret = 1;
+    }
+    if(f != NULL) {
+        fclose(f);
+    }
+    serial_free(&ser);
+    return ret;
+}
+
+/** \brief Empties the learned AI move statistics
+  *
+  * AI controllers created after this start from scratch, and the stats file
+  * is not loaded.
+  */
+void ai_controller_reset_stats() {
+    ai_stats_reset();
+    ai_stats_loaded = 1;
+}
+
+/** \brief Toggles AI training
+  *
+  * When training is on, AI controllers fold their move statistics into the
+  * learned table when they are freed, ie. when a match ends.
+  */
+void ai_controller_set_training(int training) {
+    ai_training = training;
+}
+
 void ai_controller_free(controller *ctrl) {
     ai *a = ctrl->data;
+    if(ai_training) {
+        ai_stats_merge(a);
+    }
     vector_free(&a->active_projectiles);
     free(a);
 }
@@ -223,9 +481,9 @@ int maybe(int difficulty) {
 // return 1 on block
 int ai_block_har(controller *ctrl, ctrl_event **ev) {
     ai *a = ctrl->data;
-    object *o = ctrl->har;
+    object *o = controller_get_har(ctrl);
     har *h = object_get_userdata(o);
-    object *o_enemy = game_state_get_player(o->gs, h->player_id == 1 ? 0 : 1)->har;
+    object *o_enemy = game_player_get_har(game_state_get_player(o->gs, h->player_id == 1 ? 0 : 1));
     har *h_enemy = object_get_userdata(o_enemy);
 
     // XXX TODO get maximum move distance from the animation object
@@ -246,7 +504,7 @@ int ai_block_har(controller *ctrl, ctrl_event **ev) {
 
 int ai_block_projectile(controller *ctrl, ctrl_event **ev) {
     ai *a = ctrl->data;
-    object *o = ctrl->har;
+    object *o = controller_get_har(ctrl);
 
     iterator it;
     object **o_tmp;
@@ -274,14 +532,129 @@ int ai_block_projectile(controller *ctrl, ctrl_event **ev) {
     return 0;
 }
 
+static ai_sim_har* ai_sim_clone(ai *a, const object *o) {
+    if(a->sim_used >= AI_SIM_ARENA_SIZE) {
+        return NULL;
+    }
+    ai_sim_har *s = &a->sim_arena[a->sim_used++];
+    s->pos = o->pos;
+    s->vel = o->vel;
+    s->gravity = o->gravity;
+    return s;
+}
+
+// Roughly what har_move and object gravity do, minus all the state handling
+static void ai_sim_step(ai_sim_har *s) {
+    s->pos.x += s->vel.x;
+    s->pos.y += s->vel.y;
+    if(s->pos.x < ARENA_LEFT_WALL) {
+        s->pos.x = ARENA_LEFT_WALL;
+    } else if(s->pos.x > ARENA_RIGHT_WALL) {
+        s->pos.x = ARENA_RIGHT_WALL;
+    }
+    if(s->pos.y < ARENA_FLOOR) {
+        s->vel.y += s->gravity;
+    } else {
+        s->pos.y = ARENA_FLOOR;
+        s->vel.y = 0;
+        s->vel.x = 0;
+    }
+}
+
+static void ai_profile_move(move_hit_profile *p, af_move *move) {
+    p->profiled = 1;
+    p->hit_tick = -1;
+    p->reach = 0;
+    if(vector_size(&move->ani.collision_coords) == 0) {
+        return;
+    }
+
+    sd_script script;
+    int err_pos;
+    sd_script_create(&script);
+    if(sd_script_decode(&script, str_c(&move->ani.animation_string), &err_pos) != SD_SUCCESS) {
+        sd_script_free(&script);
+        return;
+    }
+
+    iterator it;
+    collision_coord *cc;
+    const sd_script_frame *frame;
+    for(int i = 0; (frame = sd_script_get_frame(&script, i)) != NULL; i++) {
+        int found = 0;
+        vector_iter_begin(&move->ani.collision_coords, &it);
+        while((cc = iter_next(&it)) != NULL) {
+            if(cc->frame_index == frame->sprite) {
+                found = 1;
+                if(cc->pos.x > p->reach) {
+                    p->reach = cc->pos.x;
+                }
+            }
+        }
+        if(found && p->hit_tick < 0) {
+            p->hit_tick = sd_script_get_tick_pos_at_frame(&script, i);
+        }
+    }
+    sd_script_free(&script);
+}
+
+// Predict both HAR positions a few ticks ahead. Returns 0 if the clone arena ran out.
+static int ai_predict(ai *a, object *o, object *o_enemy, int ticks) {
+    a->sim_used = 0;
+    ai_sim_har *enemy = ai_sim_clone(a, o_enemy);
+    ai_sim_har *ground = ai_sim_clone(a, o);
+    ai_sim_har *air = ai_sim_clone(a, o);
+    if(!enemy || !ground || !air) {
+        return 0;
+    }
+
+    // Starting a move on the ground stops walking. In the air we keep going.
+    if(ground->pos.y >= ARENA_FLOOR) {
+        ground->vel.x = 0;
+    }
+    for(int i = 0; i < ticks; i++) {
+        a->dist_ground[i] = abs((int)(ground->pos.x - enemy->pos.x));
+        a->dist_air[i] = abs((int)(air->pos.x - enemy->pos.x));
+        ai_sim_step(enemy);
+        ai_sim_step(ground);
+        ai_sim_step(air);
+    }
+    return 1;
+}
+
+// Score adjustment from the lookahead; whether the move would connect when its hit frames come up.
+static int ai_lookahead_value(ai *a, af_move *move) {
+    move_hit_profile *p = &a->hit_profiles[move->id];
+    if(p->hit_tick < 0) {
+        return 0;
+    }
+    int tick = p->hit_tick < AI_LOOKAHEAD_TICKS ? p->hit_tick : AI_LOOKAHEAD_TICKS - 1;
+    int dist = (move->category == CAT_JUMPING) ? a->dist_air[tick] : a->dist_ground[tick];
+    if(dist <= p->reach + AI_BODY_HALF_WIDTH) {
+        return 4;
+    }
+    if(dist > p->reach + AI_BODY_HALF_WIDTH * 2) {
+        return -4;
+    }
+    return 0;
+}
+
 int ai_controller_poll(controller *ctrl, ctrl_event **ev) {
     ai *a = ctrl->data;
-    object *o = ctrl->har;
+    object *o = controller_get_har(ctrl);
     if (!o) {
         return 1;
     }
     har *h = object_get_userdata(o);
-    object *o_enemy = game_state_get_player(o->gs, h->player_id == 1 ? 0 : 1)->har;
+    object *o_enemy = game_player_get_har(game_state_get_player(o->gs, h->player_id == 1 ? 0 : 1));
+
+    // Pick up learned stats once we know which HAR we are driving
+    if(a->stats_har != h->id) {
+        if(ai_training) {
+            ai_stats_merge(a);
+        }
+        ai_stats_apply(a, h->id);
+    }
 
     // Do not run AI while the game is paused
     if(game_state_is_paused(o->gs)) { return 0; }
@@ -329,7 +702,10 @@ int ai_controller_poll(controller *ctrl, ctrl_event **ev) {
         af_move *selected_move = NULL;
         int top_value = 0;
 
-        // Attack
+        // Collect valid moves and their base values first
+        af_move *cand_moves[70];
+        int cand_values[70];
+        int cand_count = 0;
         for(int i = 0; i < 70; i++) {
             af_move *move = NULL;
             if((move = af_get_move(h->af_data, i))) {
@@ -352,14 +728,42 @@ int ai_controller_poll(controller *ctrl, ctrl_event **ev) {
                         continue;
                     }
 
-                    if (selected_move == NULL){
-                        selected_move = move;
-                        top_value = value;
-                    } else if (value > top_value) {
-                        selected_move = move;
-                        top_value = value;
+                    cand_moves[cand_count] = move;
+                    cand_values[cand_count] = value;
+                    cand_count++;
+                }
+            }
+        }
+
+        // Lookahead search, only done at DEADLY and above. This is not a real
+        // simulation; ai_sim_step just extrapolates both HARs linearly from their
+        // current velocity. Hit profiles are computed lazily, at most search_budget
+        // of them per decision, and moves that have not been profiled yet keep
+        // their base value. The budget counts work instead of time, so the same
+        // situation always gives the same decision, regardless of machine speed.
+        if(a->search_budget > 0 && cand_count > 0 && ai_predict(a, o, o_enemy, AI_LOOKAHEAD_TICKS)) {
+            if(a->profiled_af != h->af_data) {
+                memset(a->hit_profiles, 0, sizeof(a->hit_profiles));
+                a->profiled_af = h->af_data;
+            }
+            int budget = a->search_budget;
+            for(int i = 0; i < cand_count; i++) {
+                move_hit_profile *p = &a->hit_profiles[cand_moves[i]->id];
+                if(!p->profiled) {
+                    if(budget <= 0) {
+                        continue;
                     }
+                    budget--;
+                    ai_profile_move(p, cand_moves[i]);
                 }
+                cand_values[i] += ai_lookahead_value(a, cand_moves[i]);
+            }
+        }
+
+        for(int i = 0; i < cand_count; i++) {
+            if(selected_move == NULL || cand_values[i] > top_value) {
+                selected_move = cand_moves[i];
+                top_value = cand_values[i];
             }
         }
         for(int i = 0; i < 70; i++) {
@@ -415,6 +819,10 @@ int ai_controller_poll(controller *ctrl, ctrl_event **ev) {
 }
 
 void ai_controller_create(controller *ctrl, int difficulty) {
+    if(!ai_stats_loaded) {
+        ai_controller_load_stats(pm_get_local_path(AI_STATS_PATH));
+    }
+
     ai *a = malloc(sizeof(ai));
     a->har_event_hooked = 0;
     a->difficulty = difficulty+1;
@@ -431,8 +839,17 @@ void ai_controller_create(controller *ctrl, int difficulty) {
         a->move_stats[i].last_dist = -1;
     }
     a->blocked = 0;
+    a->stats_har = -1;
     vector_create(&a->active_projectiles, sizeof(object*));
 
+    // Only the hardest difficulties get to spend CPU on searching
+    a->search_budget = 0;
+    if(difficulty >= DEADLY && settings_get()->advanced.ai_search_budget > 0) {
+        a->search_budget = settings_get()->advanced.ai_search_budget;
+    }
+    a->profiled_af = NULL;
+    a->sim_used = 0;
+
     ctrl->data = a;
     ctrl->type = CTRL_TYPE_AI;
     ctrl->poll_fun = &ai_controller_poll;
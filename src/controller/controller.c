@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include "utils/log.h"
+#include "utils/frame_alloc.h"
 #include "controller/controller.h"
 
 typedef struct hook_function_t {
@@ -10,7 +11,7 @@ typedef struct hook_function_t {
 void controller_init(controller *ctrl) {
     list_create(&ctrl->hooks);
     ctrl->extra_events = NULL;
-    ctrl->har = NULL;
+    ctrl->har = object_ref_create(NULL);
     ctrl->poll_fun = NULL;
     ctrl->tick_fun = NULL;
     ctrl->dyntick_fun = NULL;
@@ -47,7 +48,7 @@ void controller_free_chain(ctrl_event *ev) {
             serial_free(ev->event_data.ser);
             free(ev->event_data.ser);
         }
-        free(ev);
+        frame_alloc_free(ev);
     }
 }
 
@@ -62,14 +63,14 @@ void controller_cmd(controller* ctrl, int action, ctrl_event **ev) {
         ((*p)->fp)((*p)->source, action);
     }
     if (*ev == NULL) {
-        *ev = malloc(sizeof(ctrl_event));
+        *ev = frame_alloc_malloc(sizeof(ctrl_event));
         (*ev)->type = EVENT_TYPE_ACTION;
         (*ev)->event_data.action = action;
         (*ev)->next = NULL;
     } else {
         i = *ev;
         while (i->next) { i = i->next; }
-        i->next = malloc(sizeof(ctrl_event));
+        i->next = frame_alloc_malloc(sizeof(ctrl_event));
         i->next->type = EVENT_TYPE_ACTION;
         i->next->event_data.action = action;
         i->next->next = NULL;
@@ -81,7 +82,7 @@ void controller_sync(controller *ctrl, serial *ser, ctrl_event **ev) {
         // a sync event obsoletes all previous events
         controller_free_chain(*ev);
     }
-    *ev = malloc(sizeof(ctrl_event));
+    *ev = frame_alloc_malloc(sizeof(ctrl_event));
     (*ev)->type = EVENT_TYPE_SYNC;
     (*ev)->event_data.ser = ser;
     (*ev)->next = NULL;
@@ -92,7 +93,7 @@ void controller_close(controller *ctrl, ctrl_event **ev) {
         // a close event obsoletes all previous events
         controller_free_chain(*ev);
     }
-    *ev = malloc(sizeof(ctrl_event));
+    *ev = frame_alloc_malloc(sizeof(ctrl_event));
     (*ev)->type = EVENT_TYPE_CLOSE;
     (*ev)->next = NULL;
 }
@@ -132,6 +133,15 @@ int controller_har_hook(controller *ctrl, har_event event) {
     return 0;
 }
 
+void controller_set_har(controller *ctrl, object *har) {
+    ctrl->har = object_ref_create(har);
+}
+
+// NULL if the controller has no HAR, or it has been freed
+object* controller_get_har(controller *ctrl) {
+    return object_ref_get(&ctrl->har);
+}
+
 void controller_set_repeat(controller *ctrl, int repeat) {
     ctrl->repeat = repeat;
 }
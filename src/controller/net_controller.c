@@ -2,6 +2,7 @@
 
 #include "controller/net_controller.h"
 #include "utils/log.h"
+#include "utils/metrics.h"
 
 typedef struct wtf_t {
     ENetHost *host;
@@ -13,6 +14,12 @@ typedef struct wtf_t {
     int disconnected;
 } wtf;
 
+static void net_controller_send(ENetPeer *peer, int channel, ENetPacket *packet) {
+    metrics_add(METRIC_PACKETS_SENT, 1);
+    metrics_add(METRIC_BYTES_SENT, packet->dataLength);
+    enet_peer_send(peer, channel, packet);
+}
+
 void net_controller_free(controller *ctrl) {
     wtf *data = ctrl->data;
     ENetEvent event;
@@ -50,6 +57,8 @@ int net_controller_tick(controller *ctrl, int ticks, ctrl_event **ev) {
     while (enet_host_service(host, &event, 0) > 0) {
         switch (event.type) {
             case ENET_EVENT_TYPE_RECEIVE:
+                metrics_add(METRIC_PACKETS_RECEIVED, 1);
+                metrics_add(METRIC_BYTES_RECEIVED, event.packet->dataLength);
                 ser = malloc(sizeof(serial));
                 serial_create(ser);
                 ser->data = malloc(event.packet->dataLength);
@@ -78,6 +87,7 @@ int net_controller_tick(controller *ctrl, int ticks, ctrl_event **ev) {
                                 } else if (newrtt < ctrl->rtt) {
                                     ctrl->rtt--;
                                 }
+                                metrics_set_slot(METRIC_PEER_RTT, data->id, ctrl->rtt);
                                 data->outstanding_hb = 0;
                                 data->last_hb = ticks;
                                 serial_free(ser);
@@ -86,7 +96,7 @@ int net_controller_tick(controller *ctrl, int ticks, ctrl_event **ev) {
                                 ENetPacket *packet;
                                 packet = enet_packet_create(ser->data, ser->len, ENET_PACKET_FLAG_UNSEQUENCED);
                                 if (peer) {
-                                    enet_peer_send(peer, 0, packet);
+                                    net_controller_send(peer, 0, packet);
                                     enet_host_flush (host);
                                 }
                             }
@@ -124,7 +134,7 @@ int net_controller_tick(controller *ctrl, int ticks, ctrl_event **ev) {
         serial_write_int32(&ser, ticks);
         packet = enet_packet_create(ser.data, ser.len, ENET_PACKET_FLAG_UNSEQUENCED);
         if (peer) {
-            enet_peer_send(peer, 0, packet);
+            net_controller_send(peer, 0, packet);
             enet_host_flush (host);
         } else {
             DEBUG("peer is null~");
@@ -154,8 +164,9 @@ int net_controller_update(controller *ctrl, serial *serial) {
     packet = enet_packet_create(buf, serial->len+4, 0);
     free(buf);
     if (peer) {
-        enet_peer_send(peer, 1, packet);
+        net_controller_send(peer, 1, packet);
         enet_host_flush(host);
+        metrics_add(METRIC_SYNCS_SENT, 1);
     } else {
         DEBUG("peer is null~");
     }
@@ -181,7 +192,7 @@ void controller_hook(controller *ctrl, int action) {
     /*sprintf(buf, "k%d", action);*/
     packet = enet_packet_create(ser.data, ser.len, ENET_PACKET_FLAG_RELIABLE);
     if (peer) {
-        enet_peer_send(peer, 1, packet);
+        net_controller_send(peer, 1, packet);
         enet_host_flush (host);
     } else {
         DEBUG("peer is null~");
@@ -211,7 +222,7 @@ void net_controller_har_hook(int action, void *cb_data) {
     /*sprintf(buf, "k%d", action);*/
     packet = enet_packet_create(ser.data, ser.len, ENET_PACKET_FLAG_RELIABLE);
     if (peer) {
-        enet_peer_send(peer, 1, packet);
+        net_controller_send(peer, 1, packet);
         /*enet_host_flush (host);*/
     } else {
         DEBUG("peer is null~");
@@ -78,3 +78,41 @@ void rec_controller_create(controller *ctrl, int player, sd_rec_file *rec) {
     ctrl->type = CTRL_TYPE_REC;
     ctrl->dyntick_fun = &rec_controller_tick;
 }
+
+/*
+ * The arena ID resides in the high byte of header field 'L', same as in the original game.
+ * Game speed and RNG seed are not part of the original format, so we stash them in
+ * fields 'I', 'J' and 'K'. The original game writes its own data there, so the high
+ * byte of 'I' holds REC_INFO_MAGIC to tell our files apart; the speed is in the low byte.
+ */
+#define REC_INFO_MAGIC 0x4F
+
+void rec_write_match_info(sd_rec_file *rec, const rec_match_info *info) {
+    rec->unknown_l = (rec->unknown_l & 0x00FFFFFF) | ((info->arena_id & 0xFF) << 24);
+    rec->unknown_i = (REC_INFO_MAGIC << 8) | (info->speed & 0xFF);
+    rec->unknown_j = info->seed & 0xFFFF;
+    rec->unknown_k = (info->seed >> 16) & 0xFFFF;
+}
+
+void rec_read_match_info(const sd_rec_file *rec, rec_match_info *info) {
+    info->arena_id = ((uint32_t)rec->unknown_l >> 24) & 0xFF;
+    info->speed = -1;
+    info->seed = 0;
+    info->has_seed = 0;
+
+    // Files recorded by the original game may contain anything in these fields
+    if(info->arena_id > 4) {
+        DEBUG("Recording has invalid arena ID %d, falling back to arena 0", info->arena_id);
+        info->arena_id = 0;
+    }
+    if((((uint16_t)rec->unknown_i >> 8) & 0xFF) != REC_INFO_MAGIC) {
+        DEBUG("Recording has no speed and seed, using the defaults");
+        return;
+    }
+    info->speed = rec->unknown_i & 0xFF;
+    info->seed = ((uint32_t)(uint16_t)rec->unknown_k << 16) | (uint16_t)rec->unknown_j;
+    info->has_seed = 1;
+    if(info->speed > 10) {
+        info->speed = -1;
+    }
+}
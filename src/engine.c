@@ -1,34 +1,99 @@
 #include <stdio.h>
+#include <string.h>
 #include <signal.h> // signal()
+#include <stdatomic.h>
 #include <SDL2/SDL.h>
 #include "engine.h"
 #include "utils/log.h"
 #include "utils/config.h"
+#include "utils/frame_alloc.h"
+#include "utils/histogram.h"
+#include "utils/memtrack.h"
+#include "utils/metrics.h"
+#include "utils/miscmath.h"
+#include "utils/profiler.h"
+#include "utils/task.h"
 #include "audio/audio.h"
 #include "audio/music.h"
 #include "resources/sounds_loader.h"
+#include "resources/prefetch.h"
+#include "resources/baked.h"
 #include "video/surface.h"
 #include "video/video.h"
+#include "video/video_export.h"
 #include "resources/languages.h"
 #include "game/game_state.h"
+#include "game/protos/object.h"
 #include "game/utils/settings.h"
 #include "game/utils/ticktimer.h"
 #include "game/gui/text_render.h"
+#include "controller/ai_controller.h"
+#include "resources/pathmanager.h"
 #include "console/console.h"
 
-static int run = 0;
+// Headless runs advance this much game time per rendered frame
+#define HEADLESS_FRAME_MS 20
+
+// Static ticks run at a fixed rate regardless of game speed
+#define MS_PER_STATIC_TICK 10.0
+
+static const float frame_time_bounds[] = {2.0f, 4.0f, 8.0f, 12.0f, 17.0f, 21.0f, 34.0f, 50.0f, 100.0f};
+static const float frame_tick_bounds[] = {1.0f, 2.0f, 3.0f, 5.0f};
+
+// Events waiting for the simulation thread
+#define ENGINE_EVENT_QUEUE_SIZE 64
+
+typedef struct engine_sim_t {
+    game_state *gs;
+    engine_init_flags *init_flags;
+} engine_sim;
+
+static atomic_int run = 0;
 static int start_timeout = 30;
+static int visual_debugger = 0;
+static int debugger_proceed = 0;
+static int debugger_render = 0;
 #ifndef STANDALONE_SERVER
 static int take_screenshot = 0;
 static int enable_screen_updates = 1;
 static char screenshot_filename[128];
+static char frame_filename[300];
+static unsigned int frame_number = 0;
+
+//if mouse_visible_ticks <= 0, hide mouse
+static int mouse_visible_ticks = 1000;
+
+static SDL_Event event_queue[ENGINE_EVENT_QUEUE_SIZE];
+static int event_head = 0;
+static int event_count = 0;
+static SDL_mutex *event_lock = NULL;
+static atomic_int sim_done = 0;
+static unsigned int startup_last = 0;
+static int startup_logged = 0;
 #endif
 
 void exit_handler(int s) {
     run = 0;
 }
 
-int engine_init() {
+// Logs how long each part of the startup took. Time is counted from SDL_Init.
+static void engine_startup_mark(const char *stage) {
+    unsigned int now = SDL_GetTicks();
+    INFO("Startup: %-16s at %4ums (+%ums)", stage, now, now - startup_last);
+    startup_last = now;
+}
+
+static int engine_load_altpals(void *userdata) {
+    return altpals_init();
+}
+
+int engine_init(engine_init_flags *init_flags) {
+    task altpals_task;
+    int fonts_ret, altpals_ret;
+
+    profiler_init();
+    metrics_init(settings_get()->net.metrics_file, settings_get()->net.metrics_interval);
+
 #ifndef STANDALONE_SERVER
     settings *setting = settings_get();
 
@@ -41,9 +106,16 @@ int engine_init() {
     const char *audiosink = setting->sound.sink;
 
     // Initialize everything.
-    if(video_init(w, h, fs, vsync, scaler, scale_factor)) {
+    if(init_flags->headless) {
+        if(video_init_headless()) {
+            goto exit_0;
+        }
+    } else if(video_init(w, h, fs, vsync, scaler, scale_factor)) {
         goto exit_0;
     }
+    if(setting->video.software_render) {
+        video_set_software(1);
+    }
     if(!audio_is_sink_available(audiosink)) {
         const char *prev_sink = audiosink;
         audiosink = audio_get_first_sink_name();
@@ -53,29 +125,54 @@ int engine_init() {
             INFO("Could not find requested sink '%s'. Falling back to '%s'.", prev_sink, audiosink);
         }
     }
-    if(audio_init(audiosink)) {
+    if(strlen(init_flags->export_file) > 0) {
+        if(audio_init_export(init_flags->export_audio_file)) {
+            goto exit_1;
+        }
+        if(video_export_open(init_flags->export_file, 1000 / HEADLESS_FRAME_MS)) {
+            goto exit_2;
+        }
+    } else if(init_flags->headless) {
+        // Nobody to listen to it
+        audio_init(NULL);
+    } else if(audio_init(audiosink)) {
         goto exit_1;
     }
     sound_set_volume(setting->sound.sound_vol/10.0f);
     music_set_volume(setting->sound.music_vol/10.0f);
 #endif
+    engine_startup_mark("video and audio");
 
+    // Sounds and language strings load in the background until first used,
+    // and altpals loads while the fonts are decoded.
     if(sounds_loader_init()) {
         goto exit_2;
     }
     if(lang_init()) {
         goto exit_3;
     }
-    if(fonts_init()) {
+    task_start(&altpals_task, "altpals", engine_load_altpals, NULL);
+    fonts_ret = fonts_init();
+    altpals_ret = task_wait(&altpals_task);
+    task_free(&altpals_task);
+    if(fonts_ret) {
+        altpals_close();
         goto exit_4;
     }
-    if(altpals_init()) {
+    if(altpals_ret) {
         goto exit_5;
     }
+    engine_startup_mark("fonts and palettes");
     if(console_init()) {
         goto exit_6;
     }
 
+    // Prebaked sprites, if the resources have been baked. Original files are used otherwise.
+    baked_open(pm_get_local_path(BAKE_PATH));
+
+    // Background loader for scene changes. Not fatal if it fails to start.
+    prefetch_init();
+
     // Return successfully
     run = 1;
     INFO("Engine initialization successful.");
@@ -93,6 +190,7 @@ exit_3:
 
 exit_2:
 #ifndef STANDALONE_SERVER
+    video_export_close();
     audio_close();
 #endif
 
@@ -105,153 +203,218 @@ exit_0:
     return 1;
 }
 
-void engine_run(engine_init_flags *init_flags) {
-    SDL_Event e;
-    int visual_debugger = 0;
-    int debugger_proceed = 0;
-    int debugger_render = 0;
+#ifndef STANDALONE_SERVER
+// Passes an event on to the console or to the game, and picks up the debug keys
+static void engine_dispatch_event(game_state *gs, SDL_Event *e) {
+    if(e->type == SDL_KEYDOWN) {
+        if(e->key.keysym.sym == SDLK_F1) {
+            take_screenshot = 1;
+        }
+        if(e->key.keysym.sym == SDLK_F5) {
+            visual_debugger = !visual_debugger;
+        }
+        if(e->key.keysym.sym == SDLK_SPACE) {
+            debugger_proceed = 1;
+        }
+        if(e->key.keysym.sym == SDLK_F6) {
+            debugger_render = !debugger_render;
+        }
+        if(e->key.keysym.sym == SDLK_F7) {
+            profiler_set_enabled(!profiler_is_enabled());
+        }
+    }
 
-    //if mouse_visible_ticks <= 0, hide mouse
-    int mouse_visible_ticks = 1000;
+    // Console events
+    if(e->type == SDL_KEYDOWN) {
+        if(console_window_is_open() && (e->key.keysym.scancode == SDL_SCANCODE_GRAVE ||
+                                        e->key.keysym.sym == SDLK_BACKQUOTE ||
+                                        e->key.keysym.sym == SDLK_TAB ||
+                                        e->key.keysym.sym == SDLK_ESCAPE)) {
+            console_window_close();
+            return;
+        } else if(e->key.keysym.sym == SDLK_TAB ||
+                  e->key.keysym.sym == SDLK_BACKQUOTE ||
+                  e->key.keysym.scancode == SDL_SCANCODE_GRAVE) {
+            console_window_open();
+            return;
+        }
+    }
 
-    INFO(" --- BEGIN GAME LOG ---");
+    // If console windows is open, pass events to console.
+    // Otherwise to the objects.
+    if(console_window_is_open()) {
+        console_event(gs, e);
+    } else {
+        game_state_handle_event(gs, e);
+    }
+}
 
-#ifdef STANDALONE_SERVER
-    // Init interrupt signal handler
-    signal(SIGINT, exit_handler);
-#endif
+// Average time per frame spent in each profiled zone, and how many times it was run
+static void engine_render_profiler() {
+    char buf[64];
+    for(int i = 0; i < PROFILE_ZONE_COUNT; i++) {
+        snprintf(buf, sizeof(buf), "%-17s %6.2fms %5.1f",
+                 profiler_zone_name(i),
+                 profiler_zone_ms(i),
+                 profiler_zone_calls(i));
+        font_render_shadowed(&font_small, buf, 4, 4 + i * 8, COLOR_GREEN, TEXT_SHADOW_RIGHT|TEXT_SHADOW_BOTTOM);
+    }
+}
 
-#ifndef STANDALONE_SERVER
-    // Game start timeout.
-    // Wait a moment so that people are mentally prepared
-    // (with the recording software on) for the game to start :)
-    if(!settings_get()->video.crossfade_on) {
-        start_timeout = 0;
+static void engine_queue_event(const SDL_Event *e) {
+    SDL_LockMutex(event_lock);
+    if(event_count < ENGINE_EVENT_QUEUE_SIZE) {
+        event_queue[(event_head + event_count) % ENGINE_EVENT_QUEUE_SIZE] = *e;
+        event_count++;
+    } else {
+        DEBUG("Event queue is full, dropping an event.");
     }
-    while(start_timeout > 0) {
-        start_timeout--;
-        while(SDL_PollEvent(&e)) {
-            if(e.type == SDL_QUIT) {
-                return;
-            }
-        }
-        video_render_prepare();
-        video_render_finish();
-        continue;
+    SDL_UnlockMutex(event_lock);
+}
+
+// Called on the simulation thread to handle whatever the window thread has queued
+static void engine_dispatch_queued_events(game_state *gs) {
+    SDL_Event e;
+    SDL_LockMutex(event_lock);
+    while(event_count > 0) {
+        e = event_queue[event_head];
+        event_head = (event_head + 1) % ENGINE_EVENT_QUEUE_SIZE;
+        event_count--;
+        SDL_UnlockMutex(event_lock);
+        engine_dispatch_event(gs, &e);
+        SDL_LockMutex(event_lock);
     }
+    SDL_UnlockMutex(event_lock);
+}
 
-    // apply volume settings
-    sound_set_volume(settings_get()->sound.sound_vol/10.0f);
-#endif
+/*
+ * Handles the window events, and passes the rest on to the game. When the
+ * simulation runs on its own thread, the rest are queued for it instead.
+ * Must be called from the thread that owns the window.
+ */
+static void engine_poll_events(game_state *gs, int threaded, double elapsed_ms) {
+    SDL_Event e;
+    int check_fs;
+    while(SDL_PollEvent(&e)) {
+        // Handle other events
+        switch(e.type) {
+            case SDL_QUIT:
+                run = 0;
+                break;
+            case SDL_MOUSEMOTION:
+                mouse_visible_ticks = 1000;
+                SDL_ShowCursor(1);
+                break;
+            case SDL_WINDOWEVENT:
+                switch(e.window.event) {
+                    case SDL_WINDOWEVENT_MINIMIZED:
+                        DEBUG("MINIMIZED");
+                        enable_screen_updates = 0;
+                        break;
+                    case SDL_WINDOWEVENT_HIDDEN:
+                        DEBUG("HIDDEN");
+                        enable_screen_updates = 0;
+                        break;
+                    case SDL_WINDOWEVENT_MAXIMIZED:
+                        DEBUG("MAXIMIZED");
+                        enable_screen_updates = 1;
+                        break;
+                    case SDL_WINDOWEVENT_RESTORED:
+                        video_get_state(NULL, NULL, &check_fs, NULL);
+                        if(check_fs) {
+                            // While threaded, this is queued up and done when presenting
+                            video_reinit_renderer();
+                        }
+                        DEBUG("RESTORED");
+                        enable_screen_updates = 1;
+                        break;
+                    case SDL_WINDOWEVENT_SHOWN:
+                        enable_screen_updates = 1;
+                        DEBUG("SHOWN");
+                        break;
+                }
+                break;
+        }
 
-    // Set up game
-    game_state *gs = malloc(sizeof(game_state));
-    if(game_state_create(gs, init_flags)) {
-        return;
+        if(threaded) {
+            engine_queue_event(&e);
+        } else {
+            engine_dispatch_event(gs, &e);
+        }
+    }
+
+    // hide mouse after n ticks
+    if(mouse_visible_ticks > 0) {
+        mouse_visible_ticks -= elapsed_ms;
+        if(mouse_visible_ticks <= 0) {
+            SDL_ShowCursor(0);
+        }
     }
+}
+#endif // STANDALONE_SERVER
+
+static void engine_dynamic_tick(game_state *gs, uint64_t perf_freq) {
+    uint64_t start = SDL_GetPerformanceCounter();
+    game_state_dynamic_tick(gs);
+    metrics_add(METRIC_TICKS, 1);
+    metrics_observe(METRIC_TICK_TIME, (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / perf_freq);
+}
+
+// Runs the game until it ends. When threaded, this is the simulation thread,
+// and the window is handled by engine_run_threaded().
+static void engine_loop(game_state *gs, engine_init_flags *init_flags, int threaded) {
+    // Game loop. Time is counted in milliseconds, but with performance counter precision.
+    uint64_t perf_freq = SDL_GetPerformanceFrequency();
+    uint64_t frame_start = SDL_GetPerformanceCounter();
+    double dynamic_wait = 0.0;
+    double static_wait = 0.0;
+    double max_catchup = settings_get()->video.max_catchup;
+    unsigned int dropped_ms = 0;
+    histogram frame_times;
+    histogram frame_ticks;
+    histogram_create(&frame_times, frame_time_bounds, sizeof(frame_time_bounds) / sizeof(float));
+    histogram_create(&frame_ticks, frame_tick_bounds, sizeof(frame_tick_bounds) / sizeof(float));
+
+    // A threaded simulation draws once per tick, and the display shows the newest of
+    // those whenever it is ready; there are no frames in between to interpolate.
+    int interpolate = settings_get()->video.interpolate && !threaded;
 
-    // Game loop
-    int frame_start = SDL_GetTicks();
-    int dynamic_wait = 0;
-    int static_wait = 0;
     while(run && game_state_is_running(gs)) {
+        metrics_tick();
 
 #ifndef STANDALONE_SERVER
         // Handle events
-        int check_fs;
-        while(SDL_PollEvent(&e)) {
-            // Handle other events
-            switch(e.type) {
-                case SDL_QUIT:
-                    run = 0;
-                    break;
-                case SDL_KEYDOWN:
-                    if(e.key.keysym.sym == SDLK_F1) {
-                        take_screenshot = 1;
-                    }
-                    if(e.key.keysym.sym == SDLK_F5) {
-                        visual_debugger = !visual_debugger;
-                    }
-                    if(e.key.keysym.sym == SDLK_SPACE) {
-                        debugger_proceed = 1;
-                    }
-                    if(e.key.keysym.sym == SDLK_F6) {
-                        debugger_render = !debugger_render;
-                    }
-                    break;
-                case SDL_MOUSEMOTION:
-                    mouse_visible_ticks = 1000;
-                    SDL_ShowCursor(1);
-                    break;
-                case SDL_WINDOWEVENT:
-                    switch(e.window.event) {
-                        case SDL_WINDOWEVENT_MINIMIZED:
-                            DEBUG("MINIMIZED");
-                            enable_screen_updates = 0;
-                            break;
-                        case SDL_WINDOWEVENT_HIDDEN:
-                            DEBUG("HIDDEN");
-                            enable_screen_updates = 0;
-                            break;
-                        case SDL_WINDOWEVENT_MAXIMIZED:
-                            DEBUG("MAXIMIZED");
-                            enable_screen_updates = 1;
-                            break;
-                        case SDL_WINDOWEVENT_RESTORED:
-                            video_get_state(NULL, NULL, &check_fs, NULL);
-                            if(check_fs) {
-                                video_reinit_renderer();
-                            }
-                            DEBUG("RESTORED");
-                            enable_screen_updates = 1;
-                            break;
-                        case SDL_WINDOWEVENT_SHOWN:
-                            enable_screen_updates = 1;
-                            DEBUG("SHOWN");
-                            break;
-                    }
-                    break;
-            }
-
-            // Console events
-            if(e.type == SDL_KEYDOWN) {
-                if(console_window_is_open() && (e.key.keysym.scancode == SDL_SCANCODE_GRAVE ||
-                                                e.key.keysym.sym == SDLK_BACKQUOTE ||
-                                                e.key.keysym.sym == SDLK_TAB ||
-                                                e.key.keysym.sym == SDLK_ESCAPE)) {
-                    console_window_close();
-                    continue;
-                } else if(e.key.keysym.sym == SDLK_TAB ||
-                          e.key.keysym.sym == SDLK_BACKQUOTE ||
-                          e.key.keysym.scancode == SDL_SCANCODE_GRAVE) {
-                    console_window_open();
-                    continue;
-                }
-            }
-
-            // If console windows is open, pass events to console.
-            // Otherwise to the objects.
-            if(console_window_is_open()) {
-                console_event(gs, &e);
-            } else {
-                game_state_handle_event(gs, &e);
-            }
+        if(threaded) {
+            engine_dispatch_queued_events(gs);
+        } else {
+            engine_poll_events(gs, 0, (double)(SDL_GetPerformanceCounter() - frame_start) * 1000.0 / perf_freq);
         }
-
-        // hide mouse after n ticks
-        if(mouse_visible_ticks > 0) {
-            mouse_visible_ticks -= SDL_GetTicks() - frame_start;
-            if(mouse_visible_ticks <= 0) {
-                SDL_ShowCursor(0);
+#endif
+        // AI training runs the simulation as fast as it can, with no rendering or audio
+        if(init_flags->train_ticks > 0) {
+            game_state_tick_controllers(gs);
+            game_state_static_tick(gs);
+            engine_dynamic_tick(gs, perf_freq);
+            if(gs->int_tick >= init_flags->train_ticks) {
+                run = 0;
             }
+            continue;
         }
-#endif
+
         // Tick controllers
         game_state_tick_controllers(gs);
 
         // Render scene
-        int dt = (SDL_GetTicks() - frame_start);
-        frame_start = SDL_GetTicks(); // Reset timer
+        uint64_t now = SDL_GetPerformanceCounter();
+        double dt = (double)(now - frame_start) * 1000.0 / perf_freq;
+        frame_start = now; // Reset timer
+        histogram_add(&frame_times, dt);
+        metrics_observe(METRIC_FRAME_TIME, dt);
+
+        // Headless runs are not tied to the wall clock, and run as fast as they can
+        if(init_flags->headless) {
+            dt = HEADLESS_FRAME_MS;
+        }
         if(!visual_debugger) {
             dynamic_wait += dt;
             static_wait += dt;
@@ -260,7 +423,21 @@ void engine_run(engine_init_flags *init_flags) {
             static_wait += 20;
             debugger_proceed = 0;
         }
-        while(static_wait > 10) {
+
+        // After a long stall, don't try to run everything that was missed
+        double catchup = max_catchup;
+        if(catchup < game_state_ms_per_dyntick(gs)) {
+            catchup = game_state_ms_per_dyntick(gs);
+        }
+        if(dynamic_wait > catchup) {
+            dropped_ms += dynamic_wait - catchup;
+            dynamic_wait = catchup;
+        }
+        if(static_wait > catchup) {
+            static_wait = catchup;
+        }
+
+        while(static_wait >= MS_PER_STATIC_TICK) {
             // Static tick for gamestate
             game_state_static_tick(gs);
 
@@ -270,14 +447,23 @@ void engine_run(engine_init_flags *init_flags) {
             // Tick video (tcache)
             video_tick();
 
-            static_wait -= 10;
+            static_wait -= MS_PER_STATIC_TICK;
         }
-        while(dynamic_wait > game_state_ms_per_dyntick(gs)) {
+        int ticks = 0;
+        while(dynamic_wait >= game_state_ms_per_dyntick(gs)) {
+            // Handle waiting period leftover time. Tick may change the speed, so take it first.
+            dynamic_wait -= game_state_ms_per_dyntick(gs);
+
             // Tick scene
-            game_state_dynamic_tick(gs);
+            engine_dynamic_tick(gs, perf_freq);
+            ticks++;
+        }
+        histogram_add(&frame_ticks, ticks);
 
-            // Handle waiting period leftover time
-            dynamic_wait -= game_state_ms_per_dyntick(gs);
+        // Draw objects partway between the last two ticks
+        gs->render_alpha = 1.0f;
+        if(interpolate && !init_flags->headless) {
+            gs->render_alpha = clampf(dynamic_wait / game_state_ms_per_dyntick(gs), 0.0f, 1.0f);
         }
 
 #ifndef STANDALONE_SERVER
@@ -287,15 +473,23 @@ void engine_run(engine_init_flags *init_flags) {
         }
 
         // Do the actual video rendering jobs
-        if(enable_screen_updates) {
+        if(threaded || enable_screen_updates) {
 
             video_render_prepare();
             game_state_render(gs);
             if(debugger_render) {
                 game_state_debug(gs);
             }
+            if(profiler_is_enabled()) {
+                engine_render_profiler();
+            }
             console_render();
             video_render_finish();
+            profiler_frame();
+            if(!startup_logged) {
+                engine_startup_mark("first frame");
+                startup_logged = 1;
+            }
 
             // If screenshot requested, do it here.
             if(take_screenshot) {
@@ -316,6 +510,53 @@ void engine_run(engine_init_flags *init_flags) {
                 image_free(&img);
                 take_screenshot = 0;
             }
+
+            // Save every frame as a numbered image
+            if(strlen(init_flags->frame_dir) > 0) {
+                image img;
+                video_screenshot(&img);
+                int scr_ret = 0;
+                if(image_supports_png()) {
+                    snprintf(frame_filename, sizeof(frame_filename), "%s/frame_%06u.png", init_flags->frame_dir, frame_number);
+                    scr_ret = image_write_png(&img, frame_filename);
+                } else {
+                    snprintf(frame_filename, sizeof(frame_filename), "%s/frame_%06u.tga", init_flags->frame_dir, frame_number);
+                    scr_ret = image_write_tga(&img, frame_filename);
+                }
+                if(scr_ret) {
+                    PERROR("Frame write operation failed (%s)", frame_filename);
+                    run = 0;
+                }
+                image_free(&img);
+                frame_number++;
+            }
+
+            // Feed the exported video and audio the same amount of game time
+            if(strlen(init_flags->export_file) > 0) {
+                if(video_export_frame()) {
+                    run = 0;
+                }
+                audio_export_render(HEADLESS_FRAME_MS);
+            }
+
+            // Without vsync, sleep until the next tick is due. Interpolated frames differ
+            // even between ticks, so then only yield for a moment. A threaded simulation
+            // never waits for vsync, as it does not present anything itself.
+            int vsync = 0;
+            if(!threaded) {
+                video_get_state(NULL, NULL, NULL, &vsync);
+            }
+            if(!vsync && !init_flags->headless) {
+                double until_tick = game_state_ms_per_dyntick(gs) - dynamic_wait;
+                if(MS_PER_STATIC_TICK - static_wait < until_tick) {
+                    until_tick = MS_PER_STATIC_TICK - static_wait;
+                }
+                if(interpolate) {
+                    SDL_Delay(1);
+                } else if(until_tick >= 1.0) {
+                    SDL_Delay((Uint32)until_tick);
+                }
+            }
         } else {
             // If screen updates are disabled, then wait
             SDL_Delay(1);
@@ -326,22 +567,161 @@ void engine_run(engine_init_flags *init_flags) {
 #endif // STANDALONE_SERVER
     }
 
+    // Frame pacing report
+    histogram_log(&frame_times, "Frame times", "ms");
+    histogram_log(&frame_ticks, "Dynamic ticks per frame", "ticks");
+    if(dropped_ms > 0) {
+        INFO("Dropped %u ms of game time to stay within the %d ms catch-up limit.", dropped_ms, (int)max_catchup);
+    }
+}
+
+#ifndef STANDALONE_SERVER
+static int engine_sim_thread(void *userdata) {
+    engine_sim *sim = userdata;
+    engine_loop(sim->gs, sim->init_flags, 1);
+    profiler_thread_exit();
+    sim_done = 1;
+    return 0;
+}
+
+/*
+ * Runs the simulation on its own thread, at its own pace. This thread keeps the
+ * window: it handles window events, queues the rest for the simulation, and
+ * presents the newest frame the simulation has published.
+ */
+static void engine_run_threaded(game_state *gs, engine_init_flags *init_flags) {
+    engine_sim sim;
+    sim.gs = gs;
+    sim.init_flags = init_flags;
+
+    if(video_set_threaded(1)) {
+        engine_loop(gs, init_flags, 0);
+        return;
+    }
+    event_lock = SDL_CreateMutex();
+    event_head = 0;
+    event_count = 0;
+    sim_done = 0;
+    SDL_Thread *thread = SDL_CreateThread(engine_sim_thread, "simulation", &sim);
+    if(thread == NULL) {
+        PERROR("Unable to start simulation thread: %s", SDL_GetError());
+        video_set_threaded(0);
+        SDL_DestroyMutex(event_lock);
+        event_lock = NULL;
+        engine_loop(gs, init_flags, 0);
+        return;
+    }
+
+    uint64_t perf_freq = SDL_GetPerformanceFrequency();
+    uint64_t last = SDL_GetPerformanceCounter();
+    while(!sim_done) {
+        uint64_t now = SDL_GetPerformanceCounter();
+        engine_poll_events(gs, 1, (double)(now - last) * 1000.0 / perf_freq);
+        last = now;
+
+        // With vsync, presenting waits for the display. Otherwise just wait for a new frame.
+        if(!enable_screen_updates || video_present()) {
+            SDL_Delay(1);
+        }
+    }
+    SDL_WaitThread(thread, NULL);
+    video_set_threaded(0);
+    SDL_DestroyMutex(event_lock);
+    event_lock = NULL;
+}
+#endif // STANDALONE_SERVER
+
+void engine_run(engine_init_flags *init_flags) {
+    INFO(" --- BEGIN GAME LOG ---");
+
+#ifdef STANDALONE_SERVER
+    // Init interrupt signal handler
+    signal(SIGINT, exit_handler);
+#endif
+
+#ifndef STANDALONE_SERVER
+    // Game start timeout.
+    // Wait a moment so that people are mentally prepared
+    // (with the recording software on) for the game to start :)
+    if(!settings_get()->video.crossfade_on) {
+        start_timeout = 0;
+    }
+    // Replays jump straight into the arena, so don't wait for those either.
+    if(strlen(init_flags->rec_file) > 0 && !init_flags->record) {
+        start_timeout = 0;
+    }
+    if(init_flags->train_ticks > 0 || init_flags->headless) {
+        start_timeout = 0;
+    }
+    while(start_timeout > 0) {
+        SDL_Event e;
+        start_timeout--;
+        while(SDL_PollEvent(&e)) {
+            if(e.type == SDL_QUIT) {
+                return;
+            }
+        }
+        video_render_prepare();
+        video_render_finish();
+        continue;
+    }
+
+    // apply volume settings
+    sound_set_volume(settings_get()->sound.sound_vol/10.0f);
+#endif
+
+    // Set up game
+    game_state *gs = malloc(sizeof(game_state));
+    if(game_state_create(gs, init_flags)) {
+        return;
+    }
+
+    // The simulation runs on its own thread only when there is a window to present to
+#ifndef STANDALONE_SERVER
+    if(settings_get()->video.sim_thread && !init_flags->headless && init_flags->train_ticks == 0) {
+        engine_run_threaded(gs, init_flags);
+    } else {
+        engine_loop(gs, init_flags, 0);
+    }
+#else
+    engine_loop(gs, init_flags, 0);
+#endif
+
     // Free scene object
     game_state_free(gs);
     free(gs);
 
+    // Store whatever the AI learned. Controllers merge their stats when freed, above.
+    if(init_flags->train_ticks > 0) {
+        const char *path = pm_get_local_path(AI_STATS_PATH);
+        if(strlen(init_flags->train_file) > 0) {
+            path = init_flags->train_file;
+        }
+        if(ai_controller_save_stats(path) == 0) {
+            INFO("AI training done, stats saved to %s.", path);
+        }
+    }
+
     INFO(" --- END GAME LOG ---");
 }
 
 void engine_close() {
+    profiler_close();
+    metrics_close();
+    prefetch_close();
+    baked_close();
     console_close();
     altpals_close();
     fonts_close();
     lang_close();
     sounds_loader_close();
+    object_pool_close();
+    frame_alloc_close();
 #ifndef STANDALONE_SERVER
+    video_export_close();
     audio_close();
     video_close();
 #endif
+    memtrack_report_leaks();
     INFO("Engine deinit successful.");
 }
@@ -4,7 +4,7 @@
 void game_player_create(game_player *gp) {
     gp->har_id = 0;
     gp->pilot_id = 0;
-    gp->har = NULL;
+    gp->har = object_ref_create(NULL);
     gp->ctrl = NULL;
     gp->portrait = NULL;
     gp->selectable = 0;
@@ -27,11 +27,12 @@ void game_player_free(game_player *gp) {
 }
 
 void game_player_set_har(game_player *gp, object *har) {
-    gp->har = har;
+    gp->har = object_ref_create(har);
 }
 
+// NULL if the player has no HAR, or it has been freed
 object* game_player_get_har(game_player *gp) {
-    return gp->har;
+    return object_ref_get(&gp->har);
 }
 
 void game_player_set_ctrl(game_player *gp, controller *ctrl) {
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <SDL2/SDL.h>
 #include <shadowdive/shadowdive.h>
@@ -7,9 +8,13 @@
 #include "controller/rec_controller.h"
 #include "utils/log.h"
 #include "utils/miscmath.h"
+#include "utils/frame_alloc.h"
+#include "utils/profiler.h"
+#include "utils/metrics.h"
 #include "game/utils/serial.h"
 #include "resources/ids.h"
 #include "resources/pilots.h"
+#include "resources/prefetch.h"
 #include "console/console.h"
 #include "video/video.h"
 #include "video/tcache.h"
@@ -20,6 +25,7 @@
 #include "game/protos/scene.h"
 #include "game/protos/object.h"
 #include "game/protos/intersect.h"
+#include "game/objects/har.h"
 #include "game/scenes/intro.h"
 #include "game/scenes/mainmenu.h"
 #include "game/scenes/credits.h"
@@ -46,6 +52,10 @@ void _setup_rec_controller(game_state *gs, int player_id, sd_rec_file *rec);
 // Used for crossfades
 #define FRAME_WAIT_TICKS 30
 
+// How long the current scene is kept running while the next one is still
+// being decoded in the background. After this, loading waits for it.
+#define PREFETCH_HOLD_TICKS 100
+
 typedef struct {
     int layer; ///< Object rendering layer
     int persistent; ///< 1 if the object should keep alive across scene boundaries
@@ -58,12 +68,14 @@ int game_state_create(game_state *gs, engine_init_flags *init_flags) {
     gs->paused = 0;
     gs->tick = 0;
     gs->int_tick = 0;
+    gs->render_alpha = 1.0f;
     gs->role = ROLE_CLIENT;
     gs->next_requires_refresh = 0;
     gs->net_mode = init_flags->net_mode;
     gs->speed = settings_get()->gameplay.speed + 5;
     gs->init_flags = init_flags;
     vector_create(&gs->objects, sizeof(render_obj));
+    physics_store_create(&gs->bodies);
 
     // For screen shake
     gs->screen_shake_horizontal = 0;
@@ -76,6 +88,7 @@ int game_state_create(game_state *gs, engine_init_flags *init_flags) {
     // Used for crossfades
     gs->next_wait_ticks = 0;
     gs->this_wait_ticks = 0;
+    gs->next_hold_ticks = 0;
 
     // Set up players
     gs->sc = malloc(sizeof(scene));
@@ -92,29 +105,61 @@ int game_state_create(game_state *gs, engine_init_flags *init_flags) {
         int ret = sd_rec_load(&rec, init_flags->rec_file);
         if(ret != SD_SUCCESS) {
             PERROR("Unable to load recording %s.", init_flags->rec_file);
+            sd_rec_free(&rec);
             goto error_0;
         }
 
-        // hardcode arena 0 for now, although the arena ID resides in field 'L' of the REC file
-        nscene = SCENE_ARENA0;
-        DEBUG("playing recording file %s", init_flags->rec_file);
+        // Restore match setup from the REC header, and jump straight to the arena.
+        // Menu, VS and intro scenes are skipped entirely.
+        rec_match_info info;
+        rec_read_match_info(&rec, &info);
+        nscene = SCENE_ARENA0 + info.arena_id;
+        DEBUG("playing recording file %s in arena %d", init_flags->rec_file, info.arena_id);
+        if(info.speed >= 0) {
+            game_state_set_speed(gs, info.speed);
+        }
         if(scene_create(gs->sc, gs, nscene)) {
             PERROR("Error while loading scene %d.", nscene);
+            sd_rec_free(&rec);
             goto error_0;
         }
 
-        // set the HAR colors, pilot, har type
+        // set the HAR colors, pilot, har type and pilot stats
         for(int i = 0; i < 2; i++) {
             gs->players[i]->colors[0] = rec.pilots[i].info.color_3;
             gs->players[i]->colors[1] = rec.pilots[i].info.color_2;
             gs->players[i]->colors[2] = rec.pilots[i].info.color_1;
             gs->players[i]->har_id = HAR_JAGUAR + rec.pilots[i].info.har_id;
             gs->players[i]->pilot_id = rec.pilots[i].info.pilot_id;
+            memcpy(&gs->players[i]->pilot, &rec.pilots[i].info, sizeof(sd_pilot));
         }
 
-        // XXX use playback controller once it exista
         _setup_rec_controller(gs, 0, &rec);
         _setup_rec_controller(gs, 1, &rec);
+
+        // Controllers have copied the moves they need, so the file can go.
+        sd_rec_free(&rec);
+
+        // Recorder grabs the seed when the arena is created, so do the same here.
+        if(info.has_seed) {
+            rand_seed(info.seed);
+        }
+        if(arena_create(gs->sc)) {
+            PERROR("Error while creating arena scene.");
+            goto error_1;
+        }
+    } else if(init_flags->train_ticks > 0 || init_flags->ai_match) {
+        // AI self-play; both players are AI and we jump straight to a random arena.
+        // Arena keeps rotating to another one after every match.
+        if(init_flags->train_ticks > 0) {
+            ai_controller_set_training(1);
+        }
+        game_state_init_demo(gs);
+        nscene = rand_arena();
+        if(scene_create(gs->sc, gs, nscene)) {
+            PERROR("Error while loading scene %d.", nscene);
+            goto error_0;
+        }
         if(arena_create(gs->sc)) {
             PERROR("Error while creating arena scene.");
             goto error_1;
@@ -153,6 +198,7 @@ error_1:
 error_0:
     free(gs->sc);
     vector_free(&gs->objects);
+    physics_store_free(&gs->bodies);
     return 1;
 }
 
@@ -210,6 +256,33 @@ unsigned int game_state_get_speed(game_state *gs) {
     return gs->speed - 5;
 }
 
+// Marks an object for removal from the render list. Freeing it is left to
+// game_state_compact_objects, so that the list never holds a freed object.
+static void game_state_mark_object(game_state *gs, iterator *it, render_obj *robj, vector *dead) {
+    vector_append(dead, &robj->obj);
+    vector_mark_delete(&gs->objects, it);
+}
+
+// Drops the marked objects from the render list, and only then frees them.
+static void game_state_compact_objects(game_state *gs, vector *dead) {
+    vector_compact(&gs->objects);
+    iterator it;
+    object **obj;
+    vector_iter_begin(dead, &it);
+    while((obj = iter_next(&it)) != NULL) {
+        object_free(*obj);
+        object_dealloc(*obj);
+    }
+    vector_free(dead);
+}
+
+// Scratch list for the objects removed during one pass over the render list
+static void game_state_dead_create(vector *dead) {
+    allocator alloc;
+    frame_alloc_get_allocator(&alloc);
+    vector_create_with_allocator(dead, sizeof(object*), alloc);
+}
+
 void game_state_del_animation(game_state *gs, int anim_id) {
     iterator it;
     render_obj *robj;
@@ -218,7 +291,7 @@ void game_state_del_animation(game_state *gs, int anim_id) {
         animation *ani = object_get_animation(robj->obj);
         if(ani != NULL && ani->id == anim_id) {
             object_free(robj->obj);
-            free(robj->obj);
+            object_dealloc(robj->obj);
             vector_delete(&gs->objects, &it);
             DEBUG("Deleted animation %i from game_state.", anim_id);
             return;
@@ -234,7 +307,7 @@ void game_state_del_object(game_state *gs, object *target) {
     while((robj = iter_next(&it)) != NULL) {
         if(target == robj->obj) {
             object_free(robj->obj);
-            free(robj->obj);
+            object_dealloc(robj->obj);
             vector_delete(&gs->objects, &it);
             return;
         }
@@ -255,14 +328,15 @@ void game_state_get_projectiles(game_state *gs, vector *obj_proj) {
 void game_state_clear_hazards_projectiles(game_state *gs) {
     iterator it;
     render_obj *robj;
+    vector dead;
+    game_state_dead_create(&dead);
     vector_iter_begin(&gs->objects, &it);
     while((robj = iter_next(&it)) != NULL) {
         if(object_get_group(robj->obj) == GROUP_PROJECTILE) {
-            object_free(robj->obj);
-            free(robj->obj);
-            vector_delete(&gs->objects, &it);
+            game_state_mark_object(gs, &it, robj, &dead);
         }
     }
+    game_state_compact_objects(gs, &dead);
 }
 
 void game_state_set_next(game_state *gs, unsigned int next_scene_id) {
@@ -270,6 +344,17 @@ void game_state_set_next(game_state *gs, unsigned int next_scene_id) {
         gs->next_wait_ticks = FRAME_WAIT_TICKS;
         gs->next_next_id = SCENE_MENU;
         gs->next_id = next_scene_id;
+
+        // Start decoding the next scene resources while we crossfade
+        if(next_scene_id != SCENE_NONE) {
+            prefetch_discard_all();
+            prefetch_bk(scene_to_resource(next_scene_id));
+            if(is_arena(next_scene_id)) {
+                for(int i = 0; i < 2; i++) {
+                    prefetch_af(har_to_resource(gs->players[i]->har_id));
+                }
+            }
+        }
     }
 }
 
@@ -325,14 +410,17 @@ void game_state_render(game_state *gs) {
     }
 
     // Render scene background
+    PROFILE_BEGIN(PROFILE_RENDER_BACKGROUND);
     scene_render(gs->sc);
+    PROFILE_END(PROFILE_RENDER_BACKGROUND);
 
     // Get har objects
     object *har[2];
-    har[0] = game_state_get_player(gs, 0)->har;
-    har[1] = game_state_get_player(gs, 1)->har;
+    har[0] = game_player_get_har(game_state_get_player(gs, 0));
+    har[1] = game_player_get_har(game_state_get_player(gs, 1));
 
     // Render BOTTOM layer
+    PROFILE_BEGIN(PROFILE_RENDER_BOTTOM);
     vector_iter_begin(&gs->objects, &it);
     while((robj = iter_next(&it)) != NULL) {
         if(robj->layer == RENDER_LAYER_BOTTOM) {
@@ -342,13 +430,22 @@ void game_state_render(game_state *gs) {
         }
     }
 
+    // HAR shadow trails go below the HARs
+    for(int i = 0; i < 2; i++) {
+        if(har[i] != NULL) {
+            har_render_trail(har[i]);
+        }
+    }
+
     // cast object shadows (scrap, projectiles, etc)
     vector_iter_begin(&gs->objects, &it);
     while((robj = iter_next(&it)) != NULL) {
         object_render_shadow(robj->obj);
     }
+    PROFILE_END(PROFILE_RENDER_BOTTOM);
 
     // Render passive HARs here
+    PROFILE_BEGIN(PROFILE_RENDER_MIDDLE);
     for(int i = 0; i < 2; i++) {
         if(har[i] != NULL && !har_is_active(har[i])) {
             object_render(har[i]);
@@ -372,7 +469,10 @@ void game_state_render(game_state *gs) {
         }
     }
 
+    PROFILE_END(PROFILE_RENDER_MIDDLE);
+
     // Render TOP layer
+    PROFILE_BEGIN(PROFILE_RENDER_TOP);
     vector_iter_begin(&gs->objects, &it);
     while((robj = iter_next(&it)) != NULL) {
         if(robj->layer == RENDER_LAYER_TOP) {
@@ -382,15 +482,19 @@ void game_state_render(game_state *gs) {
         }
     }
 
+    PROFILE_END(PROFILE_RENDER_TOP);
+
     // Render scene overlay (menus, etc.)
+    PROFILE_BEGIN(PROFILE_RENDER_OVERLAY);
     scene_render_overlay(gs->sc);
+    PROFILE_END(PROFILE_RENDER_OVERLAY);
 }
 
 void game_state_debug(game_state *gs) {
     // If we are in debug mode, handle HAR debug layers
 #ifdef DEBUGMODE
     for(int i = 0; i < 2; i++) {
-        object *h = game_state_get_player(gs, i)->har;
+        object *h = game_player_get_har(game_state_get_player(gs, i));
         if(h != NULL) {
             object_debug(h);
         }
@@ -409,14 +513,15 @@ int game_load_new(game_state *gs, int scene_id) {
     // Remove old objects
     render_obj *robj;
     iterator it;
+    vector dead;
+    game_state_dead_create(&dead);
     vector_iter_begin(&gs->objects, &it);
     while((robj = iter_next(&it)) != NULL) {
         if(!robj->persistent) {
-            object_free(robj->obj);
-            free(robj->obj);
-            vector_delete(&gs->objects, &it);
+            game_state_mark_object(gs, &it, robj, &dead);
         }
     }
+    game_state_compact_objects(gs, &dead);
 
     // Initialize new scene with BK data etc.
     gs->sc = malloc(sizeof(scene));
@@ -534,24 +639,35 @@ void game_state_call_collide(game_state *gs) {
 void game_state_cleanup(game_state *gs) {
     render_obj *robj;
     iterator it;
+    vector dead;
+    game_state_dead_create(&dead);
     vector_iter_begin(&gs->objects, &it);
     while((robj = iter_next(&it)) != NULL) {
         if(object_finished(robj->obj)) {
             /*DEBUG("Animation object %d is finished, removing.", robj->obj->cur_animation->id);*/
-            object_free(robj->obj);
-            free(robj->obj);
-            vector_delete(&gs->objects, &it);
+            game_state_mark_object(gs, &it, robj, &dead);
         }
     }
+
+    // Drop the removed objects from the render list in one go
+    game_state_compact_objects(gs, &dead);
 }
 
 void game_state_call_move(game_state *gs) {
     render_obj *robj;
     iterator it;
+
+    // Objects with a body (scrap, projectiles) are collected and moved all at once.
+    // Everything else gets moved by its move callback.
+    physics_store_clear(&gs->bodies);
     vector_iter_begin(&gs->objects, &it);
     while((robj = iter_next(&it)) != NULL) {
-        object_move(robj->obj);
+        if(physics_store_add(&gs->bodies, robj->obj)) {
+            object_move(robj->obj);
+        }
     }
+    physics_store_step(&gs->bodies);
+    physics_store_write(&gs->bodies);
 }
 
 void game_state_tick_controllers(game_state *gs) {
@@ -628,10 +744,26 @@ void game_state_static_tick(game_state *gs) {
     game_state_call_tick(gs, TICK_STATIC);
 }
 
+// Keeps the current scene going while the next one is still being decoded.
+// Headless and network games need the switch to happen on the same tick every
+// time, so those load right away and wait for the loader instead.
+static int game_state_next_ready(game_state *gs) {
+    if(gs->init_flags->headless || gs->net_mode != NET_MODE_NONE || gs->next_id == SCENE_NONE) {
+        return 1;
+    }
+    if(gs->next_hold_ticks < PREFETCH_HOLD_TICKS && prefetch_poll()) {
+        gs->next_hold_ticks++;
+        return 0;
+    }
+    gs->next_hold_ticks = 0;
+    return 1;
+}
+
 // This function is called when the game speed requires it
 void game_state_dynamic_tick(game_state *gs) {
     // We want to load another scene
-    if(gs->this_id != gs->next_id && (gs->next_wait_ticks <= 1 || !settings_get()->video.crossfade_on)) {
+    if(gs->this_id != gs->next_id && (gs->next_wait_ticks <= 1 || !settings_get()->video.crossfade_on)
+        && game_state_next_ready(gs)) {
         // If this is the end, set run to 0 so that engine knows to close here
         if(gs->next_id == SCENE_NONE) {
             DEBUG("Next ID is SCENE_NONE! bailing.");
@@ -640,7 +772,10 @@ void game_state_dynamic_tick(game_state *gs) {
         }
 
         // Load up new scene
-        if(game_load_new(gs, gs->next_id)) {
+        PROFILE_BEGIN(PROFILE_SCENE_LOAD);
+        int load_ret = game_load_new(gs, gs->next_id);
+        PROFILE_END(PROFILE_SCENE_LOAD);
+        if(load_ret) {
             PERROR("Error while loading new scene! bailing.");
             gs->run = 0;
             return;
@@ -653,6 +788,15 @@ void game_state_dynamic_tick(game_state *gs) {
         }
     }
 
+    // Remember where objects were, so that rendering can interpolate from there
+    render_obj *robj;
+    iterator it;
+    vector_iter_begin(&gs->objects, &it);
+    while((robj = iter_next(&it)) != NULL) {
+        robj->obj->prev_pos = robj->obj->pos;
+        robj->obj->prev_pos_tick = gs->int_tick;
+    }
+
     // Change the screen shake value downwards
     if(gs->screen_shake_horizontal > 0 && !gs->paused) {
         gs->screen_shake_horizontal--;
@@ -690,16 +834,24 @@ void game_state_dynamic_tick(game_state *gs) {
 
     if(!game_state_is_paused(gs)) {
         // Clean up objects
+        PROFILE_BEGIN(PROFILE_TICK_CLEANUP);
         game_state_cleanup(gs);
+        PROFILE_END(PROFILE_TICK_CLEANUP);
 
         // Call object_move for all objects
+        PROFILE_BEGIN(PROFILE_TICK_MOVE);
         game_state_call_move(gs);
+        PROFILE_END(PROFILE_TICK_MOVE);
 
         // Handle physics for all pairs of objects
+        PROFILE_BEGIN(PROFILE_TICK_COLLIDE);
         game_state_call_collide(gs);
+        PROFILE_END(PROFILE_TICK_COLLIDE);
 
         // Tick all objects
+        PROFILE_BEGIN(PROFILE_TICK_OBJECTS);
         game_state_call_tick(gs, TICK_DYNAMIC);
+        PROFILE_END(PROFILE_TICK_OBJECTS);
 
         // Increment tick
         gs->tick++;
@@ -709,6 +861,16 @@ void game_state_dynamic_tick(game_state *gs) {
     // Free extra controller events
     game_state_ctrl_events_free(gs);
 
+    // Tick scratch data is no longer needed
+    frame_alloc_reset();
+
+    frame_alloc_stats alloc_stats;
+    size_t alloc_peak;
+    frame_alloc_get_stats(&alloc_stats, &alloc_peak);
+    metrics_set(METRIC_FRAME_ALLOC_BYTES, alloc_stats.bytes);
+    metrics_set(METRIC_FRAME_ALLOC_PEAK, alloc_peak);
+    metrics_set(METRIC_OBJECTS, vector_size(&gs->objects));
+
     // int_tick is used for ping calculation so it shouldn't be touched
     gs->int_tick++;
 }
@@ -834,10 +996,10 @@ void game_state_free(game_state *gs) {
     vector_iter_begin(&gs->objects, &it);
     while((robj = iter_next(&it)) != NULL) {
         object_free(robj->obj);
-        free(robj->obj);
-        vector_delete(&gs->objects, &it);
+        object_dealloc(robj->obj);
     }
     vector_free(&gs->objects);
+    physics_store_free(&gs->bodies);
 
     // Free scene
     scene_free(gs->sc);
@@ -851,29 +1013,29 @@ void game_state_free(game_state *gs) {
     }
 }
 
-int game_state_ms_per_dyntick(game_state *gs) {
-    float tmp;
+float game_state_ms_per_dyntick(game_state *gs) {
     switch(gs->this_id) {
         case SCENE_ARENA0:
         case SCENE_ARENA1:
         case SCENE_ARENA2:
         case SCENE_ARENA3:
         case SCENE_ARENA4:
-            tmp = 8.0f + MS_PER_OMF_TICK_SLOWEST - ((float)gs->speed / 15.0f) * MS_PER_OMF_TICK_SLOWEST;
-            return (int)tmp;
+            return 8.0f + MS_PER_OMF_TICK_SLOWEST - ((float)gs->speed / 15.0f) * MS_PER_OMF_TICK_SLOWEST;
     }
     return MS_PER_OMF_TICK;
 }
 
 int game_state_serialize(game_state *gs, serial *ser) {
+    size_t start_len = ser->len;
+
     // serialize tick time and random seed, so client can reply state from this point
     serial_write_int32(ser, game_state_get_tick(gs));
     serial_write_int32(ser, rand_get_seed());
     serial_write_int32(ser, game_state_is_paused(gs));
 
     object *har[2];
-    har[0] = game_state_get_player(gs, 0)->har;
-    har[1] = game_state_get_player(gs, 1)->har;
+    har[0] = game_player_get_har(game_state_get_player(gs, 0));
+    har[1] = game_player_get_har(game_state_get_player(gs, 1));
 
     object_serialize(har[0], ser);
     object_serialize(har[1], ser);
@@ -901,6 +1063,7 @@ int game_state_serialize(game_state *gs, serial *ser) {
     chr_score_serialize(game_player_get_score(game_state_get_player(gs, 0)), ser);
     chr_score_serialize(game_player_get_score(game_state_get_player(gs, 1)), ser);
 
+    metrics_add(METRIC_BYTES_SERIALIZED, ser->len - start_len);
     return 0;
 }
 
@@ -916,8 +1079,8 @@ int game_state_unserialize(game_state *gs, serial *ser, int rtt) {
     for(int i = 0; i < 2; i++) {
         // Declare some vars
         game_player *player = game_state_get_player(gs, i);
-        game_state_del_object(gs, player->har);
-        object *obj = malloc(sizeof(object));
+        game_state_del_object(gs, game_player_get_har(player));
+        object *obj = object_alloc();
 
         // Create object and specialize it as HAR.
         // Errors are unlikely here, but check anyway.
@@ -930,7 +1093,7 @@ int game_state_unserialize(game_state *gs, serial *ser, int rtt) {
 
         // Set HAR for player
         game_player_set_har(player, obj);
-        game_player_get_ctrl(player)->har = obj;
+        controller_set_har(game_player_get_ctrl(player), obj);
     }
 
     // ensure the HARs know each other's positions
@@ -938,25 +1101,26 @@ int game_state_unserialize(game_state *gs, serial *ser, int rtt) {
     obj_har1 = game_player_get_har(game_state_get_player(gs, 0));
     obj_har2 = game_player_get_har(game_state_get_player(gs, 1));
 
-    obj_har1->animation_state.enemy = obj_har2;
-    obj_har2->animation_state.enemy = obj_har1;
+    obj_har1->animation_state.enemy = object_ref_create(obj_har2);
+    obj_har2->animation_state.enemy = object_ref_create(obj_har1);
 
     // clean out any current projectiles/hazards
     iterator it;
+    vector dead;
+    game_state_dead_create(&dead);
     vector_iter_begin(&gs->objects, &it);
     render_obj *robj;
     while((robj = iter_next(&it)) != NULL) {
         if (robj->obj->group == GROUP_PROJECTILE) {
-            object_free(robj->obj);
-            free(robj->obj);
-            vector_delete(&gs->objects, &it);
+            game_state_mark_object(gs, &it, robj, &dead);
         }
     }
+    game_state_compact_objects(gs, &dead);
 
     uint8_t count = serial_read_int8(ser);
 
     for (int i = 0; i < count; i++) {
-        object *obj = malloc(sizeof(object));
+        object *obj = object_alloc();
         int layer = serial_read_int8(ser);
         object_create(obj, gs, vec2i_create(0, 0), vec2f_create(0,0));
         object_unserialize(obj, ser, gs);
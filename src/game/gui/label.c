@@ -5,15 +5,18 @@
 typedef struct {
     char *text;
     text_settings tconf;
+    text_layout layout;
 } label;
 
 static void label_render(component *c) {
     label *local = widget_get_obj(c);
-    text_render(&local->tconf, c->x, c->y, c->w, c->h, local->text);
+    text_layout_update(&local->layout, &local->tconf, c->w, c->h, local->text);
+    text_layout_render(&local->layout, &local->tconf, c->x, c->y);
 }
 
 static void label_free(component *c) {
     label *local = widget_get_obj(c);
+    text_layout_free(&local->layout);
     free(local->text);
     free(local);
 }
@@ -42,6 +45,7 @@ component* label_create(const text_settings *tconf, const char *text) {
     memset(local, 0, sizeof(label));
     memcpy(&local->tconf, tconf, sizeof(text_settings));
     local->text = strdup(text);
+    text_layout_create(&local->layout);
 
     widget_set_obj(c, local);
     widget_set_render_cb(c, label_render);
@@ -18,7 +18,7 @@ typedef struct {
 static void pilotpic_render(component *c) {
     pilotpic *g = widget_get_obj(c);
     if(g->img != NULL) {
-        video_render_sprite(g->img->data, c->x, c->y, BLEND_ALPHA, 0);
+        video_render_sprite(sprite_get_surface(g->img), c->x, c->y, BLEND_ALPHA, 0);
     }
 }
 
@@ -59,14 +59,12 @@ void pilotpic_select(component *c, int pic_id, int pilot_id) {
     // Create new
     const sd_pic_photo *photo = sd_pic_get(&pics, pilot_id);
     local->img = malloc(sizeof(sprite));
-    sprite_create(local->img, photo->sprite, -1);
+    sprite_create(local->img, photo->sprite, -1, NULL);
 
     // Position and size hints for the gui component
     // These are set on layout function call
-    component_set_size_hints(
-        c,
-        local->img->data->w,
-        local->img->data->h);
+    vec2i size = sprite_get_size(local->img);
+    component_set_size_hints(c, size.x, size.y);
 
     // Save some information
     local->selected = pilot_id;
@@ -14,6 +14,7 @@
 typedef struct {
     char *text;
     text_settings tconf;
+    text_layout layout;
     surface *img;
     int active;
 
@@ -29,12 +30,14 @@ static void spritebutton_render(component *c) {
     }
     if(sb->text) {
         sb->tconf.opacity = clamp(s->opacity * 255, 0, 255);
-        text_render(&sb->tconf, c->x, c->y, c->w, c->h, sb->text);
+        text_layout_update(&sb->layout, &sb->tconf, c->w, c->h, sb->text);
+        text_layout_render(&sb->layout, &sb->tconf, c->x, c->y);
     }
 }
 
 static void spritebutton_free(component *c) {
     spritebutton *sb = widget_get_obj(c);
+    text_layout_free(&sb->layout);
     free(sb->text);
     free(sb);
 }
@@ -66,6 +69,7 @@ component* spritebutton_create(const text_settings *tconf, const char *text, sur
 
     spritebutton *sb = malloc(sizeof(spritebutton));
     memset(sb, 0, sizeof(spritebutton));
+    text_layout_create(&sb->layout);
     if(text != NULL)
         sb->text = strdup(text);
     memcpy(&sb->tconf, tconf, sizeof(text_settings));
@@ -1,6 +1,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <stdlib.h>
 
 #include "game/gui/text_render.h"
 #include "video/video.h"
@@ -114,9 +115,9 @@ int text_find_line_count(text_direction dir, int cols, int rows, int len, const
     return lines;
 }
 
-void text_render(const text_settings *settings, int x, int y, int w, int h, const char *text) {
-    int len = strlen(text);
-
+// Places the characters of the text into a box of the given size. Writes at most
+// one glyph per character of the text, and returns the amount of glyphs written.
+static int text_layout_run(const text_settings *settings, int w, int h, const char *text, int len, text_glyph *glyphs) {
     int size = text_char_width(settings);
     int xspace = w - settings->padding.left - settings->padding.right;
     int yspace = h - settings->padding.top - settings->padding.bottom;
@@ -126,9 +127,10 @@ void text_render(const text_settings *settings, int x, int y, int w, int h, cons
     int cols = (xspace + settings->cspacing) / charw;
     int fit_lines = text_find_line_count(settings->direction, cols, rows, len, text);
 
-    int start_x = x + settings->padding.left;
-    int start_y = y + settings->padding.top;
+    int start_x = settings->padding.left;
+    int start_y = settings->padding.top;
     int tmp_s = 0;
+    int count = 0;
 
     // Initial alignment for whole text block
     switch(settings->direction) {
@@ -219,16 +221,20 @@ void text_render(const text_settings *settings, int x, int y, int w, int h, cons
                 break;
         }
 
-        // Render characters
+        // Place characters
         for(; k < line_len; k++) {
-            // Skip line endings.
-            if(text[ptr+k] == '\n')
+            // Skip line endings, and characters the fonts don't have.
+            char ch = text[ptr+k];
+            if(ch == '\n')
                 continue;
+            if(ch >= 32) {
+                glyphs[count].x = mx + start_x;
+                glyphs[count].y = my + start_y;
+                glyphs[count].ch = ch;
+                count++;
+            }
 
-            // Render character
-            text_render_char(settings, mx + start_x, my + start_y, text[ptr+k]);
-
-            // Render to the right direction
+            // Move to the right direction
             if(settings->direction == TEXT_HORIZONTAL) {
                 mx += charw;
             } else {
@@ -239,6 +245,88 @@ void text_render(const text_settings *settings, int x, int y, int w, int h, cons
         ptr += line_len;
         line++;
     }
+    return count;
+}
+
+#define TEXT_STACK_GLYPHS 256
+
+void text_render(const text_settings *settings, int x, int y, int w, int h, const char *text) {
+    text_glyph stack_glyphs[TEXT_STACK_GLYPHS];
+    text_glyph *glyphs = stack_glyphs;
+    int len = strlen(text);
+    if(len > TEXT_STACK_GLYPHS) {
+        glyphs = malloc(len * sizeof(text_glyph));
+    }
+    int count = text_layout_run(settings, w, h, text, len, glyphs);
+    for(int i = 0; i < count; i++) {
+        text_render_char(settings, x + glyphs[i].x, y + glyphs[i].y, glyphs[i].ch);
+    }
+    if(glyphs != stack_glyphs) {
+        free(glyphs);
+    }
+}
+
+void text_layout_create(text_layout *layout) {
+    memset(layout, 0, sizeof(text_layout));
+}
+
+void text_layout_free(text_layout *layout) {
+    free(layout->text);
+    free(layout->glyphs);
+    memset(layout, 0, sizeof(text_layout));
+}
+
+// Only the settings that move characters around
+static int text_layout_settings_equal(const text_settings *a, const text_settings *b) {
+    return a->valign == b->valign
+        && a->halign == b->halign
+        && a->direction == b->direction
+        && a->font == b->font
+        && a->cspacing == b->cspacing
+        && a->lspacing == b->lspacing
+        && memcmp(&a->padding, &b->padding, sizeof(text_padding)) == 0;
+}
+
+/** \brief Lays out the text into a box, unless the same text has already been laid out.
+  * \param layout Layout handle
+  * \param settings Text settings
+  * \param w Width of the text box
+  * \param h Height of the text box
+  * \param text Text to lay out
+  * \return 1 if the text was laid out again, 0 if the cached layout was kept
+  */
+int text_layout_update(text_layout *layout, const text_settings *settings, int w, int h, const char *text) {
+    if(layout->text != NULL
+        && layout->w == w
+        && layout->h == h
+        && text_layout_settings_equal(&layout->settings, settings)
+        && strcmp(layout->text, text) == 0) {
+        return 0;
+    }
+
+    int len = strlen(text);
+    if(layout->text == NULL || strlen(layout->text) < (size_t)len) {
+        free(layout->text);
+        layout->text = malloc(len + 1);
+    }
+    memcpy(layout->text, text, len + 1);
+    if(layout->glyph_capacity < len) {
+        free(layout->glyphs);
+        layout->glyphs = malloc(len * sizeof(text_glyph));
+        layout->glyph_capacity = len;
+    }
+    layout->w = w;
+    layout->h = h;
+    memcpy(&layout->settings, settings, sizeof(text_settings));
+    layout->glyph_count = text_layout_run(settings, w, h, layout->text, len, layout->glyphs);
+    return 1;
+}
+
+void text_layout_render(const text_layout *layout, const text_settings *settings, int x, int y) {
+    for(int i = 0; i < layout->glyph_count; i++) {
+        const text_glyph *g = &layout->glyphs[i];
+        text_render_char(settings, x + g->x, y + g->y, g->ch);
+    }
 }
 
 /// ---------------- OLD RENDERER FUNCTIONS ---------------------
@@ -13,6 +13,7 @@
 typedef struct {
     char *text;
     text_settings tconf;
+    text_layout layout;
     int ticks;
     int dir;
 
@@ -67,7 +68,8 @@ static void textbutton_render(component *c) {
     } else {
         tb->tconf.cforeground = color_create(0, 121, 0, 255);
     }
-    text_render(&tb->tconf, c->x, c->y, c->w, c->h, tb->text);
+    text_layout_update(&tb->layout, &tb->tconf, c->w, c->h, tb->text);
+    text_layout_render(&tb->layout, &tb->tconf, c->x, c->y);
 
     // Border
     if(tb->border_enabled) {
@@ -110,6 +112,7 @@ static void textbutton_free(component *c) {
     if(tb->border_created) {
         surface_free(&tb->border);
     }
+    text_layout_free(&tb->layout);
     free(tb->text);
     free(tb);
 }
@@ -120,6 +123,7 @@ component* textbutton_create(const text_settings *tconf, const char *text, int d
 
     textbutton *tb = malloc(sizeof(textbutton));
     memset(tb, 0, sizeof(textbutton));
+    text_layout_create(&tb->layout);
     tb->text = strdup(text);
     memcpy(&tb->tconf, tconf, sizeof(text_settings));
     tb->click_cb = cb;
@@ -12,6 +12,7 @@
 typedef struct {
     char *text;
     text_settings tconf;
+    text_layout layout;
     int ticks;
     int dir;
     int pos_;
@@ -73,7 +74,8 @@ static void textselector_render(component *c) {
     } else {
         tb->tconf.cforeground = color_create(0, 121, 0, 255);
     }
-    text_render(&tb->tconf, c->x, c->y, c->w, c->h, buf);
+    text_layout_update(&tb->layout, &tb->tconf, c->w, c->h, buf);
+    text_layout_render(&tb->layout, &tb->tconf, c->x, c->y);
 }
 
 static int textselector_action(component *c, int action) {
@@ -133,6 +135,7 @@ static void textselector_free(component *c) {
     textselector *tb = widget_get_obj(c);
     textselector_clear_options(c);
     vector_free(&tb->options);
+    text_layout_free(&tb->layout);
     free(tb->text);
     free(tb);
 }
@@ -142,6 +145,7 @@ component* textselector_create(const text_settings *tconf, const char *text, tex
 
     textselector *tb = malloc(sizeof(textselector));
     memset(tb, 0, sizeof(textselector));
+    text_layout_create(&tb->layout);
     tb->text = strdup(text);
     memcpy(&tb->tconf, tconf, sizeof(text_settings));
     tb->pos = &tb->pos_;
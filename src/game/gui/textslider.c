@@ -12,6 +12,7 @@
 typedef struct {
     char *text;
     text_settings tconf;
+    text_layout layout;
     int ticks;
     int dir;
     int pos_;
@@ -54,7 +55,8 @@ static void textslider_render(component *c) {
     } else {
         tb->tconf.cforeground = color_create(0, 121, 0, 255);
     }
-    text_render(&tb->tconf, c->x, c->y, c->w, c->h, buf);
+    text_layout_update(&tb->layout, &tb->tconf, c->w, c->h, buf);
+    text_layout_render(&tb->layout, &tb->tconf, c->x, c->y);
 }
 
 static int textslider_action(component *c, int action) {
@@ -106,6 +108,7 @@ static void textslider_tick(component *c) {
 
 static void textslider_free(component *c) {
     textslider *tb = widget_get_obj(c);
+    text_layout_free(&tb->layout);
     free(tb->text);
     free(tb);
 }
@@ -115,6 +118,7 @@ component* textslider_create(const text_settings *tconf, const char *text, unsig
 
     textslider *tb = malloc(sizeof(textslider));
     memset(tb, 0, sizeof(textslider));
+    text_layout_create(&tb->layout);
     tb->text = strdup(text);
     memcpy(&tb->tconf, tconf, sizeof(text_settings));
     tb->ticks = 0;
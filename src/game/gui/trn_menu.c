@@ -40,11 +40,11 @@ void trnmenu_bind_hand(component *c, animation *hand_ani, game_state *gs) {
     // Free old. Shouldn't be needed, but let's be thorough.
     if(m->hand.obj != NULL) {
         object_free(m->hand.obj);
-        free(m->hand.obj);
+        object_dealloc(m->hand.obj);
     }
 
     // Set up new hand object
-    m->hand.obj = malloc(sizeof(object));
+    m->hand.obj = object_alloc();
     object_create(m->hand.obj, gs, vec2i_create(0,0), vec2f_create(0,0));
     object_set_animation(m->hand.obj, hand_ani);
     object_set_userdata(m->hand.obj, &m->hand);
@@ -79,7 +79,7 @@ static void trnmenu_free(component *c) {
     }
     if(m->hand.obj != NULL) {
         object_free(m->hand.obj);
-        free(m->hand.obj);
+        object_dealloc(m->hand.obj);
     }
     free(m);
 }
@@ -28,7 +28,6 @@
 
 void har_finished(object *obj);
 int har_act(object *obj, int act_type);
-void har_spawn_scrap(object *obj, vec2i pos, int amount);
 
 void har_free(object *obj) {
     har *h = object_get_userdata(obj);
@@ -50,7 +49,7 @@ void fire_hooks(har *h, har_event event) {
         hook->cb(event, hook->data);
     }
     controller *ctrl = game_player_get_ctrl(h->gp);
-    if(object_get_userdata(ctrl->har) == h) {
+    if(object_get_userdata(controller_get_har(ctrl)) == h) {
         controller_har_hook(ctrl, event);
     }
 }
@@ -350,7 +349,7 @@ void cb_har_spawn_object(object *parent, int id, vec2i pos, int g, void *userdat
     // ... otherwise expect it is a projectile
     af_move *move = af_get_move(h->af_data, id);
     if(move != NULL) {
-        object *obj = malloc(sizeof(object));
+        object *obj = object_alloc();
         object_create(obj, parent->gs, pos, vec2f_create(0,0));
         object_set_userdata(obj, h);
         object_set_stl(obj, object_get_stl(parent));
@@ -387,7 +386,7 @@ void har_floor_landing_effects(object *obj) {
     for(int i = 0; i < amount; i++) {
         int variance = rand_int(20) - 10;
         vec2i coord = vec2i_create(obj->pos.x + variance + i*10, obj->pos.y);
-        object *dust = malloc(sizeof(object));
+        object *dust = object_alloc();
         object_create(dust, obj->gs, coord, vec2f_create(0,0));
         object_set_stl(dust, object_get_stl(obj));
         object_set_animation(dust, &bk_get_info(&game_state_get_scene(obj->gs)->bk_data, 26)->ani);
@@ -522,7 +521,7 @@ void har_take_damage(object *obj, str* string, float damage) {
     // Take a screencap of enemy har
     if(h->health == 0 && h->endurance == 0) {
         game_player *other_player = game_state_get_player(obj->gs, !h->player_id);
-        har_screencaps_capture(&other_player->screencaps, other_player->har, SCREENCAP_BLOW);
+        har_screencaps_capture(&other_player->screencaps, game_player_get_har(other_player), SCREENCAP_BLOW);
     }
 
     // If damage is high enough, slow down the game for a bit
@@ -604,7 +603,7 @@ void har_spawn_oil(object *obj, vec2i pos, int amount, float gravity, int layer)
         if(vely < 0.1 && vely > -0.1) vely += 0.21;
 
         // Create the object
-        object *scrap = malloc(sizeof(object));
+        object *scrap = object_alloc();
         int anim_no = ANIM_BURNING_OIL;
         object_create(scrap, obj->gs, pos, vec2f_create(velx, vely));
         object_set_animation(scrap, &af_get_move(h->af_data, anim_no)->ani);
@@ -621,8 +620,8 @@ void har_spawn_oil(object *obj, vec2i pos, int amount, float gravity, int layer)
 // HAR is doing destruction. If there is any way to do this better,
 // this should be changed.
 int is_destruction(game_state *gs) {
-    har *har_a = object_get_userdata(game_state_get_player(gs, 0)->har);
-    har *har_b = object_get_userdata(game_state_get_player(gs, 1)->har);
+    har *har_a = object_get_userdata(game_player_get_har(game_state_get_player(gs, 0)));
+    har *har_b = object_get_userdata(game_player_get_har(game_state_get_player(gs, 1)));
     return (har_a->state == STATE_DESTRUCTION || har_b->state == STATE_DESTRUCTION);
 }
 
@@ -662,7 +661,7 @@ void har_spawn_scrap(object *obj, vec2i pos, int amount) {
         if(vely < 0.1 && vely > -0.1) vely += 0.21;
 
         // Create the object
-        object *scrap = malloc(sizeof(object));
+        object *scrap = object_alloc();
         int anim_no = rand_int(3) + ANIM_SCRAP_METAL;
         object_create(scrap, obj->gs, pos, vec2f_create(velx, vely));
         object_set_animation(scrap, &af_get_move(h->af_data, anim_no)->ani);
@@ -693,7 +692,7 @@ void har_block(object *obj, vec2i hit_coord) {
         // don't make another scrape
         return;
     }
-    object *scrape = malloc(sizeof(object));
+    object *scrape = object_alloc();
     object_create(scrape, obj->gs, hit_coord, vec2f_create(0, 0));
     object_set_animation(scrape, &af_get_move(h->af_data, ANIM_BLOCKING_SCRAPE)->ani);
     object_set_stl(scrape, object_get_stl(obj));
@@ -1008,7 +1007,7 @@ void har_collide_with_projectile(object *o_har, object *o_pjt) {
     har *h = object_get_userdata(o_har);
     af *prog_owner_af_data = projectile_get_af_data(o_pjt);
     // lol
-    har *other = object_get_userdata(game_state_get_player(o_har->gs, abs(h->player_id - 1))->har);
+    har *other = object_get_userdata(game_player_get_har(game_state_get_player(o_har->gs, abs(h->player_id - 1))));
 
     if(h->state == STATE_FALLEN
         || h->state == STATE_STANDING_UP
@@ -1343,23 +1342,22 @@ void har_tick(object *obj) {
     }
 
     // Leave shadow trail
-    // IF trail is on, copy current sprite to a new animation, and set animation string
-    // to show the sprite with animation string that interpolates opacity down
-    // Mark new object as the owner of the animation, so that the animation gets
-    // removed when the object is finished.
-    if(player_frame_isset(obj, "ub")) {
+    // Age the existing trail entries, and if trail is on, record the current sprite
+    // and position. The entries are rendered with the original sprite surface at
+    // decreasing opacity, so no copies are needed.
+    for(int i = 0; i < HAR_TRAIL_LENGTH; i++) {
+        if(h->trail[i].age >= 0 && ++h->trail[i].age >= HAR_TRAIL_TICKS) {
+            h->trail[i].age = -1;
+        }
+    }
+    if(player_frame_isset(obj, "ub") && obj->cur_sprite != NULL) {
         if(obj->age % 2 == 0) {
-            sprite *nsp = sprite_copy(obj->cur_sprite);
-            object *nobj = malloc(sizeof(object));
-            object_create(nobj, obj->gs, object_get_pos(obj), vec2f_create(0,0));
-            object_set_stl(nobj, object_get_stl(obj));
-            object_set_animation(nobj, create_animation_from_single(nsp, obj->cur_animation->start_pos));
-            object_set_animation_owner(nobj, OWNER_OBJECT);
-            object_set_custom_string(nobj, "bs100A1-bf0A15");
-            object_set_effects(nobj, EFFECT_SHADOW);
-            object_set_direction(nobj, object_get_direction(obj));
-            object_dynamic_tick(nobj);
-            game_state_add_object(obj->gs, nobj, RENDER_LAYER_BOTTOM, 0, 0);
+            har_trail *t = &h->trail[h->trail_head];
+            t->spr = obj->cur_sprite;
+            t->pos = object_get_pos(obj);
+            t->direction = object_get_direction(obj);
+            t->age = 0;
+            h->trail_head = (h->trail_head + 1) % HAR_TRAIL_LENGTH;
         }
     }
 
@@ -2024,6 +2022,38 @@ void har_copy_actions(object *new, object *old) {
     memcpy(h_new->act_buf, h_old->act_buf, sizeof(action_buffer) * OBJECT_EVENT_BUFFER_SIZE);
 }
 
+void har_render_trail(object *obj) {
+    har *h = object_get_userdata(obj);
+
+    // Oldest first, so that the newer ones are drawn on top
+    for(int n = 0; n < HAR_TRAIL_LENGTH; n++) {
+        har_trail *t = &h->trail[(h->trail_head + n) % HAR_TRAIL_LENGTH];
+        if(t->age < 0) {
+            continue;
+        }
+
+        int x = t->pos.x + t->spr->pos.x;
+        int y = t->pos.y + t->spr->pos.y;
+        int flipmode = 0;
+        if(t->direction == OBJECT_FACE_LEFT) {
+            x = t->pos.x - t->spr->pos.x - sprite_get_size(t->spr).x;
+            flipmode = FLIP_HORIZONTAL;
+        }
+
+        // Same fade as the old "bs100A1-bf0A15" animation string
+        uint8_t opacity = 100 * (HAR_TRAIL_TICKS - t->age) / HAR_TRAIL_TICKS;
+        video_render_sprite_flip_scale_opacity_tint(
+            sprite_get_surface(t->spr),
+            x, y,
+            BLEND_ALPHA,
+            object_get_pal_offset(obj),
+            flipmode,
+            1.0f,
+            opacity,
+            color_create(0x20, 0x20, 0x20, 0xFF));
+    }
+}
+
 int har_create(object *obj, af *af_data, int dir, int har_id, int pilot_id, int player_id) {
     // Create local data
     har *local = malloc(sizeof(har));
@@ -2070,6 +2100,12 @@ int har_create(object *obj, af *af_data, int dir, int har_id, int pilot_id, int
 
     local->stun_timer = 0;
 
+    // No shadow trail yet
+    for(int i = 0; i < HAR_TRAIL_LENGTH; i++) {
+        local->trail[i].age = -1;
+    }
+    local->trail_head = 0;
+
     // Set palette offset 0 for player1, 48 for player2
     object_set_pal_offset(obj, player_id * 48);
 
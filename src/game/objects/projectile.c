@@ -4,15 +4,10 @@
 #include "game/game_state.h"
 #include "game/game_player.h"
 #include "utils/log.h"
-#include "game/objects/arena_constraints.h"
-
-#define IS_ZERO(n) (n < 0.1 && n > -0.1)
 
 typedef struct projectile_local_t {
-    object *owner;
+    object_ref owner;
     af *af_data;
-    int wall_bounce;
-    int ground_freeze;
 } projectile_local;
 
 void projectile_tick(object *obj) {
@@ -38,52 +33,9 @@ void projectile_tick(object *obj) {
 }
 
 void projectile_free(object *obj) {
-    free(object_get_userdata(obj));
-}
-
-void projectile_move(object *obj) {
-    projectile_local *local = object_get_userdata(obj);
-
-    obj->pos.x += obj->vel.x;
-    obj->vel.y += obj->gravity;
-    obj->pos.y += obj->vel.y;
-
-    float dampen = 0.7f;
-
-    // If wall bounce flag is on, bounce the projectile on wall hit
-    // Otherwise kill it.
-    if(local->wall_bounce) {
-        if(obj->pos.x <  ARENA_LEFT_WALL) {
-            obj->pos.x = ARENA_LEFT_WALL;
-            obj->vel.x = -obj->vel.x * dampen;
-        }
-        if(obj->pos.x > ARENA_RIGHT_WALL) {
-            obj->pos.x = ARENA_RIGHT_WALL;
-            obj->vel.x = -obj->vel.x * dampen;
-        }
-    } else {
-        if(obj->pos.x < ARENA_LEFT_WALL) {
-            obj->pos.x = ARENA_LEFT_WALL;
-            obj->animation_state.finished = 1;
-        }
-        if(obj->pos.x > ARENA_RIGHT_WALL) {
-            obj->pos.x = ARENA_RIGHT_WALL;
-            obj->animation_state.finished = 1;
-        }
-    }
-    if(obj->pos.y > ARENA_FLOOR) {
-        obj->pos.y = ARENA_FLOOR;
-        obj->vel.y = -obj->vel.y * dampen;
-        obj->vel.x = obj->vel.x * dampen;
-    }
-    if(obj->pos.y >= (ARENA_FLOOR-5)
-        && IS_ZERO(obj->vel.x)
-        && obj->vel.y < obj->gravity * 1.1
-        && obj->vel.y > obj->gravity * -1.1
-        && local->ground_freeze) {
-
-        object_disable_rewind_tag(obj, 1);
-    }
+    allocator alloc;
+    object_get_allocator(&alloc);
+    alloc.cfree(object_get_userdata(obj));
 }
 
 int projectile_serialize(object *obj, serial *ser) {
@@ -124,18 +76,20 @@ void projectile_bootstrap(object *obj) {
 }
 
 int projectile_create(object *obj) {
-    // strore the HAR in local userdata instead
-    projectile_local *local = malloc(sizeof(projectile_local));
-    local->owner = obj;
-    local->wall_bounce = 0;
-    local->ground_freeze = 0;
-    local->af_data = ((har*)object_get_userdata(obj))->af_data;
+    // strore the HAR in local userdata instead. Projectiles come in bursts, so
+    // take the local struct from the object pool too.
+    allocator alloc;
+    object_get_allocator(&alloc);
+    projectile_local *local = alloc.cmalloc(sizeof(projectile_local));
+    har *h = object_get_userdata(obj);
+    local->owner = object_ref_create(game_player_get_har(game_state_get_player(obj->gs, h->player_id)));
+    local->af_data = h->af_data;
 
     // Set up callbacks
     object_set_userdata(obj, local);
     object_set_dynamic_tick_cb(obj, projectile_tick);
     object_set_free_cb(obj, projectile_free);
-    object_set_move_cb(obj, projectile_move);
+    object_set_body(obj, BODY_PROJECTILE, 0);
     projectile_bootstrap(obj);
     return 0;
 }
@@ -144,16 +98,23 @@ af *projectile_get_af_data(object *obj) {
     return ((projectile_local*)object_get_userdata(obj))->af_data;
 }
 
+// HAR that fired the projectile, or NULL if it is gone
 object *projectile_get_owner(object *obj) {
-    return ((projectile_local*)object_get_userdata(obj))->owner;
+    return object_ref_get(&((projectile_local*)object_get_userdata(obj))->owner);
 }
 
 void projectile_set_wall_bounce(object *obj, int bounce) {
-    projectile_local *local = object_get_userdata(obj);
-    local->wall_bounce = bounce;
+    if(bounce) {
+        obj->body_flags |= BODY_WALL_BOUNCE;
+    } else {
+        obj->body_flags &= ~BODY_WALL_BOUNCE;
+    }
 }
 
 void projectile_stop_on_ground(object *obj, int stop) {
-    projectile_local *local = object_get_userdata(obj);
-    local->ground_freeze = stop;
+    if(stop) {
+        obj->body_flags |= BODY_GROUND_FREEZE;
+    } else {
+        obj->body_flags &= ~BODY_GROUND_FREEZE;
+    }
 }
\ No newline at end of file
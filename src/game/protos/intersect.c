@@ -79,7 +79,7 @@ int intersect_sprite_hitpoint(object *obj, object *target, int level, vec2i *poi
         if(ycoord < 0 || ycoord >= size_b.y) continue;
 
         // Get hitpixel
-        surface *sfc = target->cur_sprite->data;
+        surface *sfc = sprite_get_surface(target->cur_sprite);
         int hitpoint = (ycoord * sfc->w) + xcoord;
         if (object_get_direction(target) == OBJECT_FACE_LEFT) {
             hitpoint = (ycoord * sfc->w) + (sfc->w - xcoord);
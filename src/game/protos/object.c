@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <shadowdive/sprite.h>
 #include "game/protos/object.h"
 #include "game/protos/object_specializer.h"
@@ -8,9 +9,127 @@
 #include "video/video.h"
 #include "utils/log.h"
 #include "utils/miscmath.h"
+#include "utils/memtrack.h"
+#include "utils/pool.h"
 
 #define UNUSED(x) (void)(x)
 
+// Enough for all scrap, projectiles and hazards of a busy arena, with room to spare.
+#define OBJECT_POOL_SIZE 512
+
+static pool object_pool;
+static int object_pool_ready = 0;
+
+static void* object_pool_malloc(size_t size) {
+    if(!object_pool_ready) {
+        if(pool_create(&object_pool, sizeof(object), OBJECT_POOL_SIZE)) {
+            PERROR("Unable to create object pool!");
+            return memtrack_malloc(MEM_OBJECTS, size);
+        }
+        object_pool_ready = 1;
+    }
+    void *ptr = NULL;
+    if(size <= object_pool.slot_size) {
+        ptr = pool_alloc(&object_pool, NULL);
+    }
+    if(ptr == NULL) {
+        return memtrack_malloc(MEM_OBJECTS, size);
+    }
+    memtrack_add(MEM_OBJECTS, object_pool.slot_size);
+    return ptr;
+}
+
+static void object_pool_free(void *ptr) {
+    if(ptr == NULL) {
+        return;
+    }
+    if(object_pool_ready && pool_owns(&object_pool, ptr)) {
+        memtrack_sub(MEM_OBJECTS, object_pool.slot_size);
+        pool_release(&object_pool, ptr);
+    } else {
+        memtrack_free(ptr);
+    }
+}
+
+static void* object_pool_realloc(void *ptr, size_t size) {
+    if(ptr != NULL && object_pool_ready && pool_owns(&object_pool, ptr)) {
+        if(size <= object_pool.slot_size) {
+            return ptr;
+        }
+        void *nptr = memtrack_malloc(MEM_OBJECTS, size);
+        if(nptr != NULL) {
+            memcpy(nptr, ptr, object_pool.slot_size);
+            memtrack_sub(MEM_OBJECTS, object_pool.slot_size);
+            pool_release(&object_pool, ptr);
+        }
+        return nptr;
+    }
+    return memtrack_realloc(MEM_OBJECTS, ptr, size);
+}
+
+/** \brief Allocates memory for a new object from the object pool.
+  * \return Uninitialized object; use object_create to set it up.
+  */
+object* object_alloc() {
+    return object_pool_malloc(sizeof(object));
+}
+
+/** \brief Returns object memory to the pool. Call object_free first.
+  * \param obj Object handle
+  */
+void object_dealloc(object *obj) {
+    object_pool_free(obj);
+}
+
+/** \brief Gets an allocator that serves small blocks from the object pool.
+  * Useful for object userdata that is created and freed along with the object.
+  * \param alloc Allocator struct to fill
+  */
+void object_get_allocator(allocator *alloc) {
+    alloc->cmalloc = object_pool_malloc;
+    alloc->cfree = object_pool_free;
+    alloc->crealloc = object_pool_realloc;
+}
+
+/** \brief Frees the object pool. All objects must be deallocated before this.
+  */
+void object_pool_close() {
+    if(!object_pool_ready) {
+        return;
+    }
+    if(pool_size(&object_pool) > 0) {
+        // Keep the memory around; something may still hold a pointer to it.
+        PERROR("Object pool closed with %u objects still allocated!", pool_size(&object_pool));
+        return;
+    }
+    pool_free(&object_pool);
+    object_pool_ready = 0;
+}
+
+/** \brief Creates a reference to an object, for keeping in other objects.
+  * \param obj Object to refer to, or NULL
+  */
+object_ref object_ref_create(object *obj) {
+    object_ref ref;
+    ref.ptr = obj;
+    ref.handle = POOL_INVALID_HANDLE;
+    if(obj != NULL && object_pool_ready) {
+        ref.handle = pool_get_handle(&object_pool, obj);
+    }
+    return ref;
+}
+
+/** \brief Resolves an object reference.
+  * \param ref Reference made with object_ref_create
+  * \return Object, or NULL if there is none or it has been freed since.
+  */
+object* object_ref_get(const object_ref *ref) {
+    if(ref->handle == POOL_INVALID_HANDLE) {
+        return ref->ptr;
+    }
+    return pool_get(&object_pool, ref->handle);
+}
+
 /** \brief Creates a new, empty object.
   * \param obj Object handle
   * \param gs Game state handle
@@ -26,6 +145,8 @@ void object_create(object *obj, game_state *gs, vec2i pos, vec2f vel) {
     // remember the place we were spawned, the x= and y= tags are relative to that
     obj->start = vec2i_to_f(pos);
     obj->vel = vel;
+    obj->prev_pos = obj->pos;
+    obj->prev_pos_tick = (gs != NULL) ? gs->int_tick : 0;
     obj->direction = OBJECT_FACE_RIGHT;
     obj->y_percent = 1.0;
 
@@ -33,12 +154,14 @@ void object_create(object *obj, game_state *gs, vec2i pos, vec2f vel) {
     obj->layers = OBJECT_DEFAULT_LAYER;
     obj->group = OBJECT_NO_GROUP;
     obj->gravity = 0.0f;
+    obj->body = BODY_NONE;
+    obj->body_flags = 0;
 
     // Video effect stuff
     obj->video_effects = 0;
 
     // Attachment stuff
-    obj->attached_to = NULL;
+    obj->attached_to = object_ref_create(NULL);
 
     // Fire orb wandering
     obj->orbit = 0;
@@ -246,9 +369,10 @@ void object_set_playback_direction(object *obj, int dir) {
 void object_dynamic_tick(object *obj) {
     obj->age++;
 
-    if(obj->attached_to != NULL) {
-        object_set_pos(obj, object_get_pos(obj->attached_to));
-        object_set_direction(obj, object_get_direction(obj->attached_to));
+    object *attached_to = object_ref_get(&obj->attached_to);
+    if(attached_to != NULL) {
+        object_set_pos(obj, object_get_pos(attached_to));
+        object_set_direction(obj, object_get_direction(attached_to));
     }
 
     // Run animation player
@@ -312,21 +436,39 @@ int object_get_effects(const object *obj) {
     return obj->video_effects;
 }
 
+/*
+ * Position to draw the object at. When rendering between two dynamic ticks, this is
+ * interpolated from the position at the start of the last tick. Objects that were not
+ * ticked last time, or that jumped far, are drawn where they are.
+ */
+vec2f object_get_render_pos(object *obj) {
+    if(obj->gs == NULL || obj->gs->render_alpha >= 1.0f || obj->prev_pos_tick + 1 != obj->gs->int_tick) {
+        return obj->pos;
+    }
+    vec2f d = vec2f_sub(obj->pos, obj->prev_pos);
+    if(fabsf(d.x) > OBJECT_INTERPOLATE_MAX || fabsf(d.y) > OBJECT_INTERPOLATE_MAX) {
+        return obj->pos;
+    }
+    float a = obj->gs->render_alpha;
+    return vec2f_create(obj->prev_pos.x + d.x * a, obj->prev_pos.y + d.y * a);
+}
+
 void object_render(object *obj) {
     // Stop here if cur_sprite is NULL
     if(obj->cur_sprite == NULL) return;
 
     // Set current surface
-    obj->cur_surface = obj->cur_sprite->data;
+    obj->cur_surface = sprite_get_surface(obj->cur_sprite);
 
     // Something to ease the pain ...
     player_sprite_state *rstate = &obj->sprite_state;
 
     // Position
-    int y = obj->pos.y + obj->cur_sprite->pos.y;
-    int x = obj->pos.x + obj->cur_sprite->pos.x;
+    vec2f pos = object_get_render_pos(obj);
+    int y = pos.y + obj->cur_sprite->pos.y;
+    int x = pos.x + obj->cur_sprite->pos.x;
     if(object_get_direction(obj) == OBJECT_FACE_LEFT) {
-        x = obj->pos.x - obj->cur_sprite->pos.x - object_get_size(obj).x;
+        x = pos.x - obj->cur_sprite->pos.x - object_get_size(obj).x;
     }
 
     // Flip to face the right direction
@@ -387,9 +529,10 @@ void object_render_shadow(object *obj) {
 
     // Determine X
     int flipmode = obj->sprite_state.flipmode;
-    int x = obj->pos.x + obj->cur_sprite->pos.x;
+    vec2f pos = object_get_render_pos(obj);
+    int x = pos.x + obj->cur_sprite->pos.x;
     if(object_get_direction(obj) == OBJECT_FACE_LEFT) {
-        x = obj->pos.x - obj->cur_sprite->pos.x - object_get_size(obj).x;
+        x = pos.x - obj->cur_sprite->pos.x - object_get_size(obj).x;
         flipmode ^= FLIP_HORIZONTAL;
     }
 
@@ -401,7 +544,7 @@ void object_render_shadow(object *obj) {
     // the shadows seem a bit blobbier and shadow-y
     for(int i = 0; i < 2; i++) {
         video_render_sprite_flip_scale_opacity_tint(
-            obj->cur_sprite->data,
+            sprite_get_surface(obj->cur_sprite),
             x+i, y+i,
             BLEND_ALPHA,
             obj->pal_offset,
@@ -607,8 +750,10 @@ void object_set_pal_transform_cb(object *obj, object_palette_transform_cb cbfunc
 void object_set_layers(object *obj, int layers) { obj->layers = layers; }
 void object_set_group(object *obj, int group) { obj->group = group; }
 void object_set_gravity(object *obj, float gravity) { obj->gravity = gravity; }
+void object_set_body(object *obj, int body, int flags) { obj->body = body; obj->body_flags = flags; }
 
 int object_get_gravity(const object *obj) { return obj->gravity; }
+int object_get_body(const object *obj) { return obj->body; }
 int object_get_group(const object *obj) { return obj->group; }
 int object_get_layers(const object *obj) { return obj->layers; }
 
@@ -678,6 +823,6 @@ int object_is_airborne(const object *obj) {
 }
 
 /* Attaches one object to another. Positions are synced to this from the attached. */
-void object_attach_to(object *obj, const object *attach_to) {
-    obj->attached_to = attach_to;
+void object_attach_to(object *obj, object *attach_to) {
+    obj->attached_to = object_ref_create(attach_to);
 }
@@ -0,0 +1,173 @@
+#include <stdlib.h>
+#include <string.h>
+#include "game/protos/physics.h"
+#include "game/protos/object.h"
+#include "game/objects/arena_constraints.h"
+
+#define PHYSICS_START_SIZE 32
+#define IS_ZERO(n) (n < 0.1 && n > -0.1)
+
+enum {
+    RESULT_REST = 0x1,
+    RESULT_FINISHED = 0x2
+};
+
+void physics_store_create(physics_store *ps) {
+    memset(ps, 0, sizeof(physics_store));
+}
+
+void physics_store_free(physics_store *ps) {
+    free(ps->objs);
+    free(ps->px);
+    free(ps->py);
+    free(ps->vx);
+    free(ps->vy);
+    free(ps->gravity);
+    free(ps->dampen);
+    free(ps->body);
+    free(ps->flags);
+    free(ps->result);
+    memset(ps, 0, sizeof(physics_store));
+}
+
+void physics_store_clear(physics_store *ps) {
+    ps->size = 0;
+}
+
+static void physics_store_grow(physics_store *ps) {
+    unsigned int n = (ps->capacity == 0) ? PHYSICS_START_SIZE : ps->capacity * 2;
+    ps->objs = realloc(ps->objs, n * sizeof(object*));
+    ps->px = realloc(ps->px, n * sizeof(float));
+    ps->py = realloc(ps->py, n * sizeof(float));
+    ps->vx = realloc(ps->vx, n * sizeof(float));
+    ps->vy = realloc(ps->vy, n * sizeof(float));
+    ps->gravity = realloc(ps->gravity, n * sizeof(float));
+    ps->dampen = realloc(ps->dampen, n * sizeof(float));
+    ps->body = realloc(ps->body, n);
+    ps->flags = realloc(ps->flags, n);
+    ps->result = realloc(ps->result, n);
+    ps->capacity = n;
+}
+
+/*
+ * Gathers the physics state of an object. Returns 1 if the object does not have
+ * a body, and should be moved with object_move instead.
+ */
+int physics_store_add(physics_store *ps, object *obj) {
+    if(obj->body == BODY_NONE) {
+        return 1;
+    }
+
+    // Same as in object_move
+    if(obj->sprite_state.disable_gravity) {
+        obj->vel = vec2f_create(0, 0);
+    }
+
+    // Scrap that has settled down doesn't move at all
+    if(obj->body == BODY_SCRAP && object_is_rewind_tag_disabled(obj) > 0) {
+        return 0;
+    }
+
+    if(ps->size >= ps->capacity) {
+        physics_store_grow(ps);
+    }
+    unsigned int i = ps->size++;
+    ps->objs[i] = obj;
+    ps->vx[i] = obj->vel.x;
+    ps->vy[i] = obj->vel.y;
+    ps->gravity[i] = obj->gravity;
+    ps->body[i] = obj->body;
+    ps->flags[i] = obj->body_flags;
+    ps->result[i] = 0;
+    if(obj->body == BODY_SCRAP) {
+        vec2i pos = vec2f_to_i(obj->pos);
+        ps->px[i] = pos.x;
+        ps->py[i] = pos.y;
+        ps->dampen[i] = 0.4f;
+    } else {
+        ps->px[i] = obj->pos.x;
+        ps->py[i] = obj->pos.y;
+        ps->dampen[i] = 0.7f;
+    }
+    return 0;
+}
+
+void physics_store_step(physics_store *ps) {
+    const unsigned int n = ps->size;
+    float *restrict px = ps->px;
+    float *restrict py = ps->py;
+    float *restrict vx = ps->vx;
+    float *restrict vy = ps->vy;
+    const float *restrict gravity = ps->gravity;
+    const float *restrict dampen = ps->dampen;
+    const uint8_t *restrict body = ps->body;
+    const uint8_t *restrict flags = ps->flags;
+    uint8_t *restrict result = ps->result;
+
+    // Integrate
+    for(unsigned int i = 0; i < n; i++) {
+        px[i] += vx[i];
+        vy[i] += gravity[i];
+        py[i] += vy[i];
+    }
+
+    // Scrap lives on integer coordinates
+    for(unsigned int i = 0; i < n; i++) {
+        if(body[i] == BODY_SCRAP) {
+            px[i] = (int)px[i];
+            py[i] = (int)py[i];
+        }
+    }
+
+    // Walls and floor
+    for(unsigned int i = 0; i < n; i++) {
+        int bounce = flags[i] & BODY_WALL_BOUNCE;
+        if(px[i] < ARENA_LEFT_WALL) {
+            px[i] = ARENA_LEFT_WALL;
+            if(bounce) {
+                vx[i] = -vx[i] * dampen[i];
+            } else {
+                result[i] |= RESULT_FINISHED;
+            }
+        }
+        if(px[i] > ARENA_RIGHT_WALL) {
+            px[i] = ARENA_RIGHT_WALL;
+            if(bounce) {
+                vx[i] = -vx[i] * dampen[i];
+            } else {
+                result[i] |= RESULT_FINISHED;
+            }
+        }
+        if(py[i] > ARENA_FLOOR) {
+            py[i] = ARENA_FLOOR;
+            vy[i] = -vy[i] * dampen[i];
+            vx[i] = vx[i] * dampen[i];
+        }
+        if(body[i] == BODY_SCRAP && IS_ZERO(vx[i])) {
+            vx[i] = 0;
+        }
+
+        // If object is at rest, the animation can be halted
+        if((flags[i] & BODY_GROUND_FREEZE)
+            && py[i] >= (ARENA_FLOOR-5)
+            && IS_ZERO(vx[i])
+            && vy[i] < gravity[i] * 1.1
+            && vy[i] > gravity[i] * -1.1) {
+            result[i] |= RESULT_REST;
+        }
+    }
+}
+
+void physics_store_write(physics_store *ps) {
+    for(unsigned int i = 0; i < ps->size; i++) {
+        object *obj = ps->objs[i];
+        obj->pos = vec2f_create(ps->px[i], ps->py[i]);
+        obj->vel = vec2f_create(ps->vx[i], ps->vy[i]);
+        if(ps->result[i] & RESULT_REST) {
+            object_disable_rewind_tag(obj, 1);
+        }
+        if(ps->result[i] & RESULT_FINISHED) {
+            obj->animation_state.finished = 1;
+        }
+    }
+}
@@ -58,7 +58,7 @@ void player_create(object *obj) {
     obj->animation_state.destroy = NULL;
     obj->animation_state.destroy_userdata = NULL;
     obj->animation_state.disable_d = 0;
-    obj->animation_state.enemy = NULL;
+    obj->animation_state.enemy = object_ref_create(NULL);
     obj->slide_state.timer = 0;
     obj->slide_state.vel = vec2f_create(0,0);
     sd_script_create(&obj->animation_state.parser);
@@ -178,10 +178,13 @@ void player_run(object *obj) {
         obj->slide_state.timer--;
     }
 
+    object *enemy = object_ref_get(&state->enemy);
     if(obj->enemy_slide_state.timer > 0) {
         obj->enemy_slide_state.duration++;
-        obj->pos.x = state->enemy->pos.x + obj->enemy_slide_state.dest.x;
-        obj->pos.y = state->enemy->pos.y + obj->enemy_slide_state.dest.y;
+        if(enemy != NULL) {
+            obj->pos.x = enemy->pos.x + obj->enemy_slide_state.dest.x;
+            obj->pos.y = enemy->pos.y + obj->enemy_slide_state.dest.y;
+        }
         obj->enemy_slide_state.timer--;
     }
 
@@ -230,8 +233,8 @@ void player_run(object *obj) {
                 rstate->disable_gravity = 0;
             }
 
-            if(sd_script_isset(frame, "ua")) {
-                obj->animation_state.enemy->sprite_state.disable_gravity = 1;
+            if(sd_script_isset(frame, "ua") && enemy != NULL) {
+                enemy->sprite_state.disable_gravity = 1;
             }
 
             // Animation creation command
@@ -342,7 +345,7 @@ void player_run(object *obj) {
             if(sd_script_isset(frame, "bps")) { rstate->pal_start_index = sd_script_get(frame, "bps"); }
             if(sd_script_isset(frame, "bpf")) {
                 // Exact values come from master.dat
-                if(game_state_get_player(obj->gs, 0)->har == obj) {
+                if(game_player_get_har(game_state_get_player(obj->gs, 0)) == obj) {
                     rstate->pal_start_index =  1;
                     rstate->pal_entry_count = 47;
                 } else {
@@ -377,11 +380,11 @@ void player_run(object *obj) {
                 /*obj->pos.y += sd_script_get(frame, "oy");*/
             }
 
-            if (sd_script_isset(frame, "bm")) {
+            if (sd_script_isset(frame, "bm") && enemy != NULL) {
                 // hack because we don't have 'walk to other HAR' implemented
-                obj->pos.x = state->enemy->pos.x;
-                obj->pos.y = state->enemy->pos.y;
-                player_next_frame(state->enemy);
+                obj->pos.x = enemy->pos.x;
+                obj->pos.y = enemy->pos.y;
+                player_next_frame(enemy);
             }
 
             if (sd_script_isset(frame, "v")) {
@@ -532,9 +535,9 @@ void player_run(object *obj) {
                 obj->hit_frames--;
             }
 
-            if(sd_script_isset(frame, "at")) {
+            if(sd_script_isset(frame, "at") && enemy != NULL) {
                 // set the object's X position to be behind the opponent
-                obj->pos.x = obj->animation_state.enemy->pos.x + (15 * object_get_direction(obj));
+                obj->pos.x = enemy->pos.x + (15 * object_get_direction(obj));
             }
 
             if(sd_script_isset(frame, "ar")) {
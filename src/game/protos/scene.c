@@ -112,7 +112,7 @@ void scene_init(scene *scene) {
 
         // Start up animations
         if(m_load) {
-            object *obj = malloc(sizeof(object));
+            object *obj = object_alloc();
             object_create(obj, scene->gs, info->ani.start_pos, vec2f_create(0,0));
             object_set_stl(obj, scene->bk_data.sound_translation_table);
             object_set_animation(obj, &info->ani);
@@ -281,7 +281,7 @@ void cb_scene_spawn_object(object *parent, int id, vec2i pos, int g, void *userd
     // Get next animation
     bk_info *info = bk_get_info(&s->bk_data, id);
     if(info != NULL) {
-        object *obj = malloc(sizeof(object));
+        object *obj = object_alloc();
         object_create(obj, parent->gs, vec2i_add(pos, info->ani.start_pos), vec2f_create(0,0));
         object_set_stl(obj, object_get_stl(parent));
         object_set_animation(obj, &info->ani);
@@ -33,9 +33,11 @@
 #include "game/gui/progressbar.h"
 #include "controller/controller.h"
 #include "controller/net_controller.h"
+#include "controller/rec_controller.h"
 #include "resources/ids.h"
 #include "utils/log.h"
 #include "utils/random.h"
+#include "utils/frame_alloc.h"
 
 #define TEXT_COLOR color_create(186,250,250,255)
 
@@ -120,7 +122,7 @@ void scene_fight_anim_start(void *userdata) {
     game_state *gs = userdata;
     scene *scene = game_state_get_scene(gs);
     animation *fight_ani = &bk_get_info(&scene->bk_data, 10)->ani;
-    object *fight = malloc(sizeof(object));
+    object *fight = object_alloc();
     object_create(fight, gs, fight_ani->start_pos, vec2f_create(0,0));
     object_set_stl(fight, bk_get_stl(&scene->bk_data));
     object_set_animation(fight, fight_ani);
@@ -149,7 +151,7 @@ void scene_youwin_anim_start(void *userdata) {
     game_state *gs = userdata;
     scene *scene = game_state_get_scene(gs);
     animation *youwin_ani = &bk_get_info(&scene->bk_data, 9)->ani;
-    object *youwin = malloc(sizeof(object));
+    object *youwin = object_alloc();
     object_create(youwin, gs, youwin_ani->start_pos, vec2f_create(0,0));
     object_set_stl(youwin, bk_get_stl(&scene->bk_data));
     object_set_animation(youwin, youwin_ani);
@@ -171,7 +173,7 @@ void scene_youlose_anim_start(void *userdata) {
     game_state *gs = userdata;
     scene *scene = game_state_get_scene(gs);
     animation *youlose_ani = &bk_get_info(&scene->bk_data, 8)->ani;
-    object *youlose = malloc(sizeof(object));
+    object *youlose = object_alloc();
     object_create(youlose, gs, youlose_ani->start_pos, vec2f_create(0,0));
     object_set_stl(youlose, bk_get_stl(&scene->bk_data));
     object_set_animation(youlose, youlose_ani);
@@ -222,16 +224,16 @@ void arena_screengrab_winner(scene* sc) {
     game_state *gs = sc->gs;
 
     // take victory pose screenshot for the newsroom
-    har *h1 = object_get_userdata(game_state_get_player(gs, 0)->har);
+    har *h1 = object_get_userdata(game_player_get_har(game_state_get_player(gs, 0)));
     if(h1->state == STATE_VICTORY || h1->state == STATE_DONE) {
         har_screencaps_capture(
             &game_state_get_player(gs, 0)->screencaps,
-            game_state_get_player(gs, 0)->har,
+            game_player_get_har(game_state_get_player(gs, 0)),
             SCREENCAP_POSE);
     } else {
         har_screencaps_capture(
             &game_state_get_player(gs, 1)->screencaps,
-            game_state_get_player(gs, 1)->har,
+            game_player_get_har(game_state_get_player(gs, 1)),
             SCREENCAP_POSE);
     }
 }
@@ -291,7 +293,7 @@ void arena_reset(scene *sc) {
     sc->bk_data.sound_translation_table[3] = 23 + local->round; // NUMBER
     // ROUND animation
     animation *round_ani = &bk_get_info(&sc->bk_data, 6)->ani;
-    object *round = malloc(sizeof(object));
+    object *round = object_alloc();
     object_create(round, sc->gs, round_ani->start_pos, vec2f_create(0,0));
     object_set_stl(round, sc->bk_data.sound_translation_table);
     object_set_animation(round, round_ani);
@@ -300,7 +302,7 @@ void arena_reset(scene *sc) {
 
     // Round number
     animation *number_ani = &bk_get_info(&sc->bk_data, 7)->ani;
-    object *number = malloc(sizeof(object));
+    object *number = object_alloc();
     object_create(number, sc->gs, number_ani->start_pos, vec2f_create(0,0));
     object_set_stl(number, sc->bk_data.sound_translation_table);
     object_set_animation(number, number_ani);
@@ -320,7 +322,9 @@ void arena_maybe_sync(scene *scene, int need_sync) {
 
         // some of the moves did something interesting and we should synchronize the peer
         serial ser;
-        serial_create(&ser);
+        allocator alloc;
+        frame_alloc_get_allocator(&alloc);
+        serial_create_with_allocator(&ser, alloc);
         game_state_serialize(scene->gs, &ser);
         if (player1->ctrl->type == CTRL_TYPE_NETWORK) {
             controller_update(player1->ctrl, &ser);
@@ -420,7 +424,7 @@ void arena_har_hit_wall_hook(int player_id, int wall, scene *scene) {
 
         // Spawn wall animation
         bk_info *info = bk_get_info(&scene->bk_data, 20+wall);
-        object *obj = malloc(sizeof(object));
+        object *obj = object_alloc();
         object_create(obj, scene->gs, info->ani.start_pos, vec2f_create(0,0));
         object_set_stl(obj, scene->bk_data.sound_translation_table);
         object_set_animation(obj, &info->ani);
@@ -429,7 +433,7 @@ void arena_har_hit_wall_hook(int player_id, int wall, scene *scene) {
             // spawn the electricity on top of the HAR
             // TODO this doesn't track the har's position well...
             info = bk_get_info(&scene->bk_data, 22);
-            object *obj2 = malloc(sizeof(object));
+            object *obj2 = object_alloc();
             object_create(obj2, scene->gs, vec2i_create(o_har->pos.x, o_har->pos.y), vec2f_create(0, 0));
             object_set_stl(obj2, scene->bk_data.sound_translation_table);
             object_set_animation(obj2, &info->ani);
@@ -438,7 +442,7 @@ void arena_har_hit_wall_hook(int player_id, int wall, scene *scene) {
             game_state_add_object(scene->gs, obj2, RENDER_LAYER_TOP, 0, 0);
         } else {
             object_free(obj);
-            free(obj);
+            object_dealloc(obj);
         }
         return;
     }
@@ -458,14 +462,14 @@ void arena_har_hit_wall_hook(int player_id, int wall, scene *scene) {
 
         // desert always shows the 'hit' animation when you touch the wall
         bk_info *info = bk_get_info(&scene->bk_data, 20+wall);
-        object *obj = malloc(sizeof(object));
+        object *obj = object_alloc();
         object_create(obj, scene->gs, info->ani.start_pos, vec2f_create(0,0));
         object_set_stl(obj, scene->bk_data.sound_translation_table);
         object_set_animation(obj, &info->ani);
         object_set_custom_string(obj, "brwA1-brwB1-brwD1-brwE0-brwD4-brwC2-brwB2-brwA2");
         if(game_state_add_object(scene->gs, obj, RENDER_LAYER_BOTTOM, 1, 0) != 0) {
             object_free(obj);
-            free(obj);
+            object_dealloc(obj);
         }
     }
 
@@ -490,7 +494,7 @@ void arena_har_hit_wall_hook(int player_id, int wall, scene *scene) {
             DEBUG("XXX anim = %d, variance = %d", anim_no, variance);
             int pos_y = o_har->pos.y - object_get_size(o_har).y + variance + i*25;
             vec2i coord = vec2i_create(o_har->pos.x, pos_y);
-            object *dust = malloc(sizeof(object));
+            object *dust = object_alloc();
             object_create(dust, scene->gs, coord, vec2f_create(0,0));
             object_set_stl(dust, scene->bk_data.sound_translation_table);
             object_set_animation(dust, &bk_get_info(&scene->bk_data, anim_no)->ani);
@@ -737,7 +741,7 @@ void arena_free(scene *scene) {
 
         for (int j = 0; j < 4; j++) {
             if (j < ceil(local->rounds / 2.0f)) {
-                free(local->player_rounds[i][j]);
+                object_dealloc(local->player_rounds[i][j]);
             }
         }
     }
@@ -873,7 +877,7 @@ void arena_spawn_hazard(scene *scene) {
         if(info->probability > 1) {
             if (rand_int(info->probability) == 1) {
                 // TODO don't spawn it if we already have this animation running
-                object *obj = malloc(sizeof(object));
+                object *obj = object_alloc();
                 object_create(obj, scene->gs, info->ani.start_pos, vec2f_create(0,0));
                 object_set_stl(obj, scene->bk_data.sound_translation_table);
                 object_set_animation(obj, &info->ani);
@@ -908,7 +912,7 @@ void arena_spawn_hazard(scene *scene) {
                     changed++;
                 } else {
                     object_free(obj);
-                    free(obj);
+                    object_dealloc(obj);
                 }
             }
         }
@@ -984,7 +988,7 @@ void arena_dynamic_tick(scene *scene, int paused) {
             if(rand_float() > 0.65f) {
                 vec2i pos = vec2i_create(rand_int(NATIVE_W), -10);
                 for(int harnum = 0;harnum < game_state_num_players(gs);harnum++) {
-                    object *h_obj = game_state_get_player(gs, harnum)->har;
+                    object *h_obj = game_player_get_har(game_state_get_player(gs, harnum));
                     har *h = object_get_userdata(h_obj);
                     // Calculate velocity etc.
                     float rv = rand_float() - 0.5f;
@@ -996,7 +1000,7 @@ void arena_dynamic_tick(scene *scene, int paused) {
                     if(vely < 0.1 && vely > -0.1) vely += 0.21;
 
                     // Create the object
-                    object *scrap = malloc(sizeof(object));
+                    object *scrap = object_alloc();
                     int anim_no = rand_int(3) + ANIM_SCRAP_METAL;
                     object_create(scrap, gs, pos, vec2f_create(velx, vely));
                     object_set_animation(scrap, &af_get_move(h->af_data, anim_no)->ani);
@@ -1169,6 +1173,10 @@ int arena_create(scene *scene) {
     // Load up settings
     setting = settings_get();
 
+    // Grab the seed before anything here eats random numbers. Recordings store this,
+    // so that playback can start the match from the very same RNG state.
+    uint32_t match_seed = rand_get_seed();
+
     // Initialize Demo
     if(is_demoplay(scene)) {
         game_state_init_demo(scene->gs);
@@ -1222,7 +1230,7 @@ int arena_create(scene *scene) {
     for(int i = 0; i < 2; i++) {
         // Declare some vars
         game_player *player = game_state_get_player(scene->gs, i);
-        object *obj = malloc(sizeof(object));
+        object *obj = object_alloc();
 
         // load the player's colors into the palette
         palette *base_pal = video_get_base_palette();
@@ -1235,7 +1243,7 @@ int arena_create(scene *scene) {
         // Errors are unlikely here, but check anyway.
 
         if (scene_load_har(scene, i, player->har_id)) {
-            free(obj);
+            object_dealloc(obj);
             return 1;
         }
 
@@ -1249,12 +1257,12 @@ int arena_create(scene *scene) {
 
         // Set HAR for player
         game_player_set_har(player, obj);
-        game_player_get_ctrl(player)->har = obj;
+        controller_set_har(game_player_get_ctrl(player), obj);
 
         // Create round tokens
         for (int j = 0; j < 4; j++) {
             if (j < ceil(local->rounds / 2.0f)) {
-                local->player_rounds[i][j] = malloc(sizeof(object));
+                local->player_rounds[i][j] = object_alloc();
                 int xoff = 110 + 9 * j + 3 + j;
                 if (i == 1) {
                     xoff = 210 - 9 * j - 3 - j;
@@ -1285,8 +1293,8 @@ int arena_create(scene *scene) {
     controller_set_repeat(game_player_get_ctrl(_player[0]), 1);
     controller_set_repeat(game_player_get_ctrl(_player[1]), 1);
 
-    game_player_get_har(_player[0])->animation_state.enemy = game_player_get_har(_player[1]);
-    game_player_get_har(_player[1])->animation_state.enemy = game_player_get_har(_player[0]);
+    game_player_get_har(_player[0])->animation_state.enemy = object_ref_create(game_player_get_har(_player[1]));
+    game_player_get_har(_player[1])->animation_state.enemy = object_ref_create(game_player_get_har(_player[0]));
 
     maybe_install_har_hooks(scene);
 
@@ -1368,7 +1376,7 @@ int arena_create(scene *scene) {
     if (local->rounds == 1) {
         // Start READY animation
         animation *ready_ani = &bk_get_info(&scene->bk_data, 11)->ani;
-        object *ready = malloc(sizeof(object));
+        object *ready = object_alloc();
         object_create(ready, scene->gs, ready_ani->start_pos, vec2f_create(0,0));
         object_set_stl(ready, scene->bk_data.sound_translation_table);
         object_set_animation(ready, ready_ani);
@@ -1377,7 +1385,7 @@ int arena_create(scene *scene) {
     } else {
         // ROUND
         animation *round_ani = &bk_get_info(&scene->bk_data, 6)->ani;
-        object *round = malloc(sizeof(object));
+        object *round = object_alloc();
         object_create(round, scene->gs, round_ani->start_pos, vec2f_create(0,0));
         object_set_stl(round, scene->bk_data.sound_translation_table);
         object_set_animation(round, round_ani);
@@ -1386,7 +1394,7 @@ int arena_create(scene *scene) {
 
         // Number
         animation *number_ani = &bk_get_info(&scene->bk_data, 7)->ani;
-        object *number = malloc(sizeof(object));
+        object *number = object_alloc();
         object_create(number, scene->gs, number_ani->start_pos, vec2f_create(0,0));
         object_set_stl(number, scene->bk_data.sound_translation_table);
         object_set_animation(number, number_ani);
@@ -1421,6 +1429,12 @@ int arena_create(scene *scene) {
             local->rec->pilots[i].info.color_3 = player->colors[0];
             memcpy(local->rec->pilots[i].info.name, lang_get(player->pilot_id+20), 18);
         }
+        rec_match_info info;
+        info.arena_id = scene->id - SCENE_ARENA0;
+        info.speed = game_state_get_speed(scene->gs);
+        info.seed = match_seed;
+        info.has_seed = 1;
+        rec_write_match_info(local->rec, &info);
     } else{
         local->rec = NULL;
     }
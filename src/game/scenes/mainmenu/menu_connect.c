@@ -102,10 +102,10 @@ void menu_connect_tick(component *c) {
 
             player1_ctrl = malloc(sizeof(controller));
             controller_init(player1_ctrl);
-            player1_ctrl->har = p1->har;
+            controller_set_har(player1_ctrl, game_player_get_har(p1));
             player2_ctrl = malloc(sizeof(controller));
             controller_init(player2_ctrl);
-            player2_ctrl->har = p2->har;
+            controller_set_har(player2_ctrl, game_player_get_har(p2));
 
             // Player 1 controller -- Network
             net_controller_create(player1_ctrl, local->host, event.peer, ROLE_CLIENT);
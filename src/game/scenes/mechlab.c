@@ -44,7 +44,7 @@ void mechlab_free(scene *scene) {
     guiframe_free(local->frame);
     guiframe_free(local->dashboard);
     object_free(local->mech);
-    free(local->mech);
+    object_dealloc(local->mech);
     free(local);
 }
 
@@ -231,7 +231,7 @@ int mechlab_create(scene *scene) {
 
     // Load HAR
     animation *initial_har_ani = &bk_get_info(&scene->bk_data, 15 + p1->pilot.har_id)->ani;
-    local->mech = malloc(sizeof(object));
+    local->mech = object_alloc();
     object_create(local->mech, scene->gs, vec2i_create(0,0), vec2f_create(0,0));
     object_set_animation(local->mech, initial_har_ani);
     object_set_repeat(local->mech, 1);
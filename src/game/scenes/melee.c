@@ -86,6 +86,7 @@ void mask_sprite(surface *vga, int x, int y, int w, int h) {
             }
         }
     }
+    surface_force_refresh(vga);
 }
 
 void melee_free(scene *scene) {
@@ -611,7 +612,7 @@ int melee_create(scene *scene) {
         int row = i / 5;
         int col = i % 5;
         spr = sprite_copy(animation_get_sprite(&bk_get_info(&scene->bk_data, 1)->ani, 0));
-        mask_sprite(spr->data, 62*col, 42*row, 51, 36);
+        mask_sprite(sprite_get_surface(spr), 62*col, 42*row, 51, 36);
         ani = create_animation_from_single(spr, spr->pos);
         object_create(&local->harportraits_player1[i], scene->gs, vec2i_create(0, 0), vec2f_create(0, 0));
         object_set_animation(&local->harportraits_player1[i], ani);
@@ -619,7 +620,7 @@ int melee_create(scene *scene) {
         object_set_animation_owner(&local->harportraits_player1[i], OWNER_OBJECT);
         if (player2->selectable) {
             spr = sprite_copy(animation_get_sprite(&bk_get_info(&scene->bk_data, 1)->ani, 0));
-            mask_sprite(spr->data, 62*col, 42*row, 51, 36);
+            mask_sprite(sprite_get_surface(spr), 62*col, 42*row, 51, 36);
             ani = create_animation_from_single(spr, spr->pos);
             object_create(&local->harportraits_player2[i], scene->gs, vec2i_create(0, 0), vec2f_create(0, 0));
             object_set_animation(&local->harportraits_player2[i], ani);
@@ -659,7 +660,7 @@ int melee_create(scene *scene) {
     }
 
     spr = sprite_copy(animation_get_sprite(&bk_get_info(&scene->bk_data, 1)->ani, 0));
-    surface_convert_to_rgba(spr->data, video_get_pal_ref(), 0);
+    surface_convert_to_rgba(sprite_get_surface(spr), video_get_pal_ref(), 0);
     ani = create_animation_from_single(spr, spr->pos);
     object_create(&local->unselected_har_portraits, scene->gs, vec2i_create(0,0), vec2f_create(0, 0));
     object_set_animation(&local->unselected_har_portraits, ani);
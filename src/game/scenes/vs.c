@@ -106,7 +106,7 @@ void cb_vs_spawn_object(object *parent, int id, vec2i pos, int g, void *userdata
     // Get next animation
     bk_info *info = bk_get_info(&s->bk_data, id);
     if(info != NULL) {
-        object *obj = malloc(sizeof(object));
+        object *obj = object_alloc();
         object_create(obj, parent->gs, vec2i_add(pos, vec2f_to_i(parent->pos)), vec2f_create(0,0));
         object_set_stl(obj, object_get_stl(parent));
         object_set_animation(obj, &info->ani);
@@ -372,7 +372,7 @@ int vs_create(scene *scene) {
     } else {
         scientistcoord.x -= 50;
     }
-    object *o_scientist = malloc(sizeof(object));
+    object *o_scientist = object_alloc();
     ani = &bk_get_info(&scene->bk_data, 8)->ani;
     object_create(o_scientist, scene->gs, scientistcoord, vec2f_create(0, 0));
     object_set_animation(o_scientist, ani);
@@ -388,7 +388,7 @@ int vs_create(scene *scene) {
     while ((welderpos % 2)  == (scientistpos % 2) || (scientistpos < 2 && welderpos < 2) || (scientistpos > 1 && welderpos > 1 && welderpos < 4)) {
         welderpos = rand_int(6);
     }
-    object *o_welder = malloc(sizeof(object));
+    object *o_welder = object_alloc();
     ani = &bk_get_info(&scene->bk_data, 7)->ani;
     object_create(o_welder, scene->gs, spawn_position(welderpos, 0), vec2f_create(0, 0));
     object_set_animation(o_welder, ani);
@@ -399,14 +399,14 @@ int vs_create(scene *scene) {
     game_state_add_object(scene->gs, o_welder, RENDER_LAYER_MIDDLE, 0, 0);
 
     // GANTRIES
-    object *o_gantry_a = malloc(sizeof(object));
+    object *o_gantry_a = object_alloc();
     ani = &bk_get_info(&scene->bk_data, 11)->ani;
     object_create(o_gantry_a, scene->gs, vec2i_create(0,0), vec2f_create(0, 0));
     object_set_animation(o_gantry_a, ani);
     object_select_sprite(o_gantry_a, 0);
     game_state_add_object(scene->gs, o_gantry_a, RENDER_LAYER_TOP, 0, 0);
 
-    object *o_gantry_b = malloc(sizeof(object));
+    object *o_gantry_b = object_alloc();
     object_create(o_gantry_b, scene->gs, vec2i_create(320,0), vec2f_create(0, 0));
     object_set_animation(o_gantry_b, ani);
     object_select_sprite(o_gantry_b, 0);
@@ -13,6 +13,7 @@ void har_screencaps_create(har_screencaps *caps) {
 
 void har_screencaps_free(har_screencaps *caps) {
     for(int i = 0; i < 2; i++) {
+        video_area_capture_cancel(&caps->cap[i]);
         if(caps->ok[i]) {
             surface_free(&caps->cap[i]);
             caps->ok[i] = 0;
@@ -38,9 +39,6 @@ void har_screencaps_capture(har_screencaps *caps, object *obj, int id) {
     if(x + SCREENCAP_W >= NATIVE_W) x = NATIVE_W - SCREENCAP_W;
     if(y + SCREENCAP_H >= NATIVE_H) y = NATIVE_H - SCREENCAP_H;
 
-    // Capture
-    int ret = video_area_capture(&caps->cap[id], x, y, SCREENCAP_W, SCREENCAP_H);
-    if(ret == 0) {
-        caps->ok[id] = 1;
-    }
+    // Capture is taken when the current frame is finished, and sets ok then
+    video_area_capture(&caps->cap[id], x, y, SCREENCAP_W, SCREENCAP_H, &caps->ok[id]);
 }
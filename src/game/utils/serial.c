@@ -32,15 +32,25 @@ void serial_create(serial *s) {
     s->len = 0;
     s->rpos = 0;
     s->data = NULL;
+    s->alloc.cmalloc = malloc;
+    s->alloc.cfree = free;
+    s->alloc.crealloc = realloc;
+}
+
+void serial_create_with_allocator(serial *s, allocator alloc) {
+    s->len = 0;
+    s->rpos = 0;
+    s->data = NULL;
+    s->alloc = alloc;
 }
 
 // TODO: Optimize writing
 void serial_write(serial *s, const char *buf, int len) {
     if(s->data == NULL) {
-        s->data = malloc(len);
+        s->data = s->alloc.cmalloc(len);
         memcpy(s->data, buf, len);
     } else {
-        s->data = realloc(s->data, s->len + len);
+        s->data = s->alloc.crealloc(s->data, s->len + len);
         memcpy(s->data + s->len, buf, len);
     }
     s->len += len;
@@ -67,7 +77,7 @@ void serial_write_float(serial *s, float v) {
 
 void serial_free(serial *s) {
     if(s->data != NULL) {
-        free(s->data);
+        s->alloc.cfree(s->data);
         s->data = NULL;
         s->len = 0;
         s->rpos = 0;
@@ -55,6 +55,10 @@ const field f_video[] = {
     F_BOOL(settings_video, crossfade_on,     1),
     F_STRING(settings_video, scaler, "Nearest"),
     F_INT(settings_video,  scale_factor,     1),
+    F_BOOL(settings_video, software_render,  0),
+    F_BOOL(settings_video, interpolate,      0),
+    F_INT(settings_video,  max_catchup,    250),
+    F_BOOL(settings_video, sim_thread,       0),
 };
 
 const field f_sound[] = {
@@ -94,6 +98,7 @@ const field f_advanced[] = {
     F_INT(settings_advanced, vitality, 100),
     F_INT(settings_advanced, knock_down, KNOCK_DOWN_BOTH),
     F_INT(settings_advanced, block_damage, 0),
+    F_INT(settings_advanced, ai_search_budget, 8),
 };
 
 const field f_keyboard[] = {
@@ -125,7 +130,9 @@ const field f_keyboard[] = {
 const field f_net[] = {
     F_STRING(settings_network, net_connect_ip,   "localhost"),
     F_INT(settings_network,    net_connect_port, 2097),
-    F_INT(settings_network,    net_listen_port, 2097)
+    F_INT(settings_network,    net_listen_port, 2097),
+    F_STRING(settings_network, metrics_file,     ""),
+    F_INT(settings_network,    metrics_interval, 10)
 };
 
 // Map struct to field
@@ -17,8 +17,10 @@
 #include "resources/pathmanager.h"
 #include "resources/ids.h"
 #include "resources/sgmanager.h"
+#include "resources/baked.h"
 #include "plugins/plugins.h"
 #include "controller/gamecontrollerdb.h"
+#include "controller/ai_controller.h"
 
 #ifndef SHA1_HASH
     const char *git_sha1_hash = "";
@@ -34,8 +36,18 @@ int main(int argc, char *argv[]) {
     engine_init_flags init_flags;
     init_flags.net_mode = NET_MODE_NONE;
     init_flags.record = 0;
+    init_flags.train_ticks = 0;
+    init_flags.ai_match = 0;
+    init_flags.headless = 0;
     memset(init_flags.rec_file, 0, 255);
+    memset(init_flags.train_file, 0, 255);
+    memset(init_flags.frame_dir, 0, 255);
+    memset(init_flags.export_file, 0, 255);
+    memset(init_flags.export_audio_file, 0, 255);
     int ret = 0;
+    int bake = 0;
+    int merge_argc = 0;
+    char **merge_argv = NULL;
 
     // Path manager
     if(pm_init() != 0) {
@@ -57,6 +69,20 @@ int main(int argc, char *argv[]) {
             printf("-c [ip] [port]  Connect to server\n");
             printf("-l [port]       Start server\n");
             printf("play [FILE.REC] Play recording file, defaults to LAST.REC\n");
+            printf("train [TICKS] [FILE]\n");
+            printf("                Train AI by self-play, defaults to 1000000 ticks.\n");
+            printf("                Results are saved to FILE, or to AISTATS.DAT\n");
+            printf("train --merge OUT FILE...\n");
+            printf("                Merge the results of parallel training runs into OUT\n");
+            printf("frames [FILE.REC] [DIR]\n");
+            printf("                Play recording without a window, saving every frame to DIR\n");
+            printf("bake            Decode the sprites of all BK and AF files into BAKED.DAT,\n");
+            printf("                which is then used instead of decoding them on every load\n");
+            printf("--export-video [OUT] [FILE.REC] [AUDIO.WAV]\n");
+            printf("                Play recording without a window, as fast as possible, and\n");
+            printf("                save it as video. OUT ending in .y4m or - (stdout) is written\n");
+            printf("                as YUV4MPEG2, anything else as raw 320x200 RGBA frames.\n");
+            printf("                Audio goes to AUDIO.WAV, defaults to OUT with .wav extension\n");
             goto exit_0;
         } else if(strcmp(argv[1], "-c") == 0) {
             if(argc >= 3) {
@@ -82,12 +108,69 @@ int main(int argc, char *argv[]) {
                 printf("playing recording LAST.REC\n");
                 snprintf(init_flags.rec_file, 254, "LAST.REC");
             }
+        } else if(strcmp(argv[1], "train") == 0 && argc > 3 && strcmp(argv[2], "--merge") == 0) {
+            merge_argc = argc - 3;
+            merge_argv = argv + 3;
+        } else if(strcmp(argv[1], "train") == 0) {
+            init_flags.headless = 1;
+            init_flags.train_ticks = 1000000;
+            if(argc > 2 && atoi(argv[2]) > 0) {
+                init_flags.train_ticks = atoi(argv[2]);
+            }
+            if(argc > 3) {
+                strncpy(init_flags.train_file, argv[3], 254);
+            }
+            printf("training AI for %u ticks\n", init_flags.train_ticks);
+        } else if(strcmp(argv[1], "frames") == 0) {
+            init_flags.headless = 1;
+            if(argc > 2) {
+                strncpy(init_flags.rec_file, argv[2], 254);
+            } else {
+                snprintf(init_flags.rec_file, 254, "LAST.REC");
+            }
+            if(argc > 3) {
+                strncpy(init_flags.frame_dir, argv[3], 254);
+            } else {
+                snprintf(init_flags.frame_dir, 254, ".");
+            }
+            printf("rendering recording %s to %s\n", init_flags.rec_file, init_flags.frame_dir);
+        } else if(strcmp(argv[1], "bake") == 0) {
+            bake = 1;
+        } else if(strcmp(argv[1], "--export-video") == 0 && argc > 2) {
+            init_flags.headless = 1;
+            strncpy(init_flags.export_file, argv[2], 254);
+            if(argc > 3) {
+                strncpy(init_flags.rec_file, argv[3], 254);
+            } else {
+                snprintf(init_flags.rec_file, 254, "LAST.REC");
+            }
+            if(argc > 4) {
+                strncpy(init_flags.export_audio_file, argv[4], 254);
+            } else if(strcmp(argv[2], "-") == 0) {
+                snprintf(init_flags.export_audio_file, 254, "export.wav");
+            } else {
+                // Swap the extension for .wav
+                strncpy(init_flags.export_audio_file, argv[2], 250);
+                char *ext = strrchr(init_flags.export_audio_file, '.');
+                if(ext != NULL && strchr(ext, '/') == NULL && strchr(ext, '\\') == NULL) {
+                    *ext = 0;
+                }
+                strcat(init_flags.export_audio_file, ".wav");
+            }
+            // Video may be going to stdout, so keep quiet there
+            fprintf(stderr, "exporting recording %s to %s and %s\n",
+                    init_flags.rec_file, init_flags.export_file, init_flags.export_audio_file);
         }
     }
 
     // Init log
 #if defined(DEBUGMODE) || defined(STANDALONE_SERVER)
-    if(log_init(0)) {
+    // Log goes to stdout, unless exported video is going there
+    const char *log_file = 0;
+    if(strcmp(init_flags.export_file, "-") == 0) {
+        log_file = pm_get_local_path(LOG_PATH);
+    }
+    if(log_init(log_file)) {
         err_msgbox("Error while initializing log!");
         printf("Error while initializing log!\n");
         goto exit_0;
@@ -109,6 +192,29 @@ int main(int argc, char *argv[]) {
     // Dump pathmanager log
     pm_log();
 
+    // Bake resources and quit
+    if(bake) {
+        ret = baked_write(pm_get_local_path(BAKE_PATH));
+        printf("%s\n", ret ? "Baking failed; see the log." : "Baked resources.");
+        goto exit_1;
+    }
+
+    // Merge training results and quit. The first file is the output, and is
+    // merged in too if it already exists.
+    if(merge_argc > 0) {
+        ai_controller_reset_stats();
+        ai_controller_merge_stats(merge_argv[0]);
+        for(int i = 1; i < merge_argc; i++) {
+            if(ai_controller_merge_stats(merge_argv[i])) {
+                PERROR("Unable to merge AI stats file '%s'.", merge_argv[i]);
+                goto exit_1;
+            }
+        }
+        ret = ai_controller_save_stats(merge_argv[0]);
+        printf("%s\n", ret ? "Merging failed; see the log." : "Merged AI stats.");
+        goto exit_1;
+    }
+
     // Random seed
     rand_seed(time(NULL));
 
@@ -141,7 +247,10 @@ int main(int argc, char *argv[]) {
         settings_get()->net.net_listen_port = listen_port;
     }
 
-    // Init SDL2
+    // Init SDL2. Headless runs must not need a display.
+    if(init_flags.headless) {
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    }
     unsigned int sdl_flags = SDL_INIT_TIMER;
 #ifndef STANDALONE_SERVER
     sdl_flags |= SDL_INIT_VIDEO;
@@ -212,7 +321,7 @@ int main(int argc, char *argv[]) {
     }
 
     // Initialize engine
-    if(engine_init()) {
+    if(engine_init(&init_flags)) {
         err_msgbox("Failed to initialize game engine.");
         goto exit_4;
     }
@@ -1,4 +1,5 @@
 #include <SDL2/SDL_loadso.h>
+#include <SDL2/SDL_mutex.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -11,8 +12,17 @@
 #define PLUGIN_MAX_COUNT 128
 static base_plugin _plugins[PLUGIN_MAX_COUNT];
 static int _plugins_count;
+static int _plugins_scanned;
+static SDL_mutex *_plugins_lock = NULL;
 
+// Opening every plugin is slow, so the plugin directory is only scanned
+// when a plugin is first asked for.
 void plugins_init() {
+    _plugins_scanned = 0;
+    _plugins_lock = SDL_CreateMutex();
+}
+
+static void plugins_scan() {
     // Zero out plugin list
     _plugins_count = 0;
     for(int i = 0; i < PLUGIN_MAX_COUNT; i++) {
@@ -112,7 +122,17 @@ void plugins_init() {
     INFO("%d plugins found.", _plugins_count);
 }
 
+static void plugins_load() {
+    SDL_LockMutex(_plugins_lock);
+    if(!_plugins_scanned) {
+        plugins_scan();
+        _plugins_scanned = 1;
+    }
+    SDL_UnlockMutex(_plugins_lock);
+}
+
 int plugins_get_scaler(scaler_plugin *scaler, const char* name) {
+    plugins_load();
     // Search for a scaler with given name
     for(int i = 0; i < PLUGIN_MAX_COUNT; i++) {
         if(_plugins[i].handle != NULL
@@ -133,6 +153,7 @@ int plugins_get_scaler(scaler_plugin *scaler, const char* name) {
 int plugins_get_list_by_type(list *tlist, const char* type) {
     // Search for a scaler with given type
     int count = 0;
+    plugins_load();
     for(int i = 0; i < PLUGIN_MAX_COUNT; i++) {
         if(_plugins[i].handle != NULL
            && strcmp(_plugins[i].get_type(), type) == 0)
@@ -152,4 +173,9 @@ void plugins_close() {
             _plugins[i].handle = NULL;
         }
     }
+    _plugins_scanned = 0;
+    if(_plugins_lock != NULL) {
+        SDL_DestroyMutex(_plugins_lock);
+        _plugins_lock = NULL;
+    }
 }
@@ -1,8 +1,9 @@
 #include <string.h>
 #include <shadowdive/shadowdive.h>
 #include "resources/af.h"
+#include "utils/memtrack.h"
 
-void af_create(af *a, void *src) {
+void af_create(af *a, void *src, const baked_file *baked) {
     sd_af_file *sdaf = (sd_af_file*)src;
 
     // Trivial stuff
@@ -23,14 +24,19 @@ void af_create(af *a, void *src) {
     a->sound_translation_table[26] = 0;
     a->sound_translation_table[27] = 0;
 
-    // Moves
+    // Moves. Identical sprites are shared between moves.
+    sprite_store store;
+    sprite_store_create(&store, MEM_AF_SPRITES);
+    store.baked = baked;
     for(int i = 0; i < 70; i++) {
         if(sdaf->moves[i] != NULL) {
-            af_move_create(&a->moves[i], (void*)sdaf->moves[i], i);
+            af_move_create(&a->moves[i], (void*)sdaf->moves[i], i, &store);
         } else {
             a->moves[i].id = -1;
         }
     }
+    sprite_store_report(&store, "AF", a->id);
+    sprite_store_free(&store);
 }
 
 af_move* af_get_move(af *a, int id) {
@@ -1,8 +1,10 @@
 #include "resources/af_loader.h"
 #include "resources/pathmanager.h"
+#include "resources/prefetch.h"
+#include "resources/baked.h"
 #include <shadowdive/shadowdive.h>
 
-int load_af_file(af *a, int id) {
+int load_af_file_sync(af *a, int id) {
     // Get directory + filename
     const char *filename = pm_get_resource_path(id);
 
@@ -17,7 +19,15 @@ int load_af_file(af *a, int id) {
     }
 
     // Convert
-    af_create(a, &tmp);
+    af_create(a, &tmp, baked_find(id));
     sd_af_free(&tmp);
     return 0;
 }
+
+int load_af_file(af *a, int id) {
+    // Pick up the result from the prefetch thread, if the file was queued there
+    if(prefetch_get_af(a, id) == 0) {
+        return 0;
+    }
+    return load_af_file_sync(a, id);
+}
@@ -2,7 +2,7 @@
 #include <shadowdive/shadowdive.h>
 #include "resources/af_move.h"
 
-void af_move_create(af_move *move, void *src, int id) {
+void af_move_create(af_move *move, void *src, int id, sprite_store *store) {
     sd_move *sdmv = (sd_move*)src;
     str_create_from_cstr(&move->move_string, sdmv->move_string);
     str_create_from_cstr(&move->footer_string, sdmv->footer_string);
@@ -14,7 +14,7 @@ void af_move_create(af_move *move, void *src, int id) {
     move->points = sdmv->points * 400;
     move->scrap_amount = sdmv->scrap_amount;
     move->pos_constraints = sdmv->unknown_2;
-    animation_create(&move->ani, sdmv->animation, id);
+    animation_create(&move->ani, sdmv->animation, id, store);
 }
 
 void af_move_free(af_move *move) {
@@ -2,7 +2,7 @@
 #include <shadowdive/shadowdive.h>
 #include <stdlib.h>
 
-void animation_create(animation *ani, void *src, int id) {
+void animation_create(animation *ani, void *src, int id, sprite_store *store) {
     sd_animation *sdani = (sd_animation*)src;
 
     // Copy simple stuff
@@ -31,10 +31,13 @@ void animation_create(animation *ani, void *src, int id) {
     }
 
     // Handle sprites
+    if(store != NULL) {
+        store->anim_id = id;
+    }
     vector_create(&ani->sprites, sizeof(sprite));
     sprite tmp_sprite;
     for(int i = 0; i < sdani->sprite_count; i++) {
-        sprite_create(&tmp_sprite, (void*)sdani->sprites[i], i);
+        sprite_create(&tmp_sprite, (void*)sdani->sprites[i], i, store);
         vector_append(&ani->sprites, &tmp_sprite);
     }
 }
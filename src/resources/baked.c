@@ -0,0 +1,476 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <shadowdive/shadowdive.h>
+#include <sys/stat.h>
+#if !defined(_WIN32) && !defined(WIN32)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "resources/baked.h"
+#include "resources/sprite_store.h"
+#include "resources/pathmanager.h"
+#include "resources/ids.h"
+#include "utils/vector.h"
+#include "utils/hashmap.h"
+#include "utils/memtrack.h"
+#include "utils/log.h"
+
+static const char baked_magic[8] = {'O', 'M', 'F', 'B', 'A', 'K', 'E', 'D'};
+
+static unsigned char *archive = NULL;
+static size_t archive_size = 0;
+static int archive_mapped = 0;
+
+// Filled in when the archive is opened
+static unsigned char *file_stale = NULL;   // Per file; 1 if the original has changed since baking
+static unsigned char *sprite_checks = NULL; // Per sprite table entry; see below
+static size_t sprites_start = 0;
+static size_t sprites_end = 0;
+
+enum {
+    SPRITE_UNCHECKED = 0,
+    SPRITE_VALID,
+    SPRITE_INVALID
+};
+
+// Size and modification time of the original file. Returns 1 if it can't be read.
+static int baked_source_info(int resource_id, uint32_t *size, uint32_t *mtime) {
+    struct stat st;
+    if(stat(pm_get_resource_path(resource_id), &st) != 0) {
+        return 1;
+    }
+    *size = st.st_size;
+    *mtime = st.st_mtime;
+    return 0;
+}
+
+static void baked_unmap() {
+    if(archive == NULL) {
+        return;
+    }
+#if defined(_WIN32) || defined(WIN32)
+    free(archive);
+#else
+    if(archive_mapped) {
+        munmap(archive, archive_size);
+    } else {
+        free(archive);
+    }
+#endif
+    archive = NULL;
+    archive_size = 0;
+    archive_mapped = 0;
+    free(file_stale);
+    free(sprite_checks);
+    file_stale = NULL;
+    sprite_checks = NULL;
+    sprites_start = 0;
+    sprites_end = 0;
+}
+
+static int baked_map(const char *filename) {
+#if defined(_WIN32) || defined(WIN32)
+    FILE *f = fopen(filename, "rb");
+    if(f == NULL) {
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if(size <= 0) {
+        fclose(f);
+        return 1;
+    }
+    archive = malloc(size);
+    if(fread(archive, 1, size, f) != (size_t)size) {
+        free(archive);
+        archive = NULL;
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+    archive_size = size;
+    archive_mapped = 0;
+#else
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+        return 1;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return 1;
+    }
+    void *ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(ptr == MAP_FAILED) {
+        return 1;
+    }
+    archive = ptr;
+    archive_size = st.st_size;
+    archive_mapped = 1;
+#endif
+    return 0;
+}
+
+// Checks that the tables are within the archive. Sprite data is checked by
+// baked_check_sprite when it is first used.
+static int baked_validate() {
+    const baked_header *header = (const baked_header*)archive;
+    if(archive_size < sizeof(baked_header) || memcmp(header->magic, baked_magic, 8) != 0) {
+        PERROR("Baked archive is not valid.");
+        return 1;
+    }
+    if(header->version != BAKED_VERSION) {
+        INFO("Baked archive is version %u, expected %u; ignoring it.", header->version, BAKED_VERSION);
+        return 1;
+    }
+    uint64_t tables_end = sizeof(baked_header) + (uint64_t)header->file_count * sizeof(baked_file);
+    if(tables_end > archive_size) {
+        PERROR("Baked archive is truncated.");
+        return 1;
+    }
+    const baked_file *files = (const baked_file*)(archive + sizeof(baked_header));
+    sprites_start = tables_end;
+    sprites_end = tables_end;
+    for(unsigned int i = 0; i < header->file_count; i++) {
+        const baked_file *file = &files[i];
+        uint64_t end = file->sprites_offset + (uint64_t)file->sprite_count * sizeof(baked_sprite);
+        if(file->sprites_offset < tables_end || (file->sprites_offset - tables_end) % sizeof(baked_sprite) != 0
+            || end > archive_size) {
+            PERROR("Baked archive is truncated.");
+            return 1;
+        }
+        if(end > sprites_end) {
+            sprites_end = end;
+        }
+    }
+    return 0;
+}
+
+// Compares the original files against what was baked. This is done only once,
+// so loading a file does not need to look at the original again.
+static int baked_check_sources() {
+    const baked_header *header = (const baked_header*)archive;
+    const baked_file *files = (const baked_file*)(archive + sizeof(baked_header));
+    file_stale = calloc(header->file_count + 1, 1);
+    sprite_checks = calloc((sprites_end - sprites_start) / sizeof(baked_sprite) + 1, 1);
+    if(file_stale == NULL || sprite_checks == NULL) {
+        return 1;
+    }
+    for(unsigned int i = 0; i < header->file_count; i++) {
+        uint32_t size, mtime;
+        if(baked_source_info(files[i].resource_id, &size, &mtime)
+            || size != files[i].source_size || mtime != files[i].source_mtime) {
+            INFO("Baked sprites of %s are out of date; the original file will be decoded.",
+                 get_resource_name(files[i].resource_id));
+            file_stale[i] = 1;
+        }
+    }
+    return 0;
+}
+
+/** \brief Maps the baked archive. Resources are loaded from the original files if this fails.
+  * \param filename Archive file
+  * \return 0 if the archive is in use, 1 otherwise
+  */
+int baked_open(const char *filename) {
+    baked_close();
+    if(baked_map(filename)) {
+        DEBUG("No baked archive at '%s'.", filename);
+        return 1;
+    }
+    if(baked_validate() || baked_check_sources()) {
+        baked_unmap();
+        return 1;
+    }
+    INFO("Using baked sprites from '%s'.", filename);
+    return 0;
+}
+
+void baked_close() {
+    baked_unmap();
+}
+
+/** \brief Finds the baked data of a BK or AF file.
+  * \param resource_id Resource ID of the file
+  * \return Baked file, or NULL if the file is not baked or the original has changed since
+  */
+const baked_file* baked_find(int resource_id) {
+    if(archive == NULL) {
+        return NULL;
+    }
+    const baked_header *header = (const baked_header*)archive;
+    const baked_file *files = (const baked_file*)(archive + sizeof(baked_header));
+    for(unsigned int i = 0; i < header->file_count; i++) {
+        if(files[i].resource_id == (uint32_t)resource_id) {
+            return file_stale[i] ? NULL : &files[i];
+        }
+    }
+    return NULL;
+}
+
+const baked_sprite* baked_find_sprite(const baked_file *file, int anim_id, int sprite_id) {
+    const baked_sprite *sprites = (const baked_sprite*)(archive + file->sprites_offset);
+    uint32_t key = ((uint32_t)anim_id << 16) | (uint32_t)sprite_id;
+    int lo = 0;
+    int hi = (int)file->sprite_count - 1;
+    while(lo <= hi) {
+        int mid = (lo + hi) / 2;
+        uint32_t mid_key = ((uint32_t)sprites[mid].anim_id << 16) | sprites[mid].sprite_id;
+        if(mid_key == key) {
+            return &sprites[mid];
+        }
+        if(mid_key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+const unsigned char* baked_sprite_data(const baked_sprite *sprite) {
+    return archive + sprite->data_offset;
+}
+
+/** \brief Checks that the pixel data of a sprite is within the archive and valid
+  * for its size. The result is remembered, so each sprite is checked only once.
+  * \param sprite Sprite from baked_find_sprite
+  * \return 0 if the data can be used, 1 otherwise
+  */
+int baked_check_sprite(const baked_sprite *sprite) {
+    size_t index = ((const unsigned char*)sprite - archive - sprites_start) / sizeof(baked_sprite);
+    if(sprite_checks[index] == SPRITE_UNCHECKED) {
+        sprite_checks[index] = SPRITE_VALID;
+        if(sprite->data_offset + (uint64_t)sprite->data_size > archive_size
+            || sprite_pixels_check(archive + sprite->data_offset, sprite->data_size, sprite->w, sprite->h)) {
+            PERROR("Baked sprite %u of animation %u is corrupted; decoding the original.",
+                   sprite->sprite_id, sprite->anim_id);
+            sprite_checks[index] = SPRITE_INVALID;
+        }
+    }
+    return (sprite_checks[index] == SPRITE_INVALID);
+}
+
+typedef struct baked_writer_t {
+    sprite_store store;
+    vector packed;   // sprite_pixels* to release when done
+    hashmap offsets; // sprite_pixels* -> offset in the pixel data
+    vector files;    // baked_file
+    vector sprites;  // baked_sprite
+    unsigned char *data;
+    size_t data_len;
+    size_t data_cap;
+} baked_writer;
+
+static int baked_add_data(baked_writer *w, const unsigned char *src, size_t len) {
+    if(w->data_len + len > w->data_cap) {
+        size_t cap = w->data_cap > 0 ? w->data_cap : 65536;
+        while(w->data_len + len > cap) {
+            cap *= 2;
+        }
+        unsigned char *data = realloc(w->data, cap);
+        if(data == NULL) {
+            return 1;
+        }
+        w->data = data;
+        w->data_cap = cap;
+    }
+    memcpy(w->data + w->data_len, src, len);
+    w->data_len += len;
+    return 0;
+}
+
+static int baked_add_animation(baked_writer *w, const sd_animation *ani, int anim_id) {
+    for(int i = 0; i < ani->sprite_count; i++) {
+        sd_vga_image raw;
+        if(sd_sprite_vga_decode(&raw, ani->sprites[i]) != SD_SUCCESS) {
+            return 1;
+        }
+        sprite_pixels *px = sprite_store_pack(&w->store, raw.data, raw.stencil, raw.w, raw.h);
+        sd_vga_image_free(&raw);
+        if(px == NULL) {
+            return 1;
+        }
+        vector_append(&w->packed, &px);
+
+        // Identical sprites are written only once
+        uint32_t *found;
+        unsigned int found_len;
+        uint32_t offset;
+        if(hashmap_get(&w->offsets, &px, sizeof(px), (void**)&found, &found_len) == 0) {
+            offset = *found;
+        } else {
+            offset = w->data_len;
+            if(baked_add_data(w, px->data, px->size)) {
+                return 1;
+            }
+            hashmap_put(&w->offsets, &px, sizeof(px), &offset, sizeof(offset));
+        }
+
+        baked_sprite bs;
+        bs.anim_id = anim_id;
+        bs.sprite_id = i;
+        bs.w = px->w;
+        bs.h = px->h;
+        bs.data_offset = offset; // Fixed up when written
+        bs.data_size = px->size;
+        vector_append(&w->sprites, &bs);
+    }
+    return 0;
+}
+
+static int baked_add_file(baked_writer *w, int resource_id) {
+    const char *filename = pm_get_resource_path(resource_id);
+    baked_file file;
+    file.resource_id = resource_id;
+    if(baked_source_info(resource_id, &file.source_size, &file.source_mtime)) {
+        PERROR("Unable to read '%s'!", filename);
+        return 1;
+    }
+    file.sprites_offset = vector_size(&w->sprites); // Fixed up when written
+    int ret = 0;
+
+    if(is_scene(resource_id)) {
+        sd_bk_file bk;
+        if(sd_bk_create(&bk) != SD_SUCCESS) {
+            return 1;
+        }
+        if(sd_bk_load(&bk, filename) != SD_SUCCESS) {
+            PERROR("Unable to load BK file '%s'!", filename);
+            sd_bk_free(&bk);
+            return 1;
+        }
+        for(int i = 0; i < 50 && ret == 0; i++) {
+            if(bk.anims[i] != NULL) {
+                ret = baked_add_animation(w, bk.anims[i]->animation, i);
+            }
+        }
+        sd_bk_free(&bk);
+    } else {
+        sd_af_file af;
+        if(sd_af_create(&af) != SD_SUCCESS) {
+            return 1;
+        }
+        if(sd_af_load(&af, filename) != SD_SUCCESS) {
+            PERROR("Unable to load AF file '%s'!", filename);
+            sd_af_free(&af);
+            return 1;
+        }
+        for(int i = 0; i < 70 && ret == 0; i++) {
+            if(af.moves[i] != NULL) {
+                ret = baked_add_animation(w, af.moves[i]->animation, i);
+            }
+        }
+        sd_af_free(&af);
+    }
+
+    file.sprite_count = vector_size(&w->sprites) - file.sprites_offset;
+    vector_append(&w->files, &file);
+    return ret;
+}
+
+static int baked_save(baked_writer *w, const char *filename) {
+    baked_header header;
+    memcpy(header.magic, baked_magic, 8);
+    header.version = BAKED_VERSION;
+    header.file_count = vector_size(&w->files);
+
+    // Turn table indexes and data offsets into offsets from the start of the archive
+    size_t tables_start = sizeof(baked_header) + header.file_count * sizeof(baked_file);
+    size_t data_start = tables_start + vector_size(&w->sprites) * sizeof(baked_sprite);
+    iterator it;
+    baked_file *file;
+    vector_iter_begin(&w->files, &it);
+    while((file = iter_next(&it)) != NULL) {
+        file->sprites_offset = tables_start + file->sprites_offset * sizeof(baked_sprite);
+    }
+    baked_sprite *bs;
+    vector_iter_begin(&w->sprites, &it);
+    while((bs = iter_next(&it)) != NULL) {
+        bs->data_offset += data_start;
+    }
+
+    char *tmp_path = malloc(strlen(filename) + 5);
+    sprintf(tmp_path, "%s.tmp", filename);
+    FILE *f = fopen(tmp_path, "wb");
+    if(f == NULL) {
+        PERROR("Could not open %s for writing!", tmp_path);
+        free(tmp_path);
+        return 1;
+    }
+    int ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+    vector_iter_begin(&w->files, &it);
+    while(ok && (file = iter_next(&it)) != NULL) {
+        ok = (fwrite(file, sizeof(baked_file), 1, f) == 1);
+    }
+    vector_iter_begin(&w->sprites, &it);
+    while(ok && (bs = iter_next(&it)) != NULL) {
+        ok = (fwrite(bs, sizeof(baked_sprite), 1, f) == 1);
+    }
+    if(ok && w->data_len > 0) {
+        ok = (fwrite(w->data, w->data_len, 1, f) == 1);
+    }
+    fclose(f);
+    if(!ok) {
+        PERROR("Writing baked archive to %s failed!", tmp_path);
+        remove(tmp_path);
+        free(tmp_path);
+        return 1;
+    }
+#if defined(_WIN32) || defined(WIN32)
+    remove(filename);
+#endif
+    if(rename(tmp_path, filename) != 0) {
+        PERROR("Could not move baked archive to %s!", filename);
+        free(tmp_path);
+        return 1;
+    }
+    free(tmp_path);
+    INFO("Baked %u sprites, %u kB of pixels, into '%s'.",
+         vector_size(&w->sprites), (unsigned int)(w->data_len / 1024), filename);
+    return 0;
+}
+
+/** \brief Decodes the sprites of every BK and AF file, and writes them into a baked archive.
+  * \param filename Archive file to write
+  * \return 0 on success, 1 on failure
+  */
+int baked_write(const char *filename) {
+    baked_writer w;
+    int ret = 0;
+    sprite_store_create(&w.store, MEM_SURFACES);
+    vector_create(&w.packed, sizeof(sprite_pixels*));
+    hashmap_create(&w.offsets, 10);
+    vector_create(&w.files, sizeof(baked_file));
+    vector_create(&w.sprites, sizeof(baked_sprite));
+    w.data = NULL;
+    w.data_len = 0;
+    w.data_cap = 0;
+
+    for(int i = 0; i < NUMBER_OF_RESOURCES && ret == 0; i++) {
+        if(is_scene(i) || is_har(i)) {
+            ret = baked_add_file(&w, i);
+        }
+    }
+    if(ret == 0) {
+        ret = baked_save(&w, filename);
+    }
+
+    iterator it;
+    sprite_pixels **px;
+    vector_iter_begin(&w.packed, &it);
+    while((px = iter_next(&it)) != NULL) {
+        sprite_pixels_release(*px);
+    }
+    sprite_store_free(&w.store);
+    vector_free(&w.packed);
+    hashmap_free(&w.offsets);
+    vector_free(&w.files);
+    vector_free(&w.sprites);
+    free(w.data);
+    return ret;
+}
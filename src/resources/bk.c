@@ -2,8 +2,9 @@
 #include <stdlib.h>
 #include <shadowdive/shadowdive.h>
 #include "resources/bk.h"
+#include "utils/memtrack.h"
 
-void bk_create(bk *b, void *src) {
+void bk_create(bk *b, void *src, const baked_file *baked) {
     sd_bk_file *sdbk = (sd_bk_file*)src;
 
     // File ID
@@ -26,15 +27,20 @@ void bk_create(bk *b, void *src) {
         vector_append(&b->palettes, (palette*)sdbk->palettes[i]);
     }
 
-    // Copy info structs
+    // Copy info structs. Identical sprites are shared between animations.
+    sprite_store store;
+    sprite_store_create(&store, MEM_BK_SPRITES);
+    store.baked = baked;
     hashmap_create(&b->infos, 7);
     bk_info tmp_bk_info;
     for(int i = 0; i < 50; i++) {
         if(sdbk->anims[i] != NULL) {
-            bk_info_create(&tmp_bk_info, (void*)sdbk->anims[i], i);
+            bk_info_create(&tmp_bk_info, (void*)sdbk->anims[i], i, &store);
             hashmap_iput(&b->infos, i, &tmp_bk_info, sizeof(bk_info));
         }
     }
+    sprite_store_report(&store, "BK", b->file_id);
+    sprite_store_free(&store);
 }
 
 bk_info* bk_get_info(bk *b, int id) {
@@ -1,9 +1,9 @@
 #include "resources/bk_info.h"
 #include <shadowdive/shadowdive.h>
 
-void bk_info_create(bk_info *info, void *src, int id) {
+void bk_info_create(bk_info *info, void *src, int id, sprite_store *store) {
     sd_bk_anim *sdinfo = (sd_bk_anim*)src;
-    animation_create(&info->ani, sdinfo->animation, id);
+    animation_create(&info->ani, sdinfo->animation, id, store);
     info->chain_hit = sdinfo->chain_hit;
     info->chain_no_hit = sdinfo->chain_no_hit;
     info->load_on_start = sdinfo->load_on_start;
@@ -1,8 +1,10 @@
 #include "resources/bk_loader.h"
 #include "resources/pathmanager.h"
+#include "resources/prefetch.h"
+#include "resources/baked.h"
 #include <shadowdive/shadowdive.h>
 
-int load_bk_file(bk *b, int id) {
+int load_bk_file_sync(bk *b, int id) {
     // Get directory + filename
     const char *filename = pm_get_resource_path(id);
 
@@ -17,7 +19,15 @@ int load_bk_file(bk *b, int id) {
     }
 
     // Convert
-    bk_create(b, &tmp);
+    bk_create(b, &tmp, baked_find(id));
     sd_bk_free(&tmp);
     return 0;
 }
+
+int load_bk_file(bk *b, int id) {
+    // Pick up the result from the prefetch thread, if the file was queued there
+    if(prefetch_get_bk(b, id) == 0) {
+        return 0;
+    }
+    return load_bk_file_sync(b, id);
+}
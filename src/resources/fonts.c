@@ -1,6 +1,7 @@
 #include <shadowdive/shadowdive.h>
 
 #include "utils/log.h"
+#include "utils/task.h"
 #include "utils/vector.h"
 #include "video/surface.h"
 #include "resources/ids.h"
@@ -70,36 +71,47 @@ int font_load(font *font, const char* filename, unsigned int size) {
     return 0;
 }
 
+static int fonts_load_small(void *userdata) {
+    const char *filename = pm_get_resource_path(DAT_CHARSMAL);
+    if(font_load(&font_small, filename, FONT_SMALL)) {
+        PERROR("Unable to load font file '%s'!", filename);
+        return 1;
+    }
+    INFO("Loaded font file '%s'", filename);
+    return 0;
+}
+
 int fonts_init() {
     font_create(&font_small);
     font_create(&font_large);
     const char *filename = NULL;
+    int ret = 0;
 
-    // Load small font
-    filename = pm_get_resource_path(DAT_CHARSMAL);
-    if(font_load(&font_small, filename, FONT_SMALL)) {
-        PERROR("Unable to load font file '%s'!", filename);
-        goto error_2;
-    }
-    INFO("Loaded font file '%s'", filename);
+    // Load small font on another thread while the big one is loaded here
+    task small_task;
+    task_start(&small_task, "small font", fonts_load_small, NULL);
 
     // Load big font
     filename = pm_get_resource_path(DAT_GRAPHCHR);
     if(font_load(&font_large, filename, FONT_BIG)) {
         PERROR("Unable to load font file '%s'!", filename);
-        goto error_1;
+        ret = 1;
+    } else {
+        INFO("Loaded font file '%s'", filename);
+    }
+    if(task_wait(&small_task)) {
+        ret = 1;
+    }
+    task_free(&small_task);
+    if(ret) {
+        font_free(&font_small);
+        font_free(&font_large);
+        return 1;
     }
-    INFO("Loaded font file '%s'", filename);
 
     // All done.
     fonts_loaded = 1;
     return 0;
-
-error_2:
-    font_free(&font_small);
-error_1:
-    font_free(&font_large);
-    return 1;
 }
 
 void fonts_close() {
@@ -3,11 +3,13 @@
 #include "resources/pathmanager.h"
 #include "utils/array.h"
 #include "utils/log.h"
+#include "utils/task.h"
 
 array language_strings;
 sd_language *language;
+static task load_task;
 
-int lang_init() {
+static int lang_load(void *userdata) {
     // Get filename
     const char *filename = pm_get_resource_path(DAT_ENGLISH);
 
@@ -22,7 +24,6 @@ int lang_init() {
     }
 
     // Load language strings
-    array_create(&language_strings);
     for(int i = 0; i < language->count; i++) {
         array_set(&language_strings, i, language->strings[i].data);
     }
@@ -34,16 +35,30 @@ error_1:
     sd_language_free(language);
 error_0:
     free(language);
+    language = NULL;
     return 1;
 }
 
+// The language file is read in the background, and the first string asked for waits for it.
+int lang_init() {
+    array_create(&language_strings);
+    task_start(&load_task, "language", lang_load, NULL);
+    return 0;
+}
+
 void lang_close() {
+    task_free(&load_task);
     array_free(&language_strings);
-    sd_language_free(language);
-    free(language);
-    language = NULL;
+    if(language != NULL) {
+        sd_language_free(language);
+        free(language);
+        language = NULL;
+    }
 }
 
 const char* lang_get(unsigned int id) {
+    if(task_wait(&load_task)) {
+        return "";
+    }
     return (const char*)array_get(&language_strings, id);
 }
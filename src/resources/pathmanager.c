@@ -18,6 +18,8 @@ static const char* logfile_name = "openomf.log";
 static const char* configfile_name = "openomf.conf";
 static const char* scorefile_name = "SCORES.DAT";
 static const char* savegamedir_name = "save/";
+static const char* aistatsfile_name = "AISTATS.DAT";
+static const char* bakefile_name = "BAKED.DAT";
 static char errormessage[128];
 
 // Lists
@@ -66,6 +68,8 @@ int pm_init() {
     local_path_build(CONFIG_PATH, local_base_dir, configfile_name);
     local_path_build(SCORE_PATH, local_base_dir, scorefile_name);
     local_path_build(SAVE_PATH, local_base_dir, savegamedir_name);
+    local_path_build(AI_STATS_PATH, local_base_dir, aistatsfile_name);
+    local_path_build(BAKE_PATH, local_base_dir, bakefile_name);
 
     // Set default base dirs for resources and plugins
     int m_ok = 0;
@@ -231,6 +235,8 @@ const char* pm_get_local_path_type_name(unsigned int path_id) {
         case LOG_PATH: return "LOG_PATH";
         case SCORE_PATH: return "SCORE_PATH";
         case SAVE_PATH: return "SAVE_PATH";
+        case AI_STATS_PATH: return "AI_STATS_PATH";
+        case BAKE_PATH: return "BAKE_PATH";
     }
     return "UNKNOWN";
 }
@@ -0,0 +1,281 @@
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "resources/prefetch.h"
+#include "resources/bk_loader.h"
+#include "resources/af_loader.h"
+#include "utils/log.h"
+
+// Background loader for BK and AF files. Scene changes queue the files of the next
+// scene here, and the loader thread decodes them while the crossfade is running.
+
+#define PREFETCH_SLOTS 4
+
+enum {
+    PREFETCH_FREE = 0,
+    PREFETCH_QUEUED,
+    PREFETCH_LOADING,
+    PREFETCH_DONE,
+    PREFETCH_FAILED
+};
+
+enum {
+    PREFETCH_TYPE_BK,
+    PREFETCH_TYPE_AF
+};
+
+typedef struct prefetch_slot_t {
+    int state;
+    int type;
+    int resource_id;
+    int discard; // Result is not wanted anymore; free it when done
+    union {
+        bk bk_data;
+        af *af_data;
+    };
+} prefetch_slot;
+
+static prefetch_slot slots[PREFETCH_SLOTS];
+static SDL_Thread *thread = NULL;
+static SDL_mutex *lock = NULL;
+static SDL_cond *cond = NULL;
+static int running = 0;
+
+static void prefetch_slot_free(prefetch_slot *slot) {
+    if(slot->state == PREFETCH_DONE) {
+        if(slot->type == PREFETCH_TYPE_BK) {
+            bk_free(&slot->bk_data);
+        } else {
+            af_free(slot->af_data);
+            free(slot->af_data);
+        }
+    }
+    slot->state = PREFETCH_FREE;
+    slot->discard = 0;
+}
+
+static int prefetch_run(void *data) {
+    SDL_LockMutex(lock);
+    while(running) {
+        // Find next queued job
+        prefetch_slot *slot = NULL;
+        for(int i = 0; i < PREFETCH_SLOTS; i++) {
+            if(slots[i].state == PREFETCH_QUEUED) {
+                slot = &slots[i];
+                break;
+            }
+        }
+        if(slot == NULL) {
+            SDL_CondWait(cond, lock);
+            continue;
+        }
+
+        // Decode without holding the lock
+        slot->state = PREFETCH_LOADING;
+        int type = slot->type;
+        int resource_id = slot->resource_id;
+        SDL_UnlockMutex(lock);
+
+        int ret;
+        bk tmp_bk;
+        af *tmp_af = NULL;
+        if(type == PREFETCH_TYPE_BK) {
+            ret = load_bk_file_sync(&tmp_bk, resource_id);
+        } else {
+            tmp_af = malloc(sizeof(af));
+            ret = load_af_file_sync(tmp_af, resource_id);
+            if(ret) {
+                free(tmp_af);
+            }
+        }
+
+        SDL_LockMutex(lock);
+        if(ret) {
+            slot->state = PREFETCH_FAILED;
+        } else {
+            slot->state = PREFETCH_DONE;
+            if(type == PREFETCH_TYPE_BK) {
+                slot->bk_data = tmp_bk;
+            } else {
+                slot->af_data = tmp_af;
+            }
+        }
+        if(slot->discard) {
+            prefetch_slot_free(slot);
+        }
+        SDL_CondBroadcast(cond);
+    }
+    SDL_UnlockMutex(lock);
+    return 0;
+}
+
+int prefetch_init() {
+    memset(slots, 0, sizeof(slots));
+    lock = SDL_CreateMutex();
+    cond = SDL_CreateCond();
+    if(lock == NULL || cond == NULL) {
+        goto error_0;
+    }
+    running = 1;
+    thread = SDL_CreateThread(prefetch_run, "prefetch", NULL);
+    if(thread == NULL) {
+        goto error_0;
+    }
+    INFO("Resource prefetch thread started.");
+    return 0;
+
+error_0:
+    // Not fatal; everything just gets loaded synchronously.
+    PERROR("Unable to start resource prefetch thread: %s", SDL_GetError());
+    running = 0;
+    if(cond) {
+        SDL_DestroyCond(cond);
+        cond = NULL;
+    }
+    if(lock) {
+        SDL_DestroyMutex(lock);
+        lock = NULL;
+    }
+    return 0;
+}
+
+void prefetch_close() {
+    if(thread == NULL) {
+        return;
+    }
+    SDL_LockMutex(lock);
+    running = 0;
+    SDL_CondBroadcast(cond);
+    SDL_UnlockMutex(lock);
+    SDL_WaitThread(thread, NULL);
+    thread = NULL;
+
+    for(int i = 0; i < PREFETCH_SLOTS; i++) {
+        prefetch_slot_free(&slots[i]);
+    }
+    SDL_DestroyCond(cond);
+    SDL_DestroyMutex(lock);
+    cond = NULL;
+    lock = NULL;
+}
+
+static void prefetch_queue(int type, int resource_id) {
+    if(thread == NULL) {
+        return;
+    }
+    SDL_LockMutex(lock);
+    prefetch_slot *free_slot = NULL;
+    for(int i = 0; i < PREFETCH_SLOTS; i++) {
+        prefetch_slot *slot = &slots[i];
+        if(slot->state != PREFETCH_FREE && !slot->discard
+            && slot->type == type && slot->resource_id == resource_id) {
+            // Already queued or loaded
+            SDL_UnlockMutex(lock);
+            return;
+        }
+        if(slot->state == PREFETCH_FREE && free_slot == NULL) {
+            free_slot = slot;
+        }
+    }
+    if(free_slot != NULL) {
+        free_slot->state = PREFETCH_QUEUED;
+        free_slot->type = type;
+        free_slot->resource_id = resource_id;
+        free_slot->discard = 0;
+        SDL_CondBroadcast(cond);
+    }
+    SDL_UnlockMutex(lock);
+}
+
+void prefetch_bk(int resource_id) {
+    prefetch_queue(PREFETCH_TYPE_BK, resource_id);
+}
+
+void prefetch_af(int resource_id) {
+    prefetch_queue(PREFETCH_TYPE_AF, resource_id);
+}
+
+void prefetch_discard_all() {
+    if(thread == NULL) {
+        return;
+    }
+    SDL_LockMutex(lock);
+    for(int i = 0; i < PREFETCH_SLOTS; i++) {
+        prefetch_slot *slot = &slots[i];
+        if(slot->state == PREFETCH_LOADING) {
+            slot->discard = 1;
+        } else {
+            prefetch_slot_free(slot);
+        }
+    }
+    SDL_UnlockMutex(lock);
+}
+
+int prefetch_poll() {
+    if(thread == NULL) {
+        return 0;
+    }
+    int pending = 0;
+    SDL_LockMutex(lock);
+    for(int i = 0; i < PREFETCH_SLOTS; i++) {
+        prefetch_slot *slot = &slots[i];
+        if(!slot->discard && (slot->state == PREFETCH_QUEUED || slot->state == PREFETCH_LOADING)) {
+            pending = 1;
+            break;
+        }
+    }
+    SDL_UnlockMutex(lock);
+    return pending;
+}
+
+// Waits for the matching slot to finish, and hands the result over.
+static prefetch_slot* prefetch_take(int type, int resource_id) {
+    if(thread == NULL) {
+        return NULL;
+    }
+    for(int i = 0; i < PREFETCH_SLOTS; i++) {
+        prefetch_slot *slot = &slots[i];
+        if(slot->state == PREFETCH_FREE || slot->discard
+            || slot->type != type || slot->resource_id != resource_id) {
+            continue;
+        }
+        while(slot->state == PREFETCH_QUEUED || slot->state == PREFETCH_LOADING) {
+            SDL_CondWait(cond, lock);
+        }
+        if(slot->state == PREFETCH_DONE) {
+            return slot;
+        }
+        slot->state = PREFETCH_FREE;
+        return NULL;
+    }
+    return NULL;
+}
+
+int prefetch_get_bk(bk *b, int resource_id) {
+    if(thread == NULL) {
+        return 1;
+    }
+    SDL_LockMutex(lock);
+    prefetch_slot *slot = prefetch_take(PREFETCH_TYPE_BK, resource_id);
+    if(slot != NULL) {
+        *b = slot->bk_data;
+        slot->state = PREFETCH_FREE;
+    }
+    SDL_UnlockMutex(lock);
+    return (slot == NULL);
+}
+
+int prefetch_get_af(af *a, int resource_id) {
+    if(thread == NULL) {
+        return 1;
+    }
+    SDL_LockMutex(lock);
+    prefetch_slot *slot = prefetch_take(PREFETCH_TYPE_AF, resource_id);
+    if(slot != NULL) {
+        memcpy(a, slot->af_data, sizeof(af));
+        free(slot->af_data);
+        slot->state = PREFETCH_FREE;
+    }
+    SDL_UnlockMutex(lock);
+    return (slot == NULL);
+}
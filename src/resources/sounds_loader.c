@@ -4,10 +4,14 @@
 #include "resources/ids.h"
 #include "resources/pathmanager.h"
 #include "utils/log.h"
+#include "utils/memtrack.h"
+#include "utils/task.h"
 
 sd_sound_file *sound_data = NULL;
+static size_t sound_bytes = 0;
+static task load_task;
 
-int sounds_loader_init() {
+static int sounds_loader_load(void *userdata) {
     // Get filename
     const char *filename = pm_get_resource_path(DAT_SOUNDS);
 
@@ -21,6 +25,15 @@ int sounds_loader_init() {
         goto error_1;
     }
     INFO("Loaded sounds file '%s'.", filename);
+
+    sound_bytes = sizeof(sd_sound_file);
+    for(int i = 0; i < SD_SOUNDS_MAX; i++) {
+        const sd_sound *sample = sd_sounds_get(sound_data, i);
+        if(sample != NULL) {
+            sound_bytes += sample->len;
+        }
+    }
+    memtrack_add(MEM_AUDIO, sound_bytes);
     return 0;
 
 error_1:
@@ -31,9 +44,15 @@ error_0:
     return 1;
 }
 
+// SOUNDS.DAT is read in the background, and the first sound played waits for it.
+int sounds_loader_init() {
+    task_start(&load_task, "sounds", sounds_loader_load, NULL);
+    return 0;
+}
+
 int sounds_loader_get(int id, char **buffer, int *len) {
     // Make sure the data is ok and sound exists
-    if(sound_data == NULL) return 1;
+    if(task_wait(&load_task) || sound_data == NULL) return 1;
 
     // Get sound
     const sd_sound *sample = sd_sounds_get(sound_data, id);
@@ -50,7 +69,9 @@ int sounds_loader_get(int id, char **buffer, int *len) {
 }
 
 void sounds_loader_close() {
+    task_free(&load_task);
     if(sound_data != NULL) {
+        memtrack_sub(MEM_AUDIO, sound_bytes);
         sd_sounds_free(sound_data);
         free(sound_data);
         sound_data = NULL;
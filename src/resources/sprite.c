@@ -2,37 +2,68 @@
 #include <stdlib.h>
 #include <string.h>
 #include "resources/sprite.h"
+#include "utils/memtrack.h"
 
 void sprite_create_custom(sprite *sp, vec2i pos, surface *data) {
     sp->id = -1;
     sp->pos = pos;
     sp->data = data;
+    sp->pixels = NULL;
 }
 
-void sprite_create(sprite *sp, void *src, int id) {
+void sprite_create(sprite *sp, void *src, int id, sprite_store *store) {
     sd_sprite *sdsprite = (sd_sprite*)src;
     sp->id = id;
     sp->pos = vec2i_create(sdsprite->pos_x, sdsprite->pos_y);
-    sp->data = malloc(sizeof(surface));
+    sp->data = NULL;
+
+    // Baked sprites are used straight from the archive
+    sp->pixels = sprite_store_find_baked(store, id, sdsprite->width, sdsprite->height);
+    if(sp->pixels != NULL) {
+        return;
+    }
 
-    // Load data
+    // Keep the pixels packed; the surface is decoded when the sprite is first used
     sd_vga_image raw;
     sd_sprite_vga_decode(&raw, sdsprite);
-    surface_create_from_data(sp->data, SURFACE_TYPE_PALETTE, raw.w, raw.h, raw.data);
-    memcpy(sp->data->stencil, raw.stencil, raw.w * raw.h);
+    sp->pixels = sprite_store_pack(store, raw.data, raw.stencil, raw.w, raw.h);
+    if(sp->pixels == NULL) {
+        sp->data = malloc(sizeof(surface));
+        surface_create_from_data(sp->data, SURFACE_TYPE_PALETTE, raw.w, raw.h, raw.data);
+        memcpy(sp->data->stencil, raw.stencil, raw.w * raw.h);
+        if(store != NULL) {
+            surface_set_mem_tag(sp->data, store->mem_tag);
+        }
+    }
     sd_vga_image_free(&raw);
 }
 
 void sprite_free(sprite *sp) {
-    surface_free(sp->data);
-    free(sp->data);
-    sp->data = NULL;
+    if(sp->data != NULL) {
+        surface_free(sp->data);
+        free(sp->data);
+        sp->data = NULL;
+    }
+    sprite_pixels_release(sp->pixels);
+    sp->pixels = NULL;
+}
+
+// Surfaces of packed sprites are shared with identical sprites. Use sprite_copy
+// to get a surface that can be modified.
+surface* sprite_get_surface(sprite *sp) {
+    if(sp->pixels != NULL) {
+        return sprite_pixels_get_surface(sp->pixels);
+    }
+    return sp->data;
 }
 
 vec2i sprite_get_size(sprite *sp) {
     if(sp->data != NULL) {
         return vec2i_create(sp->data->w, sp->data->h);
     }
+    if(sp->pixels != NULL) {
+        return vec2i_create(sp->pixels->w, sp->pixels->h);
+    }
     return vec2i_create(0,0);
 }
 
@@ -42,9 +73,10 @@ sprite* sprite_copy(sprite *src) {
     sprite *new = malloc(sizeof(sprite));
     new->pos = src->pos;
     new->id = src->id;
+    new->pixels = NULL;
 
     // Copy surface
     new->data = malloc(sizeof(surface));
-    surface_copy(new->data, src->data);
+    surface_copy(new->data, sprite_get_surface(src));
     return new;
 }
@@ -0,0 +1,278 @@
+#include <stdlib.h>
+#include <string.h>
+#include "resources/sprite_store.h"
+#include "utils/log.h"
+#include "utils/memtrack.h"
+
+static void put16(unsigned char *dst, unsigned int v) {
+    dst[0] = v & 0xFF;
+    dst[1] = (v >> 8) & 0xFF;
+}
+
+static unsigned int get16(const unsigned char *src) {
+    return src[0] | (src[1] << 8);
+}
+
+static uint32_t sprite_pixels_hash(const unsigned char *buf, unsigned int len, int w, int h) {
+    uint32_t hash = 2166136261u;
+    for(unsigned int i = 0; i < len; i++) {
+        hash = (hash ^ buf[i]) * 16777619u;
+    }
+    hash = (hash ^ (uint32_t)w) * 16777619u;
+    hash = (hash ^ (uint32_t)h) * 16777619u;
+    return hash;
+}
+
+// Returns the amount of bytes written to dst. dst must fit the worst case,
+// which is every other pixel being transparent.
+static unsigned int sprite_pixels_encode(unsigned char *dst, const char *data, const char *stencil, int w, int h) {
+    unsigned char *p = dst;
+    for(int y = 0; y < h; y++) {
+        unsigned char *count_pos = p;
+        unsigned int count = 0;
+        p += 2;
+        int x = 0;
+        while(x < w) {
+            // Skip transparent pixels
+            while(x < w && !stencil[y * w + x]) {
+                x++;
+            }
+            if(x >= w) {
+                break;
+            }
+            int start = x;
+            while(x < w && stencil[y * w + x]) {
+                x++;
+            }
+            put16(p, start);
+            put16(p + 2, x - start);
+            memcpy(p + 4, data + y * w + start, x - start);
+            p += 4 + x - start;
+            count++;
+        }
+        put16(count_pos, count);
+    }
+    return p - dst;
+}
+
+void sprite_store_create(sprite_store *st, int mem_tag) {
+    hashmap_create(&st->entries, 7);
+    st->mem_tag = mem_tag;
+    st->baked = NULL;
+    st->anim_id = 0;
+    st->baked_sprites = 0;
+    st->sprites = 0;
+    st->unique = 0;
+    st->raw_bytes = 0;
+    st->packed_bytes = 0;
+}
+
+/*
+ * Encodes the pixels and stencil of a decoded VGA image. If the store already
+ * holds identical pixels, those are shared instead. Store may be NULL, in which
+ * case nothing is shared. Returns NULL on failure.
+ */
+sprite_pixels* sprite_store_pack(sprite_store *st, const char *data, const char *stencil, int w, int h) {
+    unsigned int bound = h * (2 + 4 * ((w + 1) / 2) + w);
+    unsigned char *tmp = malloc(bound > 0 ? bound : 1);
+    if(tmp == NULL) {
+        return NULL;
+    }
+    unsigned int len = sprite_pixels_encode(tmp, data, stencil, w, h);
+    uint32_t hash = sprite_pixels_hash(tmp, len, w, h);
+
+    if(st != NULL) {
+        st->sprites++;
+        st->raw_bytes += w * h * 2;
+
+        sprite_pixels **found;
+        unsigned int found_len;
+        if(hashmap_iget(&st->entries, hash, (void**)&found, &found_len) == 0) {
+            sprite_pixels *old = *found;
+            if(old->w == w && old->h == h && old->size == len && memcmp(old->data, tmp, len) == 0) {
+                old->refs++;
+                free(tmp);
+                return old;
+            }
+        }
+    }
+
+    sprite_pixels *px = malloc(sizeof(sprite_pixels) + len);
+    if(px == NULL) {
+        free(tmp);
+        return NULL;
+    }
+    px->hash = hash;
+    px->w = w;
+    px->h = h;
+    px->refs = 1;
+    px->size = len;
+    px->mem_tag = (st != NULL) ? st->mem_tag : MEM_SURFACES;
+    px->decoded = NULL;
+    px->data = px->inline_data;
+    memcpy(px->inline_data, tmp, len);
+    free(tmp);
+    memtrack_add(px->mem_tag, sizeof(sprite_pixels) + len);
+
+    if(st != NULL) {
+        // On a hash collision the first entry stays in the index
+        sprite_pixels **found;
+        unsigned int found_len;
+        if(hashmap_iget(&st->entries, hash, (void**)&found, &found_len) == 1) {
+            hashmap_iput(&st->entries, hash, &px, sizeof(sprite_pixels*));
+        }
+        st->unique++;
+        st->packed_bytes += sizeof(sprite_pixels) + len;
+    }
+    return px;
+}
+
+/*
+ * Returns pixels that point into the baked archive, if it has the sprite of the
+ * current animation with the expected size. Returns NULL otherwise. Sprites that
+ * were baked only once share the same pixels.
+ */
+sprite_pixels* sprite_store_find_baked(sprite_store *st, int sprite_id, int w, int h) {
+    if(st == NULL || st->baked == NULL) {
+        return NULL;
+    }
+    const baked_sprite *bs = baked_find_sprite(st->baked, st->anim_id, sprite_id);
+    if(bs == NULL || bs->w != w || bs->h != h || baked_check_sprite(bs)) {
+        return NULL;
+    }
+    const unsigned char *data = baked_sprite_data(bs);
+    st->baked_sprites++;
+
+    // Baked pixels are indexed by their offset in the archive
+    sprite_pixels **found;
+    unsigned int found_len;
+    if(hashmap_iget(&st->entries, bs->data_offset, (void**)&found, &found_len) == 0) {
+        sprite_pixels *old = *found;
+        if(old->data == data && old->w == w && old->h == h) {
+            old->refs++;
+            return old;
+        }
+    }
+
+    sprite_pixels *px = malloc(sizeof(sprite_pixels));
+    if(px == NULL) {
+        return NULL;
+    }
+    px->hash = bs->data_offset;
+    px->w = w;
+    px->h = h;
+    px->refs = 1;
+    px->size = bs->data_size;
+    px->mem_tag = st->mem_tag;
+    px->decoded = NULL;
+    px->data = data;
+    memtrack_add(px->mem_tag, sizeof(sprite_pixels));
+    if(hashmap_iget(&st->entries, bs->data_offset, (void**)&found, &found_len) == 1) {
+        hashmap_iput(&st->entries, bs->data_offset, &px, sizeof(sprite_pixels*));
+    }
+    return px;
+}
+
+void sprite_store_report(const sprite_store *st, const char *file_type, int file_id) {
+    if(st->baked_sprites > 0) {
+        DEBUG("%s file %d: %u sprites mapped from the baked archive.", file_type, file_id, st->baked_sprites);
+    }
+    if(st->sprites == 0) {
+        return;
+    }
+    // Surfaces are decoded later, once for each unique sprite that gets drawn
+    DEBUG("%s file %d: %u sprites, %u unique, %u kB packed (%u kB saved before decoding).",
+          file_type,
+          file_id,
+          st->sprites,
+          st->unique,
+          (unsigned int)(st->packed_bytes / 1024),
+          (unsigned int)((st->raw_bytes - st->packed_bytes) / 1024));
+}
+
+// Entries are owned by the sprites using them, so only the index is freed here
+void sprite_store_free(sprite_store *st) {
+    hashmap_free(&st->entries);
+}
+
+void sprite_pixels_release(sprite_pixels *px) {
+    if(px == NULL) {
+        return;
+    }
+    px->refs--;
+    if(px->refs == 0) {
+        if(px->decoded != NULL) {
+            surface_free(px->decoded);
+            free(px->decoded);
+        }
+        memtrack_sub(px->mem_tag, sizeof(sprite_pixels) + (px->data == px->inline_data ? px->size : 0));
+        free(px);
+    }
+}
+
+/*
+ * Checks that span encoded data has a row for every line of the sprite, that
+ * every span is within the sprite and the data, and that nothing is left over.
+ * Returns 0 if the data is valid, 1 otherwise.
+ */
+int sprite_pixels_check(const unsigned char *data, unsigned int size, int w, int h) {
+    const unsigned char *p = data;
+    const unsigned char *end = data + size;
+    for(int y = 0; y < h; y++) {
+        if(end - p < 2) {
+            return 1;
+        }
+        unsigned int count = get16(p);
+        p += 2;
+        for(unsigned int i = 0; i < count; i++) {
+            if(end - p < 4) {
+                return 1;
+            }
+            unsigned int x = get16(p);
+            unsigned int len = get16(p + 2);
+            if(x + len > (unsigned int)w || (size_t)(end - p - 4) < len) {
+                return 1;
+            }
+            p += 4 + len;
+        }
+    }
+    return (p == end) ? 0 : 1;
+}
+
+static void sprite_pixels_decode(const sprite_pixels *px, surface *sur) {
+    surface_create(sur, SURFACE_TYPE_PALETTE, px->w, px->h);
+    memset(sur->data, 0, px->w * px->h);
+    memset(sur->stencil, 0, px->w * px->h);
+
+    // Baked data is checked when the archive is opened, but the file could
+    // still change under the mapping, so never write outside the surface.
+    const unsigned char *p = px->data;
+    const unsigned char *end = px->data + px->size;
+    for(int y = 0; y < px->h && end - p >= 2; y++) {
+        unsigned int count = get16(p);
+        p += 2;
+        for(unsigned int i = 0; i < count; i++) {
+            if(end - p < 4) {
+                return;
+            }
+            unsigned int x = get16(p);
+            unsigned int len = get16(p + 2);
+            if(x + len > px->w || (size_t)(end - p - 4) < len) {
+                return;
+            }
+            memcpy(sur->data + y * px->w + x, p + 4, len);
+            memset(sur->stencil + y * px->w + x, 1, len);
+            p += 4 + len;
+        }
+    }
+}
+
+// Every sprite sharing the pixels gets the same surface, so it must not be modified
+surface* sprite_pixels_get_surface(sprite_pixels *px) {
+    if(px->decoded == NULL) {
+        px->decoded = malloc(sizeof(surface));
+        sprite_pixels_decode(px, px->decoded);
+        surface_set_mem_tag(px->decoded, px->mem_tag);
+    }
+    return px->decoded;
+}
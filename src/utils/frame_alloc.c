@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <string.h>
+#include "utils/frame_alloc.h"
+#include "utils/log.h"
+
+#define FRAME_ALIGN 16
+#define ALIGN_UP(n) (((n) + FRAME_ALIGN - 1) & ~(size_t)(FRAME_ALIGN - 1))
+
+// Every allocation is prefixed with its size, so that realloc knows how much
+// to copy and free can tell whether the block is on top of the stack.
+typedef struct frame_header_t {
+    size_t size;
+    size_t pad;
+} frame_header;
+
+static char *block = NULL;
+static size_t top = 0;
+static unsigned int live = 0;
+static size_t peak = 0;
+static frame_alloc_stats current;
+static frame_alloc_stats last;
+
+static frame_header* frame_get_header(void *ptr) {
+    return (frame_header*)((char*)ptr - sizeof(frame_header));
+}
+
+static int frame_is_top(void *ptr) {
+    return ((char*)ptr + ALIGN_UP(frame_get_header(ptr)->size) == block + top);
+}
+
+/** \brief Checks whether the pointer was handed out from the frame arena
+  * \param ptr Pointer to check
+  * \return 1 if the pointer is arena memory, 0 otherwise.
+  */
+int frame_alloc_owns(const void *ptr) {
+    if(block == NULL) {
+        return 0;
+    }
+    const char *c = ptr;
+    return (c >= block && c < block + FRAME_ALLOC_SIZE);
+}
+
+/** \brief Allocates memory from the frame arena
+  *
+  * If the arena is full, the memory is taken from the heap instead.
+  * Either way, the memory must be released with frame_alloc_free.
+  *
+  * \param size Amount of bytes to allocate
+  * \return Pointer to memory, or NULL on failure.
+  */
+void* frame_alloc_malloc(size_t size) {
+    if(block == NULL) {
+        block = malloc(FRAME_ALLOC_SIZE);
+        if(block == NULL) {
+            PERROR("Unable to allocate frame arena; using heap.");
+        }
+    }
+
+    size_t need = sizeof(frame_header) + ALIGN_UP(size);
+    if(block == NULL || need > FRAME_ALLOC_SIZE - top) {
+        current.fallbacks++;
+        return malloc(size);
+    }
+
+    frame_header *hdr = (frame_header*)(block + top);
+    hdr->size = size;
+    top += need;
+    live++;
+    current.bytes += size;
+    current.allocs++;
+    if(top > peak) {
+        peak = top;
+    }
+    return hdr + 1;
+}
+
+/** \brief Releases memory allocated with frame_alloc_malloc
+  *
+  * Arena memory is reclaimed right away if it was the latest allocation, and
+  * all of it is reclaimed when nothing in the arena is in use anymore.
+  *
+  * \param ptr Memory to release. NULL is accepted.
+  */
+void frame_alloc_free(void *ptr) {
+    if(ptr == NULL) {
+        return;
+    }
+    if(!frame_alloc_owns(ptr)) {
+        free(ptr);
+        return;
+    }
+    if(frame_is_top(ptr)) {
+        top = (char*)frame_get_header(ptr) - block;
+    }
+    live--;
+    if(live == 0) {
+        top = 0;
+    }
+}
+
+/** \brief Resizes memory allocated with frame_alloc_malloc
+  *
+  * Growing the latest allocation happens in place, which makes appending to a
+  * single buffer cheap.
+  *
+  * \param ptr Memory to resize, or NULL
+  * \param size New size in bytes
+  * \return Pointer to resized memory, or NULL on failure.
+  */
+void* frame_alloc_realloc(void *ptr, size_t size) {
+    if(ptr == NULL) {
+        return frame_alloc_malloc(size);
+    }
+    if(!frame_alloc_owns(ptr)) {
+        return realloc(ptr, size);
+    }
+
+    frame_header *hdr = frame_get_header(ptr);
+    size_t offset = (char*)ptr - block;
+    if(frame_is_top(ptr) && ALIGN_UP(size) <= FRAME_ALLOC_SIZE - offset) {
+        if(size > hdr->size) {
+            current.bytes += size - hdr->size;
+        }
+        hdr->size = size;
+        top = offset + ALIGN_UP(size);
+        if(top > peak) {
+            peak = top;
+        }
+        return ptr;
+    }
+
+    void *nptr = frame_alloc_malloc(size);
+    if(nptr == NULL) {
+        return NULL;
+    }
+    memcpy(nptr, ptr, (hdr->size < size) ? hdr->size : size);
+    frame_alloc_free(ptr);
+    return nptr;
+}
+
+/** \brief Gets an allocator that uses the frame arena
+  * \param alloc Allocator struct to fill
+  */
+void frame_alloc_get_allocator(allocator *alloc) {
+    alloc->cmalloc = frame_alloc_malloc;
+    alloc->cfree = frame_alloc_free;
+    alloc->crealloc = frame_alloc_realloc;
+}
+
+/** \brief Marks the end of a frame
+  *
+  * Collects the counters for the frame. Memory that is still in use stays
+  * valid; it is reclaimed once all of it has been released.
+  */
+void frame_alloc_reset() {
+    last = current;
+    memset(&current, 0, sizeof(frame_alloc_stats));
+    if(live == 0) {
+        top = 0;
+    }
+}
+
+/** \brief Gets the counters of the last finished frame
+  * \param stats Counters are written here. May be NULL.
+  * \param peak_bytes Highest arena usage so far is written here. May be NULL.
+  */
+void frame_alloc_get_stats(frame_alloc_stats *stats, size_t *peak_bytes) {
+    if(stats != NULL) {
+        *stats = last;
+    }
+    if(peak_bytes != NULL) {
+        *peak_bytes = peak;
+    }
+}
+
+/** \brief Frees the frame arena
+  *
+  * Arena is not freed if some of it is still in use.
+  */
+void frame_alloc_close() {
+    if(block == NULL) {
+        return;
+    }
+    DEBUG("Frame arena peak usage was %u bytes.", (unsigned int)peak);
+    if(live > 0) {
+        PERROR("%u frame arena allocations still in use at close!", live);
+        return;
+    }
+    free(block);
+    block = NULL;
+    top = 0;
+}
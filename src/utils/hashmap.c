@@ -1,25 +1,194 @@
 #include "utils/hashmap.h"
+#include "utils/memtrack.h"
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
+
+// Open addressing hashmap with Robin Hood probing and backward shift deletion.
+// Probing never wraps around; instead there are some extra buckets past the end
+// of the table. If a probe runs past those, the table is grown. Because entries
+// only ever shift towards lower indexes on delete, iterating upwards stays
+// valid while deleting with hashmap_delete.
 
 #define FNV_32_PRIME ((uint32_t)0x01000193)
 #define FNV1_32_INIT ((uint32_t)2166136261)
-#define TINY_MASK(x) (((uint32_t)1<<(x))-1)
-#define BUCKETS_SIZE(x) (pow(2,(x)))
+#define HASHMAP_OVERFLOW 32
+#define BUCKETS_SIZE(x) (1U << (x))
+#define SLOT_COUNT(hm) (BUCKETS_SIZE((hm)->buckets_x) + HASHMAP_OVERFLOW)
+#define VAL_OFFSET(keylen) (((keylen) + 7) & ~7U)
+#define IS_INLINE(pair) (VAL_OFFSET((pair).keylen) + (pair).vallen <= HASHMAP_INLINE_SIZE)
 
 // The rest
 
-uint32_t fnv_32a_buf(const void *buf, unsigned int len, unsigned int x) {
-    unsigned char *bp = (unsigned char *)buf;
-    unsigned char *be = bp + len;
+static uint32_t fnv_32a_buf(const void *buf, unsigned int len) {
+    const unsigned char *bp = buf;
+    const unsigned char *be = bp + len;
     uint32_t hval = FNV1_32_INIT;
     while(bp < be) {
         hval ^= (uint32_t)*bp++;
         hval *= FNV_32_PRIME;
     }
-    return (((hval >> x) ^ hval) & TINY_MASK(x));
+    return hval;
+}
+
+static uint32_t int_hash(uint32_t k) {
+    k ^= k >> 16;
+    k *= 0x7feb352d;
+    k ^= k >> 15;
+    k *= 0x846ca68b;
+    k ^= k >> 16;
+    return k;
+}
+
+// Integer sized keys always use the integer hash, so that hashmap_put and
+// hashmap_iput can be used with the same map.
+static uint32_t hashmap_hash(const void *key, unsigned int keylen) {
+    if(keylen == sizeof(unsigned int)) {
+        unsigned int k;
+        memcpy(&k, key, sizeof(unsigned int));
+        return int_hash(k);
+    }
+    return fnv_32a_buf(key, keylen);
+}
+
+// Points key & val to the right place after the node has been moved
+static void hashmap_node_fix(hashmap_node *node) {
+    if(IS_INLINE(node->pair)) {
+        node->pair.key = node->data;
+        node->pair.val = (char*)node->data + VAL_OFFSET(node->pair.keylen);
+    }
+}
+
+static void hashmap_node_store(hashmap *hm, hashmap_node *node,
+                               const void *key, unsigned int keylen,
+                               const void *val, unsigned int vallen) {
+    node->pair.keylen = keylen;
+    node->pair.vallen = vallen;
+    char *block;
+    if(IS_INLINE(node->pair)) {
+        block = (char*)node->data;
+    } else {
+        // Key and value share a single allocation
+        block = hm->alloc.cmalloc(VAL_OFFSET(keylen) + vallen);
+    }
+    memcpy(block, key, keylen);
+    memcpy(block + VAL_OFFSET(keylen), val, vallen);
+    node->pair.key = block;
+    node->pair.val = block + VAL_OFFSET(keylen);
+}
+
+static void hashmap_node_release(hashmap *hm, hashmap_node *node) {
+    if(!IS_INLINE(node->pair)) {
+        hm->alloc.cfree(node->pair.key);
+    }
+}
+
+static hashmap_node* hashmap_find(const hashmap *hm, const void *key, unsigned int keylen, uint32_t hash) {
+    unsigned int slots = SLOT_COUNT(hm);
+    uint32_t dist = 1;
+    for(unsigned int i = hash & (BUCKETS_SIZE(hm->buckets_x) - 1); i < slots; i++, dist++) {
+        hashmap_node *node = &hm->buckets[i];
+        // Empty bucket, or an entry closer to its home than we would be: key is not here.
+        if(node->dist < dist) {
+            return NULL;
+        }
+        if(node->hash == hash
+            && node->pair.keylen == keylen
+            && memcmp(node->pair.key, key, keylen) == 0) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+// Same as above, but for unsigned int keys.
+static hashmap_node* hashmap_ifind(const hashmap *hm, unsigned int key) {
+    uint32_t hash = int_hash(key);
+    unsigned int slots = SLOT_COUNT(hm);
+    uint32_t dist = 1;
+    for(unsigned int i = hash & (BUCKETS_SIZE(hm->buckets_x) - 1); i < slots; i++, dist++) {
+        hashmap_node *node = &hm->buckets[i];
+        if(node->dist < dist) {
+            return NULL;
+        }
+        if(node->hash == hash
+            && node->pair.keylen == sizeof(unsigned int)
+            && *(unsigned int*)node->pair.key == key) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+// Robin Hood insert. If the carried node displaces an entry, that entry gets carried
+// forward instead. Placed gets the bucket where the first carried node went. Returns 1
+// if the probe ran past the end of the table, in which case carry holds the node that
+// still needs a place.
+static int hashmap_place(hashmap *hm, hashmap_node *carry, hashmap_node **placed) {
+    unsigned int slots = SLOT_COUNT(hm);
+    hashmap_node tmp;
+    *placed = NULL;
+    carry->dist = 1;
+    for(unsigned int i = carry->hash & (BUCKETS_SIZE(hm->buckets_x) - 1); i < slots; i++, carry->dist++) {
+        hashmap_node *node = &hm->buckets[i];
+        if(node->dist == 0) {
+            *node = *carry;
+            hashmap_node_fix(node);
+            if(*placed == NULL) {
+                *placed = node;
+            }
+            return 0;
+        }
+        if(node->dist < carry->dist) {
+            tmp = *node;
+            *node = *carry;
+            hashmap_node_fix(node);
+            if(*placed == NULL) {
+                *placed = node;
+            }
+            *carry = tmp;
+            hashmap_node_fix(carry);
+        }
+    }
+    return 1;
+}
+
+static void hashmap_grow(hashmap *hm) {
+    hashmap_node *old = hm->buckets;
+    unsigned int old_slots = SLOT_COUNT(hm);
+    hashmap_node *placed;
+
+    hm->buckets_x++;
+    size_t b_size = SLOT_COUNT(hm) * sizeof(hashmap_node);
+    hm->buckets = hm->alloc.cmalloc(b_size);
+    memset(hm->buckets, 0, b_size);
+
+    for(unsigned int i = 0; i < old_slots; i++) {
+        if(old[i].dist == 0) {
+            continue;
+        }
+        hashmap_node carry = old[i];
+        hashmap_node_fix(&carry);
+        while(hashmap_place(hm, &carry, &placed)) {
+            hashmap_grow(hm);
+        }
+    }
+    hm->alloc.cfree(old);
+}
+
+// Removes the entry, and shifts the following entries back by one until one
+// is found that is already in its home bucket.
+static void hashmap_remove_at(hashmap *hm, unsigned int index) {
+    unsigned int slots = SLOT_COUNT(hm);
+    hashmap_node_release(hm, &hm->buckets[index]);
+    while(index + 1 < slots && hm->buckets[index + 1].dist > 1) {
+        hm->buckets[index] = hm->buckets[index + 1];
+        hm->buckets[index].dist--;
+        hashmap_node_fix(&hm->buckets[index]);
+        index++;
+    }
+    hm->buckets[index].dist = 0;
+    hm->reserved--;
 }
 
 /** \brief Creates a new hashmap with an allocator
@@ -28,13 +197,13 @@ uint32_t fnv_32a_buf(const void *buf, unsigned int len, unsigned int x) {
   * allows the user to define the memory allocation functions.
   *
   * \param hm Allocated memory pointer
-  * \param n_size Size of the hashmap. Final size will be pow(w, n_size)
+  * \param n_size Initial size of the hashmap. Size will be pow(2, n_size)
   * \param alloc Allocation functions
   */
 void hashmap_create_with_allocator(hashmap *hm, int n_size, allocator alloc) {
     hm->alloc = alloc;
     hm->buckets_x = n_size;
-    size_t b_size = hashmap_size(hm) * sizeof(hashmap_node*);
+    size_t b_size = SLOT_COUNT(hm) * sizeof(hashmap_node);
     hm->buckets = hm->alloc.cmalloc(b_size);
     memset(hm->buckets, 0, b_size);
     hm->reserved = 0;
@@ -45,18 +214,15 @@ void hashmap_create_with_allocator(hashmap *hm, int n_size, allocator alloc) {
   *
   * Creates a new hashmap. Note that the size parameter doesn't mean bucket count,
   * but the bucket count is actually calculated pow(2, n_size). So for example value
-  * 8 means 256 buckets, and 9 would be 512 buckets.
-  *
-  * \todo Make a better create function
+  * 8 means 256 buckets, and 9 would be 512 buckets. The hashmap will grow
+  * automatically when it gets too full.
   *
   * \param hm Allocated memory pointer
-  * \param n_size Size of the hashmap. Final size will be pow(w, n_size)
+  * \param n_size Initial size of the hashmap. Size will be pow(2, n_size)
   */
 void hashmap_create(hashmap *hm, int n_size) {
     allocator alloc;
-    alloc.cmalloc = malloc;
-    alloc.crealloc = realloc;
-    alloc.cfree = free;
+    memtrack_get_allocator(&alloc);
     hashmap_create_with_allocator(hm, n_size, alloc);
 }
 
@@ -68,20 +234,14 @@ void hashmap_create(hashmap *hm, int n_size) {
   * \param hm Hashmap to clear
   */
 void hashmap_clear(hashmap *hm) {
-    hashmap_node *node = NULL;
-    hashmap_node *tmp = NULL;
-    for(unsigned int i = 0; i < hashmap_size(hm); i++) {
-        node = hm->buckets[i];
-        while(node != NULL) {
-            tmp = node;
-            node = node->next;
-            hm->alloc.cfree(tmp->pair.key);
-            hm->alloc.cfree(tmp->pair.val);
-            hm->alloc.cfree(tmp);
-            hm->reserved--;
+    unsigned int slots = SLOT_COUNT(hm);
+    for(unsigned int i = 0; i < slots; i++) {
+        if(hm->buckets[i].dist != 0) {
+            hashmap_node_release(hm, &hm->buckets[i]);
+            hm->buckets[i].dist = 0;
         }
-        hm->buckets[i] = NULL;
     }
+    hm->reserved = 0;
 }
 
 /** \brief Free hashmap
@@ -112,10 +272,8 @@ unsigned int hashmap_size(const hashmap *hm) {
 
 /** \brief Gets hashmap reserved buckets
   *
-  * Returns the amount of items in the hashmap. Note that the item count
-  * can be larger than the bucket count, if the hashmap is full enough.
-  * If there are a lot more items than buckets, you should really consider
-  * growing your hashmap bucket count ...
+  * Returns the amount of items in the hashmap. The hashmap grows when
+  * this reaches 3/4 of the bucket count.
   *
   * \param hm Hashmap
   * \return Amount of items in the hashmap
@@ -126,34 +284,48 @@ unsigned int hashmap_reserved(const hashmap *hm) {
 
 /** \brief Puts an item to the hashmap
   *
-  * Puts a new item to the hashmap. Note that the
-  * contents of the value memory block will be copied. However,
-  * any memory _pointed to_ by it will NOT be copied. So be careful!
+  * Puts a new item to the hashmap. If the key already exists, its value
+  * is replaced. Note that the contents of the value memory block will be
+  * copied. However, any memory _pointed to_ by it will NOT be copied.
+  * So be careful! Also note that the returned pointer is only valid until
+  * the hashmap is modified next time, as the entries may move around.
   *
   * \param hm Hashmap
   * \param key Pointer to key memory block
   * \param keylen Length of the key memory block
   * \param val Pointer to value memory block
   * \param vallen Length of the value memory block
-  * \return Returns a pointer to the newly reserved hashmap pair.
+  * \return Returns a pointer to the newly reserved value.
   */
 void* hashmap_put(hashmap *hm,
                   const void *key, unsigned int keylen,
                   const void *val, unsigned int vallen) {
-    unsigned int index = fnv_32a_buf(key, keylen, hm->buckets_x);
+    uint32_t hash = hashmap_hash(key, keylen);
+
+    // Replace old value if key already exists
+    hashmap_node *node = hashmap_find(hm, key, keylen, hash);
+    if(node != NULL) {
+        hashmap_node_release(hm, node);
+        hashmap_node_store(hm, node, key, keylen, val, vallen);
+        return node->pair.val;
+    }
 
-    // Create new node, copy data
-    hashmap_node *node = hm->alloc.cmalloc(sizeof(hashmap_node));
-    node->pair.keylen = keylen;
-    node->pair.vallen = vallen;
-    node->pair.key = hm->alloc.cmalloc(keylen);
-    node->pair.val = hm->alloc.cmalloc(vallen);
-    memcpy(node->pair.key, key, keylen);
-    memcpy(node->pair.val, val, vallen);
-
-    // Set new node as first
-    node->next = hm->buckets[index];
-    hm->buckets[index] = node;
+    // Keep load factor under 3/4
+    if((hm->reserved + 1) * 4 > hashmap_size(hm) * 3) {
+        hashmap_grow(hm);
+    }
+
+    hashmap_node carry;
+    carry.hash = hash;
+    hashmap_node_store(hm, &carry, key, keylen, val, vallen);
+    if(hashmap_place(hm, &carry, &node)) {
+        // Ran out of buckets at the end of the table. Grow and place whatever
+        // was left over; the new entry may have moved, so look it up again.
+        do {
+            hashmap_grow(hm);
+        } while(hashmap_place(hm, &carry, &node));
+        node = hashmap_find(hm, key, keylen, hash);
+    }
     hm->reserved++;
 
     // Return a pointer to the newly allocated value
@@ -174,42 +346,12 @@ void* hashmap_put(hashmap *hm,
   * \return Returns 0 on success, 1 on error (not found).
   */
 int hashmap_del(hashmap *hm, const void *key, unsigned int keylen) {
-    unsigned int index = fnv_32a_buf(key, keylen, hm->buckets_x);
-
-    // Get node
-    hashmap_node *node = hm->buckets[index];
-    hashmap_node *prev = NULL;
-    if(node == NULL) return 1;
-
-    // Find the node we want to delete
-    int found = 0;
-    while(node) {
-        if(node->pair.keylen == keylen) {
-            if(memcmp(node->pair.key, key, keylen) == 0) {
-                found = 1;
-                break;
-            }
-        }
-        prev = node;
-        node = node->next;
+    hashmap_node *node = hashmap_find(hm, key, keylen, hashmap_hash(key, keylen));
+    if(node == NULL) {
+        return 1;
     }
-
-    // If node was found, handle delete
-    if(found) {
-        if(prev != NULL) {
-            // If node is not first in chain, set correct links
-            prev->next = node->next;
-        } else {
-            // If node is first in chain, set possible next entry as first
-            hm->buckets[index] = node->next;
-        }
-        hm->alloc.cfree(node->pair.key);
-        hm->alloc.cfree(node->pair.val);
-        hm->alloc.cfree(node);
-        hm->reserved--;
-        return 0;
-    }
-    return 1;
+    hashmap_remove_at(hm, node - hm->buckets);
+    return 0;
 }
 
 /** \brief Gets an item from the hashmap
@@ -224,29 +366,15 @@ int hashmap_del(hashmap *hm, const void *key, unsigned int keylen) {
   * \return Returns 0 on success, 1 on error (not found).
   */
 int hashmap_get(hashmap *hm, const void *key, unsigned int keylen, void **val, unsigned int *vallen) {
-    unsigned int index = fnv_32a_buf(key, keylen, hm->buckets_x);
-
-    // Set defaults for error cases
-    *val = NULL;
-    *vallen = 0;
-
-    // Get node
-    hashmap_node *node = hm->buckets[index];
-    if(node == NULL) return 1;
-
-    // Find the node we want
-    while(node) {
-        if(node->pair.keylen == keylen) {
-            if(memcmp(node->pair.key, key, keylen) == 0) {
-                *val = node->pair.val;
-                *vallen = node->pair.vallen;
-                return 0;
-            }
-        }
-        node = node->next;
+    hashmap_node *node = hashmap_find(hm, key, keylen, hashmap_hash(key, keylen));
+    if(node == NULL) {
+        *val = NULL;
+        *vallen = 0;
+        return 1;
     }
-
-    return 1;
+    *val = node->pair.val;
+    *vallen = node->pair.vallen;
+    return 0;
 }
 
 void hashmap_sput(hashmap *hm, const char *key, void *value, unsigned int value_len) {
@@ -262,7 +390,15 @@ int hashmap_sget(hashmap *hm, const char *key, void **value, unsigned int *value
 }
 
 int hashmap_iget(hashmap *hm, unsigned int key, void **value, unsigned int *value_len) {
-    return hashmap_get(hm, (void*)&key, sizeof(unsigned int), value, value_len);
+    hashmap_node *node = hashmap_ifind(hm, key);
+    if(node == NULL) {
+        *value = NULL;
+        *value_len = 0;
+        return 1;
+    }
+    *value = node->pair.val;
+    *value_len = node->pair.vallen;
+    return 0;
 }
 
 void hashmap_sdel(hashmap *hm, const char *key) {
@@ -270,7 +406,10 @@ void hashmap_sdel(hashmap *hm, const char *key) {
 }
 
 void hashmap_idel(hashmap *hm, unsigned int key) {
-    hashmap_del(hm, (char*)&key, sizeof(unsigned int));
+    hashmap_node *node = hashmap_ifind(hm, key);
+    if(node != NULL) {
+        hashmap_remove_at(hm, node - hm->buckets);
+    }
 }
 
 /** \brief Deletes an item from the hashmap by iterator key
@@ -284,89 +423,32 @@ void hashmap_idel(hashmap *hm, unsigned int key) {
   * \return Returns 0 on success, 1 on error (not found).
   */
 int hashmap_delete(hashmap *hm, iterator *iter) {
-    int index = iter->inow - 1;
-
-    // Find correct node
-    hashmap_node *node = hm->buckets[index];
-    hashmap_node *prev = NULL;
-    hashmap_node *seek = iter->vnow;
-    if(node == NULL || seek == NULL) return 1;
-
-    // Find the node we want to delete
-    int found = 0;
-    while(node) {
-        if(node == seek) {
-            found = 1;
-            break;
-        }
-        prev = node;
-        node = node->next;
-    }
-
-    // If node was found, handle delete
-    if(found) {
-        // If node is not first in chain, set correct links
-        // Otherwise set possible next entry as first
-        if(prev != NULL) {
-            prev->next = node->next;
-            iter->vnow = prev;
-        } else {
-            hm->buckets[index] = node->next;
-            iter->vnow = NULL;
-            iter->inow--;
-        }
-
-        // Alld one, free up memory.
-        hm->alloc.cfree(node->pair.key);
-        hm->alloc.cfree(node->pair.val);
-        hm->alloc.cfree(node);
-        hm->reserved--;
-        return 0;
+    hashmap_node *node = iter->vnow;
+    if(node == NULL) {
+        return 1;
     }
-    return 1;
-}
 
-static void _hashmap_seek_next(hashmap *hm, iterator *iter) {
-    if(iter->inow >= hashmap_size(hm)) {
-        iter->vnow = NULL;
-        iter->ended = 1;
-        return;
-    }
-    do {
-        iter->vnow = hm->buckets[iter->inow++];
-    } while(iter->vnow == NULL && iter->inow < hashmap_size(hm));
+    // Following entries may shift into this bucket, so it needs to be looked at again.
+    unsigned int index = node - hm->buckets;
+    hashmap_remove_at(hm, index);
+    iter->inow = index;
+    iter->vnow = NULL;
+    return 0;
 }
 
 void* hashmap_iter_next(iterator *iter) {
-    hashmap_node *tmp = NULL;
     hashmap *hm = (hashmap*)iter->data;
-
-    // Find next non-empty bucket
-    if(iter->vnow == NULL) {
-        _hashmap_seek_next(hm, iter);
-        if(iter->vnow == NULL) {
-            return NULL;
+    unsigned int slots = SLOT_COUNT(hm);
+    while(iter->inow < slots) {
+        hashmap_node *node = &hm->buckets[iter->inow++];
+        if(node->dist != 0) {
+            iter->vnow = node;
+            return &node->pair;
         }
-        tmp = (hashmap_node*)iter->vnow;
-        return &tmp->pair;
     }
-
-    // We already are in a non-empty bucket. See if it has any
-    // other non-empty buckets in list. If it does, return it.
-    tmp = (hashmap_node*)iter->vnow;
-    if(tmp->next != NULL) {
-        iter->vnow = tmp->next;
-        return &tmp->next->pair;
-    }
-
-    // We are in the end of the list for this bucket.
-    // Find next non-empty bucket.
-    _hashmap_seek_next(hm, iter);
-    if(iter->vnow == NULL) {
-        return NULL;
-    }
-    tmp = (hashmap_node*)iter->vnow;
-    return &tmp->pair;
+    iter->vnow = NULL;
+    iter->ended = 1;
+    return NULL;
 }
 
 void hashmap_iter_begin(const hashmap *hm, iterator *iter) {
@@ -0,0 +1,75 @@
+#include <string.h>
+#include "utils/histogram.h"
+#include "utils/log.h"
+
+void histogram_create(histogram *h, const float *bounds, int bound_count) {
+    if(bound_count > HISTOGRAM_MAX_BUCKETS - 1) {
+        bound_count = HISTOGRAM_MAX_BUCKETS - 1;
+    }
+    memcpy(h->bounds, bounds, sizeof(float) * bound_count);
+    h->bucket_count = bound_count + 1;
+    histogram_reset(h);
+}
+
+void histogram_reset(histogram *h) {
+    memset(h->counts, 0, sizeof(h->counts));
+    h->samples = 0;
+    h->sum = 0.0;
+    h->min = 0.0f;
+    h->max = 0.0f;
+}
+
+void histogram_add(histogram *h, float value) {
+    int i = 0;
+    while(i < h->bucket_count - 1 && value >= h->bounds[i]) {
+        i++;
+    }
+    h->counts[i]++;
+    if(h->samples == 0 || value < h->min) {
+        h->min = value;
+    }
+    if(h->samples == 0 || value > h->max) {
+        h->max = value;
+    }
+    h->samples++;
+    h->sum += value;
+}
+
+float histogram_mean(const histogram *h) {
+    if(h->samples == 0) {
+        return 0.0f;
+    }
+    return h->sum / h->samples;
+}
+
+// Upper bound of the bucket the p:th fraction of samples falls in; the maximum for the last one.
+float histogram_percentile(const histogram *h, float p) {
+    unsigned int target = p * h->samples;
+    unsigned int seen = 0;
+    for(int i = 0; i < h->bucket_count - 1; i++) {
+        seen += h->counts[i];
+        if(seen > target) {
+            return h->bounds[i];
+        }
+    }
+    return h->max;
+}
+
+void histogram_log(const histogram *h, const char *name, const char *unit) {
+    if(h->samples == 0) {
+        return;
+    }
+    INFO("%s: %u samples, mean %.2f %s, min %.2f %s, max %.2f %s",
+         name, h->samples,
+         histogram_mean(h), unit,
+         h->min, unit,
+         h->max, unit);
+    for(int i = 0; i < h->bucket_count; i++) {
+        float share = 100.0f * h->counts[i] / h->samples;
+        if(i < h->bucket_count - 1) {
+            INFO(" * < %6.2f %s: %8u (%5.1f%%)", h->bounds[i], unit, h->counts[i], share);
+        } else {
+            INFO(" * >=%6.2f %s: %8u (%5.1f%%)", h->bounds[i - 1], unit, h->counts[i], share);
+        }
+    }
+}
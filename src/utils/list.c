@@ -1,4 +1,5 @@
 #include "utils/list.h"
+#include "utils/memtrack.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -6,9 +7,7 @@ void list_create(list *list) {
     list->first = NULL;
     list->last = NULL;
     list->size = 0;
-    list->alloc.cmalloc = malloc;
-    list->alloc.crealloc = realloc;
-    list->alloc.cfree = free;
+    memtrack_get_allocator(&list->alloc);
 }
 
 void list_create_with_allocator(list *list, allocator alloc) {
@@ -1,10 +1,418 @@
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+#include <SDL2/SDL.h>
 #include "utils/log.h"
 
-FILE *handle = 0;
+/*
+* Messages are not formatted when they are logged. The call site copies the
+* format pointer and the arguments into a slot of a bounded lock-free queue,
+* and a writer thread formats them and writes them out in batches.
+*
+* The queue takes many producers and one consumer. Every slot has a sequence
+* number that tells whether it is free for the producer whose turn it is, or
+* filled for the consumer. If the queue is full the message is dropped and
+* counted, rather than making the game wait. Before log_init and after
+* log_close messages are formatted and written right away.
+*/
+
+#define LOG_QUEUE_SIZE 1024 // Must be a power of two
+#define LOG_ARGS_SIZE 480
+#define LOG_LINE_SIZE 1024
+#define LOG_BATCH_SIZE 65536
+#define LOG_MAX_MODULES 16
+#define LOG_WRITER_DELAY 5
+
+typedef struct {
+    atomic_uint seq;
+    unsigned char level;
+    unsigned char preformatted; // args holds the finished message
+    unsigned int tick;
+    const char *file;
+    const char *fn;
+    const char *fmt;
+    char args[LOG_ARGS_SIZE];
+} log_record;
+
+typedef struct {
+    char name[32];
+    atomic_int level; // -1 to follow the global level
+} log_module;
+
+// One conversion of a format string
+typedef struct {
+    const char *start; // The '%'
+    const char *end; // One past the conversion character
+    int width_star;
+    int prec_star;
+    int prec;
+    char length; // 0, 'H' (hh), 'h', 'l', 'q' (ll), 'j', 'z', 't' or 'L'
+    char conv;
+} log_spec;
+
+enum {
+    LOG_ARG_INT,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_INTMAX,
+    LOG_ARG_SIZE,
+    LOG_ARG_PTRDIFF,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_LDOUBLE,
+    LOG_ARG_PTR,
+    LOG_ARG_STR
+};
+
+static FILE *handle = 0;
 unsigned int _log_tick = 0;
 
+static atomic_int log_level = LOG_DEBUG;
+static log_module modules[LOG_MAX_MODULES];
+static atomic_int module_count = 0;
+
+static log_record queue[LOG_QUEUE_SIZE];
+static atomic_uint enqueue_pos;
+static unsigned int dequeue_pos = 0;
+static atomic_uint dropped;
+static atomic_int running = 0;
+static atomic_int quit = 0;
+static SDL_Thread *writer = NULL;
+static char *batch = NULL;
+
+// Parses the conversion that starts at the '%' in p. Returns 1 if it is not one we can store.
+static int log_parse_spec(const char *p, log_spec *spec) {
+    memset(spec, 0, sizeof(log_spec));
+    spec->start = p++;
+    spec->prec = -1;
+    while(*p != '\0' && strchr("-+ #0", *p) != NULL) {
+        p++;
+    }
+    if(*p == '*') {
+        spec->width_star = 1;
+        p++;
+    } else {
+        while(*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    if(*p == '.') {
+        p++;
+        spec->prec = 0;
+        if(*p == '*') {
+            spec->prec_star = 1;
+            p++;
+        } else {
+            while(*p >= '0' && *p <= '9') {
+                spec->prec = spec->prec * 10 + (*p - '0');
+                p++;
+            }
+        }
+    }
+    switch(*p) {
+        case 'h':
+            spec->length = (p[1] == 'h') ? 'H' : 'h';
+            p += (p[1] == 'h') ? 2 : 1;
+            break;
+        case 'l':
+            spec->length = (p[1] == 'l') ? 'q' : 'l';
+            p += (p[1] == 'l') ? 2 : 1;
+            break;
+        case 'j':
+        case 'z':
+        case 't':
+        case 'L':
+            spec->length = *p++;
+            break;
+    }
+    if(*p == '\0') {
+        return 1;
+    }
+    spec->conv = *p;
+    spec->end = p + 1;
+    if(strchr("diouxX", *p) != NULL || (*p == 'c' && spec->length == 0)) {
+        return 0;
+    }
+    if(strchr("fFeEgGaA", *p) != NULL || *p == 'p' || (*p == 's' && spec->length == 0)) {
+        return 0;
+    }
+    return 1;
+}
+
+static int log_arg_type(const log_spec *spec) {
+    switch(spec->conv) {
+        case 'p': return LOG_ARG_PTR;
+        case 's': return LOG_ARG_STR;
+        case 'f': case 'F': case 'e': case 'E':
+        case 'g': case 'G': case 'a': case 'A':
+            return (spec->length == 'L') ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE;
+    }
+    switch(spec->length) {
+        case 'l': return LOG_ARG_LONG;
+        case 'q': return LOG_ARG_LLONG;
+        case 'j': return LOG_ARG_INTMAX;
+        case 'z': return LOG_ARG_SIZE;
+        case 't': return LOG_ARG_PTRDIFF;
+    }
+    return LOG_ARG_INT;
+}
+
+static int log_put(log_record *r, size_t *pos, const void *value, size_t size) {
+    if(*pos + size > LOG_ARGS_SIZE) {
+        return 1;
+    }
+    memcpy(r->args + *pos, value, size);
+    *pos += size;
+    return 0;
+}
+
+#define LOG_PUT_ARG(type) \
+    { type v = va_arg(args, type); if(log_put(r, &pos, &v, sizeof(type))) return 1; }
+
+// Copies the arguments into the record. Returns 1 if they do not fit or can't be stored.
+static int log_encode(log_record *r, const char *fmt, va_list args) {
+    log_spec spec;
+    size_t pos = 0;
+    for(const char *p = fmt; *p != '\0'; p++) {
+        if(*p != '%') {
+            continue;
+        }
+        if(p[1] == '%') {
+            p++;
+            continue;
+        }
+        if(log_parse_spec(p, &spec)) {
+            return 1;
+        }
+        if(spec.width_star) {
+            LOG_PUT_ARG(int);
+        }
+        if(spec.prec_star) {
+            spec.prec = va_arg(args, int);
+            if(log_put(r, &pos, &spec.prec, sizeof(int))) {
+                return 1;
+            }
+        }
+        switch(log_arg_type(&spec)) {
+            case LOG_ARG_INT: LOG_PUT_ARG(int); break;
+            case LOG_ARG_LONG: LOG_PUT_ARG(long); break;
+            case LOG_ARG_LLONG: LOG_PUT_ARG(long long); break;
+            case LOG_ARG_INTMAX: LOG_PUT_ARG(intmax_t); break;
+            case LOG_ARG_SIZE: LOG_PUT_ARG(size_t); break;
+            case LOG_ARG_PTRDIFF: LOG_PUT_ARG(ptrdiff_t); break;
+            case LOG_ARG_DOUBLE: LOG_PUT_ARG(double); break;
+            case LOG_ARG_LDOUBLE: LOG_PUT_ARG(long double); break;
+            case LOG_ARG_PTR: LOG_PUT_ARG(void*); break;
+            case LOG_ARG_STR: {
+                // The string may be gone by the time it is written, so copy it
+                const char *s = va_arg(args, const char*);
+                size_t len = 0;
+                if(s == NULL) {
+                    s = "(null)";
+                }
+                while((spec.prec < 0 || len < (size_t)spec.prec) && s[len] != '\0') {
+                    len++;
+                }
+                if(log_put(r, &pos, s, len) || log_put(r, &pos, "", 1)) {
+                    return 1;
+                }
+                break;
+            }
+        }
+        p = spec.end - 1;
+    }
+    return 0;
+}
+
+#define LOG_FORMAT_ARG(type) \
+    { type v; memcpy(&v, r->args + pos, sizeof(type)); pos += sizeof(type); n = snprintf(out + len, size - len, f, v); }
+
+// Formats the message of the record into out, like vsnprintf would have
+static size_t log_decode(const log_record *r, char *out, size_t size) {
+    log_spec spec;
+    size_t pos = 0;
+    size_t len = 0;
+    char f[48];
+
+    if(r->preformatted) {
+        len = strlen(r->args);
+        len = (len < size - 1) ? len : size - 1;
+        memcpy(out, r->args, len);
+        out[len] = '\0';
+        return len;
+    }
+    for(const char *p = r->fmt; *p != '\0' && len < size - 1; p++) {
+        if(*p != '%') {
+            out[len++] = *p;
+            continue;
+        }
+        if(p[1] == '%') {
+            out[len++] = '%';
+            p++;
+            continue;
+        }
+        log_parse_spec(p, &spec);
+
+        // Rebuild the conversion with the stored widths in place of the stars
+        size_t flen = 0;
+        for(const char *c = spec.start; c < spec.end && flen < sizeof(f) - 12; c++) {
+            if(*c != '*') {
+                f[flen++] = *c;
+                continue;
+            }
+            int star;
+            memcpy(&star, r->args + pos, sizeof(int));
+            pos += sizeof(int);
+            if(c[-1] == '.' && star < 0) {
+                flen--; // Negative precision means no precision
+            } else {
+                flen += sprintf(f + flen, "%d", star);
+            }
+        }
+        f[flen] = '\0';
+
+        int n = 0;
+        switch(log_arg_type(&spec)) {
+            case LOG_ARG_INT: LOG_FORMAT_ARG(int); break;
+            case LOG_ARG_LONG: LOG_FORMAT_ARG(long); break;
+            case LOG_ARG_LLONG: LOG_FORMAT_ARG(long long); break;
+            case LOG_ARG_INTMAX: LOG_FORMAT_ARG(intmax_t); break;
+            case LOG_ARG_SIZE: LOG_FORMAT_ARG(size_t); break;
+            case LOG_ARG_PTRDIFF: LOG_FORMAT_ARG(ptrdiff_t); break;
+            case LOG_ARG_DOUBLE: LOG_FORMAT_ARG(double); break;
+            case LOG_ARG_LDOUBLE: LOG_FORMAT_ARG(long double); break;
+            case LOG_ARG_PTR: LOG_FORMAT_ARG(void*); break;
+            case LOG_ARG_STR: {
+                const char *s = r->args + pos;
+                pos += strlen(s) + 1;
+                n = snprintf(out + len, size - len, f, s);
+                break;
+            }
+        }
+        if(n > 0) {
+            len += ((size_t)n < size - len) ? (size_t)n : size - len - 1;
+        }
+        p = spec.end - 1;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+// Source file name without the directory and the extension
+static void log_module_name(const char *file, char *name, size_t size) {
+    const char *base = file;
+    for(const char *c = file; *c != '\0'; c++) {
+        if(*c == '/' || *c == '\\') {
+            base = c + 1;
+        }
+    }
+    size_t len = 0;
+    while(base[len] != '\0' && base[len] != '.' && len < size - 1) {
+        name[len] = base[len];
+        len++;
+    }
+    name[len] = '\0';
+}
+
+// Writes one full log line, and returns its length
+static size_t log_format(const log_record *r, char *out, size_t size) {
+    char module[32];
+    size_t len;
+    log_module_name(r->file, module, sizeof(module));
+    if(r->fn != NULL) {
+        len = snprintf(out, size, "[%7u][%c][%s] %s(): ", r->tick, "DIE"[r->level], module, r->fn);
+    } else {
+        len = snprintf(out, size, "[%7u][%c][%s] ", r->tick, "DIE"[r->level], module);
+    }
+    if(len >= size - 1) {
+        len = size - 2;
+    }
+    len += log_decode(r, out + len, size - len - 1);
+    out[len++] = '\n';
+    return len;
+}
+
+static int log_enabled(int level, const char *file) {
+    int count = atomic_load_explicit(&module_count, memory_order_acquire);
+    if(count > 0) {
+        char name[32];
+        log_module_name(file, name, sizeof(name));
+        for(int i = 0; i < count; i++) {
+            int module_level = atomic_load_explicit(&modules[i].level, memory_order_relaxed);
+            if(module_level >= 0 && strcmp(modules[i].name, name) == 0) {
+                return level >= module_level;
+            }
+        }
+    }
+    return level >= atomic_load_explicit(&log_level, memory_order_relaxed);
+}
+
+static log_record* log_acquire(unsigned int *seq) {
+    unsigned int pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+    while(1) {
+        log_record *r = &queue[pos & (LOG_QUEUE_SIZE - 1)];
+        unsigned int s = atomic_load_explicit(&r->seq, memory_order_acquire);
+        int diff = (int)(s - pos);
+        if(diff == 0) {
+            if(atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1,
+                                                     memory_order_relaxed, memory_order_relaxed)) {
+                *seq = s;
+                return r;
+            }
+        } else if(diff < 0) {
+            return NULL; // The writer has not caught up
+        } else {
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static size_t log_drain() {
+    size_t total = 0;
+    size_t len = 0;
+    while(1) {
+        log_record *r = &queue[dequeue_pos & (LOG_QUEUE_SIZE - 1)];
+        unsigned int s = atomic_load_explicit(&r->seq, memory_order_acquire);
+        if(s != dequeue_pos + 1) {
+            break;
+        }
+        len += log_format(r, batch + len, LOG_LINE_SIZE);
+        atomic_store_explicit(&r->seq, dequeue_pos + LOG_QUEUE_SIZE, memory_order_release);
+        dequeue_pos++;
+        if(len > LOG_BATCH_SIZE - LOG_LINE_SIZE * 2) {
+            fwrite(batch, 1, len, handle);
+            total += len;
+            len = 0;
+        }
+    }
+    unsigned int lost = atomic_exchange(&dropped, 0);
+    if(lost > 0) {
+        len += snprintf(batch + len, LOG_LINE_SIZE, "[%7u][E] %u log messages were dropped\n", _log_tick, lost);
+    }
+    if(len > 0) {
+        fwrite(batch, 1, len, handle);
+        fflush(handle);
+    }
+    return total + len;
+}
+
+static int log_writer(void *userdata) {
+    while(1) {
+        int stop = atomic_load(&quit);
+        if(log_drain() == 0) {
+            if(stop) {
+                break;
+            }
+            SDL_Delay(LOG_WRITER_DELAY);
+        }
+    }
+    return 0;
+}
+
 int log_init(const char *filename) {
     if(handle)
         return 1;
@@ -17,27 +425,117 @@ int log_init(const char *filename) {
             return 1;
         }
     }
+
+    for(unsigned int i = 0; i < LOG_QUEUE_SIZE; i++) {
+        atomic_init(&queue[i].seq, i);
+    }
+    atomic_store(&enqueue_pos, 0);
+    atomic_store(&dropped, 0);
+    atomic_store(&quit, 0);
+    dequeue_pos = 0;
+    batch = malloc(LOG_BATCH_SIZE);
+    writer = SDL_CreateThread(log_writer, "log writer", NULL);
+    if(writer == NULL) {
+        // Not fatal; just write everything right away
+        free(batch);
+        batch = NULL;
+        return 0;
+    }
+    atomic_store(&running, 1);
     return 0;
 }
 
 void log_close() {
+    if(writer != NULL) {
+        atomic_store(&running, 0);
+        atomic_store(&quit, 1);
+        SDL_WaitThread(writer, NULL);
+        writer = NULL;
+        free(batch);
+        batch = NULL;
+    }
     if(handle != stdout && handle != 0) {
         fclose(handle);
     }
+    handle = 0;
 }
 
-void log_print(char mode, const char *fn, const char *fmt, ...) {
-    if(handle == 0)
+void log_print(int level, const char *file, const char *fn, const char *fmt, ...) {
+    if(handle == 0 || !log_enabled(level, file))
         return;
-    if(fn != NULL) {
-        fprintf(handle, "[%7u][%c] %s(): ", _log_tick, mode, fn);
-    } else {
-        fprintf(handle, "[%7u][%c] ", _log_tick, mode);
-    }
+
     va_list args;
     va_start(args, fmt);
-    vfprintf(handle, fmt, args);
+    if(atomic_load_explicit(&running, memory_order_acquire)) {
+        unsigned int seq;
+        log_record *r = log_acquire(&seq);
+        if(r == NULL) {
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+            va_end(args);
+            return;
+        }
+        r->level = level;
+        r->tick = _log_tick;
+        r->file = file;
+        r->fn = fn;
+        r->fmt = fmt;
+        va_list copy;
+        va_copy(copy, args);
+        r->preformatted = log_encode(r, fmt, copy);
+        va_end(copy);
+        if(r->preformatted) {
+            vsnprintf(r->args, LOG_ARGS_SIZE, fmt, args);
+        }
+        atomic_store_explicit(&r->seq, seq + 1, memory_order_release);
+    } else {
+        log_record r;
+        char line[LOG_LINE_SIZE];
+        r.level = level;
+        r.tick = _log_tick;
+        r.file = file;
+        r.fn = fn;
+        r.fmt = fmt;
+        r.preformatted = 1;
+        vsnprintf(r.args, LOG_ARGS_SIZE, fmt, args);
+        fwrite(line, 1, log_format(&r, line, sizeof(line)), handle);
+        fflush(handle);
+    }
     va_end(args);
-    fprintf(handle, "\n");
-    fflush(handle);
+}
+
+void log_set_level(int level) {
+    atomic_store(&log_level, level);
+}
+
+int log_get_level() {
+    return atomic_load(&log_level);
+}
+
+// Not to be called from more than one thread at a time
+int log_set_module_level(const char *module, int level) {
+    int count = atomic_load(&module_count);
+    for(int i = 0; i < count; i++) {
+        if(strcmp(modules[i].name, module) == 0) {
+            atomic_store(&modules[i].level, level);
+            return 0;
+        }
+    }
+    if(count >= LOG_MAX_MODULES || strlen(module) >= sizeof(modules[count].name)) {
+        return 1;
+    }
+    strcpy(modules[count].name, module);
+    atomic_store(&modules[count].level, level);
+    atomic_store_explicit(&module_count, count + 1, memory_order_release);
+    return 0;
+}
+
+// "debug", "info", "error" or "off", or just the first letter. Returns -1 for anything else.
+int log_parse_level(const char *name) {
+    static const char *names[] = {"debug", "info", "error", "off"};
+    for(int i = 0; i <= LOG_OFF; i++) {
+        if(strcasecmp(name, names[i]) == 0 || (tolower((unsigned char)name[0]) == names[i][0] && name[1] == '\0')) {
+            return i;
+        }
+    }
+    return -1;
 }
@@ -0,0 +1,167 @@
+#include <stddef.h>
+#include <stdatomic.h>
+#include "utils/memtrack.h"
+#include "utils/log.h"
+
+static const char *tag_names[] = {
+    "containers",
+    "BK sprites",
+    "AF sprites",
+    "surfaces",
+    "tcache textures",
+    "audio buffers",
+    "objects",
+};
+
+#ifdef MEMTRACK
+
+typedef struct {
+    atomic_llong bytes;
+    atomic_llong peak;
+    atomic_llong live;
+    atomic_ullong total;
+} memtrack_counter;
+
+// Sits in front of every block from memtrack_malloc, and keeps the block aligned
+typedef union {
+    struct {
+        size_t size;
+        int tag;
+    } info;
+    max_align_t align;
+} memtrack_header;
+
+static memtrack_counter counters[MEM_TAG_COUNT];
+
+void memtrack_add(int tag, size_t bytes) {
+    memtrack_counter *c = &counters[tag];
+    long long now = atomic_fetch_add_explicit(&c->bytes, bytes, memory_order_relaxed) + bytes;
+    long long peak = atomic_load_explicit(&c->peak, memory_order_relaxed);
+    while(now > peak && !atomic_compare_exchange_weak_explicit(&c->peak, &peak, now,
+                                                               memory_order_relaxed, memory_order_relaxed));
+    atomic_fetch_add_explicit(&c->live, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->total, 1, memory_order_relaxed);
+}
+
+void memtrack_sub(int tag, size_t bytes) {
+    atomic_fetch_sub_explicit(&counters[tag].bytes, bytes, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&counters[tag].live, 1, memory_order_relaxed);
+}
+
+// Moves an allocation that has already been counted to another subsystem
+void memtrack_move(int from, int to, size_t bytes) {
+    if(from == to) {
+        return;
+    }
+    memtrack_sub(from, bytes);
+    memtrack_add(to, bytes);
+    atomic_fetch_sub_explicit(&counters[to].total, 1, memory_order_relaxed);
+}
+
+void* memtrack_malloc(int tag, size_t size) {
+    memtrack_header *h = malloc(sizeof(memtrack_header) + size);
+    if(h == NULL) {
+        return NULL;
+    }
+    h->info.size = size;
+    h->info.tag = tag;
+    memtrack_add(tag, size);
+    return h + 1;
+}
+
+void* memtrack_realloc(int tag, void *ptr, size_t size) {
+    if(ptr == NULL) {
+        return memtrack_malloc(tag, size);
+    }
+    memtrack_header *old = (memtrack_header*)ptr - 1;
+    size_t old_size = old->info.size;
+    int old_tag = old->info.tag;
+    memtrack_header *h = realloc(old, sizeof(memtrack_header) + size);
+    if(h == NULL) {
+        return NULL;
+    }
+    memtrack_sub(old_tag, old_size);
+    atomic_fetch_sub_explicit(&counters[tag].total, 1, memory_order_relaxed);
+    memtrack_add(tag, size);
+    h->info.size = size;
+    h->info.tag = tag;
+    return h + 1;
+}
+
+void memtrack_free(void *ptr) {
+    if(ptr == NULL) {
+        return;
+    }
+    memtrack_header *h = (memtrack_header*)ptr - 1;
+    memtrack_sub(h->info.tag, h->info.size);
+    free(h);
+}
+
+static void* memtrack_container_malloc(size_t size) {
+    return memtrack_malloc(MEM_CONTAINERS, size);
+}
+
+static void* memtrack_container_realloc(void *ptr, size_t size) {
+    return memtrack_realloc(MEM_CONTAINERS, ptr, size);
+}
+
+int memtrack_enabled() {
+    return 1;
+}
+
+/** \brief Gets the allocator that vector, hashmap and list use by default.
+  * Memory is counted as containers.
+  * \param alloc Allocator struct to fill
+  */
+void memtrack_get_allocator(allocator *alloc) {
+    alloc->cmalloc = memtrack_container_malloc;
+    alloc->cfree = memtrack_free;
+    alloc->crealloc = memtrack_container_realloc;
+}
+
+void memtrack_get_stats(int tag, memtrack_stats *stats) {
+    stats->bytes = atomic_load_explicit(&counters[tag].bytes, memory_order_relaxed);
+    stats->peak = atomic_load_explicit(&counters[tag].peak, memory_order_relaxed);
+    stats->live = atomic_load_explicit(&counters[tag].live, memory_order_relaxed);
+    stats->total = atomic_load_explicit(&counters[tag].total, memory_order_relaxed);
+}
+
+#else
+
+int memtrack_enabled() {
+    return 0;
+}
+
+void memtrack_get_allocator(allocator *alloc) {
+    alloc->cmalloc = malloc;
+    alloc->cfree = free;
+    alloc->crealloc = realloc;
+}
+
+void memtrack_get_stats(int tag, memtrack_stats *stats) {
+    stats->bytes = 0;
+    stats->peak = 0;
+    stats->live = 0;
+    stats->total = 0;
+}
+
+#endif // MEMTRACK
+
+const char* memtrack_tag_name(int tag) {
+    if(tag < 0 || tag >= MEM_TAG_COUNT) {
+        return "unknown";
+    }
+    return tag_names[tag];
+}
+
+// Logs everything that is still allocated, by subsystem
+void memtrack_report_leaks() {
+    memtrack_stats stats;
+    for(int i = 0; i < MEM_TAG_COUNT; i++) {
+        memtrack_get_stats(i, &stats);
+        if(stats.live != 0 || stats.bytes != 0) {
+            PERROR("Memory leak in %s: %lld bytes in %lld allocations (peak %lld bytes).",
+                   tag_names[i], stats.bytes, stats.live, stats.peak);
+        }
+    }
+}
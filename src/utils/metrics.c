@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <SDL2/SDL.h>
+#include "utils/metrics.h"
+#include "utils/log.h"
+
+/*
+* Counters, gauges and fixed bucket histograms for keeping an eye on long
+* running hosts. Every metric has static storage, and recording is a single
+* relaxed atomic operation, so it is always on. The values are written out in
+* the Prometheus text format, eg. for the node exporter textfile collector.
+*/
+
+#define METRICS_MAX_BUCKETS 16
+#define METRICS_FORMAT_SIZE 16384
+
+typedef struct {
+    const char *name;
+    const char *help;
+    int type;
+    const char *label; // Name of the slot label, if the metric has more than one slot
+    int slots;
+    const float *bounds; // Upper bounds of the histogram buckets
+    int bound_count;
+} metric_def;
+
+typedef struct {
+    atomic_llong value[METRICS_MAX_SLOTS];
+    atomic_ullong buckets[METRICS_MAX_BUCKETS];
+    atomic_llong sum; // Histogram sum in millionths
+} metric;
+
+static const float tick_time_bounds[] = {0.05f, 0.1f, 0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f};
+static const float frame_time_bounds[] = {2.0f, 4.0f, 8.0f, 12.0f, 17.0f, 21.0f, 34.0f, 50.0f, 100.0f};
+
+#define BOUNDS(b) b, sizeof(b) / sizeof(float)
+
+static const metric_def defs[METRIC_COUNT] = {
+    {"ticks_total", "Dynamic game ticks run", METRIC_COUNTER, NULL, 1, NULL, 0},
+    {"ticks_per_second", "Dynamic game ticks run during the last second", METRIC_GAUGE, NULL, 1, NULL, 0},
+    {"tick_time_ms", "Time taken by a dynamic tick", METRIC_HISTOGRAM, NULL, 1, BOUNDS(tick_time_bounds)},
+    {"frame_time_ms", "Time between main loop rounds", METRIC_HISTOGRAM, NULL, 1, BOUNDS(frame_time_bounds)},
+    {"objects", "Objects in the game state", METRIC_GAUGE, NULL, 1, NULL, 0},
+    {"tcache_hits_total", "Texture cache hits", METRIC_COUNTER, NULL, 1, NULL, 0},
+    {"tcache_misses_total", "Texture cache misses", METRIC_COUNTER, NULL, 1, NULL, 0},
+    {"packets_sent_total", "Network packets sent", METRIC_COUNTER, NULL, 1, NULL, 0},
+    {"packets_received_total", "Network packets received", METRIC_COUNTER, NULL, 1, NULL, 0},
+    {"bytes_sent_total", "Network bytes sent", METRIC_COUNTER, NULL, 1, NULL, 0},
+    {"bytes_received_total", "Network bytes received", METRIC_COUNTER, NULL, 1, NULL, 0},
+    {"peer_rtt_ticks", "Round trip time to the peer", METRIC_GAUGE, "peer", METRICS_MAX_SLOTS, NULL, 0},
+    {"syncs_sent_total", "Game state syncs sent to the peer", METRIC_COUNTER, NULL, 1, NULL, 0},
+    {"serialized_bytes_total", "Bytes of game state serialized", METRIC_COUNTER, NULL, 1, NULL, 0},
+    {"frame_alloc_bytes", "Bytes taken from the frame arena during the last frame", METRIC_GAUGE, NULL, 1, NULL, 0},
+    {"frame_alloc_peak_bytes", "Highest frame arena usage", METRIC_GAUGE, NULL, 1, NULL, 0},
+};
+
+static metric metrics[METRIC_COUNT];
+
+static char *out_path = NULL;
+static unsigned int out_interval = 0;
+static unsigned int last_write = 0;
+static unsigned int last_second = 0;
+static long long last_ticks = 0;
+
+void metrics_add(int id, long long amount) {
+    atomic_fetch_add_explicit(&metrics[id].value[0], amount, memory_order_relaxed);
+}
+
+void metrics_set(int id, long long value) {
+    atomic_store_explicit(&metrics[id].value[0], value, memory_order_relaxed);
+}
+
+void metrics_set_slot(int id, int slot, long long value) {
+    if(slot < 0 || slot >= defs[id].slots) {
+        return;
+    }
+    atomic_store_explicit(&metrics[id].value[slot], value, memory_order_relaxed);
+}
+
+void metrics_observe(int id, float value) {
+    const metric_def *def = &defs[id];
+    int i = 0;
+    while(i < def->bound_count && value > def->bounds[i]) {
+        i++;
+    }
+    atomic_fetch_add_explicit(&metrics[id].buckets[i], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&metrics[id].sum, (long long)(value * 1000000.0f), memory_order_relaxed);
+}
+
+long long metrics_get(int id, int slot) {
+    return atomic_load_explicit(&metrics[id].value[slot], memory_order_relaxed);
+}
+
+unsigned long long metrics_count(int id) {
+    unsigned long long count = 0;
+    for(int i = 0; i <= defs[id].bound_count; i++) {
+        count += atomic_load_explicit(&metrics[id].buckets[i], memory_order_relaxed);
+    }
+    return count;
+}
+
+// Upper bound of the bucket the p:th fraction of observations falls in. Past the
+// last bound there is no upper bound, so the last bound is returned.
+float metrics_percentile(int id, float p) {
+    const metric_def *def = &defs[id];
+    unsigned long long target = p * metrics_count(id);
+    unsigned long long seen = 0;
+    if(def->bound_count == 0) {
+        return 0.0f;
+    }
+    for(int i = 0; i < def->bound_count; i++) {
+        seen += atomic_load_explicit(&metrics[id].buckets[i], memory_order_relaxed);
+        if(seen > target) {
+            return def->bounds[i];
+        }
+    }
+    return def->bounds[def->bound_count - 1];
+}
+
+void metrics_reset() {
+    for(int id = 0; id < METRIC_COUNT; id++) {
+        for(int s = 0; s < METRICS_MAX_SLOTS; s++) {
+            atomic_store(&metrics[id].value[s], 0);
+        }
+        for(int i = 0; i < METRICS_MAX_BUCKETS; i++) {
+            atomic_store(&metrics[id].buckets[i], 0);
+        }
+        atomic_store(&metrics[id].sum, 0);
+    }
+    last_ticks = 0;
+}
+
+static size_t metrics_append(char *buf, size_t size, size_t len, const char *fmt, ...) {
+    if(len >= size) {
+        return len;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + len, size - len, fmt, args);
+    va_end(args);
+    if(n < 0) {
+        return len;
+    }
+    return ((size_t)n < size - len) ? len + n : size - 1;
+}
+
+// Writes all metrics in the Prometheus text format. Returns the length written.
+size_t metrics_format(char *buf, size_t size) {
+    static const char *type_names[] = {"counter", "gauge", "histogram"};
+    size_t len = 0;
+    buf[0] = '\0';
+    for(int id = 0; id < METRIC_COUNT; id++) {
+        const metric_def *def = &defs[id];
+        const metric *m = &metrics[id];
+        len = metrics_append(buf, size, len, "# HELP openomf_%s %s\n", def->name, def->help);
+        len = metrics_append(buf, size, len, "# TYPE openomf_%s %s\n", def->name, type_names[def->type]);
+        if(def->type != METRIC_HISTOGRAM) {
+            for(int s = 0; s < def->slots; s++) {
+                long long value = atomic_load_explicit(&m->value[s], memory_order_relaxed);
+                if(def->label != NULL) {
+                    len = metrics_append(buf, size, len, "openomf_%s{%s=\"%d\"} %lld\n", def->name, def->label, s, value);
+                } else {
+                    len = metrics_append(buf, size, len, "openomf_%s %lld\n", def->name, value);
+                }
+            }
+            continue;
+        }
+        unsigned long long count = 0;
+        for(int i = 0; i <= def->bound_count; i++) {
+            count += atomic_load_explicit(&m->buckets[i], memory_order_relaxed);
+            if(i < def->bound_count) {
+                len = metrics_append(buf, size, len, "openomf_%s_bucket{le=\"%g\"} %llu\n", def->name, def->bounds[i], count);
+            } else {
+                len = metrics_append(buf, size, len, "openomf_%s_bucket{le=\"+Inf\"} %llu\n", def->name, count);
+            }
+        }
+        double sum = atomic_load_explicit(&m->sum, memory_order_relaxed) / 1000000.0;
+        len = metrics_append(buf, size, len, "openomf_%s_sum %.6f\n", def->name, sum);
+        len = metrics_append(buf, size, len, "openomf_%s_count %llu\n", def->name, count);
+    }
+    return len;
+}
+
+// Writes the metrics into a temporary file first, so that readers never see a partial file
+int metrics_write(const char *path) {
+    char *buf = malloc(METRICS_FORMAT_SIZE);
+    char *tmp_path = malloc(strlen(path) + 5);
+    int ret = 1;
+    size_t len = metrics_format(buf, METRICS_FORMAT_SIZE);
+    sprintf(tmp_path, "%s.tmp", path);
+
+    FILE *f = fopen(tmp_path, "w");
+    if(f == NULL) {
+        PERROR("Could not open %s for writing!", tmp_path);
+        goto exit_0;
+    }
+    size_t written = fwrite(buf, 1, len, f);
+    fclose(f);
+    if(written != len) {
+        PERROR("Writing metrics to %s failed!", tmp_path);
+        goto exit_0;
+    }
+#if defined(_WIN32) || defined(WIN32)
+    remove(path);
+#endif
+    if(rename(tmp_path, path) != 0) {
+        PERROR("Could not move metrics to %s!", path);
+        goto exit_0;
+    }
+    ret = 0;
+
+exit_0:
+    free(tmp_path);
+    free(buf);
+    return ret;
+}
+
+void metrics_init(const char *path, int interval_s) {
+    free(out_path);
+    out_path = NULL;
+    if(path != NULL && strlen(path) > 0) {
+        out_path = strcpy(malloc(strlen(path) + 1), path);
+        out_interval = (interval_s > 0 ? interval_s : 1) * 1000;
+        INFO("Writing metrics to %s every %u seconds.", out_path, out_interval / 1000);
+    }
+    last_write = last_second = SDL_GetTicks();
+    last_ticks = metrics_get(METRIC_TICKS, 0);
+}
+
+void metrics_tick() {
+    unsigned int now = SDL_GetTicks();
+    if(now - last_second >= 1000) {
+        long long ticks = metrics_get(METRIC_TICKS, 0);
+        metrics_set(METRIC_TICKS_PER_SECOND, (ticks - last_ticks) * 1000 / (now - last_second));
+        last_ticks = ticks;
+        last_second = now;
+    }
+    if(out_path != NULL && now - last_write >= out_interval) {
+        if(metrics_write(out_path)) {
+            // Don't keep failing every round
+            free(out_path);
+            out_path = NULL;
+        }
+        last_write = now;
+    }
+}
+
+void metrics_close() {
+    if(out_path != NULL) {
+        metrics_write(out_path);
+        free(out_path);
+        out_path = NULL;
+    }
+}
@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <string.h>
+#include "utils/pool.h"
+
+#define POOL_MAX_CAPACITY 0xFFFF
+#define HANDLE_INDEX(h) ((h) & 0xFFFF)
+#define HANDLE_GEN(h) ((h) >> 16)
+
+static unsigned int pool_index_of(const pool *p, const void *ptr) {
+    return (unsigned int)(((const char*)ptr - p->data) / p->slot_size);
+}
+
+/** \brief Creates a fixed size pool
+  * \param p Pool struct to initialize
+  * \param item_size Size of a single item. Slots are padded to cache line size.
+  * \param capacity Number of slots. Max 65535.
+  * \return 0 on success, 1 on error.
+  */
+int pool_create(pool *p, size_t item_size, unsigned int capacity) {
+    if(capacity == 0 || capacity > POOL_MAX_CAPACITY) {
+        return 1;
+    }
+    p->slot_size = (item_size + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+    p->capacity = capacity;
+    p->used = 0;
+    p->block = malloc(p->slot_size * capacity + POOL_ALIGN - 1);
+    p->next_free = malloc(sizeof(int) * capacity);
+    p->generations = malloc(sizeof(uint16_t) * capacity);
+    if(p->block == NULL || p->next_free == NULL || p->generations == NULL) {
+        free(p->block);
+        free(p->next_free);
+        free(p->generations);
+        return 1;
+    }
+    uintptr_t addr = (uintptr_t)p->block;
+    p->data = (char*)((addr + POOL_ALIGN - 1) & ~(uintptr_t)(POOL_ALIGN - 1));
+
+    // Free list runs through the slots in order
+    for(unsigned int i = 0; i < capacity; i++) {
+        p->next_free[i] = i + 1;
+        p->generations[i] = 1;
+    }
+    p->next_free[capacity - 1] = -1;
+    p->free_head = 0;
+    return 0;
+}
+
+/** \brief Frees the pool memory. Items still in the pool are not cleaned up.
+  * \param p Pool to free
+  */
+void pool_free(pool *p) {
+    free(p->block);
+    free(p->next_free);
+    free(p->generations);
+    p->block = NULL;
+    p->data = NULL;
+    p->next_free = NULL;
+    p->generations = NULL;
+    p->capacity = 0;
+    p->used = 0;
+    p->free_head = -1;
+}
+
+/** \brief Takes a slot from the pool
+  * \param p Pool to allocate from
+  * \param handle If not NULL, the handle of the new slot is written here.
+  * \return Pointer to slot memory, or NULL if the pool is full.
+  */
+void* pool_alloc(pool *p, pool_handle *handle) {
+    if(p->free_head < 0) {
+        return NULL;
+    }
+    int index = p->free_head;
+    p->free_head = p->next_free[index];
+    p->next_free[index] = -1;
+    p->used++;
+    if(handle != NULL) {
+        *handle = ((pool_handle)p->generations[index] << 16) | index;
+    }
+    return p->data + p->slot_size * index;
+}
+
+/** \brief Returns a slot to the pool. Any handles to the slot become invalid.
+  * \param p Pool the slot belongs to
+  * \param ptr Slot memory, as returned by pool_alloc
+  */
+void pool_release(pool *p, void *ptr) {
+    unsigned int index = pool_index_of(p, ptr);
+    // Generation 0 is reserved, so that handle 0 is never valid
+    p->generations[index]++;
+    if(p->generations[index] == 0) {
+        p->generations[index] = 1;
+    }
+    p->next_free[index] = p->free_head;
+    p->free_head = index;
+    p->used--;
+}
+
+/** \brief Checks whether the pointer points to pool memory
+  * \param p Pool to check
+  * \param ptr Pointer to check
+  * \return 1 if the pointer belongs to the pool, 0 otherwise.
+  */
+int pool_owns(const pool *p, const void *ptr) {
+    if(p->data == NULL) {
+        return 0;
+    }
+    const char *c = ptr;
+    return (c >= p->data && c < p->data + p->slot_size * p->capacity);
+}
+
+/** \brief Gets a handle for an allocated slot
+  * \param p Pool the slot belongs to
+  * \param ptr Slot memory
+  * \return Handle, or POOL_INVALID_HANDLE if the pointer is not from the pool.
+  */
+pool_handle pool_get_handle(const pool *p, const void *ptr) {
+    if(!pool_owns(p, ptr)) {
+        return POOL_INVALID_HANDLE;
+    }
+    unsigned int index = pool_index_of(p, ptr);
+    return ((pool_handle)p->generations[index] << 16) | index;
+}
+
+/** \brief Resolves a handle to slot memory
+  * \param p Pool the handle belongs to
+  * \param handle Handle to resolve
+  * \return Slot memory, or NULL if the slot has been released since.
+  */
+void* pool_get(const pool *p, pool_handle handle) {
+    unsigned int index = HANDLE_INDEX(handle);
+    if(index >= p->capacity || p->generations[index] != HANDLE_GEN(handle)) {
+        return NULL;
+    }
+    return p->data + p->slot_size * index;
+}
+
+/** \brief Returns the amount of slots in use
+  * \param p Pool
+  */
+unsigned int pool_size(const pool *p) {
+    return p->used;
+}
@@ -0,0 +1,287 @@
+#include <SDL2/SDL.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils/profiler.h"
+#include "utils/log.h"
+
+/*
+* Scoped zone profiler.
+*
+* Every finished zone is added to the totals of the running frame, and those
+* are averaged over a few frames for the overlay. Each zone is also written as an
+* event to a ring buffer of the thread it ran on, so that the last few thousand
+* zones of every thread can be exported as a Chrome trace (chrome://tracing).
+* Threads give their ring back with profiler_thread_exit, and the next thread
+* to need one takes it over.
+*/
+
+#define PROFILER_WINDOW 30 // Frames to average zone times over
+
+typedef struct profiler_event_t {
+    uint64_t start;
+    uint64_t end;
+    int zone;
+} profiler_event;
+
+typedef struct profiler_ring_t {
+    profiler_event events[PROFILER_RING_SIZE];
+    atomic_uint head; // Number of events ever written
+    atomic_int in_use; // 0 once the thread has exited; the events are kept until the ring is taken over
+    unsigned long thread_id;
+} profiler_ring;
+
+static const char *zone_names[] = {
+    "tick cleanup",
+    "tick move",
+    "tick collide",
+    "tick objects",
+    "render background",
+    "render bottom",
+    "render middle",
+    "render top",
+    "render overlay",
+    "render finish",
+    "composite band",
+    "tcache miss",
+    "audio",
+    "scene load",
+};
+
+static atomic_int enabled = 0;
+static uint64_t perf_freq = 1;
+static uint64_t epoch = 0;
+
+// Running frame, written from any thread
+static atomic_uint_fast64_t zone_ticks[PROFILE_ZONE_COUNT];
+static atomic_uint zone_calls[PROFILE_ZONE_COUNT];
+
+// Averaging window, and its last results. Only touched by profiler_frame() and the overlay.
+static uint64_t window_ticks[PROFILE_ZONE_COUNT];
+static unsigned int window_calls[PROFILE_ZONE_COUNT];
+static int window_frames = 0;
+static float zone_ms[PROFILE_ZONE_COUNT];
+static float zone_avg_calls[PROFILE_ZONE_COUNT];
+
+static _Atomic(profiler_ring*) rings[PROFILER_MAX_THREADS];
+static _Thread_local profiler_ring *thread_ring = NULL;
+static _Thread_local int thread_ring_failed = 0;
+
+void profiler_init() {
+    perf_freq = SDL_GetPerformanceFrequency();
+    epoch = SDL_GetPerformanceCounter();
+    for(int i = 0; i < PROFILER_MAX_THREADS; i++) {
+        atomic_init(&rings[i], NULL);
+    }
+    for(int i = 0; i < PROFILE_ZONE_COUNT; i++) {
+        atomic_init(&zone_ticks[i], 0);
+        atomic_init(&zone_calls[i], 0);
+    }
+}
+
+// Other threads should be gone by now
+void profiler_close() {
+    enabled = 0;
+    for(int i = 0; i < PROFILER_MAX_THREADS; i++) {
+        free(atomic_exchange(&rings[i], NULL));
+    }
+    thread_ring = NULL;
+    thread_ring_failed = 0;
+}
+
+static void profiler_reset_window() {
+    memset(window_ticks, 0, sizeof(window_ticks));
+    memset(window_calls, 0, sizeof(window_calls));
+    memset(zone_ms, 0, sizeof(zone_ms));
+    memset(zone_avg_calls, 0, sizeof(zone_avg_calls));
+    window_frames = 0;
+}
+
+void profiler_set_enabled(int enable) {
+    if(enable) {
+        for(int i = 0; i < PROFILE_ZONE_COUNT; i++) {
+            zone_ticks[i] = 0;
+            zone_calls[i] = 0;
+        }
+        profiler_reset_window();
+    }
+    enabled = enable;
+    INFO("Profiler %s.", enable ? "enabled" : "disabled");
+}
+
+int profiler_is_enabled() {
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+// Ring buffer of the calling thread, taken on first use. The ring of a thread
+// that has exited is reused if there is one. NULL if we have run out of them.
+static profiler_ring* profiler_get_ring() {
+    if(thread_ring != NULL || thread_ring_failed) {
+        return thread_ring;
+    }
+    for(int i = 0; i < PROFILER_MAX_THREADS; i++) {
+        profiler_ring *r = atomic_load(&rings[i]);
+        if(r == NULL) {
+            profiler_ring *fresh = malloc(sizeof(profiler_ring));
+            if(fresh == NULL) {
+                break;
+            }
+            atomic_init(&fresh->head, 0);
+            atomic_init(&fresh->in_use, 1);
+            fresh->thread_id = SDL_ThreadID();
+            if(atomic_compare_exchange_strong(&rings[i], &r, fresh)) {
+                thread_ring = fresh;
+                return fresh;
+            }
+            // Another thread got this slot first; see if its ring is free
+            free(fresh);
+        }
+        int idle = 0;
+        if(atomic_compare_exchange_strong(&r->in_use, &idle, 1)) {
+            r->thread_id = SDL_ThreadID();
+            atomic_store(&r->head, 0);
+            thread_ring = r;
+            return r;
+        }
+    }
+    thread_ring_failed = 1;
+    return NULL;
+}
+
+/** \brief Gives the ring buffer of the calling thread back for other threads to use.
+  *
+  * Threads that may run profiled zones should call this before they exit.
+  */
+void profiler_thread_exit() {
+    if(thread_ring != NULL) {
+        atomic_store(&thread_ring->in_use, 0);
+    }
+    thread_ring = NULL;
+    thread_ring_failed = 0;
+}
+
+// Number of threads that currently have a ring buffer
+int profiler_thread_count() {
+    int count = 0;
+    for(int i = 0; i < PROFILER_MAX_THREADS; i++) {
+        profiler_ring *r = atomic_load(&rings[i]);
+        if(r != NULL && atomic_load(&r->in_use)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint64_t profiler_begin() {
+    if(!atomic_load_explicit(&enabled, memory_order_relaxed)) {
+        return 0;
+    }
+    return SDL_GetPerformanceCounter();
+}
+
+void profiler_end(int zone, uint64_t start) {
+    // Profiler was off when the zone began
+    if(start == 0) {
+        return;
+    }
+    uint64_t end = SDL_GetPerformanceCounter();
+    atomic_fetch_add_explicit(&zone_ticks[zone], end - start, memory_order_relaxed);
+    atomic_fetch_add_explicit(&zone_calls[zone], 1, memory_order_relaxed);
+
+    profiler_ring *r = profiler_get_ring();
+    if(r == NULL) {
+        return;
+    }
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    profiler_event *ev = &r->events[head % PROFILER_RING_SIZE];
+    ev->start = start;
+    ev->end = end;
+    ev->zone = zone;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+// Called once per frame, after the frame has been rendered
+void profiler_frame() {
+    if(!profiler_is_enabled()) {
+        return;
+    }
+    for(int i = 0; i < PROFILE_ZONE_COUNT; i++) {
+        window_ticks[i] += atomic_exchange_explicit(&zone_ticks[i], 0, memory_order_relaxed);
+        window_calls[i] += atomic_exchange_explicit(&zone_calls[i], 0, memory_order_relaxed);
+    }
+    window_frames++;
+    if(window_frames < PROFILER_WINDOW) {
+        return;
+    }
+    for(int i = 0; i < PROFILE_ZONE_COUNT; i++) {
+        zone_ms[i] = (double)window_ticks[i] * 1000.0 / perf_freq / window_frames;
+        zone_avg_calls[i] = (float)window_calls[i] / window_frames;
+        window_ticks[i] = 0;
+        window_calls[i] = 0;
+    }
+    window_frames = 0;
+}
+
+const char* profiler_zone_name(int zone) {
+    return zone_names[zone];
+}
+
+// Average time spent in the zone per frame
+float profiler_zone_ms(int zone) {
+    return zone_ms[zone];
+}
+
+// Average number of times the zone was run per frame
+float profiler_zone_calls(int zone) {
+    return zone_avg_calls[zone];
+}
+
+/*
+ * Writes the events in all ring buffers as Chrome trace JSON. Other threads
+ * should be between frames while this runs, or their newest events may come
+ * out garbled. Returns 1 on error.
+ */
+int profiler_write_trace(const char *filename) {
+    FILE *handle = fopen(filename, "w");
+    if(handle == NULL) {
+        PERROR("Could not open trace file %s!", filename);
+        return 1;
+    }
+
+    fprintf(handle, "{\"traceEvents\":[\n");
+    int first = 1;
+    unsigned int written = 0;
+    for(int i = 0; i < PROFILER_MAX_THREADS; i++) {
+        profiler_ring *r = atomic_load(&rings[i]);
+        if(r == NULL) {
+            continue;
+        }
+        unsigned int head = atomic_load_explicit(&r->head, memory_order_acquire);
+        unsigned int n = (head < PROFILER_RING_SIZE) ? head : PROFILER_RING_SIZE;
+        for(unsigned int k = head - n; k != head; k++) {
+            const profiler_event *ev = &r->events[k % PROFILER_RING_SIZE];
+            if(ev->start < epoch) {
+                continue;
+            }
+            double ts = (double)(ev->start - epoch) * 1000000.0 / perf_freq;
+            double dur = (double)(ev->end - ev->start) * 1000000.0 / perf_freq;
+            fprintf(handle, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%lu}",
+                    first ? "" : ",\n",
+                    zone_names[ev->zone],
+                    ts,
+                    dur,
+                    r->thread_id);
+            first = 0;
+            written++;
+        }
+    }
+    fprintf(handle, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    if(fclose(handle) != 0) {
+        PERROR("Writing trace file %s failed!", filename);
+        return 1;
+    }
+    INFO("Wrote %u profiler events to %s.", written, filename);
+    return 0;
+}
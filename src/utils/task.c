@@ -0,0 +1,78 @@
+#include "utils/task.h"
+#include "utils/log.h"
+
+static int task_run(void *data) {
+    task *t = data;
+    unsigned int start = SDL_GetTicks();
+    t->result = t->func(t->userdata);
+    t->took = SDL_GetTicks() - start;
+    DEBUG("Task '%s' finished in %ums.", t->name, t->took);
+    return 0;
+}
+
+/** \brief Starts running a job in the background.
+  * \param t Task to fill
+  * \param name Name of the job, for logging
+  * \param func Job to run. Returns 0 on success.
+  * \param userdata Passed to func
+  */
+void task_start(task *t, const char *name, task_func func, void *userdata) {
+    t->name = name;
+    t->func = func;
+    t->userdata = userdata;
+    t->result = 0;
+    t->took = 0;
+    atomic_init(&t->done, 0);
+    t->lock = SDL_CreateMutex();
+    t->thread = NULL;
+    if(t->lock != NULL) {
+        t->thread = SDL_CreateThread(task_run, name, t);
+    }
+    if(t->thread == NULL) {
+        PERROR("Unable to start task '%s', running it now: %s", name, SDL_GetError());
+        task_run(t);
+        atomic_store_explicit(&t->done, 1, memory_order_release);
+    }
+}
+
+/** \brief Waits for the job to finish. May be called from any thread, any number of times.
+  * \param t Task handle
+  * \return Return value of the job
+  */
+int task_wait(task *t) {
+    if(atomic_load_explicit(&t->done, memory_order_acquire)) {
+        return t->result;
+    }
+    SDL_LockMutex(t->lock);
+    if(!atomic_load_explicit(&t->done, memory_order_relaxed)) {
+        unsigned int start = SDL_GetTicks();
+        SDL_WaitThread(t->thread, NULL);
+        t->thread = NULL;
+        unsigned int waited = SDL_GetTicks() - start;
+        if(waited > 0) {
+            DEBUG("Waited %ums for task '%s'.", waited, t->name);
+        }
+        atomic_store_explicit(&t->done, 1, memory_order_release);
+    }
+    SDL_UnlockMutex(t->lock);
+    return t->result;
+}
+
+int task_is_done(task *t) {
+    return atomic_load_explicit(&t->done, memory_order_acquire);
+}
+
+/** \brief Waits for the job, and frees the thread resources.
+  * Nothing else may be waiting on the task anymore.
+  * \param t Task handle
+  */
+void task_free(task *t) {
+    if(t->lock == NULL && t->thread == NULL) {
+        return;
+    }
+    task_wait(t);
+    if(t->lock != NULL) {
+        SDL_DestroyMutex(t->lock);
+        t->lock = NULL;
+    }
+}
@@ -0,0 +1,52 @@
+#include <stdlib.h>
+#include <string.h>
+#include "utils/triple_buffer.h"
+
+// Set in ready when the hand-off buffer holds something the consumer has not seen
+#define TRIPLE_BUFFER_FRESH 0x4
+
+int triple_buffer_create(triple_buffer *tb, size_t size) {
+    tb->data = malloc(size * 3);
+    if(tb->data == NULL) {
+        return 1;
+    }
+    memset(tb->data, 0, size * 3);
+    tb->size = size;
+    tb->write = 0;
+    tb->read = 1;
+    atomic_init(&tb->ready, 2);
+    return 0;
+}
+
+void triple_buffer_free(triple_buffer *tb) {
+    free(tb->data);
+    tb->data = NULL;
+}
+
+// Buffer the producer may fill. It stays the same until the next publish.
+void* triple_buffer_write_ptr(triple_buffer *tb) {
+    return tb->data + tb->write * tb->size;
+}
+
+// Hands the written buffer over, and takes the old hand-off buffer for writing
+void triple_buffer_publish(triple_buffer *tb) {
+    int old = atomic_exchange(&tb->ready, tb->write | TRIPLE_BUFFER_FRESH);
+    tb->write = old & ~TRIPLE_BUFFER_FRESH;
+}
+
+/*
+ * Returns the latest published buffer. If something was published since the last
+ * call, the consumer swaps it in and *fresh is set; otherwise the previous buffer
+ * is returned again. The buffer stays valid until the next call.
+ */
+void* triple_buffer_read_ptr(triple_buffer *tb, int *fresh) {
+    int is_fresh = (atomic_load(&tb->ready) & TRIPLE_BUFFER_FRESH) != 0;
+    if(is_fresh) {
+        int old = atomic_exchange(&tb->ready, tb->read);
+        tb->read = old & ~TRIPLE_BUFFER_FRESH;
+    }
+    if(fresh != NULL) {
+        *fresh = is_fresh;
+    }
+    return tb->data + tb->read * tb->size;
+}
@@ -1,4 +1,5 @@
 #include "utils/vector.h"
+#include "utils/memtrack.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -12,14 +13,14 @@ void vector_init(vector *vec) {
     vec->blocks = 0;
     vec->reserved = 32;
     vec->inc_factor = 2;
+    vec->marks = NULL;
+    vec->marked = 0;
     vec->data = (char*)vec->alloc.cmalloc(vec->reserved * vec->block_size);
 }
 
 void vector_create(vector *vec, unsigned int block_size) {
     vec->block_size = block_size;
-    vec->alloc.cmalloc = malloc;
-    vec->alloc.cfree = free;
-    vec->alloc.crealloc = realloc;
+    memtrack_get_allocator(&vec->alloc);
     vector_init(vec);
 }
 
@@ -30,6 +31,10 @@ void vector_create_with_allocator(vector *vec, unsigned int block_size, allocato
 }
 
 void vector_clear(vector *vec) {
+    if(vec->marks != NULL) {
+        memset(vec->marks, 0, vec->blocks);
+    }
+    vec->marked = 0;
     vec->blocks = 0;
 }
 
@@ -39,6 +44,11 @@ void vector_free(vector *vec) {
     vec->block_size = 0;
     vec->alloc.cfree(vec->data);
     vec->data = NULL;
+    if(vec->marks != NULL) {
+        vec->alloc.cfree(vec->marks);
+        vec->marks = NULL;
+    }
+    vec->marked = 0;
 }
 
 void* vector_get(const vector *vec, unsigned int key) {
@@ -52,6 +62,12 @@ int vector_grow(vector *vec) {
     void *ndata = vec->alloc.crealloc(vec->data, vec->reserved * vec->block_size * vec->inc_factor);
     if(ndata == NULL) return 1;
     vec->data = ndata;
+    if(vec->marks != NULL) {
+        unsigned char *nmarks = vec->alloc.crealloc(vec->marks, vec->reserved * vec->inc_factor);
+        if(nmarks == NULL) return 1;
+        memset(nmarks + vec->reserved, 0, vec->reserved * (vec->inc_factor - 1));
+        vec->marks = nmarks;
+    }
     vec->reserved = vec->reserved * vec->inc_factor;
     return 0;
 }
@@ -77,6 +93,10 @@ int vector_prepend(vector *vec, const void *value) {
     char *dst = (char*)(vec->data + vec->block_size);
     memmove(dst, vec->data, vec->block_size * vec->blocks);
     memcpy(dst, value, vec->block_size);
+    if(vec->marks != NULL) {
+        memmove(vec->marks + 1, vec->marks, vec->blocks);
+        vec->marks[0] = 0;
+    }
     vec->blocks++;
     return 0;
 }
@@ -102,12 +122,20 @@ int vector_delete(vector *vec, iterator *iter) {
         void *src = vec->data + (real + 1) * vec->block_size;
         unsigned int size = (vec->blocks - 1 - real) * vec->block_size;
         memmove(dst, src, size);
+        if(vec->marks != NULL) {
+            vec->marked -= vec->marks[real];
+            memmove(vec->marks + real, vec->marks + real + 1, vec->blocks - 1 - real);
+            vec->marks[vec->blocks - 1] = 0;
+        }
 
         // If we are iterating forwards, moving an entry will hop iterator forwards by two.
         // We will fix this issue by hopping backwards by one.
         if(iter->prev == NULL) {
             iter->inow--;
         }
+    } else if(vec->marks != NULL) {
+        vec->marked -= vec->marks[real];
+        vec->marks[real] = 0;
     }
 
     // We deleted an entry, so blocks-1
@@ -119,6 +147,90 @@ int vector_delete(vector *vec, iterator *iter) {
     return 0;
 }
 
+// Deletes the current entry by moving the last entry in its place. This does not
+// keep the order of the entries, but does not need to move the whole tail either.
+int vector_swapdelete(vector *vec, iterator *iter) {
+    if(vec->blocks == 0) return 1;
+
+    // Since last iteration already changed the "now" value, find the real "now" here.
+    int real;
+    if(iter->next == NULL) {
+        real = iter->inow + 1;
+    } else {
+        real = iter->inow - 1;
+    }
+
+    unsigned int last = vec->blocks - 1;
+    if(vec->marks != NULL) {
+        vec->marked -= vec->marks[real];
+    }
+    if(real < last) {
+        memcpy(vec->data + real * vec->block_size,
+               vec->data + last * vec->block_size,
+               vec->block_size);
+        if(vec->marks != NULL) {
+            vec->marks[real] = vec->marks[last];
+        }
+
+        // When iterating forwards, the moved entry has not been seen yet; look at
+        // this slot again. Backwards iteration has already seen the last entry.
+        if(iter->prev == NULL) {
+            iter->inow--;
+        }
+    }
+    if(vec->marks != NULL) {
+        vec->marks[last] = 0;
+    }
+    vec->blocks--;
+    return 0;
+}
+
+// Marks the current entry for deletion. Marked entries are still visible until
+// vector_compact is called, which removes all of them in one pass.
+int vector_mark_delete(vector *vec, iterator *iter) {
+    if(vec->blocks == 0) return 1;
+
+    int real;
+    if(iter->next == NULL) {
+        real = iter->inow + 1;
+    } else {
+        real = iter->inow - 1;
+    }
+
+    if(vec->marks == NULL) {
+        vec->marks = vec->alloc.cmalloc(vec->reserved);
+        if(vec->marks == NULL) return 1;
+        memset(vec->marks, 0, vec->reserved);
+    }
+    if(!vec->marks[real]) {
+        vec->marks[real] = 1;
+        vec->marked++;
+    }
+    return 0;
+}
+
+// Removes all entries marked with vector_mark_delete. Order of the remaining
+// entries is kept.
+void vector_compact(vector *vec) {
+    if(vec->marked == 0) return;
+
+    unsigned int w = 0;
+    while(!vec->marks[w]) {
+        w++;
+    }
+    for(unsigned int r = w + 1; r < vec->blocks; r++) {
+        if(!vec->marks[r]) {
+            memcpy(vec->data + w * vec->block_size,
+                   vec->data + r * vec->block_size,
+                   vec->block_size);
+            w++;
+        }
+    }
+    memset(vec->marks, 0, vec->blocks);
+    vec->blocks = w;
+    vec->marked = 0;
+}
+
 void vector_sort(vector *vec, vector_compare_func cf) {
     qsort(vec->data, vec->blocks, vec->block_size, cf);
 }
@@ -2,6 +2,19 @@
 #include <string.h>
 #include <utils/log.h>
 #include "video/surface.h"
+#include "utils/memtrack.h"
+
+static size_t surface_mem_size(const surface *sur) {
+    size_t size = sur->w * sur->h * ((sur->type == SURFACE_TYPE_RGBA) ? 4 : 1);
+    if(sur->stencil != NULL) {
+        size += sur->w * sur->h;
+    }
+    return size;
+}
+
+static size_t surface_spans_size(const surface *sur) {
+    return sizeof(int) * (sur->h + 1) + sizeof(surface_span) * sur->span_rows[sur->h];
+}
 
 void surface_create(surface *sur, int type, int w, int h) {
     if(type == SURFACE_TYPE_RGBA) {
@@ -15,10 +28,73 @@ void surface_create(surface *sur, int type, int w, int h) {
     sur->h = h;
     sur->type = type;
     sur->force_refresh = 0;
+    sur->span_rows = NULL;
+    sur->mem_tag = MEM_SURFACES;
+    if(sur->data != NULL) {
+        memtrack_add(MEM_SURFACES, surface_mem_size(sur));
+    }
+}
+
+// Span list must be rebuilt whenever the stencil changes
+static void surface_drop_spans(surface *sur) {
+    if(sur->span_rows != NULL) {
+        memtrack_sub(sur->mem_tag, surface_spans_size(sur));
+    }
+    free(sur->span_rows);
+    sur->span_rows = NULL;
 }
 
 void surface_force_refresh(surface *sur) {
     sur->force_refresh = 1;
+    surface_drop_spans(sur);
+}
+
+// Builds the opaque spans of a paletted surface from its stencil. The block
+// starts with h+1 row offsets into the span array, which follows right after.
+static void surface_build_spans(surface *sur) {
+    int count = 0;
+    for(int y = 0; y < sur->h; y++) {
+        const char *row = sur->stencil + y * sur->w;
+        for(int x = 0; x < sur->w; x++) {
+            if(row[x] == 1 && (x == 0 || row[x - 1] != 1)) {
+                count++;
+            }
+        }
+    }
+
+    sur->span_rows = malloc(sizeof(int) * (sur->h + 1) + sizeof(surface_span) * count);
+    surface_span *spans = (surface_span*)(sur->span_rows + sur->h + 1);
+    int n = 0;
+    for(int y = 0; y < sur->h; y++) {
+        const char *row = sur->stencil + y * sur->w;
+        sur->span_rows[y] = n;
+        int x = 0;
+        while(x < sur->w) {
+            if(row[x] != 1) {
+                x++;
+                continue;
+            }
+            int start = x;
+            while(x < sur->w && row[x] == 1) {
+                x++;
+            }
+            spans[n].x = start;
+            spans[n].len = x - start;
+            n++;
+        }
+    }
+    sur->span_rows[sur->h] = n;
+    memtrack_add(sur->mem_tag, surface_spans_size(sur));
+}
+
+// Returns the opaque spans of a single row of a paletted surface
+const surface_span* surface_get_spans(surface *sur, int row, int *count) {
+    if(sur->span_rows == NULL) {
+        surface_build_spans(sur);
+    }
+    const surface_span *spans = (const surface_span*)(sur->span_rows + sur->h + 1);
+    *count = sur->span_rows[row + 1] - sur->span_rows[row];
+    return spans + sur->span_rows[row];
 }
 
 void surface_create_from_data(surface *sur, int type, int w, int h, const char *src) {
@@ -45,12 +121,27 @@ int surface_to_image(surface *sur, image *img) {
 }
 
 void surface_free(surface *sur) {
+    surface_drop_spans(sur);
+    if(sur->data != NULL) {
+        memtrack_sub(sur->mem_tag, surface_mem_size(sur));
+    }
     free(sur->data);
     free(sur->stencil);
     sur->stencil = NULL;
     sur->data = NULL;
 }
 
+// Counts the memory of the surface to another subsystem from now on
+void surface_set_mem_tag(surface *sur, int tag) {
+    if(sur->data != NULL) {
+        memtrack_move(sur->mem_tag, tag, surface_mem_size(sur));
+    }
+    if(sur->span_rows != NULL) {
+        memtrack_move(sur->mem_tag, tag, surface_spans_size(sur));
+    }
+    sur->mem_tag = tag;
+}
+
 int surface_get_type(surface *sur) {
     return sur->type;
 }
@@ -87,6 +178,7 @@ void surface_copy_ex(surface *dst, surface *src) {
     memcpy(dst->data, src->data, size);
     if(src->stencil != NULL)
         memcpy(dst->stencil, src->stencil, src->w * src->h);
+    surface_drop_spans(dst);
 }
 
 // Copies a surface to a new surface
@@ -117,28 +209,32 @@ void surface_sub(surface *dst,
         return;
     }
 
-    // Copy!
+    // Copy row by row
     int bytes = (src->type == SURFACE_TYPE_RGBA) ? 4 : 1;
-    int src_offset,dst_offset;
     for(int y = 0; y < h; y++) {
-        for(int x = 0; x < w; x++) {
-            src_offset = (src_x + x + (src_y + y) * src->w) * bytes;
-            switch(method) {
-                case SUB_METHOD_MIRROR:
-                    dst_offset = (dst_x + (w - x - 1) + (dst_y + y) * dst->w) * bytes;
-                    break;
-                default:
-                    dst_offset = (dst_x + x + (dst_y + y) * dst->w) * bytes;
-                    break;
+        int src_offset = src_x + (src_y + y) * src->w;
+        int dst_offset = dst_x + (dst_y + y) * dst->w;
+        char *src_row = src->data + src_offset * bytes;
+        char *dst_row = dst->data + dst_offset * bytes;
+        if(method == SUB_METHOD_MIRROR) {
+            for(int x = 0; x < w; x++) {
+                memcpy(dst_row + (w - x - 1) * bytes, src_row + x * bytes, bytes);
             }
-            for(int m = 0; m < bytes; m++) {
-                dst->data[dst_offset + m] = src->data[src_offset + m];
+            if(bytes == 1) {
+                for(int x = 0; x < w; x++) {
+                    dst->stencil[dst_offset + w - x - 1] = src->stencil[src_offset + x];
+                }
             }
+        } else {
+            memcpy(dst_row, src_row, w * bytes);
             if(bytes == 1) {
-                dst->stencil[dst_offset] = src->stencil[src_offset];
+                memcpy(dst->stencil + dst_offset, src->stencil + src_offset, w);
             }
         }
     }
+    if(bytes == 1) {
+        surface_drop_spans(dst);
+    }
 }
 
 void surface_additive_blit(surface *dst,
@@ -152,30 +248,26 @@ void surface_additive_blit(surface *dst,
         return;
     }
 
-    int src_offset,dst_offset;
-    uint8_t src_index, dst_index;
-    for(int y = 0; y < src->h; y++) {
-        for(int x = 0; x < src->w; x++) {
-            // If pixel offscreen, skip
-            if(dst_x + x >= dst->w
-                || dst_y + y >= dst->h
-                || dst_x + x < 0
-                || dst_y + y < 0) continue;
-
-            // Calculate pixel offsets
-            src_offset = ((flip & SDL_FLIP_HORIZONTAL) ? src->w - x : x) +
-                         ((flip & SDL_FLIP_VERTICAL) ? src->h - y : y) * src->w;
-            dst_offset = dst_x + x + (dst_y + y) * dst->w;
-
+    // Clip once, so that the inner loop only needs to look at the stencil
+    int y_start = (dst_y < 0) ? -dst_y : 0;
+    int y_end = (dst_y + src->h > dst->h) ? dst->h - dst_y : src->h;
+    int x_start = (dst_x < 0) ? -dst_x : 0;
+    int x_end = (dst_x + src->w > dst->w) ? dst->w - dst_x : src->w;
+    int hflip = (flip & SDL_FLIP_HORIZONTAL);
+
+    for(int y = y_start; y < y_end; y++) {
+        int src_y = (flip & SDL_FLIP_VERTICAL) ? src->h - 1 - y : y;
+        const uint8_t *src_row = (const uint8_t*)src->data + src_y * src->w;
+        uint8_t *dst_row = (uint8_t*)dst->data + (dst_y + y) * dst->w + dst_x;
+        const char *dst_stencil = dst->stencil + (dst_y + y) * dst->w + dst_x;
+        for(int x = x_start; x < x_end; x++) {
             // Do blit, if pixel is visible on stencil
-            if(dst->stencil[dst_offset] == 1) {
-                if(src->data[src_offset] == 0)
-                    continue;
-
-                src_index = src->data[src_offset]+3;
-                dst_index = dst->data[dst_offset];
-                dst->data[dst_offset] = remap_pal->remaps[src_index][dst_index];
+            uint8_t src_index = src_row[hflip ? src->w - 1 - x : x];
+            if(src_index == 0 || dst_stencil[x] != 1) {
+                continue;
             }
+            src_index += 3;
+            dst_row[x] = remap_pal->remaps[src_index][dst_row[x]];
         }
     }
 }
@@ -217,27 +309,46 @@ void surface_alpha_blit(surface *dst,
         return;
     }
 
-    int src_offset,dst_offset;
-    for(int y = 0; y < src->h; y++) {
-        for(int x = 0; x < src->w; x++) {
-            // If pixel offscreen, skip
-            if(dst_x + x >= dst->w
-                || dst_y + y >= dst->h
-                || dst_x + x < 0
-                || dst_y + y < 0) continue;
-
-            // Calculate offsets
-            src_offset = ((flip & SDL_FLIP_HORIZONTAL) ? src->w - 1 - x : x) +
-                         ((flip & SDL_FLIP_VERTICAL) ? src->h - 1 - y : y) * src->w;
-            dst_offset = dst_x + x + (dst_y + y) * dst->w;
+    // Rows are clipped once, and then each opaque span of the row is
+    // clipped and copied as a whole
+    int y_start = (dst_y < 0) ? -dst_y : 0;
+    int y_end = (dst_y + src->h > dst->h) ? dst->h - dst_y : src->h;
+    int hflip = (flip & SDL_FLIP_HORIZONTAL);
+
+    for(int y = y_start; y < y_end; y++) {
+        int src_y = (flip & SDL_FLIP_VERTICAL) ? src->h - 1 - y : y;
+        const char *src_row = src->data + src_y * src->w;
+        char *dst_row = dst->data + (dst_y + y) * dst->w;
+        char *dst_stencil = dst->stencil + (dst_y + y) * dst->w;
+
+        int count;
+        const surface_span *spans = surface_get_spans(src, src_y, &count);
+        for(int i = 0; i < count; i++) {
+            // Destination column of the leftmost pixel of the span
+            int left = hflip ? dst_x + src->w - spans[i].x - spans[i].len : dst_x + spans[i].x;
+            int right = left + spans[i].len;
+            if(left < 0) {
+                left = 0;
+            }
+            if(right > dst->w) {
+                right = dst->w;
+            }
+            if(left >= right) {
+                continue;
+            }
 
-            // If pixel is visible on stencil, do blit
-            if(src->stencil[src_offset] == 1) {
-                dst->data[dst_offset] = src->data[src_offset];
-                dst->stencil[dst_offset] = 1;
+            if(hflip) {
+                const char *s = src_row + dst_x + src->w - 1 - left;
+                for(int d = left; d < right; d++) {
+                    dst_row[d] = *s--;
+                }
+            } else {
+                memcpy(dst_row + left, src_row + left - dst_x, right - left);
             }
+            memset(dst_stencil + left, 1, right - left);
         }
     }
+    surface_drop_spans(dst);
 }
 
 // Converts an existing surface to RGBA
@@ -251,11 +362,14 @@ void surface_convert_to_rgba(surface *sur, screen_palette *pal, int pal_offset)
     surface_to_rgba(sur, pixels, pal, NULL, pal_offset);
 
     // Free old data
+    surface_drop_spans(sur);
+    memtrack_sub(sur->mem_tag, surface_mem_size(sur));
     free(sur->data);
     free(sur->stencil);
     sur->data = pixels;
     sur->stencil = NULL;
     sur->type = SURFACE_TYPE_RGBA;
+    memtrack_add(sur->mem_tag, surface_mem_size(sur));
 }
 
 // Creates a new RGBA surface
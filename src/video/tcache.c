@@ -2,6 +2,10 @@
 #include "video/tcache.h"
 #include "utils/hashmap.h"
 #include "utils/log.h"
+#include "utils/frame_alloc.h"
+#include "utils/profiler.h"
+#include "utils/metrics.h"
+#include "utils/memtrack.h"
 
 #define CACHE_LIFETIME 300
 
@@ -66,13 +70,23 @@ void tcache_reinit(SDL_Renderer *renderer, int scale_factor, scaler_plugin *scal
     tcache_clear();
 }
 
+static void tcache_destroy_texture(SDL_Texture *tex) {
+#ifdef MEMTRACK
+    int w, h;
+    if(SDL_QueryTexture(tex, NULL, NULL, &w, &h) == 0) {
+        memtrack_sub(MEM_TCACHE, w * h * 4);
+    }
+#endif
+    SDL_DestroyTexture(tex);
+}
+
 void tcache_clear() {
     iterator it;
     hashmap_iter_begin(&cache->entries, &it);
     hashmap_pair *pair;
     while((pair = iter_next(&it)) != NULL) {
         tcache_entry_value *entry = pair->val;
-        SDL_DestroyTexture(entry->tex);
+        tcache_destroy_texture(entry->tex);
     }
     hashmap_clear(&cache->entries);
 }
@@ -85,7 +99,7 @@ void tcache_tick() {
         tcache_entry_value *entry = pair->val;
         entry->age++;
         if(entry->age > CACHE_LIFETIME) {
-            SDL_DestroyTexture(entry->tex);
+            tcache_destroy_texture(entry->tex);
             hashmap_delete(&cache->entries, &it);
             cache->old_frees++;
         }
@@ -131,11 +145,13 @@ SDL_Texture* tcache_get(surface *sur,
     if(val != NULL && (val->pal_version == pal->version || sur->type == SURFACE_TYPE_RGBA) && !sur->force_refresh) {
         val->age = 0;
         cache->hits++;
+        metrics_add(METRIC_TCACHE_HITS, 1);
         return val->tex;
     }
 
     // Reset refresh flag here
     sur->force_refresh = 0;
+    PROFILE_BEGIN(PROFILE_TCACHE_MISS);
 
     // If there was no fitting surface tex in the cache at all,
     // then we need to create one
@@ -149,6 +165,9 @@ SDL_Texture* tcache_get(surface *sur,
                                           sur->w * cache->scale_factor,
                                           sur->h * cache->scale_factor);
         SDL_SetTextureBlendMode(new_entry.tex, SDL_BLENDMODE_BLEND);
+        if(new_entry.tex != NULL) {
+            memtrack_add(MEM_TCACHE, sur->w * sur->h * cache->scale_factor * cache->scale_factor * 4);
+        }
         val = tcache_add_entry(&key, &new_entry);
     }
 
@@ -156,18 +175,23 @@ SDL_Texture* tcache_get(surface *sur,
     // Either one, it needs to be updated. Let's do it now.
     // Also, scale surface if necessary
     if(cache->scale_factor > 1) {
-        char *raw = malloc(sur->w * sur->h * 4);
+        // Both buffers are only needed until the texture is updated
+        char *raw = frame_alloc_malloc(sur->w * sur->h * 4);
         surface scaled;
-        surface_create(&scaled,
-                       SURFACE_TYPE_RGBA,
-                       sur->w * cache->scale_factor,
-                       sur->h * cache->scale_factor);
+        scaled.w = sur->w * cache->scale_factor;
+        scaled.h = sur->h * cache->scale_factor;
+        scaled.type = SURFACE_TYPE_RGBA;
+        scaled.data = frame_alloc_malloc(scaled.w * scaled.h * 4);
+        scaled.stencil = NULL;
+        scaled.force_refresh = 0;
+        scaled.span_rows = NULL;
+        scaled.mem_tag = MEM_SURFACES;
 
         surface_to_rgba(sur, raw, pal, remap_table, pal_offset);
         scaler_scale(cache->scaler, raw, scaled.data, sur->w, sur->h, cache->scale_factor);
         surface_to_texture(&scaled, val->tex, pal, remap_table, pal_offset);
-        surface_free(&scaled);
-        free(raw);
+        frame_alloc_free(scaled.data);
+        frame_alloc_free(raw);
     } else {
         surface_to_texture(sur, val->tex, pal, remap_table, pal_offset);
     }
@@ -178,5 +202,7 @@ SDL_Texture* tcache_get(surface *sur,
 
     // Do some statistics stuff
     cache->misses++;
+    metrics_add(METRIC_TCACHE_MISSES, 1);
+    PROFILE_END(PROFILE_TCACHE_MISS);
     return val->tex;
 }
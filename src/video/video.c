@@ -8,13 +8,59 @@
 #include "video/tcache.h"
 #include "utils/log.h"
 #include "utils/list.h"
+#include "utils/frame_alloc.h"
+#include "utils/triple_buffer.h"
+#include "utils/profiler.h"
 #include "resources/palette.h"
 #include "video/video_state.h"
 #include "video/video_hw.h"
 #include "video/video_soft.h"
+#include "video/video_composite.h"
 #include "plugins/plugins.h"
 
+#define VIDEO_MAX_CAPTURES 4
+
+// Area captures are served at the end of the frame, from the finished picture
+typedef struct video_capture_t {
+    surface *sur;
+    int *ready;
+    int x, y, w, h;
+} video_capture;
+
+// What the presenting thread gets of a finished frame
+typedef struct video_snapshot_t {
+    uint8_t frame[NATIVE_W * NATIVE_H * 4];
+    float fade;
+    int target_move_x;
+    int target_move_y;
+} video_snapshot;
+
+// Window changes asked for while threaded, applied by the presenting thread
+typedef struct video_reinit_request_t {
+    int pending;
+    int reset_renderer; // Recreate the renderer even if no setting changed
+    int w;
+    int h;
+    int fs;
+    int vsync;
+    char scaler_name[16];
+    int scale_factor;
+} video_reinit_request;
+
 static video_state state;
+static video_capture captures[VIDEO_MAX_CAPTURES];
+static int capture_count = 0;
+
+// Only used while threaded. The window, renderer, scaler and scale factor then
+// belong to the presenting thread; the simulation thread only touches the
+// framebuffer, fade and screen shake, and hands them over in snapshots.
+// reinit_lock guards the request, and the window size, fullscreen and vsync
+// that video_get_state reads.
+static triple_buffer snapshots;
+static SDL_mutex *reinit_lock = NULL;
+static video_reinit_request reinit_request;
+static char *present_scaled = NULL;
+static int present_scale_factor = 0;
 
 void reset_targets() {
     if(state.target != NULL) {
@@ -59,9 +105,16 @@ int video_init(int window_w,
     state.fs = fullscreen;
     state.vsync = vsync;
     state.fade = 1.0f;
+    state.renderer_version = 0;
+    state.software = 0;
+    state.headless = 0;
+    state.threaded = 0;
     state.target = NULL;
     state.target_move_x = 0;
     state.target_move_y = 0;
+    state.framebuffer = malloc(NATIVE_W * NATIVE_H * 4);
+    state.framebuffer_ok = 0;
+    capture_count = 0;
 
     // Load scaler (if any)
     strncpy(state.scaler_name, scaler_name, sizeof(state.scaler_name));
@@ -137,14 +190,20 @@ int video_init(int window_w,
     // Init texture cache
     tcache_init(state.renderer, state.scale_factor, &state.scaler);
 
-    // Init hardware renderer
-    state.cur_renderer = VIDEO_RENDERER_HW;
-    video_hw_init(&state);
-
     // Get renderer data
     SDL_RendererInfo rinfo;
     SDL_GetRendererInfo(state.renderer, &rinfo);
 
+    // Init hardware renderer, or composite in software if there is no acceleration
+    if(rinfo.flags & SDL_RENDERER_ACCELERATED) {
+        state.cur_renderer = VIDEO_RENDERER_HW;
+        video_hw_init(&state);
+    } else {
+        state.software = 1;
+        state.cur_renderer = VIDEO_RENDERER_SOFT;
+        video_composite_init(&state);
+    }
+
     // Show some info
     INFO("Video Init OK");
     INFO(" * Driver: %s", SDL_GetCurrentVideoDriver());
@@ -155,9 +214,54 @@ int video_init(int window_w,
     return 0;
 }
 
-void video_reinit_renderer() {
-    // Clear old texture cache entries
-    tcache_clear();
+// Renders without a window; frames are composited on the CPU into the framebuffer only
+int video_init_headless() {
+    state.w = NATIVE_W;
+    state.h = NATIVE_H;
+    state.fs = 0;
+    state.vsync = 0;
+    state.fade = 1.0f;
+    state.renderer_version = 0;
+    state.software = 1;
+    state.headless = 1;
+    state.threaded = 0;
+    state.window = NULL;
+    state.renderer = NULL;
+    state.target = NULL;
+    state.target_move_x = 0;
+    state.target_move_y = 0;
+    state.framebuffer = malloc(NATIVE_W * NATIVE_H * 4);
+    state.framebuffer_ok = 0;
+    capture_count = 0;
+
+    // Scaling only matters for the window
+    strncpy(state.scaler_name, "", sizeof(state.scaler_name));
+    scaler_init(&state.scaler);
+    state.scale_factor = 1;
+
+    // Clear palettes
+    state.cur_palette = malloc(sizeof(screen_palette));
+    state.base_palette = malloc(sizeof(palette));
+    memset(state.cur_palette, 0, sizeof(screen_palette));
+    state.cur_palette->version = 1;
+
+    // Cache stays empty, but the rest of the engine expects it to be there
+    tcache_init(NULL, 1, &state.scaler);
+
+    state.cur_renderer = VIDEO_RENDERER_SOFT;
+    video_composite_init(&state);
+
+    INFO("Video Init OK");
+    INFO(" * Headless, %dx%d framebuffer", NATIVE_W, NATIVE_H);
+    return 0;
+}
+
+static void video_recreate_renderer() {
+    // Clear old texture cache entries. While threaded, the cache is not in use,
+    // and belongs to the simulation thread anyway.
+    if(!state.threaded) {
+        tcache_clear();
+    }
 
     // Kill old renderer
     SDL_DestroyRenderer(state.renderer);
@@ -168,21 +272,29 @@ void video_reinit_renderer() {
          renderer_flags |= SDL_RENDERER_PRESENTVSYNC;
     }
     state.renderer = SDL_CreateRenderer(state.window, -1, renderer_flags);
+    state.renderer_version++;
     SDL_RenderSetLogicalSize(state.renderer,
                              NATIVE_W * state.scale_factor,
                              NATIVE_H * state.scale_factor);
-    tcache_reinit(state.renderer, state.scale_factor, &state.scaler);
+    if(!state.threaded) {
+        tcache_reinit(state.renderer, state.scale_factor, &state.scaler);
+    }
 
      // Reset rendertarget
     reset_targets();
 }
 
-int video_reinit(int window_w,
-                 int window_h,
-                 int fullscreen,
-                 int vsync,
-                 const char* scaler_name,
-                 int scale_factor) {
+static int video_apply_reinit(int window_w,
+                              int window_h,
+                              int fullscreen,
+                              int vsync,
+                              const char* scaler_name,
+                              int scale_factor) {
+
+    // There is no window to change
+    if(state.headless) {
+        return 0;
+    }
 
     // Tells if something has changed in video settings
     int changed = 0;
@@ -227,10 +339,16 @@ int video_reinit(int window_w,
     }
 
     // Set video state
+    if(state.threaded) {
+        SDL_LockMutex(reinit_lock);
+    }
     state.vsync = vsync;
     state.fs = fullscreen;
     state.w = window_w;
     state.h = window_h;
+    if(state.threaded) {
+        SDL_UnlockMutex(reinit_lock);
+    }
 
     // Load scaler
     if(video_load_scaler(scaler_name, scale_factor)) {
@@ -243,19 +361,82 @@ int video_reinit(int window_w,
 
     // If any settings changed, reinit the screen
     if(changed) {
-        video_reinit_renderer();
+        video_recreate_renderer();
     }
 
-    state.cb.render_reinit(&state);
+    // Renderer callbacks belong to the simulation thread when threaded
+    if(!state.threaded) {
+        state.cb.render_reinit(&state);
+    }
     return 0;
 }
 
+int video_reinit(int window_w,
+                 int window_h,
+                 int fullscreen,
+                 int vsync,
+                 const char* scaler_name,
+                 int scale_factor) {
+
+    // The window belongs to the presenting thread, so leave the change for it
+    if(state.threaded) {
+        SDL_LockMutex(reinit_lock);
+        reinit_request.pending = 1;
+        reinit_request.w = window_w;
+        reinit_request.h = window_h;
+        reinit_request.fs = fullscreen;
+        reinit_request.vsync = vsync;
+        strncpy(reinit_request.scaler_name, scaler_name, sizeof(reinit_request.scaler_name));
+        reinit_request.scale_factor = scale_factor;
+        SDL_UnlockMutex(reinit_lock);
+        return 0;
+    }
+    return video_apply_reinit(window_w, window_h, fullscreen, vsync, scaler_name, scale_factor);
+}
+
+/*
+ * Recreates the renderer, eg. when a fullscreen window is restored. While
+ * threaded, this is left for the presenting thread like other window changes.
+ */
+void video_reinit_renderer() {
+    if(state.headless) {
+        return;
+    }
+    if(state.threaded) {
+        SDL_LockMutex(reinit_lock);
+        reinit_request.reset_renderer = 1;
+        SDL_UnlockMutex(reinit_lock);
+        return;
+    }
+    video_recreate_renderer();
+}
+
+// Applies the last window change asked for while threaded. Returns 1 if there was one.
+static int video_apply_reinit_request() {
+    SDL_LockMutex(reinit_lock);
+    video_reinit_request req = reinit_request;
+    reinit_request.pending = 0;
+    reinit_request.reset_renderer = 0;
+    SDL_UnlockMutex(reinit_lock);
+    if(req.pending) {
+        video_apply_reinit(req.w, req.h, req.fs, req.vsync, req.scaler_name, req.scale_factor);
+    }
+    if(req.reset_renderer) {
+        video_recreate_renderer();
+    }
+    return (req.pending || req.reset_renderer);
+}
+
+// Screen shake offset, in native pixels. Scaling is left for presenting.
 void video_move_target(int x, int y) {
-    state.target_move_x = x * state.scale_factor;
-    state.target_move_y = y * state.scale_factor;
+    state.target_move_x = x;
+    state.target_move_y = y;
 }
 
 void video_get_state(int *w, int *h, int *fs, int *vsync) {
+    if(state.threaded) {
+        SDL_LockMutex(reinit_lock);
+    }
     if(w != NULL) {
         *w = state.w;
     }
@@ -268,9 +449,20 @@ void video_get_state(int *w, int *h, int *fs, int *vsync) {
     if(vsync != NULL) {
         *vsync = state.vsync;
     }
+    if(state.threaded) {
+        SDL_UnlockMutex(reinit_lock);
+    }
 }
 
 void video_select_renderer(int renderer) {
+    // In software mode, the compositor stands in for the hardware renderer.
+    // Without a renderer, it is the only thing that can draw at all.
+    if(renderer == VIDEO_RENDERER_HW && state.software) {
+        renderer = VIDEO_RENDERER_SOFT;
+    }
+    if(state.headless || state.threaded) {
+        renderer = VIDEO_RENDERER_SOFT;
+    }
     if(renderer == state.cur_renderer) {
         return;
     }
@@ -283,14 +475,114 @@ void video_select_renderer(int renderer) {
         case VIDEO_RENDERER_HW:
             video_hw_init(&state);
             break;
+        case VIDEO_RENDERER_SOFT:
+            video_composite_init(&state);
+            break;
+    }
+}
+
+void video_set_software(int enabled) {
+    if(state.headless) {
+        return;
+    }
+    state.software = enabled;
+
+    // Threaded rendering is always composited in software; this applies once it ends
+    if(state.threaded) {
+        return;
+    }
+    if(enabled && state.cur_renderer == VIDEO_RENDERER_HW) {
+        video_select_renderer(VIDEO_RENDERER_SOFT);
+    } else if(!enabled && state.cur_renderer == VIDEO_RENDERER_SOFT) {
+        video_select_renderer(VIDEO_RENDERER_HW);
+    }
+}
+
+/*
+ * Moves drawing over to the simulation thread. While threaded, the renderer
+ * callbacks only composite into the framebuffer, and every finished frame is
+ * published as a snapshot that video_present() puts on the screen from the
+ * thread that owns the window. Returns 1 if that is not possible.
+ */
+int video_set_threaded(int enabled) {
+    if(state.headless) {
+        return 1;
+    }
+    if(enabled == state.threaded) {
+        return 0;
+    }
+    if(enabled) {
+        if(triple_buffer_create(&snapshots, sizeof(video_snapshot))) {
+            PERROR("Unable to allocate frame snapshots!");
+            return 1;
+        }
+        reinit_lock = SDL_CreateMutex();
+        reinit_request.pending = 0;
+        reinit_request.reset_renderer = 0;
+
+        // Cached textures would be aged out on the simulation thread, so drop them now
+        state.threaded = 1;
+        video_select_renderer(VIDEO_RENDERER_SOFT);
+        tcache_clear();
+        DEBUG("Presenting frames from a separate thread.");
+    } else {
+        // The simulation thread is gone, so everything is ours again
+        state.threaded = 0;
+        video_apply_reinit_request();
+        tcache_reinit(state.renderer, state.scale_factor, &state.scaler);
+        if(!state.software) {
+            video_select_renderer(VIDEO_RENDERER_HW);
+        }
+        SDL_DestroyMutex(reinit_lock);
+        reinit_lock = NULL;
+        triple_buffer_free(&snapshots);
+        free(present_scaled);
+        present_scaled = NULL;
+        present_scale_factor = 0;
     }
+    return 0;
 }
 
 void video_set_fade(float fade) {
     state.fade = fade;
 }
 
+/*
+ * Copies the last finished frame from the framebuffer into dst, as 320x200 RGBA,
+ * with fades and screen shakes applied. Returns 1 if there is no such frame.
+ */
+int video_read_frame(char *dst) {
+    memset(dst, 0, NATIVE_W * NATIVE_H * 4);
+    if(!state.framebuffer_ok) {
+        return 1;
+    }
+    int v = 255.0f * state.fade;
+    for(int y = 0; y < NATIVE_H; y++) {
+        int sy = y - state.target_move_y;
+        for(int x = 0; x < NATIVE_W; x++) {
+            int sx = x - state.target_move_x;
+            char *d = dst + (y * NATIVE_W + x) * 4;
+            d[3] = 0xFF;
+            if(sx < 0 || sx >= NATIVE_W || sy < 0 || sy >= NATIVE_H) {
+                continue;
+            }
+            const uint8_t *s = state.framebuffer + (sy * NATIVE_W + sx) * 4;
+            d[0] = s[0] * v / 255;
+            d[1] = s[1] * v / 255;
+            d[2] = s[2] * v / 255;
+        }
+    }
+    return 0;
+}
+
 void video_screenshot(image *img) {
+    // Without a window, or when the window is another thread's, the picture is what the compositor made
+    if(state.headless || state.threaded) {
+        image_create(img, NATIVE_W, NATIVE_H);
+        video_read_frame(img->data);
+        return;
+    }
+
     image_create(img, state.w, state.h);
     int ret = SDL_RenderReadPixels(state.renderer, NULL, SDL_PIXELFORMAT_ABGR8888, img->data, img->w * 4);
     if(ret != 0) {
@@ -298,31 +590,102 @@ void video_screenshot(image *img) {
     }
 }
 
-int video_area_capture(surface *sur, int x, int y, int w, int h) {
-    float scale_x = (float)state.w / NATIVE_W;
-    float scale_y = (float)state.h / NATIVE_H;
+/*
+ * Requests a capture of an area of the screen. The capture is taken from the
+ * next finished frame, and *ready is set once the surface has been filled.
+ * Returns 1 if there is no room for more requests.
+ */
+int video_area_capture(surface *sur, int x, int y, int w, int h, int *ready) {
+    *ready = 0;
+    video_area_capture_cancel(sur);
+    if(capture_count >= VIDEO_MAX_CAPTURES) {
+        PERROR("Too many pending screen captures!");
+        return 1;
+    }
+    video_capture *cap = &captures[capture_count++];
+    cap->sur = sur;
+    cap->ready = ready;
+    cap->x = x;
+    cap->y = y;
+    cap->w = w;
+    cap->h = h;
+    return 0;
+}
+
+// Drops a pending capture, eg. when its owner is being freed
+void video_area_capture_cancel(surface *sur) {
+    for(int i = 0; i < capture_count; i++) {
+        if(captures[i].sur == sur) {
+            captures[i] = captures[--capture_count];
+            i--;
+        }
+    }
+}
 
+static int video_capture_from_framebuffer(video_capture *cap) {
+    surface_create(cap->sur, SURFACE_TYPE_RGBA, cap->w, cap->h);
+    memset(cap->sur->data, 0, cap->w * cap->h * 4);
+    for(int y = 0; y < cap->h; y++) {
+        int sy = cap->y + y;
+        if(sy < 0 || sy >= NATIVE_H) {
+            continue;
+        }
+        for(int x = 0; x < cap->w; x++) {
+            int sx = cap->x + x;
+            if(sx < 0 || sx >= NATIVE_W) {
+                continue;
+            }
+            const uint8_t *s = state.framebuffer + (sy * NATIVE_W + sx) * 4;
+            char *d = cap->sur->data + (y * cap->w + x) * 4;
+            d[0] = s[0];
+            d[1] = s[1];
+            d[2] = s[2];
+            d[3] = 0xFF;
+        }
+    }
+    return 0;
+}
+
+static int video_capture_from_target(video_capture *cap) {
     // Correct position (take scaling into account)
     SDL_Rect r;
-    r.x = x * scale_x;
-    r.y = y * scale_y;
-    r.w = w * scale_x;
-    r.h = h * scale_y;
+    r.x = cap->x * state.scale_factor;
+    r.y = cap->y * state.scale_factor;
+    r.w = cap->w * state.scale_factor;
+    r.h = cap->h * state.scale_factor;
 
     // Create a new surface
-    surface_create(sur, SURFACE_TYPE_RGBA, r.w, r.h);
+    surface_create(cap->sur, SURFACE_TYPE_RGBA, r.w, r.h);
 
     // Read pixels
-    int ret = SDL_RenderReadPixels(state.renderer, &r, SDL_PIXELFORMAT_ABGR8888, sur->data, sur->w * 4);
+    int ret = SDL_RenderReadPixels(state.renderer, &r, SDL_PIXELFORMAT_ABGR8888, cap->sur->data, cap->sur->w * 4);
     if(ret != 0) {
-        surface_free(sur);
+        surface_free(cap->sur);
         PERROR("Unable to read pixels from renderer: %s", SDL_GetError());
         return 1;
     }
-
     return 0;
 }
 
+// Serves pending captures. Renderers that draw on the CPU have the frame at
+// hand; otherwise it has to be read back from the render target. While
+// threaded, the render target is not ours to read.
+static void video_process_captures() {
+    for(int i = 0; i < capture_count; i++) {
+        video_capture *cap = &captures[i];
+        int ret;
+        if(state.framebuffer_ok || state.threaded) {
+            ret = video_capture_from_framebuffer(cap);
+        } else {
+            ret = video_capture_from_target(cap);
+        }
+        if(ret == 0) {
+            *cap->ready = 1;
+        }
+    }
+    capture_count = 0;
+}
+
 void video_force_pal_refresh() {
     memcpy(state.cur_palette->data, state.base_palette->data, 768);
     state.cur_palette->version++;
@@ -352,7 +715,9 @@ screen_palette* video_get_pal_ref() {
 void video_render_prepare() {
     // Reset palette
     memcpy(state.cur_palette->data, state.base_palette->data, 768);
-    SDL_SetRenderTarget(state.renderer, state.target);
+    if(!state.headless && !state.threaded) {
+        SDL_SetRenderTarget(state.renderer, state.target);
+    }
     state.cb.render_prepare(&state);
 }
 
@@ -504,11 +869,8 @@ void video_tick() {
     tcache_tick();
 }
 
-// Called after frame has been rendered
-void video_render_finish() {
-    // Tell software/hardware renderer to finish up whatever it was doing
-    state.cb.render_finish(&state);
-
+// Draws the render target on the screen, with fading and screen shakes, and flips buffers
+static void video_present_target(float fade, int target_move_x, int target_move_y) {
     // Set our rendertarget to screen buffer.
     SDL_SetRenderTarget(state.renderer, NULL);
 
@@ -517,13 +879,13 @@ void video_render_finish() {
     SDL_RenderClear(state.renderer);
 
     // Handle fading by color modulation
-    uint8_t v = 255.0f * state.fade;
+    uint8_t v = 255.0f * fade;
     SDL_SetTextureColorMod(state.target, v, v, v);
 
     // Set screen position. take into account scaling and target moves (screen shakes)
     SDL_Rect dst;
-    dst.x = state.target_move_x * state.scale_factor;
-    dst.y = state.target_move_y * state.scale_factor;
+    dst.x = target_move_x * state.scale_factor;
+    dst.y = target_move_y * state.scale_factor;
     dst.w = NATIVE_W * state.scale_factor;
     dst.h = NATIVE_H * state.scale_factor;
     SDL_RenderCopy(state.renderer, state.target, NULL, &dst);
@@ -531,19 +893,92 @@ void video_render_finish() {
     // Reset color modulation to normal
     SDL_SetTextureColorMod(state.target, 0xFF, 0xFF, 0xFF);
 
-    // Flip buffers. If vsync is off, we should sleep here
-    // so hat our main loop doesn't eat up all cpu :)
+    // Flip buffers. Without vsync, the engine loop paces itself.
     SDL_RenderPresent(state.renderer);
-    if(!state.vsync) {
-        SDL_Delay(1);
+}
+
+// Hands the finished frame over to the presenting thread
+static void video_publish_snapshot() {
+    video_snapshot *snap = triple_buffer_write_ptr(&snapshots);
+    if(state.framebuffer_ok) {
+        memcpy(snap->frame, state.framebuffer, NATIVE_W * NATIVE_H * 4);
+    } else {
+        memset(snap->frame, 0, NATIVE_W * NATIVE_H * 4);
+    }
+    for(int i = 0; i < NATIVE_W * NATIVE_H; i++) {
+        snap->frame[i * 4 + 3] = 0xFF;
+    }
+    snap->fade = state.fade;
+    snap->target_move_x = state.target_move_x;
+    snap->target_move_y = state.target_move_y;
+    triple_buffer_publish(&snapshots);
+}
+
+/*
+ * Puts the latest published frame on the screen. Only used while threaded, and
+ * only from the thread that owns the window. Returns 1 if there was nothing new
+ * to show.
+ */
+int video_present() {
+    int changed = video_apply_reinit_request();
+    int fresh;
+    video_snapshot *snap = triple_buffer_read_ptr(&snapshots, &fresh);
+    if(!fresh && !changed) {
+        return 1;
+    }
+
+    // Upload to the render target, scaled like the renderers would do it
+    if(state.scale_factor > 1) {
+        if(present_scale_factor != state.scale_factor) {
+            free(present_scaled);
+            present_scaled = malloc(NATIVE_W * NATIVE_H * 4 * state.scale_factor * state.scale_factor);
+            present_scale_factor = state.scale_factor;
+        }
+        scaler_scale(&state.scaler, (char*)snap->frame, present_scaled, NATIVE_W, NATIVE_H, state.scale_factor);
+        SDL_UpdateTexture(state.target, NULL, present_scaled, NATIVE_W * state.scale_factor * 4);
+    } else {
+        SDL_UpdateTexture(state.target, NULL, snap->frame, NATIVE_W * 4);
     }
+    video_present_target(snap->fade, snap->target_move_x, snap->target_move_y);
+    return 0;
+}
+
+// Called after frame has been rendered
+void video_render_finish() {
+    // Tell software/hardware renderer to finish up whatever it was doing
+    PROFILE_BEGIN(PROFILE_RENDER_FINISH);
+    state.cb.render_finish(&state);
+    PROFILE_END(PROFILE_RENDER_FINISH);
+
+    // Frame is complete, so this is the time to take captures of it
+    video_process_captures();
+
+    // Frame scratch data is no longer needed
+    frame_alloc_reset();
+
+    // Nothing to present without a window
+    if(state.headless) {
+        return;
+    }
+
+    // The window is another thread's; it will present this when it gets to it
+    if(state.threaded) {
+        video_publish_snapshot();
+        return;
+    }
+    video_present_target(state.fade, state.target_move_x, state.target_move_y);
 }
 
 void video_close() {
+    video_set_threaded(0);
     state.cb.render_close(&state);
-    SDL_DestroyTexture(state.target);
-    SDL_DestroyRenderer(state.renderer);
-    SDL_DestroyWindow(state.window);
+    if(!state.headless) {
+        SDL_DestroyTexture(state.target);
+        SDL_DestroyRenderer(state.renderer);
+        SDL_DestroyWindow(state.window);
+    }
+    capture_count = 0;
+    free(state.framebuffer);
     free(state.cur_palette);
     free(state.base_palette);
     tcache_close();
@@ -0,0 +1,418 @@
+#include <stdlib.h>
+#include <string.h>
+#include "video/video_composite.h"
+#include "video/video.h"
+#include "utils/vector.h"
+#include "utils/log.h"
+#include "utils/profiler.h"
+
+/*
+* Full software renderer for machines without accelerated rendering.
+*
+* Draw calls are recorded during the frame, and composited in submission order
+* in render_finish, just like the hardware renderer would draw them. The frame is
+* split into horizontal bands, and each band is composited by its own thread.
+* The frame is kept in the framebuffer of the video state, so that it can also be
+* read back without touching the renderer. When there is a window, the result is
+* uploaded to a single streaming texture that is kept between frames, unless the
+* frame is drawn on the simulation thread; then video.c presents it.
+*/
+
+#define COMPOSITE_MAX_BANDS 8
+
+enum {
+    COMPOSITE_COPY,
+    COMPOSITE_ALPHA,
+    COMPOSITE_ADD
+};
+
+typedef struct composite_cmd_t {
+    surface *sur;
+    SDL_Rect dst;
+    int blend;
+    int pal_offset;
+    int flip;
+    uint8_t opacity;
+    color tint;
+    unsigned int pal; // Index of the palette snapshot this call was made with
+} composite_cmd;
+
+typedef struct composite_renderer_t composite_renderer;
+
+typedef struct composite_band_t {
+    composite_renderer *cr;
+    int y_start;
+    int y_end;
+    SDL_Thread *thread;
+    SDL_sem *start;
+} composite_band;
+
+struct composite_renderer_t {
+    vector cmds;
+    vector palettes;
+    unsigned int pal_version;
+    uint8_t *frame; // Framebuffer of the video state
+    char *scaled;
+    unsigned int renderer_version;
+    SDL_Texture *tex;
+    int tex_scale;
+    int band_count;
+    composite_band bands[COMPOSITE_MAX_BANDS];
+    SDL_sem *done;
+    int quit;
+};
+
+static void composite_blend(uint8_t *d, const uint8_t *c, int alpha, int blend) {
+    switch(blend) {
+        case COMPOSITE_COPY:
+            d[0] = c[0];
+            d[1] = c[1];
+            d[2] = c[2];
+            break;
+        case COMPOSITE_ALPHA:
+            d[0] = (c[0] * alpha + d[0] * (255 - alpha)) / 255;
+            d[1] = (c[1] * alpha + d[1] * (255 - alpha)) / 255;
+            d[2] = (c[2] * alpha + d[2] * (255 - alpha)) / 255;
+            break;
+        case COMPOSITE_ADD: {
+            int r = d[0] + c[0] * alpha / 255;
+            int g = d[1] + c[1] * alpha / 255;
+            int b = d[2] + c[2] * alpha / 255;
+            d[0] = (r > 255) ? 255 : r;
+            d[1] = (g > 255) ? 255 : g;
+            d[2] = (b > 255) ? 255 : b;
+            break;
+        }
+    }
+}
+
+// Plain paletted sprite at its own size; copy the opaque spans straight from the palette
+static void composite_spans(uint8_t *frame, const composite_cmd *cmd, const screen_palette *pal, int y_start, int y_end) {
+    const surface *sur = cmd->sur;
+    int hflip = (cmd->flip & SDL_FLIP_HORIZONTAL);
+    for(int y = y_start; y < y_end; y++) {
+        int sy = y - cmd->dst.y;
+        if(cmd->flip & SDL_FLIP_VERTICAL) {
+            sy = sur->h - 1 - sy;
+        }
+        const uint8_t *src_row = (const uint8_t*)sur->data + sy * sur->w;
+        uint8_t *dst_row = frame + y * NATIVE_W * 4;
+
+        int count;
+        const surface_span *spans = surface_get_spans((surface*)sur, sy, &count);
+        for(int i = 0; i < count; i++) {
+            int left = hflip
+                ? cmd->dst.x + sur->w - spans[i].x - spans[i].len
+                : cmd->dst.x + spans[i].x;
+            int right = left + spans[i].len;
+            if(left < 0) left = 0;
+            if(right > NATIVE_W) right = NATIVE_W;
+            for(int x = left; x < right; x++) {
+                int sx = x - cmd->dst.x;
+                uint8_t idx = src_row[hflip ? sur->w - 1 - sx : sx];
+                if(idx < 48) {
+                    idx += cmd->pal_offset;
+                }
+                uint8_t *d = dst_row + x * 4;
+                d[0] = pal->data[idx][0];
+                d[1] = pal->data[idx][1];
+                d[2] = pal->data[idx][2];
+            }
+        }
+    }
+}
+
+// Everything else: scaling, opacity, tint, blending and RGBA sources
+static void composite_generic(uint8_t *frame, const composite_cmd *cmd, const screen_palette *pal, int y_start, int y_end) {
+    const surface *sur = cmd->sur;
+    int x_start = (cmd->dst.x < 0) ? 0 : cmd->dst.x;
+    int x_end = (cmd->dst.x + cmd->dst.w > NATIVE_W) ? NATIVE_W : cmd->dst.x + cmd->dst.w;
+    int modulate = (cmd->tint.r != 0xFF || cmd->tint.g != 0xFF || cmd->tint.b != 0xFF);
+    uint8_t c[3];
+
+    for(int y = y_start; y < y_end; y++) {
+        int sy = (y - cmd->dst.y) * sur->h / cmd->dst.h;
+        if(cmd->flip & SDL_FLIP_VERTICAL) {
+            sy = sur->h - 1 - sy;
+        }
+        uint8_t *dst_row = frame + y * NATIVE_W * 4;
+        for(int x = x_start; x < x_end; x++) {
+            int sx = (x - cmd->dst.x) * sur->w / cmd->dst.w;
+            if(cmd->flip & SDL_FLIP_HORIZONTAL) {
+                sx = sur->w - 1 - sx;
+            }
+            int offset = sy * sur->w + sx;
+            int alpha;
+            if(sur->type == SURFACE_TYPE_PALETTE) {
+                uint8_t idx = sur->data[offset];
+                if(idx < 48) {
+                    idx += cmd->pal_offset;
+                }
+                c[0] = pal->data[idx][0];
+                c[1] = pal->data[idx][1];
+                c[2] = pal->data[idx][2];
+                alpha = (sur->stencil[offset] == 1) ? 255 : 0;
+            } else {
+                const uint8_t *s = (const uint8_t*)sur->data + offset * 4;
+                c[0] = s[0];
+                c[1] = s[1];
+                c[2] = s[2];
+                alpha = s[3];
+            }
+            if(cmd->blend != COMPOSITE_COPY) {
+                alpha = alpha * cmd->opacity / 255;
+                if(alpha == 0) {
+                    continue;
+                }
+            }
+            if(modulate) {
+                c[0] = c[0] * cmd->tint.r / 255;
+                c[1] = c[1] * cmd->tint.g / 255;
+                c[2] = c[2] * cmd->tint.b / 255;
+            }
+            composite_blend(dst_row + x * 4, c, alpha, cmd->blend);
+        }
+    }
+}
+
+static void composite_band_render(composite_renderer *cr, const composite_band *band) {
+    iterator it;
+    composite_cmd *cmd;
+    PROFILE_BEGIN(PROFILE_COMPOSITE_BAND);
+    vector_iter_begin(&cr->cmds, &it);
+    while((cmd = iter_next(&it)) != NULL) {
+        if(cmd->dst.w <= 0 || cmd->dst.h <= 0) {
+            continue;
+        }
+        int y_start = (cmd->dst.y < band->y_start) ? band->y_start : cmd->dst.y;
+        int y_end = (cmd->dst.y + cmd->dst.h > band->y_end) ? band->y_end : cmd->dst.y + cmd->dst.h;
+        if(y_start >= y_end) {
+            continue;
+        }
+
+        const screen_palette *pal = vector_get(&cr->palettes, cmd->pal);
+        if(cmd->sur->type == SURFACE_TYPE_PALETTE
+            && cmd->blend == COMPOSITE_ALPHA
+            && cmd->opacity == 0xFF
+            && cmd->tint.r == 0xFF && cmd->tint.g == 0xFF && cmd->tint.b == 0xFF
+            && cmd->dst.w == cmd->sur->w
+            && cmd->dst.h == cmd->sur->h) {
+            composite_spans(cr->frame, cmd, pal, y_start, y_end);
+        } else {
+            composite_generic(cr->frame, cmd, pal, y_start, y_end);
+        }
+    }
+    PROFILE_END(PROFILE_COMPOSITE_BAND);
+}
+
+static int composite_worker(void *userdata) {
+    composite_band *band = userdata;
+    composite_renderer *cr = band->cr;
+    while(1) {
+        SDL_SemWait(band->start);
+        if(cr->quit) {
+            break;
+        }
+        composite_band_render(cr, band);
+        SDL_SemPost(cr->done);
+    }
+    // Band threads are made again whenever the renderer is, so let the next ones have our ring
+    profiler_thread_exit();
+    return 0;
+}
+
+static void composite_push(video_state *state, composite_cmd *cmd) {
+    composite_renderer *cr = state->userdata;
+
+    // Take a copy of the palette whenever it changes, since the calls are
+    // drawn only after the whole frame is done.
+    if(vector_size(&cr->palettes) == 0 || cr->pal_version != state->cur_palette->version) {
+        vector_append(&cr->palettes, state->cur_palette);
+        cr->pal_version = state->cur_palette->version;
+    }
+    cmd->pal = vector_size(&cr->palettes) - 1;
+
+    // Spans are built lazily; do it here so that the band threads only read them
+    if(cmd->sur->type == SURFACE_TYPE_PALETTE && cmd->sur->h > 0) {
+        int count;
+        surface_get_spans(cmd->sur, 0, &count);
+    }
+    vector_append(&cr->cmds, cmd);
+}
+
+static void composite_reset_texture(video_state *state) {
+    // When threaded, the frame is uploaded by whoever presents it
+    if(state->renderer == NULL || state->threaded) {
+        return;
+    }
+    composite_renderer *cr = state->userdata;
+
+    // Textures of an old renderer are already gone with it
+    if(cr->tex != NULL && cr->renderer_version == state->renderer_version) {
+        SDL_DestroyTexture(cr->tex);
+    }
+    free(cr->scaled);
+    cr->scaled = NULL;
+    if(state->scale_factor > 1) {
+        cr->scaled = malloc(NATIVE_W * NATIVE_H * 4 * state->scale_factor * state->scale_factor);
+    }
+    cr->tex = SDL_CreateTexture(state->renderer,
+                                SDL_PIXELFORMAT_ABGR8888,
+                                SDL_TEXTUREACCESS_STREAMING,
+                                NATIVE_W * state->scale_factor,
+                                NATIVE_H * state->scale_factor);
+    SDL_SetTextureBlendMode(cr->tex, SDL_BLENDMODE_NONE);
+    cr->renderer_version = state->renderer_version;
+    cr->tex_scale = state->scale_factor;
+}
+
+void composite_render_close(video_state *state) {
+    composite_renderer *cr = state->userdata;
+
+    // Stop band threads
+    cr->quit = 1;
+    for(int i = 1; i < cr->band_count; i++) {
+        SDL_SemPost(cr->bands[i].start);
+        SDL_WaitThread(cr->bands[i].thread, NULL);
+        SDL_DestroySemaphore(cr->bands[i].start);
+    }
+    SDL_DestroySemaphore(cr->done);
+
+    if(cr->tex != NULL && cr->renderer_version == state->renderer_version) {
+        SDL_DestroyTexture(cr->tex);
+    }
+    vector_free(&cr->cmds);
+    vector_free(&cr->palettes);
+    free(cr->scaled);
+    free(cr);
+    state->framebuffer_ok = 0;
+}
+
+void composite_render_reinit(video_state *state) {
+    composite_reset_texture(state);
+}
+
+void composite_render_prepare(video_state *state) {
+    composite_renderer *cr = state->userdata;
+    vector_clear(&cr->cmds);
+    vector_clear(&cr->palettes);
+    memset(cr->frame, 0, NATIVE_W * NATIVE_H * 4);
+    state->framebuffer_ok = 0;
+}
+
+void composite_render_finish(video_state *state) {
+    composite_renderer *cr = state->userdata;
+
+    // Composite all bands, the first one on this thread
+    for(int i = 1; i < cr->band_count; i++) {
+        SDL_SemPost(cr->bands[i].start);
+    }
+    composite_band_render(cr, &cr->bands[0]);
+    for(int i = 1; i < cr->band_count; i++) {
+        SDL_SemWait(cr->done);
+    }
+    state->framebuffer_ok = 1;
+    if(state->renderer == NULL || state->threaded) {
+        return;
+    }
+
+    // Renderer may have been recreated behind our back
+    if(cr->tex == NULL || cr->renderer_version != state->renderer_version || cr->tex_scale != state->scale_factor) {
+        composite_reset_texture(state);
+    }
+
+    // Scale and upload
+    if(state->scale_factor > 1) {
+        scaler_scale(&state->scaler, (char*)cr->frame, cr->scaled, NATIVE_W, NATIVE_H, state->scale_factor);
+        SDL_UpdateTexture(cr->tex, NULL, cr->scaled, NATIVE_W * state->scale_factor * 4);
+    } else {
+        SDL_UpdateTexture(cr->tex, NULL, cr->frame, NATIVE_W * 4);
+    }
+    SDL_RenderCopy(state->renderer, cr->tex, NULL, NULL);
+}
+
+void composite_render_background(video_state *state, surface *sur) {
+    composite_cmd cmd;
+    cmd.sur = sur;
+    cmd.dst.x = 0;
+    cmd.dst.y = 0;
+    cmd.dst.w = NATIVE_W;
+    cmd.dst.h = NATIVE_H;
+    cmd.blend = COMPOSITE_COPY;
+    cmd.pal_offset = 0;
+    cmd.flip = 0;
+    cmd.opacity = 0xFF;
+    cmd.tint = color_create(0xFF, 0xFF, 0xFF, 0xFF);
+    composite_push(state, &cmd);
+}
+
+void composite_render_sprite_fsot(
+                    video_state *state,
+                    surface *sur,
+                    SDL_Rect *dst,
+                    SDL_BlendMode blend_mode,
+                    int pal_offset,
+                    SDL_RendererFlip flip_mode,
+                    uint8_t opacity,
+                    color color_mod) {
+
+    composite_cmd cmd;
+    cmd.sur = sur;
+    cmd.dst = *dst;
+    cmd.blend = (blend_mode == SDL_BLENDMODE_ADD) ? COMPOSITE_ADD : COMPOSITE_ALPHA;
+    cmd.pal_offset = pal_offset;
+    cmd.flip = flip_mode;
+    cmd.opacity = opacity;
+    cmd.tint = color_mod;
+    composite_push(state, &cmd);
+}
+
+void video_composite_init(video_state *state) {
+    composite_renderer *cr = malloc(sizeof(composite_renderer));
+    memset(cr, 0, sizeof(composite_renderer));
+    vector_create(&cr->cmds, sizeof(composite_cmd));
+    vector_create(&cr->palettes, sizeof(screen_palette));
+    cr->frame = state->framebuffer;
+    memset(cr->frame, 0, NATIVE_W * NATIVE_H * 4);
+    state->framebuffer_ok = 0;
+    state->userdata = cr;
+    composite_reset_texture(state);
+
+    // One band per CPU core, each at least a few rows high
+    cr->band_count = SDL_GetCPUCount();
+    if(cr->band_count > COMPOSITE_MAX_BANDS) {
+        cr->band_count = COMPOSITE_MAX_BANDS;
+    }
+    if(cr->band_count < 1) {
+        cr->band_count = 1;
+    }
+    cr->done = SDL_CreateSemaphore(0);
+    for(int i = 0; i < cr->band_count; i++) {
+        composite_band *band = &cr->bands[i];
+        band->cr = cr;
+        band->y_start = NATIVE_H * i / cr->band_count;
+        band->y_end = NATIVE_H * (i + 1) / cr->band_count;
+        if(i == 0) {
+            continue;
+        }
+        band->start = SDL_CreateSemaphore(0);
+        band->thread = SDL_CreateThread(composite_worker, "composite", band);
+        if(band->thread == NULL) {
+            // Whatever bands we did not get threads for are merged into the last one
+            PERROR("Unable to start compositor thread: %s", SDL_GetError());
+            SDL_DestroySemaphore(band->start);
+            cr->bands[i - 1].y_end = NATIVE_H;
+            cr->band_count = i;
+            break;
+        }
+    }
+
+    // Bind functions
+    state->cb.render_close = composite_render_close;
+    state->cb.render_reinit = composite_render_reinit;
+    state->cb.render_prepare = composite_render_prepare;
+    state->cb.render_finish = composite_render_finish;
+    state->cb.render_fsot = composite_render_sprite_fsot;
+    state->cb.render_background = composite_render_background;
+    DEBUG("Switched to software compositor with %d bands.", cr->band_count);
+}
@@ -0,0 +1,224 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#if defined(_WIN32) || defined(WIN32)
+#include <io.h>
+#include <fcntl.h>
+#endif
+#include "video/video_export.h"
+#include "video/video.h"
+#include "utils/log.h"
+
+/*
+* Writes rendered frames into a YUV4MPEG2 stream, or as raw RGBA frames.
+*
+* Frames are copied into a small ring of slots, and a writer thread does the
+* color conversion and the writing. If the writer falls behind, the game waits
+* for a free slot, so memory use stays bounded.
+*/
+
+#define EXPORT_QUEUE_SIZE 8
+#define EXPORT_FRAME_SIZE (NATIVE_W * NATIVE_H * 4)
+#define EXPORT_YUV_SIZE (NATIVE_W * NATIVE_H * 3 / 2)
+
+typedef struct {
+    FILE *handle;
+    int y4m;
+    SDL_Thread *thread;
+    SDL_mutex *lock;
+    SDL_cond *cond;
+    char *slots;
+    unsigned char *yuv;
+    int head;
+    int count;
+    int quit;
+    int failed;
+    unsigned int frames;
+} video_exporter;
+
+static video_exporter *exporter = NULL;
+
+static unsigned char clamp_byte(int v) {
+    return (v > 255) ? 255 : ((v < 0) ? 0 : v);
+}
+
+// Full range BT.601 with 2x2 subsampled chroma, which is what C420jpeg means
+static void video_export_rgba_to_yuv(const unsigned char *src, unsigned char *dst) {
+    unsigned char *py = dst;
+    unsigned char *pu = dst + NATIVE_W * NATIVE_H;
+    unsigned char *pv = pu + (NATIVE_W / 2) * (NATIVE_H / 2);
+
+    for(int i = 0; i < NATIVE_W * NATIVE_H; i++) {
+        const unsigned char *p = src + i * 4;
+        py[i] = (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+    }
+    for(int y = 0; y < NATIVE_H / 2; y++) {
+        for(int x = 0; x < NATIVE_W / 2; x++) {
+            const unsigned char *a = src + ((y * 2) * NATIVE_W + x * 2) * 4;
+            const unsigned char *b = a + NATIVE_W * 4;
+            int r = (a[0] + a[4] + b[0] + b[4] + 2) >> 2;
+            int g = (a[1] + a[5] + b[1] + b[5] + 2) >> 2;
+            int bl = (a[2] + a[6] + b[2] + b[6] + 2) >> 2;
+            pu[y * (NATIVE_W / 2) + x] = clamp_byte((-43 * r - 85 * g + 128 * bl + 32896) >> 8);
+            pv[y * (NATIVE_W / 2) + x] = clamp_byte((128 * r - 107 * g - 21 * bl + 32896) >> 8);
+        }
+    }
+}
+
+static int video_export_write(video_exporter *ex, const char *frame) {
+    if(ex->y4m) {
+        video_export_rgba_to_yuv((const unsigned char*)frame, ex->yuv);
+        if(fwrite("FRAME\n", 1, 6, ex->handle) != 6) {
+            return 1;
+        }
+        if(fwrite(ex->yuv, 1, EXPORT_YUV_SIZE, ex->handle) != EXPORT_YUV_SIZE) {
+            return 1;
+        }
+        return 0;
+    }
+    if(fwrite(frame, 1, EXPORT_FRAME_SIZE, ex->handle) != EXPORT_FRAME_SIZE) {
+        return 1;
+    }
+    return 0;
+}
+
+static int video_export_worker(void *userdata) {
+    video_exporter *ex = userdata;
+    SDL_LockMutex(ex->lock);
+    while(1) {
+        while(ex->count == 0 && !ex->quit) {
+            SDL_CondWait(ex->cond, ex->lock);
+        }
+        if(ex->count == 0) {
+            break;
+        }
+
+        // The slot at head is ours until count is decremented
+        const char *frame = ex->slots + ex->head * EXPORT_FRAME_SIZE;
+        SDL_UnlockMutex(ex->lock);
+        int ret = video_export_write(ex, frame);
+        SDL_LockMutex(ex->lock);
+
+        if(ret != 0 && !ex->failed) {
+            PERROR("Writing exported video failed!");
+            ex->failed = 1;
+        }
+        ex->head = (ex->head + 1) % EXPORT_QUEUE_SIZE;
+        ex->count--;
+        SDL_CondBroadcast(ex->cond);
+    }
+    SDL_UnlockMutex(ex->lock);
+    return 0;
+}
+
+/*
+ * Starts writing frames to filename, or to stdout if it is "-". Files ending
+ * in .y4m and stdout get a YUV4MPEG2 stream, anything else raw RGBA frames.
+ */
+int video_export_open(const char *filename, int fps) {
+    video_exporter *ex = malloc(sizeof(video_exporter));
+    memset(ex, 0, sizeof(video_exporter));
+
+    const char *ext = strrchr(filename, '.');
+    if(strcmp(filename, "-") == 0) {
+        ex->handle = stdout;
+        ex->y4m = 1;
+#if defined(_WIN32) || defined(WIN32)
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    } else {
+        ex->handle = fopen(filename, "wb");
+        ex->y4m = (ext != NULL && strcasecmp(ext, ".y4m") == 0);
+    }
+    if(ex->handle == NULL) {
+        PERROR("Could not open video export file %s!", filename);
+        goto exit_0;
+    }
+    if(ex->y4m) {
+        fprintf(ex->handle, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", NATIVE_W, NATIVE_H, fps);
+    }
+
+    ex->slots = malloc(EXPORT_FRAME_SIZE * EXPORT_QUEUE_SIZE);
+    ex->yuv = malloc(EXPORT_YUV_SIZE);
+    ex->lock = SDL_CreateMutex();
+    ex->cond = SDL_CreateCond();
+    ex->thread = SDL_CreateThread(video_export_worker, "video export", ex);
+    if(ex->thread == NULL) {
+        PERROR("Unable to start video export thread: %s", SDL_GetError());
+        goto exit_1;
+    }
+
+    exporter = ex;
+    INFO("Exporting %s video at %d fps to %s.", ex->y4m ? "Y4M" : "RGBA", fps, filename);
+    return 0;
+
+exit_1:
+    SDL_DestroyCond(ex->cond);
+    SDL_DestroyMutex(ex->lock);
+    free(ex->yuv);
+    free(ex->slots);
+    if(ex->handle != stdout) {
+        fclose(ex->handle);
+    }
+exit_0:
+    free(ex);
+    return 1;
+}
+
+// Queues the last finished frame for writing. Returns 1 if writing has failed.
+int video_export_frame() {
+    video_exporter *ex = exporter;
+    if(ex == NULL) {
+        return 1;
+    }
+
+    SDL_LockMutex(ex->lock);
+    while(ex->count == EXPORT_QUEUE_SIZE && !ex->failed) {
+        SDL_CondWait(ex->cond, ex->lock);
+    }
+    int failed = ex->failed;
+    int slot = (ex->head + ex->count) % EXPORT_QUEUE_SIZE;
+    SDL_UnlockMutex(ex->lock);
+    if(failed) {
+        return 1;
+    }
+
+    // Nobody else touches the free slot, so fill it without the lock
+    video_read_frame(ex->slots + slot * EXPORT_FRAME_SIZE);
+
+    SDL_LockMutex(ex->lock);
+    ex->count++;
+    ex->frames++;
+    SDL_CondBroadcast(ex->cond);
+    SDL_UnlockMutex(ex->lock);
+    return 0;
+}
+
+// Writes out whatever is still queued, and closes the output
+void video_export_close() {
+    video_exporter *ex = exporter;
+    if(ex == NULL) {
+        return;
+    }
+
+    SDL_LockMutex(ex->lock);
+    ex->quit = 1;
+    SDL_CondBroadcast(ex->cond);
+    SDL_UnlockMutex(ex->lock);
+    SDL_WaitThread(ex->thread, NULL);
+
+    if(ex->handle != stdout) {
+        fclose(ex->handle);
+    } else {
+        fflush(stdout);
+    }
+    INFO("Video export done, %u frames written.", ex->frames);
+    SDL_DestroyCond(ex->cond);
+    SDL_DestroyMutex(ex->lock);
+    free(ex->yuv);
+    free(ex->slots);
+    free(ex);
+    exporter = NULL;
+}
@@ -0,0 +1,525 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include "engine.h"
+#include "utils/log.h"
+#include "utils/random.h"
+#include "utils/hashmap.h"
+#include "utils/vector.h"
+#include "utils/iterator.h"
+#include "game/game_state.h"
+#include "game/game_player.h"
+#include "game/common_defines.h"
+#include "game/objects/har.h"
+#include "game/utils/serial.h"
+#include "game/utils/settings.h"
+#include "controller/ai_controller.h"
+#include "resources/ids.h"
+#include "resources/af_loader.h"
+#include "resources/bk_loader.h"
+#include "resources/pathmanager.h"
+#include "resources/baked.h"
+#include "plugins/plugins.h"
+#include "video/video.h"
+
+/*
+* Benchmarks for the hot paths of the game.
+*
+* Every scenario is set up from scratch with a fixed random seed and default
+* settings, run once to warm up, and then BENCH_RUNS times. Only the run itself
+* is timed. Nothing from the user directory is used: the AI starts without
+* learned move stats every time, and sprites are always decoded from the
+* original files, even if a baked archive exists. The time per operation of
+* each run is collected, and the results are written out as JSON so that they
+* can be compared between builds.
+*
+* Usage: openomf_bench [OUT.json] [SCENARIO]
+*/
+
+#define BENCH_RUNS 5
+#define BENCH_SEED 0x2097
+#define BENCH_CONFIG "openomf_bench.conf"
+
+#define BENCH_ARENA_TICKS 10000
+#define BENCH_SCRAP_SPAWNS 40
+#define BENCH_SCRAP_TICKS 200
+#define BENCH_MENU_FRAMES 200
+#define BENCH_CHURN_ITEMS 10000
+#define BENCH_SERIAL_ROUNDS 1000
+
+typedef struct bench_scenario_t {
+    const char *name;
+    int needs_data; // Needs game resources and an initialized engine
+    int (*setup)();
+    unsigned int (*run)(); // Returns the number of operations done
+    void (*teardown)();
+} bench_scenario;
+
+typedef struct bench_result_t {
+    const char *name;
+    int skipped;
+    unsigned int ops;
+    double mean;
+    double stddev;
+    double min;
+    double max;
+} bench_result;
+
+static engine_init_flags bench_flags;
+static game_state *gs = NULL;
+static bk bk_files[BK_WORLD - BK_INTRO + 1];
+static af af_files[AF_NOVA - AF_JAGUAR + 1];
+static int bk_loaded[BK_WORLD - BK_INTRO + 1];
+static int af_loaded[AF_NOVA - AF_JAGUAR + 1];
+
+static void bench_tick(game_state *g) {
+    game_state_tick_controllers(g);
+    game_state_static_tick(g);
+    game_state_dynamic_tick(g);
+}
+
+// AI against AI in a random arena. Training is off, so the AI does not learn between runs.
+static int bench_arena_create() {
+    memset(&bench_flags, 0, sizeof(engine_init_flags));
+    bench_flags.net_mode = NET_MODE_NONE;
+    bench_flags.ai_match = 1;
+    ai_controller_set_training(0);
+    ai_controller_reset_stats();
+    rand_seed(BENCH_SEED);
+    gs = malloc(sizeof(game_state));
+    if(game_state_create(gs, &bench_flags)) {
+        free(gs);
+        gs = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+static void bench_game_free() {
+    if(gs != NULL) {
+        game_state_free(gs);
+        free(gs);
+        gs = NULL;
+    }
+}
+
+// Decode all BK and AF files
+static unsigned int bench_decode_run() {
+    unsigned int ops = 0;
+    for(int id = BK_INTRO; id <= BK_WORLD; id++) {
+        bk b;
+        if(load_bk_file_sync(&b, id) == 0) {
+            bk_free(&b);
+            ops++;
+        }
+    }
+    for(int id = AF_JAGUAR; id <= AF_NOVA; id++) {
+        af a;
+        if(load_af_file_sync(&a, id) == 0) {
+            af_free(&a);
+            ops++;
+        }
+    }
+    return ops;
+}
+
+static unsigned int bench_arena_run() {
+    for(int i = 0; i < BENCH_ARENA_TICKS; i++) {
+        bench_tick(gs);
+    }
+    return BENCH_ARENA_TICKS;
+}
+
+// Both HARs throw scrap around, then the pile is ticked
+static int bench_scrap_setup() {
+    if(bench_arena_create()) {
+        return 1;
+    }
+    for(int i = 0; i < 10; i++) {
+        bench_tick(gs);
+    }
+    for(int i = 0; i < BENCH_SCRAP_SPAWNS; i++) {
+        object *har = game_player_get_har(game_state_get_player(gs, i % 2));
+        if(har != NULL) {
+            har_spawn_scrap(har, vec2i_create(60 + i * 5, 150), 20);
+        }
+    }
+    return 0;
+}
+
+static unsigned int bench_scrap_run() {
+    for(int i = 0; i < BENCH_SCRAP_TICKS; i++) {
+        game_state_dynamic_tick(gs);
+    }
+    return BENCH_SCRAP_TICKS;
+}
+
+// Main menu, drawn by the offscreen renderer
+static int bench_menu_setup() {
+    memset(&bench_flags, 0, sizeof(engine_init_flags));
+    bench_flags.net_mode = NET_MODE_NONE;
+    rand_seed(BENCH_SEED);
+    gs = malloc(sizeof(game_state));
+    if(game_state_create(gs, &bench_flags)) {
+        free(gs);
+        gs = NULL;
+        return 1;
+    }
+    game_state_set_next(gs, SCENE_MENU);
+    for(int i = 0; i < 100 && gs->this_id != SCENE_MENU; i++) {
+        bench_tick(gs);
+    }
+    return (gs->this_id == SCENE_MENU) ? 0 : 1;
+}
+
+static unsigned int bench_menu_run() {
+    for(int i = 0; i < BENCH_MENU_FRAMES; i++) {
+        video_render_prepare();
+        game_state_render(gs);
+        video_render_finish();
+    }
+    return BENCH_MENU_FRAMES;
+}
+
+// Sprites are decoded on first use, so do that here to keep it out of the timing
+static void bench_rgba_decode(animation *ani) {
+    for(int i = 0; i < animation_get_sprite_count(ani); i++) {
+        sprite_get_surface(animation_get_sprite(ani, i));
+    }
+}
+
+// Every sprite of every BK and AF file to RGBA
+static int bench_rgba_setup() {
+    iterator it;
+    hashmap_pair *pair;
+    for(int id = BK_INTRO; id <= BK_WORLD; id++) {
+        bk *b = &bk_files[id - BK_INTRO];
+        bk_loaded[id - BK_INTRO] = (load_bk_file_sync(b, id) == 0);
+        if(!bk_loaded[id - BK_INTRO]) {
+            continue;
+        }
+        hashmap_iter_begin(&b->infos, &it);
+        while((pair = iter_next(&it)) != NULL) {
+            bench_rgba_decode(&((bk_info*)pair->val)->ani);
+        }
+    }
+    for(int id = AF_JAGUAR; id <= AF_NOVA; id++) {
+        af *a = &af_files[id - AF_JAGUAR];
+        af_loaded[id - AF_JAGUAR] = (load_af_file_sync(a, id) == 0);
+        if(!af_loaded[id - AF_JAGUAR]) {
+            continue;
+        }
+        for(int m = 0; m < 70; m++) {
+            af_move *move = af_get_move(a, m);
+            if(move != NULL) {
+                bench_rgba_decode(&move->ani);
+            }
+        }
+    }
+    return 0;
+}
+
+static unsigned int bench_rgba_animation(animation *ani, screen_palette *pal, char **buf, int *buf_size) {
+    unsigned int ops = 0;
+    for(int i = 0; i < animation_get_sprite_count(ani); i++) {
+        surface *sur = sprite_get_surface(animation_get_sprite(ani, i));
+        if(sur == NULL || sur->w == 0 || sur->h == 0) {
+            continue;
+        }
+        if(sur->w * sur->h * 4 > *buf_size) {
+            *buf_size = sur->w * sur->h * 4;
+            *buf = realloc(*buf, *buf_size);
+        }
+        surface_to_rgba(sur, *buf, pal, NULL, 0);
+        ops++;
+    }
+    return ops;
+}
+
+static unsigned int bench_rgba_run() {
+    screen_palette pal;
+    memset(&pal, 0, sizeof(screen_palette));
+    char *buf = NULL;
+    int buf_size = 0;
+    unsigned int ops = 0;
+    iterator it;
+    hashmap_pair *pair;
+
+    for(int i = 0; i <= BK_WORLD - BK_INTRO; i++) {
+        if(!bk_loaded[i]) {
+            continue;
+        }
+        palette *p = bk_get_palette(&bk_files[i], 0);
+        if(p != NULL) {
+            memcpy(pal.data, p->data, 768);
+        }
+        hashmap_iter_begin(&bk_files[i].infos, &it);
+        while((pair = iter_next(&it)) != NULL) {
+            bk_info *info = pair->val;
+            ops += bench_rgba_animation(&info->ani, &pal, &buf, &buf_size);
+        }
+    }
+    for(int i = 0; i <= AF_NOVA - AF_JAGUAR; i++) {
+        if(!af_loaded[i]) {
+            continue;
+        }
+        for(int m = 0; m < 70; m++) {
+            af_move *move = af_get_move(&af_files[i], m);
+            if(move != NULL) {
+                ops += bench_rgba_animation(&move->ani, &pal, &buf, &buf_size);
+            }
+        }
+    }
+    free(buf);
+    return ops;
+}
+
+static void bench_rgba_teardown() {
+    for(int i = 0; i <= BK_WORLD - BK_INTRO; i++) {
+        if(bk_loaded[i]) {
+            bk_free(&bk_files[i]);
+        }
+    }
+    for(int i = 0; i <= AF_NOVA - AF_JAGUAR; i++) {
+        if(af_loaded[i]) {
+            af_free(&af_files[i]);
+        }
+    }
+}
+
+// Fill, look up and empty a hashmap and a vector
+static unsigned int bench_churn_run() {
+    hashmap h;
+    vector v;
+    iterator it;
+    unsigned int ops = 0;
+
+    hashmap_create(&h, 8);
+    for(unsigned int i = 0; i < BENCH_CHURN_ITEMS; i++) {
+        hashmap_iput(&h, i * 7919, &i, sizeof(unsigned int));
+        ops++;
+    }
+    for(unsigned int i = 0; i < BENCH_CHURN_ITEMS; i++) {
+        void *val;
+        unsigned int len;
+        hashmap_iget(&h, i * 7919, &val, &len);
+        ops++;
+    }
+    for(unsigned int i = 0; i < BENCH_CHURN_ITEMS; i += 2) {
+        hashmap_idel(&h, i * 7919);
+        ops++;
+    }
+    hashmap_free(&h);
+
+    vector_create(&v, sizeof(unsigned int));
+    for(unsigned int i = 0; i < BENCH_CHURN_ITEMS; i++) {
+        vector_append(&v, &i);
+        ops++;
+    }
+    unsigned int *item;
+    vector_iter_begin(&v, &it);
+    while((item = iter_next(&it)) != NULL) {
+        if(*item % 2) {
+            vector_mark_delete(&v, &it);
+        }
+        ops++;
+    }
+    vector_compact(&v);
+    vector_free(&v);
+    return ops;
+}
+
+// Snapshot and restore, as netplay does
+static int bench_serial_setup() {
+    if(bench_arena_create()) {
+        return 1;
+    }
+    for(int i = 0; i < 100; i++) {
+        bench_tick(gs);
+    }
+    return 0;
+}
+
+static unsigned int bench_serial_run() {
+    for(int i = 0; i < BENCH_SERIAL_ROUNDS; i++) {
+        serial ser;
+        serial_create(&ser);
+        game_state_serialize(gs, &ser);
+        game_state_unserialize(gs, &ser, 0);
+        serial_free(&ser);
+    }
+    return BENCH_SERIAL_ROUNDS;
+}
+
+static const bench_scenario scenarios[] = {
+    {"decode_bk_af",       1, NULL,               bench_decode_run, NULL},
+    {"arena_ai_10k_ticks", 1, bench_arena_create, bench_arena_run,  bench_game_free},
+    {"scrap_tick",         1, bench_scrap_setup,  bench_scrap_run,  bench_game_free},
+    {"menu_render",        1, bench_menu_setup,   bench_menu_run,   bench_game_free},
+    {"surface_to_rgba",    1, bench_rgba_setup,   bench_rgba_run,   bench_rgba_teardown},
+    {"hashmap_vector",     0, NULL,               bench_churn_run,  NULL},
+    {"serialize_round",    1, bench_serial_setup, bench_serial_run, bench_game_free},
+};
+
+static int bench_run_scenario(const bench_scenario *sc, bench_result *res) {
+    double samples[BENCH_RUNS];
+    uint64_t freq = SDL_GetPerformanceFrequency();
+
+    // The first run is a warmup and does not count
+    for(int r = -1; r < BENCH_RUNS; r++) {
+        if(sc->setup != NULL && sc->setup()) {
+            PERROR("Setting up benchmark %s failed.", sc->name);
+            if(sc->teardown != NULL) {
+                sc->teardown();
+            }
+            return 1;
+        }
+        uint64_t start = SDL_GetPerformanceCounter();
+        unsigned int ops = sc->run();
+        uint64_t end = SDL_GetPerformanceCounter();
+        if(sc->teardown != NULL) {
+            sc->teardown();
+        }
+        if(ops == 0) {
+            PERROR("Benchmark %s did nothing.", sc->name);
+            return 1;
+        }
+        if(r >= 0) {
+            samples[r] = (double)(end - start) * 1000000000.0 / freq / ops;
+            res->ops = ops;
+        }
+    }
+
+    res->mean = 0.0;
+    res->min = samples[0];
+    res->max = samples[0];
+    for(int r = 0; r < BENCH_RUNS; r++) {
+        res->mean += samples[r] / BENCH_RUNS;
+        if(samples[r] < res->min) {
+            res->min = samples[r];
+        }
+        if(samples[r] > res->max) {
+            res->max = samples[r];
+        }
+    }
+    double var = 0.0;
+    for(int r = 0; r < BENCH_RUNS; r++) {
+        var += (samples[r] - res->mean) * (samples[r] - res->mean) / BENCH_RUNS;
+    }
+    res->stddev = sqrt(var);
+    return 0;
+}
+
+static void bench_write_json(FILE *out, const bench_result *results, int count) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"version\": \"%d.%d.%d\",\n", V_MAJOR, V_MINOR, V_PATCH);
+    fprintf(out, "  \"runs\": %d,\n", BENCH_RUNS);
+    fprintf(out, "  \"scenarios\": [\n");
+    for(int i = 0; i < count; i++) {
+        const bench_result *res = &results[i];
+        if(res->skipped) {
+            fprintf(out, "    {\"name\": \"%s\", \"skipped\": true}", res->name);
+        } else {
+            fprintf(out, "    {\"name\": \"%s\", \"ops\": %u, \"ns_per_op\": %.1f, "
+                         "\"stddev\": %.1f, \"min\": %.1f, \"max\": %.1f}",
+                    res->name, res->ops, res->mean, res->stddev, res->min, res->max);
+        }
+        fprintf(out, "%s\n", (i < count - 1) ? "," : "");
+    }
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *out_file = (argc > 1) ? argv[1] : NULL;
+    const char *only = (argc > 2) ? argv[2] : NULL;
+    int have_data = 0;
+    int have_paths = (pm_init() == 0);
+    int ret = 0;
+
+    // Results may be going to stdout, so keep the log away from there
+    if(out_file != NULL) {
+        log_init(0);
+    } else if(have_paths) {
+        log_init(pm_get_local_path(LOG_PATH));
+    }
+    if(!have_paths) {
+        PERROR("%s; only running benchmarks that need no game data.", pm_get_errormsg());
+    }
+
+    // Nothing is drawn on screen, and timings should not depend on the user's settings
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    if(SDL_Init(SDL_INIT_TIMER|SDL_INIT_VIDEO)) {
+        PERROR("SDL2 Initialization failed: %s", SDL_GetError());
+        ret = 1;
+        goto exit_0;
+    }
+    if(have_paths) {
+        remove(BENCH_CONFIG);
+        if(settings_init(BENCH_CONFIG) == 0) {
+            settings_load();
+            settings_get()->video.crossfade_on = 0;
+            plugins_init();
+            memset(&bench_flags, 0, sizeof(engine_init_flags));
+            bench_flags.headless = 1;
+            have_data = (engine_init(&bench_flags) == 0);
+            // A baked archive would change what decode_bk_af measures
+            baked_close();
+        }
+    }
+
+    int count = sizeof(scenarios) / sizeof(bench_scenario);
+    bench_result results[sizeof(scenarios) / sizeof(bench_scenario)];
+    int done = 0;
+    for(int i = 0; i < count; i++) {
+        const bench_scenario *sc = &scenarios[i];
+        if(only != NULL && strcmp(only, sc->name) != 0) {
+            continue;
+        }
+        bench_result *res = &results[done++];
+        memset(res, 0, sizeof(bench_result));
+        res->name = sc->name;
+        if(sc->needs_data && !have_data) {
+            res->skipped = 1;
+            continue;
+        }
+        fprintf(stderr, "Running %s ...\n", sc->name);
+        if(bench_run_scenario(sc, res)) {
+            res->skipped = 1;
+            ret = 1;
+        }
+    }
+
+    FILE *out = stdout;
+    if(out_file != NULL) {
+        out = fopen(out_file, "w");
+        if(out == NULL) {
+            PERROR("Could not open %s for writing!", out_file);
+            ret = 1;
+            goto exit_1;
+        }
+    }
+    bench_write_json(out, results, done);
+    if(out != stdout) {
+        fclose(out);
+    }
+
+exit_1:
+    if(have_data) {
+        engine_close();
+    }
+    if(have_paths) {
+        plugins_close();
+        settings_free();
+        remove(BENCH_CONFIG);
+    }
+    SDL_Quit();
+exit_0:
+    log_close();
+    if(have_paths) {
+        pm_free();
+    }
+    return ret;
+}
@@ -0,0 +1,96 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <utils/frame_alloc.h>
+#include <stdint.h>
+#include <string.h>
+
+void test_frame_alloc_malloc(void) {
+    char *a = frame_alloc_malloc(10);
+    char *b = frame_alloc_malloc(100);
+    CU_ASSERT_FATAL(a != NULL);
+    CU_ASSERT_FATAL(b != NULL);
+    CU_ASSERT(frame_alloc_owns(a));
+    CU_ASSERT(frame_alloc_owns(b));
+    CU_ASSERT(((uintptr_t)a % 16) == 0);
+    CU_ASSERT(((uintptr_t)b % 16) == 0);
+    CU_ASSERT(b > a);
+    memset(a, 1, 10);
+    memset(b, 2, 100);
+    CU_ASSERT(a[9] == 1);
+
+    // Freeing the latest allocation hands the same memory out again
+    frame_alloc_free(b);
+    char *c = frame_alloc_malloc(100);
+    CU_ASSERT(c == b);
+    frame_alloc_free(c);
+    frame_alloc_free(a);
+
+    // Everything is released, so the arena starts from the beginning
+    CU_ASSERT(frame_alloc_malloc(1) == a);
+    frame_alloc_free(a);
+}
+
+void test_frame_alloc_realloc(void) {
+    char *a = frame_alloc_malloc(16);
+    memset(a, 3, 16);
+
+    // Latest allocation grows in place
+    char *b = frame_alloc_realloc(a, 1024);
+    CU_ASSERT(b == a);
+    CU_ASSERT(b[15] == 3);
+
+    // Otherwise the contents are moved
+    char *c = frame_alloc_malloc(16);
+    char *d = frame_alloc_realloc(b, 2048);
+    CU_ASSERT(d != b);
+    CU_ASSERT(d[0] == 3 && d[15] == 3);
+    frame_alloc_free(c);
+    frame_alloc_free(d);
+}
+
+void test_frame_alloc_fallback(void) {
+    char *a = frame_alloc_malloc(FRAME_ALLOC_SIZE + 1);
+    CU_ASSERT_FATAL(a != NULL);
+    CU_ASSERT(frame_alloc_owns(a) == 0);
+    frame_alloc_free(a);
+}
+
+void test_frame_alloc_stats(void) {
+    frame_alloc_stats stats;
+    frame_alloc_reset();
+    frame_alloc_free(frame_alloc_malloc(10));
+    frame_alloc_free(frame_alloc_malloc(20));
+    frame_alloc_free(frame_alloc_malloc(FRAME_ALLOC_SIZE + 1));
+    frame_alloc_reset();
+    frame_alloc_get_stats(&stats, NULL);
+    CU_ASSERT(stats.allocs == 2);
+    CU_ASSERT(stats.bytes == 30);
+    CU_ASSERT(stats.fallbacks == 1);
+
+    frame_alloc_reset();
+    frame_alloc_get_stats(&stats, NULL);
+    CU_ASSERT(stats.allocs == 0);
+    CU_ASSERT(stats.bytes == 0);
+}
+
+void test_frame_alloc_reset(void) {
+    // Memory in use must survive a reset
+    char *a = frame_alloc_malloc(8);
+    strcpy(a, "frame");
+    frame_alloc_reset();
+    char *b = frame_alloc_malloc(8);
+    CU_ASSERT(b != a);
+    CU_ASSERT(strcmp(a, "frame") == 0);
+    frame_alloc_free(a);
+    frame_alloc_free(b);
+    frame_alloc_close();
+}
+
+void frame_alloc_test_suite(CU_pSuite suite) {
+    // Add tests
+    if(CU_add_test(suite, "Test for frame alloc malloc", test_frame_alloc_malloc) == NULL) { return; }
+    if(CU_add_test(suite, "Test for frame alloc realloc", test_frame_alloc_realloc) == NULL) { return; }
+    if(CU_add_test(suite, "Test for frame alloc fallback", test_frame_alloc_fallback) == NULL) { return; }
+    if(CU_add_test(suite, "Test for frame alloc stats", test_frame_alloc_stats) == NULL) { return; }
+    if(CU_add_test(suite, "Test for frame alloc reset", test_frame_alloc_reset) == NULL) { return; }
+}
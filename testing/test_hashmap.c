@@ -3,8 +3,10 @@
 #include <utils/hashmap.h>
 #include <utils/iterator.h>
 #include <stdio.h>
+#include <time.h>
 
 #define TEST_VAL_COUNT 1000
+#define BENCH_COUNT 200000
 
 hashmap test_map;
 unsigned int test_values[TEST_VAL_COUNT];
@@ -112,6 +114,87 @@ void test_hashmap_clear(void) {
     CU_ASSERT(hashmap_reserved(&test_map) == 0);
 }
 
+void test_hashmap_replace(void) {
+    hashmap map;
+    unsigned int *val;
+    unsigned int vlen;
+    unsigned int a = 1, b = 2;
+    hashmap_create(&map, 2);
+    hashmap_iput(&map, 5, &a, sizeof(int));
+    hashmap_iput(&map, 5, &b, sizeof(int));
+    CU_ASSERT(hashmap_reserved(&map) == 1);
+    CU_ASSERT(hashmap_iget(&map, 5, (void**)&val, &vlen) == 0);
+    CU_ASSERT(*val == 2);
+    hashmap_free(&map);
+}
+
+static double bench_mops(clock_t start, clock_t end, int count) {
+    double secs = (double)(end - start) / CLOCKS_PER_SEC;
+    if(secs <= 0) {
+        return 0;
+    }
+    return count / secs / 1000000.0;
+}
+
+void test_hashmap_benchmark(void) {
+    hashmap map;
+    char key[32];
+    unsigned int *val;
+    unsigned int vlen;
+    int failed = 0;
+    clock_t t[7];
+
+    // Start small, so that the growth path gets exercised too
+    hashmap_create(&map, 4);
+    t[0] = clock();
+    for(unsigned int i = 0; i < BENCH_COUNT; i++) {
+        hashmap_iput(&map, i, &i, sizeof(int));
+    }
+    t[1] = clock();
+    for(unsigned int i = 0; i < BENCH_COUNT; i++) {
+        if(hashmap_iget(&map, i, (void**)&val, &vlen) != 0 || *val != i) {
+            failed++;
+        }
+    }
+    t[2] = clock();
+    CU_ASSERT(failed == 0);
+    CU_ASSERT(hashmap_reserved(&map) == BENCH_COUNT);
+    CU_ASSERT(hashmap_size(&map) >= BENCH_COUNT);
+    for(unsigned int i = 0; i < BENCH_COUNT; i++) {
+        hashmap_idel(&map, i);
+    }
+    t[3] = clock();
+    CU_ASSERT(hashmap_reserved(&map) == 0);
+    hashmap_free(&map);
+
+    // String keys
+    failed = 0;
+    hashmap_create(&map, 4);
+    t[4] = clock();
+    for(unsigned int i = 0; i < BENCH_COUNT; i++) {
+        sprintf(key, "bench_key_%u", i);
+        hashmap_sput(&map, key, &i, sizeof(int));
+    }
+    t[5] = clock();
+    for(unsigned int i = 0; i < BENCH_COUNT; i++) {
+        sprintf(key, "bench_key_%u", i);
+        if(hashmap_sget(&map, key, (void**)&val, &vlen) != 0 || *val != i) {
+            failed++;
+        }
+    }
+    t[6] = clock();
+    CU_ASSERT(failed == 0);
+    hashmap_free(&map);
+
+    printf("\n    int put %.2f Mops/s, int get %.2f Mops/s, int del %.2f Mops/s",
+        bench_mops(t[0], t[1], BENCH_COUNT),
+        bench_mops(t[1], t[2], BENCH_COUNT),
+        bench_mops(t[2], t[3], BENCH_COUNT));
+    printf("\n    str put %.2f Mops/s, str get %.2f Mops/s\n    ",
+        bench_mops(t[4], t[5], BENCH_COUNT),
+        bench_mops(t[5], t[6], BENCH_COUNT));
+}
+
 void hashmap_test_suite(CU_pSuite suite) {
     // Add tests
     if(CU_add_test(suite, "Test for hashmap create", test_hashmap_create) == NULL) { return; }
@@ -122,4 +205,6 @@ void hashmap_test_suite(CU_pSuite suite) {
     if(CU_add_test(suite, "Test for hashmap iterator delete operation", test_hashmap_iter_del) == NULL) { return; }
     if(CU_add_test(suite, "Test for hashmap clear operation", test_hashmap_clear) == NULL) { return; }
     if(CU_add_test(suite, "Test for hashmap free operation", test_hashmap_free) == NULL) { return; }
+    if(CU_add_test(suite, "Test for hashmap value replace", test_hashmap_replace) == NULL) { return; }
+    if(CU_add_test(suite, "Hashmap throughput benchmark", test_hashmap_benchmark) == NULL) { return; }
 }
@@ -0,0 +1,57 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <utils/histogram.h>
+
+static const float bounds[] = {1.0f, 2.0f, 4.0f};
+
+void test_histogram_add(void) {
+    histogram h;
+    histogram_create(&h, bounds, 3);
+    CU_ASSERT(h.bucket_count == 4);
+
+    histogram_add(&h, 0.5f);
+    histogram_add(&h, 1.0f);
+    histogram_add(&h, 1.5f);
+    histogram_add(&h, 3.0f);
+    histogram_add(&h, 10.0f);
+    CU_ASSERT(h.counts[0] == 1);
+    CU_ASSERT(h.counts[1] == 2);
+    CU_ASSERT(h.counts[2] == 1);
+    CU_ASSERT(h.counts[3] == 1);
+    CU_ASSERT(h.samples == 5);
+    CU_ASSERT_DOUBLE_EQUAL(h.min, 0.5f, 0.0001f);
+    CU_ASSERT_DOUBLE_EQUAL(h.max, 10.0f, 0.0001f);
+    CU_ASSERT_DOUBLE_EQUAL(histogram_mean(&h), 3.2f, 0.0001f);
+}
+
+void test_histogram_percentile(void) {
+    histogram h;
+    histogram_create(&h, bounds, 3);
+    for(int i = 0; i < 90; i++) {
+        histogram_add(&h, 0.5f);
+    }
+    for(int i = 0; i < 9; i++) {
+        histogram_add(&h, 3.0f);
+    }
+    histogram_add(&h, 20.0f);
+    CU_ASSERT_DOUBLE_EQUAL(histogram_percentile(&h, 0.5f), 1.0f, 0.0001f);
+    CU_ASSERT_DOUBLE_EQUAL(histogram_percentile(&h, 0.95f), 4.0f, 0.0001f);
+    CU_ASSERT_DOUBLE_EQUAL(histogram_percentile(&h, 0.999f), 20.0f, 0.0001f);
+}
+
+void test_histogram_reset(void) {
+    histogram h;
+    histogram_create(&h, bounds, 3);
+    histogram_add(&h, 3.0f);
+    histogram_reset(&h);
+    CU_ASSERT(h.samples == 0);
+    CU_ASSERT(h.counts[2] == 0);
+    CU_ASSERT_DOUBLE_EQUAL(histogram_mean(&h), 0.0f, 0.0001f);
+}
+
+void histogram_test_suite(CU_pSuite suite) {
+    // Add tests
+    if(CU_add_test(suite, "Test for histogram add", test_histogram_add) == NULL) { return; }
+    if(CU_add_test(suite, "Test for histogram percentile", test_histogram_percentile) == NULL) { return; }
+    if(CU_add_test(suite, "Test for histogram reset", test_histogram_reset) == NULL) { return; }
+}
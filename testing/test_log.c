@@ -0,0 +1,70 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <stdio.h>
+#include <string.h>
+#include <utils/log.h>
+
+#define TEST_LOG_FILE "test_log.txt"
+
+static void read_log(char *buf, size_t size) {
+    FILE *f = fopen(TEST_LOG_FILE, "r");
+    size_t len = 0;
+    if(f != NULL) {
+        len = fread(buf, 1, size - 1, f);
+        fclose(f);
+    }
+    buf[len] = '\0';
+}
+
+void test_log_format(void) {
+    char buf[1024];
+    char name[16];
+    CU_ASSERT(log_init(TEST_LOG_FILE) == 0);
+    strcpy(name, "jaguar");
+    log_print(LOG_INFO, "src/game/objects/har.c", "har_tick", "%s %d %5.2f|%-4u|%*d|%.*s|%lu|%zu %c 100%%",
+              name, -3, 1.5, 7u, 3, 4, 2, "abcd", 12345678UL, (size_t)9, 'x');
+    strcpy(name, "gone");
+    log_print(LOG_ERROR, "src/game/protos/object.c", NULL, "plain");
+    log_close();
+
+    read_log(buf, sizeof(buf));
+    CU_ASSERT_STRING_EQUAL(buf,
+        "[      0][I][har] har_tick(): jaguar -3  1.50|7   |  4|ab|12345678|9 x 100%\n"
+        "[      0][E][object] plain\n");
+    remove(TEST_LOG_FILE);
+}
+
+void test_log_levels(void) {
+    char buf[1024];
+    CU_ASSERT(log_init(TEST_LOG_FILE) == 0);
+    log_set_level(LOG_ERROR);
+    CU_ASSERT(log_set_module_level("har", LOG_DEBUG) == 0);
+    log_print(LOG_INFO, "src/game/protos/object.c", NULL, "dropped");
+    log_print(LOG_DEBUG, "src/game/objects/har.c", NULL, "kept %d", 1);
+    log_print(LOG_ERROR, "src/game/protos/object.c", NULL, "kept %d", 2);
+    CU_ASSERT(log_set_module_level("har", -1) == 0);
+    log_print(LOG_DEBUG, "src/game/objects/har.c", NULL, "dropped");
+    log_set_level(LOG_DEBUG);
+    log_close();
+
+    read_log(buf, sizeof(buf));
+    CU_ASSERT_STRING_EQUAL(buf,
+        "[      0][D][har] kept 1\n"
+        "[      0][E][object] kept 2\n");
+    remove(TEST_LOG_FILE);
+}
+
+void test_log_parse_level(void) {
+    CU_ASSERT(log_parse_level("debug") == LOG_DEBUG);
+    CU_ASSERT(log_parse_level("I") == LOG_INFO);
+    CU_ASSERT(log_parse_level("e") == LOG_ERROR);
+    CU_ASSERT(log_parse_level("off") == LOG_OFF);
+    CU_ASSERT(log_parse_level("loud") == -1);
+}
+
+void log_test_suite(CU_pSuite suite) {
+    // Add tests
+    if(CU_add_test(suite, "Test for log formatting", test_log_format) == NULL) { return; }
+    if(CU_add_test(suite, "Test for log levels", test_log_levels) == NULL) { return; }
+    if(CU_add_test(suite, "Test for log level names", test_log_parse_level) == NULL) { return; }
+}
@@ -6,7 +6,16 @@ void hashmap_test_suite(CU_pSuite suite);
 void vector_test_suite(CU_pSuite suite);
 void list_test_suite(CU_pSuite suite);
 void array_test_suite(CU_pSuite suite);
+void pool_test_suite(CU_pSuite suite);
+void frame_alloc_test_suite(CU_pSuite suite);
+void histogram_test_suite(CU_pSuite suite);
+void triple_buffer_test_suite(CU_pSuite suite);
 void text_render_test_suite(CU_pSuite suite);
+void log_test_suite(CU_pSuite suite);
+void metrics_test_suite(CU_pSuite suite);
+void memtrack_test_suite(CU_pSuite suite);
+void task_test_suite(CU_pSuite suite);
+void profiler_test_suite(CU_pSuite suite);
 
 int main(int argc, char **argv) {
     if(CU_initialize_registry() != CUE_SUCCESS) {
@@ -34,10 +43,46 @@ int main(int argc, char **argv) {
     if(array_suite == NULL) goto end;
     array_test_suite(array_suite);
 
+    CU_pSuite pool_suite = CU_add_suite("Pool", NULL, NULL);
+    if(pool_suite == NULL) goto end;
+    pool_test_suite(pool_suite);
+
+    CU_pSuite frame_alloc_suite = CU_add_suite("Frame allocator", NULL, NULL);
+    if(frame_alloc_suite == NULL) goto end;
+    frame_alloc_test_suite(frame_alloc_suite);
+
+    CU_pSuite histogram_suite = CU_add_suite("Histogram", NULL, NULL);
+    if(histogram_suite == NULL) goto end;
+    histogram_test_suite(histogram_suite);
+
+    CU_pSuite triple_buffer_suite = CU_add_suite("Triple buffer", NULL, NULL);
+    if(triple_buffer_suite == NULL) goto end;
+    triple_buffer_test_suite(triple_buffer_suite);
+
     CU_pSuite text_render_suite = CU_add_suite("Text Renderer", NULL, NULL);
     if(text_render_suite == NULL) goto end;
     text_render_test_suite(text_render_suite);
 
+    CU_pSuite log_suite = CU_add_suite("Log", NULL, NULL);
+    if(log_suite == NULL) goto end;
+    log_test_suite(log_suite);
+
+    CU_pSuite metrics_suite = CU_add_suite("Metrics", NULL, NULL);
+    if(metrics_suite == NULL) goto end;
+    metrics_test_suite(metrics_suite);
+
+    CU_pSuite memtrack_suite = CU_add_suite("Memtrack", NULL, NULL);
+    if(memtrack_suite == NULL) goto end;
+    memtrack_test_suite(memtrack_suite);
+
+    CU_pSuite task_suite = CU_add_suite("Task", NULL, NULL);
+    if(task_suite == NULL) goto end;
+    task_test_suite(task_suite);
+
+    CU_pSuite profiler_suite = CU_add_suite("Profiler", NULL, NULL);
+    if(profiler_suite == NULL) goto end;
+    profiler_test_suite(profiler_suite);
+
     // Run tests
     CU_basic_set_mode(CU_BRM_VERBOSE);
     CU_basic_run_tests();
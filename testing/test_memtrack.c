@@ -0,0 +1,68 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <string.h>
+#include <utils/memtrack.h>
+#include <utils/vector.h>
+
+void test_memtrack_alloc(void) {
+    memtrack_stats before, after;
+    memtrack_get_stats(MEM_OBJECTS, &before);
+    char *ptr = memtrack_malloc(MEM_OBJECTS, 100);
+    CU_ASSERT_FATAL(ptr != NULL);
+    memset(ptr, 0xAB, 100);
+    ptr = memtrack_realloc(MEM_OBJECTS, ptr, 300);
+    CU_ASSERT_FATAL(ptr != NULL);
+    CU_ASSERT((unsigned char)ptr[99] == 0xAB);
+    memtrack_get_stats(MEM_OBJECTS, &after);
+    if(memtrack_enabled()) {
+        CU_ASSERT(after.bytes - before.bytes == 300);
+        CU_ASSERT(after.live - before.live == 1);
+        CU_ASSERT(after.peak >= before.bytes + 300);
+    }
+    memtrack_free(ptr);
+    memtrack_get_stats(MEM_OBJECTS, &after);
+    CU_ASSERT(after.bytes == before.bytes);
+    CU_ASSERT(after.live == before.live);
+}
+
+void test_memtrack_move(void) {
+    memtrack_stats surfaces, sprites;
+    memtrack_add(MEM_SURFACES, 64);
+    memtrack_move(MEM_SURFACES, MEM_BK_SPRITES, 64);
+    memtrack_get_stats(MEM_SURFACES, &surfaces);
+    memtrack_get_stats(MEM_BK_SPRITES, &sprites);
+    if(memtrack_enabled()) {
+        CU_ASSERT(sprites.bytes == 64);
+        CU_ASSERT(sprites.live == 1);
+    }
+    memtrack_sub(MEM_BK_SPRITES, 64);
+    memtrack_get_stats(MEM_BK_SPRITES, &sprites);
+    CU_ASSERT(sprites.bytes == 0);
+    CU_ASSERT(sprites.live == 0);
+    CU_ASSERT(surfaces.bytes == 0);
+}
+
+void test_memtrack_containers(void) {
+    vector vec;
+    memtrack_stats before, during, after;
+    memtrack_get_stats(MEM_CONTAINERS, &before);
+    vector_create(&vec, sizeof(int));
+    for(int i = 0; i < 100; i++) {
+        vector_append(&vec, &i);
+    }
+    memtrack_get_stats(MEM_CONTAINERS, &during);
+    vector_free(&vec);
+    memtrack_get_stats(MEM_CONTAINERS, &after);
+    if(memtrack_enabled()) {
+        CU_ASSERT(during.bytes - before.bytes >= 100 * sizeof(int));
+    }
+    CU_ASSERT(after.bytes == before.bytes);
+    CU_ASSERT(after.live == before.live);
+}
+
+void memtrack_test_suite(CU_pSuite suite) {
+    // Add tests
+    if(CU_add_test(suite, "Test for memtrack alloc and free", test_memtrack_alloc) == NULL) { return; }
+    if(CU_add_test(suite, "Test for memtrack move", test_memtrack_move) == NULL) { return; }
+    if(CU_add_test(suite, "Test for memtrack container allocator", test_memtrack_containers) == NULL) { return; }
+}
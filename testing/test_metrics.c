@@ -0,0 +1,62 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <string.h>
+#include <utils/metrics.h>
+
+void test_metrics_counters(void) {
+    metrics_reset();
+    metrics_add(METRIC_TICKS, 1);
+    metrics_add(METRIC_TICKS, 2);
+    metrics_set(METRIC_OBJECTS, 7);
+    metrics_set(METRIC_OBJECTS, 5);
+    metrics_set_slot(METRIC_PEER_RTT, 1, 12);
+    metrics_set_slot(METRIC_PEER_RTT, 2, 99);
+    CU_ASSERT(metrics_get(METRIC_TICKS, 0) == 3);
+    CU_ASSERT(metrics_get(METRIC_OBJECTS, 0) == 5);
+    CU_ASSERT(metrics_get(METRIC_PEER_RTT, 0) == 0);
+    CU_ASSERT(metrics_get(METRIC_PEER_RTT, 1) == 12);
+}
+
+void test_metrics_histogram(void) {
+    metrics_reset();
+    for(int i = 0; i < 90; i++) {
+        metrics_observe(METRIC_TICK_TIME, 0.2f);
+    }
+    for(int i = 0; i < 9; i++) {
+        metrics_observe(METRIC_TICK_TIME, 3.0f);
+    }
+    metrics_observe(METRIC_TICK_TIME, 100.0f);
+    CU_ASSERT(metrics_count(METRIC_TICK_TIME) == 100);
+    CU_ASSERT_DOUBLE_EQUAL(metrics_percentile(METRIC_TICK_TIME, 0.5f), 0.25f, 0.0001f);
+    CU_ASSERT_DOUBLE_EQUAL(metrics_percentile(METRIC_TICK_TIME, 0.95f), 4.0f, 0.0001f);
+    CU_ASSERT_DOUBLE_EQUAL(metrics_percentile(METRIC_TICK_TIME, 0.999f), 16.0f, 0.0001f);
+}
+
+void test_metrics_format(void) {
+    char buf[16384];
+    metrics_reset();
+    metrics_add(METRIC_TICKS, 42);
+    metrics_set_slot(METRIC_PEER_RTT, 0, 3);
+    metrics_observe(METRIC_TICK_TIME, 0.5f);
+    metrics_observe(METRIC_TICK_TIME, 20.0f);
+    CU_ASSERT(metrics_format(buf, sizeof(buf)) == strlen(buf));
+    CU_ASSERT(strstr(buf, "# TYPE openomf_ticks_total counter\nopenomf_ticks_total 42\n") != NULL);
+    CU_ASSERT(strstr(buf, "openomf_peer_rtt_ticks{peer=\"0\"} 3\n") != NULL);
+    CU_ASSERT(strstr(buf, "openomf_tick_time_ms_bucket{le=\"0.25\"} 0\n") != NULL);
+    CU_ASSERT(strstr(buf, "openomf_tick_time_ms_bucket{le=\"0.5\"} 1\n") != NULL);
+    CU_ASSERT(strstr(buf, "openomf_tick_time_ms_bucket{le=\"+Inf\"} 2\n") != NULL);
+    CU_ASSERT(strstr(buf, "openomf_tick_time_ms_sum 20.500000\n") != NULL);
+    CU_ASSERT(strstr(buf, "openomf_tick_time_ms_count 2\n") != NULL);
+
+    // Output is cut short rather than overflowing
+    CU_ASSERT(metrics_format(buf, 64) == 63);
+    CU_ASSERT(strlen(buf) == 63);
+    metrics_reset();
+}
+
+void metrics_test_suite(CU_pSuite suite) {
+    // Add tests
+    if(CU_add_test(suite, "Test for metrics counters and gauges", test_metrics_counters) == NULL) { return; }
+    if(CU_add_test(suite, "Test for metrics histograms", test_metrics_histogram) == NULL) { return; }
+    if(CU_add_test(suite, "Test for metrics format", test_metrics_format) == NULL) { return; }
+}
@@ -0,0 +1,84 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <utils/pool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define TEST_POOL_SIZE 4
+#define TEST_ITEM_SIZE 40
+
+pool test_pool;
+
+void test_pool_create(void) {
+    CU_ASSERT_FATAL(pool_create(&test_pool, TEST_ITEM_SIZE, TEST_POOL_SIZE) == 0);
+    CU_ASSERT(test_pool.capacity == TEST_POOL_SIZE);
+    CU_ASSERT(test_pool.slot_size == POOL_ALIGN);
+    CU_ASSERT(pool_size(&test_pool) == 0);
+    CU_ASSERT(pool_create(&test_pool, TEST_ITEM_SIZE, 0) == 1);
+}
+
+void test_pool_alloc(void) {
+    void *items[TEST_POOL_SIZE];
+    for(int i = 0; i < TEST_POOL_SIZE; i++) {
+        items[i] = pool_alloc(&test_pool, NULL);
+        CU_ASSERT_FATAL(items[i] != NULL);
+        CU_ASSERT(((uintptr_t)items[i] % POOL_ALIGN) == 0);
+        CU_ASSERT(pool_owns(&test_pool, items[i]));
+    }
+    CU_ASSERT(pool_size(&test_pool) == TEST_POOL_SIZE);
+    CU_ASSERT(pool_alloc(&test_pool, NULL) == NULL);
+
+    // Released slot should be the next one handed out
+    pool_release(&test_pool, items[2]);
+    CU_ASSERT(pool_size(&test_pool) == TEST_POOL_SIZE - 1);
+    CU_ASSERT(pool_alloc(&test_pool, NULL) == items[2]);
+
+    for(int i = 0; i < TEST_POOL_SIZE; i++) {
+        pool_release(&test_pool, items[i]);
+    }
+    CU_ASSERT(pool_size(&test_pool) == 0);
+}
+
+void test_pool_owns(void) {
+    int local = 0;
+    void *heap = malloc(TEST_ITEM_SIZE);
+    CU_ASSERT(pool_owns(&test_pool, &local) == 0);
+    CU_ASSERT(pool_owns(&test_pool, heap) == 0);
+    free(heap);
+}
+
+void test_pool_handle(void) {
+    pool_handle handle;
+    void *item = pool_alloc(&test_pool, &handle);
+    CU_ASSERT_FATAL(item != NULL);
+    CU_ASSERT(handle != POOL_INVALID_HANDLE);
+    CU_ASSERT(pool_get(&test_pool, handle) == item);
+    CU_ASSERT(pool_get_handle(&test_pool, item) == handle);
+
+    // Stale handle must not resolve, even if the slot gets reused
+    pool_release(&test_pool, item);
+    CU_ASSERT(pool_get(&test_pool, handle) == NULL);
+    pool_handle handle2;
+    void *item2 = pool_alloc(&test_pool, &handle2);
+    CU_ASSERT(item2 == item);
+    CU_ASSERT(handle2 != handle);
+    CU_ASSERT(pool_get(&test_pool, handle) == NULL);
+    CU_ASSERT(pool_get(&test_pool, handle2) == item2);
+    CU_ASSERT(pool_get(&test_pool, POOL_INVALID_HANDLE) == NULL);
+    pool_release(&test_pool, item2);
+}
+
+void test_pool_free(void) {
+    pool_free(&test_pool);
+    CU_ASSERT(test_pool.data == NULL);
+    CU_ASSERT(pool_size(&test_pool) == 0);
+}
+
+void pool_test_suite(CU_pSuite suite) {
+    // Add tests
+    if(CU_add_test(suite, "Test for pool create", test_pool_create) == NULL) { return; }
+    if(CU_add_test(suite, "Test for pool alloc", test_pool_alloc) == NULL) { return; }
+    if(CU_add_test(suite, "Test for pool owns", test_pool_owns) == NULL) { return; }
+    if(CU_add_test(suite, "Test for pool handles", test_pool_handle) == NULL) { return; }
+    if(CU_add_test(suite, "Test for pool free", test_pool_free) == NULL) { return; }
+}
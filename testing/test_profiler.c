@@ -0,0 +1,121 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <utils/profiler.h>
+#include <utils/task.h>
+
+#define TEST_TRACE_FILE "test_profiler_trace.json"
+#define TEST_THREADS 4
+
+// Number of events in a written trace
+static int test_profiler_trace_events() {
+    if(profiler_write_trace(TEST_TRACE_FILE)) {
+        return -1;
+    }
+    FILE *f = fopen(TEST_TRACE_FILE, "r");
+    if(f == NULL) {
+        return -1;
+    }
+    int events = 0;
+    char line[256];
+    while(fgets(line, sizeof(line), f) != NULL) {
+        if(strstr(line, "\"ph\":\"X\"") != NULL) {
+            events++;
+        }
+    }
+    fclose(f);
+    remove(TEST_TRACE_FILE);
+    return events;
+}
+
+static void test_profiler_zone() {
+    PROFILE_BEGIN(PROFILE_AUDIO);
+    PROFILE_END(PROFILE_AUDIO);
+}
+
+void test_profiler_ring_wrap(void) {
+    profiler_init();
+    profiler_set_enabled(1);
+    for(int i = 0; i < 100; i++) {
+        test_profiler_zone();
+    }
+    CU_ASSERT(test_profiler_trace_events() == 100);
+
+    // Only the newest events are kept
+    for(int i = 0; i < PROFILER_RING_SIZE; i++) {
+        test_profiler_zone();
+    }
+    CU_ASSERT(test_profiler_trace_events() == PROFILER_RING_SIZE);
+    CU_ASSERT(profiler_thread_count() == 1);
+    profiler_close();
+}
+
+static atomic_int registered;
+static atomic_int release;
+
+static int test_profiler_worker(void *userdata) {
+    test_profiler_zone();
+    atomic_fetch_add(&registered, 1);
+    while(!atomic_load(&release)) {
+        SDL_Delay(1);
+    }
+    profiler_thread_exit();
+    return 0;
+}
+
+void test_profiler_threads(void) {
+    task workers[TEST_THREADS];
+    profiler_init();
+    profiler_set_enabled(1);
+    atomic_store(&registered, 0);
+    atomic_store(&release, 0);
+    for(int i = 0; i < TEST_THREADS; i++) {
+        task_start(&workers[i], "profiler", test_profiler_worker, NULL);
+    }
+    while(atomic_load(&registered) < TEST_THREADS) {
+        SDL_Delay(1);
+    }
+    CU_ASSERT(profiler_thread_count() == TEST_THREADS);
+    CU_ASSERT(test_profiler_trace_events() == TEST_THREADS);
+
+    atomic_store(&release, 1);
+    for(int i = 0; i < TEST_THREADS; i++) {
+        task_wait(&workers[i]);
+        task_free(&workers[i]);
+    }
+    CU_ASSERT(profiler_thread_count() == 0);
+    profiler_close();
+}
+
+// Returns 0 if the thread got a ring of its own
+static int test_profiler_short_worker(void *userdata) {
+    test_profiler_zone();
+    int ret = (profiler_thread_count() == 1) ? 0 : 1;
+    profiler_thread_exit();
+    return ret;
+}
+
+void test_profiler_slot_reuse(void) {
+    profiler_init();
+    profiler_set_enabled(1);
+    for(int i = 0; i < PROFILER_MAX_THREADS * 2; i++) {
+        task t;
+        task_start(&t, "profiler", test_profiler_short_worker, NULL);
+        CU_ASSERT(task_wait(&t) == 0);
+        task_free(&t);
+    }
+    CU_ASSERT(profiler_thread_count() == 0);
+
+    // Each thread took over the same ring, so only the last event is left
+    CU_ASSERT(test_profiler_trace_events() == 1);
+    profiler_close();
+}
+
+void profiler_test_suite(CU_pSuite suite) {
+    // Add tests
+    if(CU_add_test(suite, "Test for profiler ring wrap", test_profiler_ring_wrap) == NULL) { return; }
+    if(CU_add_test(suite, "Test for profiler with many threads", test_profiler_threads) == NULL) { return; }
+    if(CU_add_test(suite, "Test for profiler ring reuse", test_profiler_slot_reuse) == NULL) { return; }
+}
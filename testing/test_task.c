@@ -0,0 +1,50 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <utils/task.h>
+
+static int test_task_job(void *userdata) {
+    int *value = userdata;
+    SDL_Delay(5);
+    *value = 42;
+    return 3;
+}
+
+void test_task_wait(void) {
+    task t;
+    int value = 0;
+    task_start(&t, "test", test_task_job, &value);
+    CU_ASSERT(task_wait(&t) == 3);
+    CU_ASSERT(task_is_done(&t));
+    CU_ASSERT(value == 42);
+
+    // Result stays available
+    CU_ASSERT(task_wait(&t) == 3);
+    task_free(&t);
+    task_free(&t);
+}
+
+static int test_task_waiter(void *userdata) {
+    return task_wait(userdata);
+}
+
+void test_task_many_waiters(void) {
+    task t;
+    task waiters[4];
+    int value = 0;
+    task_start(&t, "test", test_task_job, &value);
+    for(int i = 0; i < 4; i++) {
+        task_start(&waiters[i], "waiter", test_task_waiter, &t);
+    }
+    for(int i = 0; i < 4; i++) {
+        CU_ASSERT(task_wait(&waiters[i]) == 3);
+        task_free(&waiters[i]);
+    }
+    CU_ASSERT(value == 42);
+    task_free(&t);
+}
+
+void task_test_suite(CU_pSuite suite) {
+    // Add tests
+    if(CU_add_test(suite, "Test for task wait", test_task_wait) == NULL) { return; }
+    if(CU_add_test(suite, "Test for task with many waiters", test_task_many_waiters) == NULL) { return; }
+}
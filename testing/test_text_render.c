@@ -17,8 +17,52 @@ void test_text_find_line_count(void) {
     CU_ASSERT(text_find_line_count(TEXT_HORIZONTAL, 5, 5, 11, "AAA AAA AAA") == 3);
 }
 
+void test_text_layout_positions(void) {
+    text_settings settings;
+    text_layout layout;
+    text_defaults(&settings);
+    settings.font = FONT_BIG;
+    text_layout_create(&layout);
+
+    // Two lines of 8px characters, the second one centered
+    settings.halign = TEXT_CENTER;
+    CU_ASSERT(text_layout_update(&layout, &settings, 40, 16, "AAAA BB") == 1);
+    CU_ASSERT(layout.glyph_count == 6);
+    CU_ASSERT(layout.glyphs[0].x == 4 && layout.glyphs[0].y == 0);
+    CU_ASSERT(layout.glyphs[4].ch == 'B');
+    CU_ASSERT(layout.glyphs[4].x == 12 && layout.glyphs[4].y == 8);
+    text_layout_free(&layout);
+}
+
+void test_text_layout_cache(void) {
+    text_settings settings;
+    text_layout layout;
+    text_defaults(&settings);
+    text_layout_create(&layout);
+
+    CU_ASSERT(text_layout_update(&layout, &settings, 100, 10, "HELLO") == 1);
+    CU_ASSERT(text_layout_update(&layout, &settings, 100, 10, "HELLO") == 0);
+
+    // Color does not move anything around
+    settings.cforeground = color_create(1, 2, 3, 255);
+    CU_ASSERT(text_layout_update(&layout, &settings, 100, 10, "HELLO") == 0);
+
+    // Text, box and alignment do
+    CU_ASSERT(text_layout_update(&layout, &settings, 100, 10, "HELLO!") == 1);
+    CU_ASSERT(layout.glyph_count == 6);
+    CU_ASSERT(text_layout_update(&layout, &settings, 90, 10, "HELLO!") == 1);
+    settings.halign = TEXT_RIGHT;
+    CU_ASSERT(text_layout_update(&layout, &settings, 90, 10, "HELLO!") == 1);
+    CU_ASSERT(layout.glyphs[5].x == 90 - 8);
+    CU_ASSERT(text_layout_update(&layout, &settings, 90, 10, "") == 1);
+    CU_ASSERT(layout.glyph_count == 0);
+    text_layout_free(&layout);
+}
+
 void text_render_test_suite(CU_pSuite suite) {
     // Add tests
     if(CU_add_test(suite, "Test for text_find_max_strlen", test_text_find_max_strlen) == NULL) { return; }
     if(CU_add_test(suite, "Test for text_find_line_count", test_text_find_line_count) == NULL) { return; }
+    if(CU_add_test(suite, "Test for text layout positions", test_text_layout_positions) == NULL) { return; }
+    if(CU_add_test(suite, "Test for text layout caching", test_text_layout_cache) == NULL) { return; }
 }
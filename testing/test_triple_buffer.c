@@ -0,0 +1,52 @@
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <utils/triple_buffer.h>
+
+void test_triple_buffer_publish(void) {
+    triple_buffer tb;
+    int fresh;
+    CU_ASSERT(triple_buffer_create(&tb, sizeof(int)) == 0);
+
+    // Nothing published yet
+    triple_buffer_read_ptr(&tb, &fresh);
+    CU_ASSERT(fresh == 0);
+
+    *(int*)triple_buffer_write_ptr(&tb) = 1;
+    triple_buffer_publish(&tb);
+    int *r = triple_buffer_read_ptr(&tb, &fresh);
+    CU_ASSERT(fresh == 1);
+    CU_ASSERT(*r == 1);
+
+    // Same buffer again until something new is published
+    r = triple_buffer_read_ptr(&tb, &fresh);
+    CU_ASSERT(fresh == 0);
+    CU_ASSERT(*r == 1);
+    triple_buffer_free(&tb);
+}
+
+void test_triple_buffer_latest(void) {
+    triple_buffer tb;
+    int fresh;
+    triple_buffer_create(&tb, sizeof(int));
+
+    // Consumer only sees the newest of several publishes
+    for(int i = 1; i <= 5; i++) {
+        *(int*)triple_buffer_write_ptr(&tb) = i;
+        triple_buffer_publish(&tb);
+    }
+    int *r = triple_buffer_read_ptr(&tb, &fresh);
+    CU_ASSERT(fresh == 1);
+    CU_ASSERT(*r == 5);
+
+    // Writing does not touch the buffer being read
+    *(int*)triple_buffer_write_ptr(&tb) = 6;
+    CU_ASSERT(*r == 5);
+    CU_ASSERT(triple_buffer_write_ptr(&tb) != (void*)r);
+    triple_buffer_free(&tb);
+}
+
+void triple_buffer_test_suite(CU_pSuite suite) {
+    // Add tests
+    if(CU_add_test(suite, "Test for triple buffer publish", test_triple_buffer_publish) == NULL) { return; }
+    if(CU_add_test(suite, "Test for triple buffer latest", test_triple_buffer_latest) == NULL) { return; }
+}
@@ -2,8 +2,11 @@
 #include <CUnit/Basic.h>
 #include <utils/vector.h>
 #include <utils/iterator.h>
+#include <stdio.h>
+#include <time.h>
 
 #define TEST_VAL_COUNT 1000
+#define BENCH_COUNT 50000
 
 vector test_vector;
 unsigned int test_values[TEST_VAL_COUNT];
@@ -79,6 +82,143 @@ void test_vector_delete(void) {
     CU_ASSERT_PTR_NULL(iter_next(&it));
 }
 
+static void fill_vector(vector *vec, int count) {
+    vector_clear(vec);
+    for(int i = 0; i < count; i++) {
+        vector_append(vec, &i);
+    }
+}
+
+void test_vector_swapdelete(void) {
+    vector vec;
+    iterator it;
+    int *val;
+    int seen[TEST_VAL_COUNT] = {0};
+    vector_create(&vec, sizeof(int));
+    fill_vector(&vec, TEST_VAL_COUNT);
+
+    // Delete all odd values; every value should still be visited exactly once
+    vector_iter_begin(&vec, &it);
+    while((val = iter_next(&it)) != NULL) {
+        seen[*val]++;
+        if(*val % 2) {
+            CU_ASSERT(vector_swapdelete(&vec, &it) == 0);
+        }
+    }
+    CU_ASSERT(vector_size(&vec) == TEST_VAL_COUNT / 2);
+    for(int i = 0; i < TEST_VAL_COUNT; i++) {
+        CU_ASSERT(seen[i] == 1);
+    }
+    vector_iter_begin(&vec, &it);
+    while((val = iter_next(&it)) != NULL) {
+        CU_ASSERT(*val % 2 == 0);
+    }
+
+    // Backwards
+    fill_vector(&vec, TEST_VAL_COUNT);
+    vector_iter_end(&vec, &it);
+    while((val = iter_prev(&it)) != NULL) {
+        if(*val % 2) {
+            CU_ASSERT(vector_swapdelete(&vec, &it) == 0);
+        }
+    }
+    CU_ASSERT(vector_size(&vec) == TEST_VAL_COUNT / 2);
+    vector_free(&vec);
+}
+
+void test_vector_compact(void) {
+    vector vec;
+    iterator it;
+    int *val;
+    vector_create(&vec, sizeof(int));
+    fill_vector(&vec, TEST_VAL_COUNT);
+
+    // Marked entries stay around until compacted
+    vector_iter_begin(&vec, &it);
+    while((val = iter_next(&it)) != NULL) {
+        if(*val % 3 == 0) {
+            CU_ASSERT(vector_mark_delete(&vec, &it) == 0);
+        }
+    }
+    CU_ASSERT(vector_size(&vec) == TEST_VAL_COUNT);
+    vector_compact(&vec);
+    CU_ASSERT(vector_size(&vec) == TEST_VAL_COUNT - (TEST_VAL_COUNT + 2) / 3);
+
+    // Order must be kept
+    int prev = -1;
+    vector_iter_begin(&vec, &it);
+    while((val = iter_next(&it)) != NULL) {
+        CU_ASSERT(*val % 3 != 0);
+        CU_ASSERT(*val > prev);
+        prev = *val;
+    }
+
+    // Marks must survive appends and regular deletes
+    vector_iter_begin(&vec, &it);
+    val = iter_next(&it);
+    CU_ASSERT(vector_mark_delete(&vec, &it) == 0);
+    for(int i = 0; i < TEST_VAL_COUNT; i++) {
+        vector_append(&vec, &i);
+    }
+    val = iter_next(&it);
+    CU_ASSERT(vector_delete(&vec, &it) == 0);
+    vector_compact(&vec);
+    CU_ASSERT(vector_size(&vec) == 2 * TEST_VAL_COUNT - (TEST_VAL_COUNT + 2) / 3 - 2);
+    CU_ASSERT(*(int*)vector_get(&vec, 0) == 4);
+    vector_free(&vec);
+}
+
+static double bench_ms(clock_t start, clock_t end) {
+    return (double)(end - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+void test_vector_benchmark(void) {
+    vector vec;
+    iterator it;
+    int *val;
+    clock_t t[4];
+    vector_create(&vec, sizeof(int));
+
+    // Delete every other entry with each method
+    fill_vector(&vec, BENCH_COUNT);
+    t[0] = clock();
+    vector_iter_begin(&vec, &it);
+    while((val = iter_next(&it)) != NULL) {
+        if(*val % 2) {
+            vector_delete(&vec, &it);
+        }
+    }
+    t[1] = clock();
+    CU_ASSERT(vector_size(&vec) == BENCH_COUNT / 2);
+
+    fill_vector(&vec, BENCH_COUNT);
+    t[2] = clock();
+    vector_iter_begin(&vec, &it);
+    while((val = iter_next(&it)) != NULL) {
+        if(*val % 2) {
+            vector_swapdelete(&vec, &it);
+        }
+    }
+    t[3] = clock();
+    CU_ASSERT(vector_size(&vec) == BENCH_COUNT / 2);
+
+    fill_vector(&vec, BENCH_COUNT);
+    clock_t c0 = clock();
+    vector_iter_begin(&vec, &it);
+    while((val = iter_next(&it)) != NULL) {
+        if(*val % 2) {
+            vector_mark_delete(&vec, &it);
+        }
+    }
+    vector_compact(&vec);
+    clock_t c1 = clock();
+    CU_ASSERT(vector_size(&vec) == BENCH_COUNT / 2);
+    vector_free(&vec);
+
+    printf("\n    %d deletes: delete %.2f ms, swapdelete %.2f ms, mark + compact %.2f ms\n    ",
+        BENCH_COUNT / 2, bench_ms(t[0], t[1]), bench_ms(t[2], t[3]), bench_ms(c0, c1));
+}
+
 void vector_test_suite(CU_pSuite suite) {
     // Add tests
     if(CU_add_test(suite, "Test for vector create", test_vector_create) == NULL) { return; }
@@ -88,4 +228,7 @@ void vector_test_suite(CU_pSuite suite) {
     if(CU_add_test(suite, "Test for vector iterator", test_vector_iterator) == NULL) { return; }
     if(CU_add_test(suite, "Test for vector delete", test_vector_delete) == NULL) { return; }
     if(CU_add_test(suite, "Test for vector free operation", test_vector_free) == NULL) { return; }
+    if(CU_add_test(suite, "Test for vector swapdelete", test_vector_swapdelete) == NULL) { return; }
+    if(CU_add_test(suite, "Test for vector mark delete and compact", test_vector_compact) == NULL) { return; }
+    if(CU_add_test(suite, "Vector delete benchmark", test_vector_benchmark) == NULL) { return; }
 }